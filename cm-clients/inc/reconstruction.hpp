@@ -18,6 +18,8 @@ std::istream& operator>>(std::istream& in, InputType& input_type);
 
 std::istream& operator>>(std::istream& in, cm::NIPP& nipp_value);
 
+std::istream& operator>>(std::istream& in, cm::CellOrder& cell_order);
+
 struct options_type {
   TractionType  traction_type;
   InputType     input_type;
@@ -27,6 +29,25 @@ struct options_type {
   bool nonnegative_tractions;
   double reconstructed_pitch;
   std::string input;
+  size_t num_threads;
+  double surrogate_sampled_tol;
+  bool convolution;
+  double cutoff_radius;
+  bool single_precision;
+  bool quantized;
+  double tikhonov;
+  bool truncated_svd;
+  size_t svd_rank;
+  bool iterative;
+  size_t max_iterations;
+  bool multigrid;
+  bool coarse_to_fine;
+  size_t coarse_factor;
+  std::string regions;
+  double region_overlap;
+  bool fista;
+  size_t fista_iterations;
+  cm::CellOrder cell_order;
 };
 
 struct suite_type {
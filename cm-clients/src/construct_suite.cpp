@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <vector>
 
 #include "reconstruction.hpp"
 
@@ -38,37 +39,113 @@ suite_type construct_suite(const options_type& opts)
     ret.reconstructed_grid.reset(cm::Grid::fromFill(1, cm::Square(opts.reconstructed_pitch), *(ret.raw_grid)));
   }
 
+  // before any offline phase: the precomputed data refers to the cells by their positions
+  for (cm::Grid* g : {ret.raw_grid.get(), ret.interp_grid.get(), ret.tractions_grid.get(),
+    ret.reconstructed_grid.get()}) {
+    if (g) {
+      g->reorderCells(opts.cell_order);
+    }
+  }
+
+
+  std::vector<std::vector<cm::GridCell>> regions;
+  if (!opts.regions.empty()) {
+    regions = cm::SkinRegions::fromCache(opts.regions).positions(*ret.raw_grid);
+  }
 
   if (opts.traction_type == TractionType::pressures) {
     ret.to_reconstructed.reset(new cm::AlgPressuresToDisplacements());
     auto tmp = cm::AlgPressuresToDisplacements::params_type();
     tmp.skin_props = ret.skin_provider->getAttributes();
+    tmp.num_threads = opts.num_threads;
+    tmp.surrogate_sampled_tol = opts.surrogate_sampled_tol;
+    tmp.convolution = opts.convolution;
+    tmp.cutoff_radius = opts.cutoff_radius;
+    tmp.single_precision = opts.single_precision;
     ret.to_reconstructed_params = tmp;
     if (opts.nonnegative_tractions) {
       ret.to_tractions.reset(new cm::AlgDisplacementsToNonnegativePressures());
       auto tmp = cm::AlgDisplacementsToNonnegativePressures::params_type();
       tmp.skin_props = ret.skin_provider->getAttributes();
+      tmp.num_threads = opts.num_threads;
+      tmp.surrogate_sampled_tol = opts.surrogate_sampled_tol;
+      tmp.cutoff_radius = opts.cutoff_radius;
+      tmp.fista = opts.fista;
+      tmp.max_iterations = opts.fista_iterations;
       ret.to_tractions_params = tmp;
     } else {
       ret.to_tractions.reset(new cm::AlgDisplacementsToPressures());
       auto tmp = cm::AlgDisplacementsToPressures::params_type();
       tmp.skin_props = ret.skin_provider->getAttributes();
+      tmp.num_threads = opts.num_threads;
+      tmp.surrogate_sampled_tol = opts.surrogate_sampled_tol;
+      // single_precision is for the dense matrices: here, only a plain (or Tikhonov) inverse's
+      tmp.single_precision = opts.single_precision && !opts.quantized && !opts.truncated_svd
+        && !opts.iterative && !opts.coarse_to_fine;
+      tmp.quantized = opts.quantized;
+      if (opts.tikhonov > 0) {
+        // iterative only regularises through the multigrid
+        tmp.tikhonov = !opts.iterative;
+        tmp.regularisation = opts.tikhonov;
+      }
+      tmp.truncated_svd = opts.truncated_svd;
+      tmp.svd_rank = opts.svd_rank;
+      tmp.iterative = opts.iterative;
+      tmp.max_iterations = opts.max_iterations;
+      tmp.multigrid = opts.multigrid;
+      tmp.coarse_to_fine = opts.coarse_to_fine;
+      tmp.coarse_factor = opts.coarse_factor;
+      tmp.regions = regions;
+      tmp.region_overlap = opts.region_overlap;
+      if (opts.iterative) {
+        tmp.cutoff_radius = opts.cutoff_radius;
+      }
       ret.to_tractions_params = tmp;
     }
   } else if (opts.traction_type == TractionType::forces) {
     ret.to_reconstructed.reset(new cm::AlgForcesToDisplacements());
     auto tmp = cm::AlgForcesToDisplacements::params_type();
     tmp.skin_props = ret.skin_provider->getAttributes();
+    tmp.num_threads = opts.num_threads;
+    tmp.convolution = opts.convolution;
+    tmp.cutoff_radius = opts.cutoff_radius;
+    tmp.single_precision = opts.single_precision;
     ret.to_reconstructed_params = tmp;
     if (opts.nonnegative_tractions) {
       ret.to_tractions.reset(new cm::AlgDisplacementsToNonnegativeNormalForces());
       auto tmp = cm::AlgDisplacementsToNonnegativeNormalForces::params_type();
       tmp.skin_props = ret.skin_provider->getAttributes();
+      tmp.num_threads = opts.num_threads;
+      tmp.cutoff_radius = opts.cutoff_radius;
+      tmp.fista = opts.fista;
+      tmp.max_iterations = opts.fista_iterations;
       ret.to_tractions_params = tmp;
     } else {
       ret.to_tractions.reset(new cm::AlgDisplacementsToForces());
       auto tmp = cm::AlgDisplacementsToForces::params_type();
       tmp.skin_props = ret.skin_provider->getAttributes();
+      tmp.num_threads = opts.num_threads;
+      // single_precision is for the dense matrices: here, only a plain (or Tikhonov) inverse's
+      tmp.single_precision = opts.single_precision && !opts.quantized && !opts.truncated_svd
+        && !opts.iterative && !opts.coarse_to_fine;
+      tmp.quantized = opts.quantized;
+      if (opts.tikhonov > 0) {
+        // iterative only regularises through the multigrid
+        tmp.tikhonov = !opts.iterative;
+        tmp.regularisation = opts.tikhonov;
+      }
+      tmp.truncated_svd = opts.truncated_svd;
+      tmp.svd_rank = opts.svd_rank;
+      tmp.iterative = opts.iterative;
+      tmp.max_iterations = opts.max_iterations;
+      tmp.multigrid = opts.multigrid;
+      tmp.coarse_to_fine = opts.coarse_to_fine;
+      tmp.coarse_factor = opts.coarse_factor;
+      tmp.regions = regions;
+      tmp.region_overlap = opts.region_overlap;
+      if (opts.iterative) {
+        tmp.cutoff_radius = opts.cutoff_radius;
+      }
       ret.to_tractions_params = tmp;
     }
   } else {
@@ -42,3 +42,19 @@ std::istream& operator>>(std::istream& in, cm::NIPP& nipp_value)
   }
   return in;
 }
+
+std::istream& operator>>(std::istream& in, cm::CellOrder& cell_order)
+{
+  std::string token;
+  in >> token;
+  if (token == "original") {
+    cell_order = cm::CellOrder::original;
+  } else if (token == "morton") {
+    cell_order = cm::CellOrder::morton;
+  } else if (token == "hilbert") {
+    cell_order = cm::CellOrder::hilbert;
+  } else {
+    throw boost::program_options::invalid_option_value(token);
+  }
+  return in;
+}
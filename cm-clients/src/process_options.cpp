@@ -45,6 +45,95 @@ options_type process_options(int argc, char** argv)
       "Pitch of the (resulting) displacements grid, i.e. distance between two neighbourint cells in "
       "either x or y direction, in meters. Default: 0.001 [m]. If <= 0, it will be cloned from the "
       "source grid (interpolated or not).")
+    ("threads",
+      po::value<size_t>(&options.num_threads)->default_value(1),
+      "Number of threads to assemble the models' matrices with (offline phase). 0 means one per "
+      "hardware thread. Default: 1.")
+    ("surrogate_sampled_tol",
+      po::value<double>(&options.surrogate_sampled_tol)->default_value(0),
+      "Relative error allowed for interpolating the pressure model's coefficients from a table "
+      "instead of evaluating them (offline phase), checked at samples of the table: not a bound. "
+      "Not with single_precision or quantized. 0 evaluates them all. Default: 0.")
+    ("convolution",
+      po::value<bool>(&options.convolution)->default_value(false, "false"),
+      "Whether to compute the reconstructed displacements by FFT convolution, which takes memory "
+      "linear in the number of cells rather than quadratic. Only used if the tractions and "
+      "displacements grids are regular with the same pitch (e.g. tractions_pitch equal to "
+      "displacements_pitch). Default: false.")
+    ("cutoff_radius",
+      po::value<double>(&options.cutoff_radius)->default_value(0),
+      "If > 0, the models' coefficients between cells further apart than this are dropped and "
+      "the rest is stored sparse, for the non-negative or iterative tractions and the "
+      "reconstructed displacements, in meters. A few skin thicknesses keep the coefficients above the noise. "
+      "Default: 0 (dense).")
+    ("single_precision",
+      po::value<bool>(&options.single_precision)->default_value(false, "false"),
+      "Whether to store the dense matrices of the tractions and the reconstructed displacements "
+      "in single precision: half the memory and memory traffic per frame, for relative errors "
+      "well below the sensors' noise. Default: false.")
+    ("quantized",
+      po::value<bool>(&options.quantized)->default_value(false, "false"),
+      "Whether to store the pseudoinverse of the tractions as 16-bit integers: about a quarter of "
+      "the memory and memory traffic per frame. The error is logged during the offline phase. "
+      "Not for non-negative tractions. Default: false.")
+    ("tikhonov",
+      po::value<double>(&options.tikhonov)->default_value(0),
+      "If > 0, compute the tractions with a Tikhonov-regularised inverse rather than the "
+      "pseudoinverse, with this regularisation parameter relative to the model's largest squared "
+      "singular value: several times cheaper offline, and less sensitive to noise. Not for "
+      "non-negative tractions. Default: 0 (pseudoinverse).")
+    ("truncated_svd",
+      po::value<bool>(&options.truncated_svd)->default_value(false, "false"),
+      "Whether to keep the singular value decomposition of the model and compute the tractions "
+      "through it (filtered as by tikhonov, if given): O(k (m+n)) per frame for k singular "
+      "values. Not for non-negative tractions. Default: false.")
+    ("svd_rank",
+      po::value<size_t>(&options.svd_rank)->default_value(0),
+      "With truncated_svd, the number of the largest singular values to keep, found by a "
+      "randomized range finder if far fewer than the cells. 0 keeps them all. Default: 0.")
+    ("iterative",
+      po::value<bool>(&options.iterative)->default_value(false, "false"),
+      "Whether to compute the tractions of every frame by a few iterations of CGLS against the "
+      "model, starting from the previous frame's, instead of inverting the model offline (with "
+      "cutoff_radius, against its sparse version). Not for non-negative tractions. "
+      "Default: false.")
+    ("max_iterations",
+      po::value<size_t>(&options.max_iterations)->default_value(10),
+      "With iterative, the number of iterations per frame at most. Default: 10.")
+    ("multigrid",
+      po::value<bool>(&options.multigrid)->default_value(false, "false"),
+      "With iterative, whether to solve the regularised normal equations (regularised by "
+      "tikhonov, if given) by conjugate gradients preconditioned with multigrid V-cycles, if the "
+      "tractions' grid is regular; CGLS otherwise. Default: false.")
+    ("coarse_to_fine",
+      po::value<bool>(&options.coarse_to_fine)->default_value(false, "false"),
+      "Whether to locate the contact on a coarser grid first, then solve for the tractions (with "
+      "the regularisation of tikhonov, if given) only around it. Default: false.")
+    ("coarse_factor",
+      po::value<size_t>(&options.coarse_factor)->default_value(4),
+      "With coarse_to_fine, the coarse grid's pitch relative to the tractions'. Default: 4.")
+    ("regions",
+      po::value<std::string>(&options.regions)->default_value(""),
+      "A regionalisation cache (e.g. data/regionalisation.cache) splitting the taxels into "
+      "regions whose tractions are solved for independently, in parallel. Default: none.")
+    ("region_overlap",
+      po::value<double>(&options.region_overlap)->default_value(0),
+      "With regions, the width [m] of the halo of cells every region's model takes in from its "
+      "neighbours, blended across. Default: 0.")
+    ("fista",
+      po::value<bool>(&options.fista)->default_value(false, "false"),
+      "Whether to compute the non-negative tractions by FISTA, an accelerated projected gradient "
+      "which only applies the model, rather than by the active set method: approximate, but "
+      "with a bound on the time per frame. Default: false.")
+    ("fista_iterations",
+      po::value<size_t>(&options.fista_iterations)->default_value(100),
+      "With fista, the number of iterations per frame at most. Default: 100.")
+    ("cell_order",
+      po::value<cm::CellOrder>(&options.cell_order)->default_value(cm::CellOrder::original,
+        "original"),
+      "Order of the grids' cells: original, morton or hilbert. Along the space-filling curves "
+      "(morton, hilbert), nearby cells are stored close to each other, and so are the models' "
+      "coefficients between them. The dumped grids keep the original order. Default: original.")
   ;
 
   po::variables_map vm;
@@ -69,7 +69,8 @@ void offline(suite_type& suite)
 void run(suite_type& suite)
 {
   // update values in the source mesh
-  suite.raw_grid->setRawValues(suite.skin_provider->update());
+  // the provider's values come in the order its grid was created in
+  suite.raw_grid->setRawValuesInOriginalOrder(suite.skin_provider->update());
 
   if (suite.interpolator && suite.interp_grid) {
     suite.interpolator->interpolate(*suite.raw_grid, *suite.interp_grid);
@@ -1,5 +1,6 @@
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <ctime>
 #include <string>
 
 #include "cm/cm.hpp"
@@ -16,31 +17,39 @@ constexpr size_t grid_sizes[] = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100};
 constexpr cm::SkinAttributes skin_attr = {0.002, 300000, 0.5, 0.004};
 
 /**
- * \brief Measures own CPU lifetime. Outputs it on destruction
+ * \brief Measures own (wall-clock) lifetime. Outputs it on destruction
+ *
+ * Wall-clock rather than CPU time, as the latter adds up over all the threads of a multithreaded
+ * assembly.
  */
 class Timer
 {
+  typedef std::chrono::steady_clock clock;
   std::string str_;
-  std::clock_t start_;
+  clock::time_point start_;
 
 public:
   Timer(std::string str)
-    : str_(str), start_(std::clock())
+    : str_(str), start_(clock::now())
   {};
 
   ~Timer()
   {
-    double duration_clocks = std::clock() - start_;
+    std::chrono::duration<double, std::milli> duration = clock::now() - start_;
     std::cerr
       << str_ << ": "
-      << (1000.0*duration_clocks/CLOCKS_PER_SEC) << " [ms]."
+      << duration.count() << " [ms]."
       << std::endl;
   }
 };
 
 cm::Grid* genGrid(const size_t sqrt_no_nodes);
 
-int main() {
+/**
+ * \brief Usage: timeit [num_threads]; num_threads defaults to 1, 0 means one per hardware thread
+ */
+int main(int argc, char** argv) {
+  const size_t num_threads = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1;
   for (auto sqrt_no_nodes : grid_sizes) {
     cm::Grid* grid = genGrid(sqrt_no_nodes);
     if (!grid) {
@@ -51,28 +60,28 @@ int main() {
     }
     // --- time forward Boussinesq-Cerruti with exact psi calculation
     {
-      Timer t{sb() << "B-C, psi_exact=T, @" <<sqrt_no_nodes};
+      Timer t{sb() << "B-C, psi_exact=T, @" <<sqrt_no_nodes << ", threads: " << num_threads};
       auto mat = cm::details::forces_to_displacements_matrix(
           *grid,*grid,
-          skin_attr, true
+          skin_attr, true, num_threads
       );
     }
 
     // --- time forward Boussinesq-Cerruti with psi set to 0.25
     {
-      Timer t{sb() << "B-C, psi_exact=F, @" <<sqrt_no_nodes};
+      Timer t{sb() << "B-C, psi_exact=F, @" <<sqrt_no_nodes << ", threads: " << num_threads};
       auto mat = cm::details::forces_to_displacements_matrix(
           *grid,*grid,
-          skin_attr, false
+          skin_attr, false, num_threads
       );
     }
 
     // --- time forward Love's solution
     {
-      Timer t{sb() << "Love, @" <<sqrt_no_nodes};
+      Timer t{sb() << "Love, @" <<sqrt_no_nodes << ", threads: " << num_threads};
       auto mat = cm::details::pressures_to_displacements_matrix(
           *grid,*grid,
-          skin_attr
+          skin_attr, num_threads
       );
     }
 
@@ -7,7 +7,12 @@
  * minimum-norm solution).
  */
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
 #include "cm/algorithm/interface.hpp"
+#include "cm/grid/cell.hpp"
 #include "cm/skin/attributes.hpp"
 
 namespace cm {
@@ -27,6 +32,10 @@ class AlgDisplacementsToForces : public AlgInterface
 public:
   /**
    * \brief   Parameters for the algorithm -- attributes of the skin
+   *
+   * At most one of deconvolution, truncated_svd, iterative and coarse_to_fine chooses how the
+   * model is inverted (the pseudoinverse if none), and the flags for the others must stay unset:
+   * offline() and recalibrate() throw std::runtime_error on flags which contradict each other.
    */
   typedef struct params_type {
     /**
@@ -39,6 +48,168 @@ public:
      * \sa      See the thesis report for details
      */
     bool  psi_exact;
+    /**
+     * \brief   Number of threads to assemble the matrix with during offline() (0: one per
+     * hardware thread). The result doesn't depend on it. The threads which run() applies the
+     * inverse with (quantized, iterative, regions...) are started once and kept in the
+     * precomputed data: they are offline()'s (or recalibrate()'s) num_threads.
+     */
+    size_t num_threads = 1;
+    /**
+     * \brief   If both grids are regular lattices of the same pitch (e.g. made by
+     * Grid::fromFill() with the same cell shape), reconstruct by a Tikhonov-regularised
+     * deconvolution in the Fourier domain (\sa DeconvolutionOperator) instead of the
+     * pseudoinverse: O(n log n) offline and per run(), memory linear in the number of cells.
+     * Falls back to the pseudoinverse for other grids.
+     */
+    bool deconvolution = false;
+    /**
+     * \brief   Tikhonov parameter of the deconvolution, the tikhonov inverse, the multigrid and the
+     * coarse_to_fine windows, relative to the largest squared singular value of the model (for the
+     * deconvolution: the largest squared magnitude of its spectrum)
+     */
+    double regularisation = 1e-6;
+    /**
+     * \brief   Instead of the pseudoinverse, compute the Tikhonov-regularised inverse with
+     * regularisation (\sa details::tikhonov_inverse()): a Cholesky factorisation, several times
+     * cheaper offline than the pseudoinverse's SVD, and better conditioned tractions. Stored and
+     * applied as the pseudoinverse would be.
+     */
+    bool tikhonov = false;
+    /**
+     * \brief   Keep the singular value decomposition of the model (\sa details::TruncatedSVD)
+     * and reconstruct through it (\sa details::SpectralInverseOperator): O((m+n) k) per run()
+     * for k singular values. recalibrate() then follows a change of svd_rank (down to what's
+     * stored), tikhonov, regularisation or E without decomposing again. Not with the other
+     * ways of storing the inverse.
+     */
+    bool truncated_svd = false;
+    /**
+     * \brief   With truncated_svd: number of the largest singular values to keep, found by a
+     * randomized range finder if far fewer than the cells; 0 keeps them all (a full SVD).
+     */
+    size_t svd_rank = 0;
+    /**
+     * \brief   Number of refinement steps of the deconvolution; each costs about as much as the
+     * deconvolution itself, and divides its error near the grids' borders by about 5.
+     */
+    size_t refinement_steps = 2;
+    /**
+     * \brief   If not empty, keep the pseudoinverse in this file, mapped into memory (\sa
+     * details::MappedOperator): a file left by an earlier offline() for the same grids and skin
+     * is mapped as is, skipping the pseudoinverse, and several processes can share it. Computing
+     * the pseudoinverse still takes the whole matrix in memory. Only for the pseudoinverse (or
+     * the Tikhonov inverse) in double precision, and not with regions.
+     */
+    std::string mapped_file;
+    /**
+     * \brief   Store the pseudoinverse in single precision (\sa details::to_single_precision()):
+     * half the memory and memory traffic of every run(). It's still computed in double precision,
+     * and rounded once at the end. Not for the deconvolution or a mapped_file.
+     */
+    bool single_precision = false;
+    /**
+     * \brief   Store the pseudoinverse as 16-bit integers with a scale per block of 64 rows of
+     * every column (\sa details::QuantizedOperator): a quarter of the memory and memory traffic
+     * of every run(), which is then applied with num_threads threads. Every coefficient is within
+     * about 1.5e-5 of its block's largest; offline() logs the Frobenius norm of the error,
+     * relative to the pseudoinverse's. Not with single_precision.
+     */
+    bool quantized = false;
+    /**
+     * \brief   Don't invert the model: solve for the forces at every run() by a few iterations of
+     * CGLS against the model itself (\sa details::cgls()), started from the previous run()'s
+     * solution. offline() only assembles the model, O(n^2) -- or about linear with cutoff_radius,
+     * hierarchical or matrix_free -- instead of the pseudoinverse's O(n^3); a run() costs two
+     * applications of it per iteration. Not with tikhonov. The precomputed data then keeps the last
+     * solution: run()s sharing it mustn't be concurrent.
+     */
+    bool iterative = false;
+    /**
+     * \brief   With iterative: iterations per run() at most. A frame close to the previous one
+     * needs few; fewer iterations also smooth the solution, much like a truncated SVD.
+     */
+    size_t max_iterations = 10;
+    /**
+     * \brief   With iterative: stop a run() early once the gradient of the residual is this small,
+     * relative to that of a solution of 0
+     */
+    double iterative_tolerance = 1e-6;
+    /**
+     * \brief   With iterative: if > 0, drop the coefficients of the model between cells further
+     * apart than this [m] (\sa details::forces_to_displacements_sparse()): memory and run()
+     * linear in the number of cells
+     */
+    double cutoff_radius = 0;
+    /**
+     * \brief   With iterative: store the model as a hierarchical matrix (\sa
+     * details::forces_to_displacements_hmatrix()), the coefficients between far apart
+     * groups of cells compressed to low rank: memory and every application O(n log n) on grids
+     * of any layout. Not with cutoff_radius or matrix_free; the multigrid's convolution comes
+     * first.
+     */
+    bool hierarchical = false;
+    /**
+     * \brief   With hierarchical: relative error of the compressed blocks
+     */
+    double hierarchical_tolerance = 1e-6;
+    /**
+     * \brief   With iterative: don't store the model, evaluate its coefficients at every
+     * application instead (\sa details::forces_to_displacements_operator()): memory linear in the
+     * number of cells, for iterations about as costly as assembling the model.
+     */
+    bool matrix_free = false;
+    /**
+     * \brief   With iterative: if the forces' grid is a regular lattice (e.g. made by
+     * Grid::fromFill()), solve the normal equations regularised by regularisation with conjugate
+     * gradients preconditioned by multigrid V-cycles (\sa details::Multigrid) instead of CGLS.
+     * Their iterations grow slowly with the number of cells, not with a weaker regularisation; each
+     * costs a few applications of the model, by FFT if the displacements' grid is a lattice of
+     * the same pitch (and no cutoff_radius): about O(n log^2 n). The 3-valued forces' model is
+     * far worse conditioned, and gains less. Falls back to CGLS for other grids.
+     */
+    bool multigrid = false;
+    /**
+     * \brief   Solve for the forces in two levels (\sa details::CoarseToFine): first on a coarse
+     * grid filling the same area (Grid::fromFill() with cells coarse_factor times as large),
+     * through its pseudoinverse (its Tikhonov inverse if tikhonov), then at full resolution only
+     * on the cells around the coarse ones carrying at least contact_threshold of the largest
+     * traction, regularised by regularisation; the others are set to 0. A run() costs about as
+     * much as the contact is large, rather than the skin: offline() only keeps the coarse
+     * inverse, and a run() evaluates the model's columns for the window and factorises their
+     * normal equations.
+     */
+    bool coarse_to_fine = false;
+    /**
+     * \brief   With coarse_to_fine: the coarse cells' sides, in the forces' cells' sides
+     */
+    size_t coarse_factor = 4;
+    /**
+     * \brief   With coarse_to_fine: the coarse cells in contact are those with a traction (the norm
+     * of their values) at least this relative to the largest
+     */
+    double contact_threshold = 0.05;
+    /**
+     * \brief   With coarse_to_fine: the window takes in this many rings of coarse cells around
+     * those in contact
+     */
+    size_t window_dilation = 1;
+    /**
+     * \brief   If not empty, split the skin into these regions -- the positions of every region's
+     * taxels, e.g. from SkinRegions::positions() -- and invert the model of every region on its
+     * own (\sa details::RegionDecomposition): a cell belongs to the region of the nearest
+     * position. The inverses are computed, and applied at every run(), num_threads regions at a
+     * time; all the other parameters apply to every region's, but mapped_file can't be set
+     * with regions. The memory offline is then sum O(n_i^2) instead of O(n^2), but the regions'
+     * interactions beyond region_overlap are neglected.
+     */
+    std::vector<std::vector<GridCell>> regions;
+    /**
+     * \brief   With regions: every region's model also takes in the cells within this distance
+     * [m] of its own; the forces there are blended with the neighbouring regions', with weights
+     * falling linearly across that distance
+     */
+    double region_overlap = 0;
   } params_type;
 
 private:
@@ -54,6 +225,14 @@ private:
     const boost::any& params,
     const boost::any& precomputed
   );
+
+  boost::any impl_recalibrate(
+    const Grid& disps,
+    const Grid& forces,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
 };
 
 } /* namespace cm */
@@ -7,6 +7,8 @@
  * forces, nonnegative-only solution).
  */
 
+#include <cstddef>
+
 #include "cm/algorithm/interface.hpp"
 #include "cm/skin/attributes.hpp"
 
@@ -17,7 +19,9 @@ namespace cm {
  * \sa AlgDisplacementsToForces
  *
  * This algorithm serches the solutions space for nonnegative forces acting in
- * the z direction (normal to the skin) which would cause such displacements.
+ * the z direction (normal to the skin) which would cause such displacements. *
+ * The solver (\sa details::NonnegativeLeastSquares) starts every run() from the previous one's
+ * solution, which the precomputed data keeps: run()s sharing it mustn't be concurrent.
  */
 class AlgDisplacementsToNonnegativeNormalForces : public AlgInterface
 {
@@ -36,6 +40,33 @@ public:
      * \sa      See the thesis report for details
      */
     bool  psi_exact;
+    /**
+     * \brief   Number of threads to assemble the matrix with during offline() (0: one per
+     * hardware thread). The result doesn't depend on it.
+     */
+    size_t num_threads = 1;
+    /**
+     * \brief   If > 0, drop the coefficients between cells further apart than this [m] (\sa
+     * forces_to_displacements_sparse()): the matrix is assembled and stored sparse, but
+     * the NNLS solver's a^T a is dense still.
+     */
+    double cutoff_radius = 0;
+    /**
+     * \brief   Solve by FISTA (\sa details::fista()) instead of the active set method: no a^T a,
+     * just two applications of the matrix per iteration (split among num_threads threads), and
+     * at most max_iterations of them per run(), which bounds its time. The solution is then only
+     * approximate; a run() logs how close it got.
+     */
+    bool fista = false;
+    /**
+     * \brief   With fista: iterations per run() at most
+     */
+    size_t max_iterations = 100;
+    /**
+     * \brief   With fista: stop a run() early once the projected gradient step is this small,
+     * relative to the gradient at 0 (\sa details::fista())
+     */
+    double iterative_tolerance = 1e-4;
   } params_type;
 
 private:
@@ -51,6 +82,14 @@ private:
     const boost::any& params,
     const boost::any& precomputed
   );
+
+  boost::any impl_recalibrate(
+    const Grid& disps,
+    const Grid& forces,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
 };
 
 } /* namespace cm */
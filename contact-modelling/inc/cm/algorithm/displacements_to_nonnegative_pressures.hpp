@@ -7,6 +7,8 @@
  * rectangular area, nonnegative-only solution).
  */
 
+#include <cstddef>
+
 #include "cm/algorithm/interface.hpp"
 #include "cm/skin/attributes.hpp"
 
@@ -17,7 +19,9 @@ namespace cm {
  * \sa AlgDisplacementsToPressures
  *
  * This algorithm serches the solutions space for nonnegative pressures acting in
- * the z direction (normal to the skin) which would cause such displacements.
+ * the z direction (normal to the skin) which would cause such displacements. *
+ * The solver (\sa details::NonnegativeLeastSquares) starts every run() from the previous one's
+ * solution, which the precomputed data keeps: run()s sharing it mustn't be concurrent.
  */
 class AlgDisplacementsToNonnegativePressures : public AlgInterface
 {
@@ -27,6 +31,47 @@ public:
    */
   typedef struct params_type {
     SkinAttributes skin_props;
+    /**
+     * \brief   Number of threads to assemble the matrix with during offline() (0: one per
+     * hardware thread). The result doesn't depend on it.
+     */
+    size_t num_threads = 1;
+    /**
+     * \brief   If > 0, interpolate the matrix's coefficients from a table where their relative
+     * error is below this at samples of the table (\sa pressures_to_displacements_matrix()): a
+     * sampled tolerance, not a bound. 0: exact.
+     */
+    double surrogate_sampled_tol = 0;
+    /**
+     * \brief   Keep the matrix's material-independent parts (\sa pressures_to_displacements_terms())
+     * along with the precomputed data, so that recalibrate() can follow a change of nu without
+     * assembling the matrix again (a change of E needs no such thing). Doubles the memory needed;
+     * surrogate_sampled_tol is ignored.
+     */
+    bool parametric = false;
+    /**
+     * \brief   If > 0, drop the coefficients between cells further apart than this [m] (\sa
+     * pressures_to_displacements_sparse()): the matrix is assembled and stored sparse, but
+     * the NNLS solver's a^T a is dense still.
+     * parametric and surrogate_sampled_tol are ignored.
+     */
+    double cutoff_radius = 0;
+    /**
+     * \brief   Solve by FISTA (\sa details::fista()) instead of the active set method: no a^T a,
+     * just two applications of the matrix per iteration (split among num_threads threads), and
+     * at most max_iterations of them per run(), which bounds its time. The solution is then only
+     * approximate; a run() logs how close it got.
+     */
+    bool fista = false;
+    /**
+     * \brief   With fista: iterations per run() at most
+     */
+    size_t max_iterations = 100;
+    /**
+     * \brief   With fista: stop a run() early once the projected gradient step is this small,
+     * relative to the gradient at 0 (\sa details::fista())
+     */
+    double iterative_tolerance = 1e-4;
   } params_type;
 
 private:
@@ -42,6 +87,14 @@ private:
     const boost::any& params,
     const boost::any& precomputed
   );
+
+  boost::any impl_recalibrate(
+    const Grid& disps,
+    const Grid& pressures,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
 };
 
 } /* namespace cm */
@@ -6,6 +6,9 @@
  * \brief   Forward Elastic Problem solver (concentrated forces).
  */
 
+#include <cstddef>
+#include <string>
+
 #include "cm/algorithm/interface.hpp"
 #include "cm/skin/attributes.hpp"
 
@@ -33,6 +36,54 @@ public:
      * \sa      See the thesis report for details
      */
     bool  psi_exact;
+    /**
+     * \brief   Number of threads to assemble the matrix with during offline() (0: one per
+     * hardware thread). The result doesn't depend on it.
+     */
+    size_t num_threads = 1;
+    /**
+     * \brief   Don't store the matrix: evaluate its coefficients on every run() instead
+     * (\sa forces_to_displacements_operator()). Memory linear in the number of cells rather than
+     * quadratic, for a run() about as costly as an offline() with the matrix.
+     */
+    bool matrix_free = false;
+    /**
+     * \brief   If both grids are regular lattices of the same pitch (e.g. made by
+     * Grid::fromFill() with the same cell shape), apply the model as a 2D convolution by FFT
+     * (\sa forces_to_displacements_convolution()): memory linear in the number of cells and an
+     * O(n log n) run(). Falls back to matrix_free or the matrix for other grids.
+     */
+    bool convolution = false;
+    /**
+     * \brief   Store the matrix as a hierarchical matrix (\sa forces_to_displacements_hmatrix()):
+     * the coefficients between far apart groups of cells compressed to low rank, for memory and
+     * a run() O(n log n) on grids of any layout. Comes after convolution, before matrix_free.
+     */
+    bool hierarchical = false;
+    /**
+     * \brief   Relative error of the compressed blocks when hierarchical
+     */
+    double hierarchical_tolerance = 1e-6;
+    /**
+     * \brief   If > 0, drop the coefficients between cells further apart than this [m] and store
+     * the rest sparse (\sa forces_to_displacements_sparse()): memory and run() linear in the
+     * number of cells. A few skin thicknesses keep the coefficients above the sensors' noise.
+     * Comes after hierarchical, before matrix_free.
+     */
+    double cutoff_radius = 0;
+    /**
+     * \brief   If not empty, keep the matrix in this file, mapped into memory (\sa
+     * forces_to_displacements_mapped()), for matrices larger than the RAM. A file left by an
+     * earlier offline() for the same grids and skin is reused as is, and several processes can
+     * share it. Comes after cutoff_radius, before matrix_free.
+     */
+    std::string mapped_file;
+    /**
+     * \brief   Store the matrix in single precision (\sa details::to_single_precision()): half the
+     * memory and memory traffic of every run(), for relative errors about 1e-7, well below the
+     * sensors' noise. It's still assembled in double precision. Only for the stored matrix.
+     */
+    bool single_precision = false;
   } params_type;
 
 private:
@@ -48,6 +99,14 @@ private:
     const boost::any& params,
     const boost::any& precomputed
   );
+
+  boost::any impl_recalibrate(
+    const Grid& forces,
+    const Grid& disps,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
 };
 
 } /* namespace cm */
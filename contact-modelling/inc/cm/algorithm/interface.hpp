@@ -63,6 +63,30 @@ public:
     const boost::any& precomputed
   );
 
+  /**
+   * \brief   Adapt precomputed data to new parameters
+   * \param   input   The "from" for the algorithm
+   * \param   output  The "to" for the algorithm
+   * \param   params  Parameters `precomputed` was computed with
+   * \param   precomputed   Precomputed data returned from a previous call to offline() (or
+   *                        recalibrate()) with `params`
+   * \param   new_params    The new parameters
+   * \return  Precomputed data for new_params; the same as offline(input, output, new_params) would
+   *          return, up to rounding
+   *
+   * Meant for changes of the skin's material (E, nu) -- e.g. after a recalibration of its
+   * stiffness. Algorithms which can, derive the result from `precomputed` (often by mere scaling)
+   * instead of redoing the whole offline phase; for any other changes, or algorithms which can't,
+   * this falls back to offline(). `precomputed` itself is left intact.
+   */
+  boost::any recalibrate(
+    const Grid& input,
+    const Grid& output,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
+
 protected:
   AlgInterface()                               = default;
   AlgInterface& operator=(const AlgInterface&) = default;
@@ -92,6 +116,17 @@ private:
     const boost::any& params,
     const boost::any& precomputed
   ) = 0;
+
+  /**
+   * \brief   May be overriden by implementation; defaults to impl_offline() with new_params.
+   */
+  virtual boost::any impl_recalibrate(
+    const Grid&  input,
+    const Grid&  output,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
 };
 
 } /* namespace cm */
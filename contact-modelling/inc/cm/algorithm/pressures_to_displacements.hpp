@@ -7,6 +7,8 @@
  * areas).
  */
 
+#include <cstddef>
+
 #include "cm/algorithm/interface.hpp"
 #include "cm/skin/attributes.hpp"
 
@@ -26,6 +28,54 @@ public:
    */
   typedef struct params_type {
     SkinAttributes skin_props;
+    /**
+     * \brief   Number of threads to assemble the matrix with during offline() (0: one per
+     * hardware thread). The result doesn't depend on it.
+     */
+    size_t num_threads = 1;
+    /**
+     * \brief   If > 0, interpolate the matrix's coefficients from a table where their relative
+     * error is below this at samples of the table (\sa pressures_to_displacements_matrix()): a
+     * sampled tolerance, not a bound. 0: exact. Not with single_precision: its error bound
+     * wouldn't hold.
+     */
+    double surrogate_sampled_tol = 0;
+    /**
+     * \brief   Keep the matrix's material-independent parts (\sa pressures_to_displacements_terms())
+     * along with the precomputed data, so that recalibrate() can follow a change of nu without
+     * assembling the matrix again (a change of E needs no such thing). Doubles the memory needed;
+     * surrogate_sampled_tol is ignored.
+     */
+    bool parametric = false;
+    /**
+     * \brief   Don't store the matrix: evaluate its coefficients on every run() instead
+     * (\sa pressures_to_displacements_operator()). Memory linear in the number of cells rather
+     * than quadratic, for a run() about as costly as an offline() with the matrix. parametric is
+     * ignored.
+     */
+    bool matrix_free = false;
+    /**
+     * \brief   If both grids are regular lattices of the same pitch (e.g. made by
+     * Grid::fromFill() with the same cell shape), apply the model as a 2D convolution by FFT
+     * (\sa pressures_to_displacements_convolution()): memory linear in the number of cells and
+     * an O(n log n) run(). Falls back to matrix_free or the matrix for other grids; parametric
+     * and surrogate_sampled_tol are ignored when convolving.
+     */
+    bool convolution = false;
+    /**
+     * \brief   If > 0, drop the coefficients between cells further apart than this [m] and store
+     * the rest sparse (\sa pressures_to_displacements_sparse()): memory and run() linear in the
+     * number of cells. Comes after convolution, before matrix_free; parametric and
+     * surrogate_sampled_tol are ignored.
+     */
+    double cutoff_radius = 0;
+    /**
+     * \brief   Store the matrix in single precision (\sa details::to_single_precision()): half the
+     * memory and memory traffic of every run(), for relative errors about 1e-7, well below the
+     * sensors' noise. It's still assembled in double precision. Only for the stored matrix; not
+     * with surrogate_sampled_tol.
+     */
+    bool single_precision = false;
   } params_type;
 
 private:
@@ -41,6 +91,14 @@ private:
     const boost::any& params,
     const boost::any& precomputed
   );
+
+  boost::any impl_recalibrate(
+    const Grid& pressures,
+    const Grid& disps,
+    const boost::any& params,
+    const boost::any& precomputed,
+    const boost::any& new_params
+  );
 };
 
 } /* namespace cm */
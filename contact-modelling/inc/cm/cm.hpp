@@ -33,6 +33,7 @@
 
 // skin attributes
 #include "cm/skin/attributes.hpp"
+#include "cm/skin/regions.hpp"
 
 // skin providers
 #include "cm/skin_provider/interface.hpp"
@@ -0,0 +1,65 @@
+#ifndef CELL_COORDINATES_HPP
+#define CELL_COORDINATES_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "cm/grid/grid.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Structure-of-arrays copy of a grid's cell coordinates.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   x and y coordinates of a grid's cells, stored in two separate, contiguous arrays.
+ *
+ * Grid keeps its cells as an array of (x,y) structs, accessed through a bounds-checked cell().
+ * The assembly loops for the elastic models only ever need the coordinates, but need them for
+ * every (displacement, traction) pair -- copying them out once makes the inner loops operate on
+ * plain arrays, which the compiler can vectorise.
+ */
+struct CellCoordinates {
+  /**
+   * \brief   Copy the coordinates out of a grid.
+   */
+  explicit CellCoordinates(const Grid& g)
+  {
+    x.reserve(g.num_cells());
+    y.reserve(g.num_cells());
+    for (auto it = g.cells_cbegin(); it != g.cells_cend(); ++it) {
+      x.push_back(it->x);
+      y.push_back(it->y);
+    }
+  }
+
+  /**
+   * \brief   Number of cells
+   */
+  size_t size() const { return x.size(); }
+
+  /**
+   * \brief   x coordinates of the cells
+   */
+  std::vector<double> x;
+  /**
+   * \brief   y coordinates of the cells
+   */
+  std::vector<double> y;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* CELL_COORDINATES_HPP */
@@ -0,0 +1,59 @@
+#ifndef DETAILS_CGLS_HPP
+#define DETAILS_CGLS_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Iterative least squares against the models, instead of their inverses.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Improve x towards the least-squares solution of a*x = b by conjugate gradients on the
+ *          normal equations (CGLS), preconditioned by the column scaling d.
+ * \param   d               x = d .* y: CGLS runs on a*diag(d), whose columns all have the same
+ *                          norm if d is their inverse (\sa column_scaling()). Jacobi's
+ *                          preconditioner for a^T a, at no cost per iteration.
+ * \param   x               the starting point (e.g. the previous frame's solution), and the result
+ * \param   max_iterations  iterations at most, each one a*v and a^T*w
+ * \param   tolerance       stop once the (scaled) gradient ||d .* a^T (b - a*x)|| is below this
+ *                          relative to ||d .* a^T b||
+ * \return  the number of iterations done
+ *
+ * Mathematically LSQR's iterates, with a simpler recurrence; the few iterations the algorithms
+ * run per frame don't let their difference in rounding show. Started from 0, the first
+ * iterations recover the components of the largest singular values, the noise-prone ones come
+ * last: a small max_iterations regularises, much like a truncated SVD.
+ */
+size_t cgls(
+  const LinearOperator& a,
+  const std::vector<double>& d,
+  const std::vector<double>& b,
+  std::vector<double>& x,
+  const size_t max_iterations,
+  const double tolerance
+);
+
+/**
+ * \brief   The inverses of the norms of a's columns (0 for the columns of zeros)
+ */
+std::vector<double> column_scaling(const LinearOperator& a);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_CGLS_HPP */
@@ -0,0 +1,90 @@
+#ifndef DETAILS_COARSE_TO_FINE_HPP
+#define DETAILS_COARSE_TO_FINE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Tractions solved for at full resolution only around the contact.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Two-level reconstruction: the tractions on a coarse grid locate the contact, the fine
+ *          cells around it are solved for, the others are left at 0.
+ *
+ * The coarse cells whose tractions are at least threshold times the largest (by the norm of
+ * their dim values) are in contact. The window is the fine cells within reach of any of them,
+ * and its tractions x_W minimise ||a_W x_W - d||^2 + lambda ||x_W||^2, a_W being the model's
+ * columns for the window: at every run(), a_W is evaluated (\sa LinearOperator::columns()),
+ * and a_W^T a_W + lambda I formed and factorised by Cholesky.
+ *
+ * Per run(): the coarse inverse's product, a_W, a_W^T a_W and the factorisation,
+ * O(m n_c + m w^2 + w^3) for n_c coarse cells and w values in the window; on a large skin
+ * touched at a few places w is a small fraction of the fine values. Offline: the coarse inverse,
+ * and lambda by a few dozen applications of the model; nothing of the size of the fine model is
+ * stored unless the model itself is. All the displacements are fitted, not only those within the
+ * window.
+ */
+class CoarseToFine {
+public:
+  /**
+   * \param   forward         the fine model, m x dim*fine.size(); evaluated column by column
+   * \param   coarse_inverse  from the displacements to the coarse tractions,
+   *                          dim*coarse.size() x m
+   * \param   reach_x,reach_y a fine cell is within reach of a coarse cell no further than this
+   *                          along x and y
+   * \param   threshold       relative to the largest coarse traction
+   * \param   regularisation  lambda relative to the largest eigenvalue of a^T a, as estimated
+   *                          by largest_squared_singular_value() to three digits
+   */
+  CoarseToFine(
+    std::shared_ptr<const LinearOperator> forward,
+    arma::mat coarse_inverse,
+    const CellCoordinates& fine,
+    const CellCoordinates& coarse,
+    const size_t dim,
+    const double reach_x,
+    const double reach_y,
+    const double threshold,
+    const double regularisation
+  );
+
+  /**
+   * \brief   The fine tractions for the displacements d
+   * \param   window  if not null, set to the number of fine cells solved for
+   */
+  std::vector<double> solve(const std::vector<double>& d, size_t* window = nullptr) const;
+
+private:
+  size_t dim_;
+  double threshold_;
+  double lambda_;
+  std::shared_ptr<const LinearOperator> forward_;
+  arma::mat coarse_inverse_;
+  /**
+   * \brief   reachable_[k]: the fine cells within reach of coarse cell k, increasing
+   */
+  std::vector<std::vector<size_t>> reachable_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_COARSE_TO_FINE_HPP */
@@ -0,0 +1,188 @@
+#ifndef DETAILS_CONVOLUTION_OPERATOR_HPP
+#define DETAILS_CONVOLUTION_OPERATOR_HPP
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/fft.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   The elastic models on regular grids, applied as 2D convolutions.
+ */
+
+namespace cm {
+namespace details {
+
+struct CellCoordinates;
+
+/**
+ * \brief   Cells placed on the nodes of a regular lattice: node (i,j) is at (x0 + i*px, y0 + j*py),
+ *          i < nx, j < ny.
+ */
+struct Lattice {
+  double x0, y0;
+  double px, py;
+  size_t nx, ny;
+  /**
+   * \brief   Node of every cell, i*ny + j
+   */
+  std::vector<size_t> node;
+};
+
+/**
+ * \brief   Fit the cells onto a lattice of pitch (px, py), spanning their bounding box.
+ * \return  false if they don't fit: a cell further than 1e-6 of the pitch from the nearest node,
+ *          two cells on the same node, or the cells covering less than a quarter of the nodes
+ *          (the convolutions would mostly be transforming zeros then).
+ *
+ * Grid::fromFill() places its cells that way.
+ */
+bool fit_lattice(const CellCoordinates& c, const double px, const double py, Lattice& ret);
+
+/**
+ * \brief   A matrix whose coefficients only depend on the offset between the lattice nodes of its
+ *          row's and column's cells, applied as a convolution by FFT.
+ *
+ * The columns are src_dim values per cell of the src lattice, the rows dst_dim values per cell of
+ * dst (value a of cell c at c*dim + a, as in the grids' raw values); src and dst have the same
+ * pitch. Such a matrix is (up to the order of the cells) block-Toeplitz with Toeplitz blocks:
+ * the coefficients for the (2*nx-1)*(2*ny-1)-ish offsets between the nodes -- the stencil --
+ * determine it.
+ *
+ * The stencils are embedded into a circulant of the smallest power-of-2 size able to hold the
+ * linear convolution, and their spectra are kept: memory linear in the number of nodes. apply()
+ * costs src_dim forward and dst_dim inverse transforms, apply_transpose() the other way around
+ * (it correlates with the same spectra instead of convolving); O(n log n) either way. So do the
+ * column_norms(): the squared stencils correlated with dst's cells.
+ */
+class ConvolutionOperator : public LinearOperator {
+public:
+  /**
+   * \param   stencils  dst_dim*src_dim stencils, (a,b) at [a*src_dim + b]: the coefficient of
+   *                    value b of a src cell into value a of a dst cell, for every offset of
+   *                    stencil_offsets(), in its order.
+   */
+  ConvolutionOperator(
+    const Lattice& src,
+    const Lattice& dst,
+    const size_t src_dim,
+    const size_t dst_dim,
+    const std::vector<std::vector<double>>& stencils
+  );
+
+  /**
+   * \brief   The offsets (dst node - src node) the stencils are to be evaluated at: di from
+   *          -(src.nx - 1) to dst.nx - 1 (outer), dj from -(src.ny - 1) to dst.ny - 1 (inner).
+   *
+   * Offsets within a tiny fraction of the pitch of 0 are set to exactly 0, so that the kernels
+   * see coincident cells as such.
+   */
+  static void stencil_offsets(
+    const Lattice& src,
+    const Lattice& dst,
+    std::vector<double>& x,
+    std::vector<double>& y
+  );
+
+  /**
+   * \brief   Tikhonov-regularised inverse in the Fourier domain (a Wiener filter): the operator
+   *          from dst's values to src's which, at every frequency, maps the transformed values D
+   *          to (K^H K + lambda I)^-1 K^H D, K being the dst_dim x src_dim spectra there.
+   * \param   regularisation  lambda relative to the largest trace of K^H K over the frequencies
+   *
+   * The inverse is that of the circulant the matrix is embedded in, i.e. it takes dst's values to
+   * be 0 outside of its cells, and has the cells beyond either lattice's edges contribute to the
+   * solution: close to the regularised least-squares solution inside the grids, less so within a
+   * few cells of their borders. Costs as much as this operator, per application.
+   */
+  std::unique_ptr<ConvolutionOperator> regularised_inverse(const double regularisation) const;
+
+private:
+  typedef std::complex<double> complex_type;
+
+  ConvolutionOperator(
+    const size_t src_dim,
+    const size_t dst_dim,
+    const Fft2d& fft,
+    const std::vector<size_t>& src_pos,
+    const std::vector<size_t>& dst_pos,
+    std::vector<std::vector<complex_type>> spectra
+  );
+
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+  std::vector<double> impl_column_norms() const;
+
+  /**
+   * \brief   The product with (the transpose of) the matrix: the values of in_dim-valued cells at
+   *          in_pos into out_dim-valued cells at out_pos, with the spectra conjugated if
+   *          transpose.
+   */
+  void convolve(
+    const double* in, const std::vector<size_t>& in_pos, const size_t in_dim,
+    double* out, const std::vector<size_t>& out_pos, const size_t out_dim,
+    const bool transpose
+  ) const;
+
+  size_t src_dim_, dst_dim_;
+  Fft2d fft_;
+  /**
+   * \brief   Position of every cell of src/dst in the transforms' arrays
+   */
+  std::vector<size_t> src_pos_, dst_pos_;
+  /**
+   * \brief   Spectra of the embedded stencils, in the order of the stencils
+   */
+  std::vector<std::vector<complex_type>> spectra_;
+};
+
+/**
+ * \brief   A ConvolutionOperator's regularised inverse (\sa
+ *          ConvolutionOperator::regularised_inverse()), refined by iterations on the residual:
+ *          f = W d, then f += W (d - K f) steps times; K the operator, W its inverse.
+ *
+ * W inverts the circulant K is embedded in, which errs near the grids' borders; every step
+ * multiplies that error by the spectral radius of I - W K -- about 0.2 for the pressures model on
+ * a 20x20 grid, but it exceeds 1 where K's symbol comes close to 0 (the 3-valued forces model, or
+ * large grids with little regularisation). The constructor estimates it by power iteration and
+ * drops the steps, with a warning, if they wouldn't converge. The steps are iterated Tikhonov
+ * regularisation: each one weakens the regularisation too. A step costs an application of K and
+ * one of W.
+ */
+class DeconvolutionOperator : public LinearOperator {
+public:
+  DeconvolutionOperator(
+    std::shared_ptr<const ConvolutionOperator> forward,
+    const double regularisation,
+    const size_t steps
+  );
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+
+  std::shared_ptr<const ConvolutionOperator> forward_;
+  std::shared_ptr<const ConvolutionOperator> inverse_;
+  size_t steps_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_CONVOLUTION_OPERATOR_HPP */
@@ -1,7 +1,16 @@
 #ifndef ELASTIC_MODEL_BOUSSINESQ_HPP
 #define ELASTIC_MODEL_BOUSSINESQ_HPP
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 #include "cm/details/external/armadillo.hpp"
+#include "cm/details/convolution_operator.hpp"
+#include "cm/details/hmatrix.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/mapped_operator.hpp"
+#include "cm/details/sparse_operator.hpp"
 
 /**
  * \cond DEV
@@ -27,12 +36,16 @@ namespace details {
  * \tparam d    displacements grid. Required for number of cells, locations, etc.
  * \param psi_exact   whether to calculate the Psi function for the approximate
  *                    solution using the exact formula or just set it to 0.25
+ * \param num_threads number of threads to assemble the matrix with (0: one per hardware
+ *                    thread). The columns are split among the threads; the result is the same
+ *                    for any number of threads.
  */
 arma::mat forces_to_displacements_matrix(
   const Grid& f,
   const Grid& d,
   const SkinAttributes& skin_attr,
-  const bool  psi_exact
+  const bool  psi_exact,
+  const size_t num_threads = 1
 );
 
 /**
@@ -42,6 +55,7 @@ arma::mat forces_to_displacements_matrix(
  * \param f    forces grid. Required for length and locations and such
  * \param psi_exact   whether to calculate the Psi function for the approximate
  *                    solution using the exact formula or just set it to 0.25
+ * \param num_threads \sa forces_to_displacements_matrix()
  *
  * Basically returns a pinv of forces_to_displacements_matrix()
  */
@@ -49,9 +63,101 @@ arma::mat displacements_to_forces_matrix(
   const Grid& d,
   const Grid& f,
   const SkinAttributes& skin_attr,
+  const bool  psi_exact,
+  const size_t num_threads = 1
+);
+
+/**
+ * \brief   The matrix of forces_to_displacements_matrix(), as an operator which evaluates the
+ *          coefficients whenever it's applied instead of storing them.
+ * \param   num_threads number of threads to apply the operator with (\sa
+ *                      forces_to_displacements_matrix())
+ *
+ * Takes memory linear in the number of cells (it copies their coordinates; the grids needn't
+ * outlive it); every application costs about as much as assembling the matrix.
+ */
+std::unique_ptr<LinearOperator> forces_to_displacements_operator(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool  psi_exact,
+  const size_t num_threads = 1
+);
+
+/**
+ * \brief   The matrix of forces_to_displacements_matrix() as a 2D convolution (\sa
+ *          ConvolutionOperator), or nullptr if the grids' cells don't lie on lattices of the
+ *          forces' cells' pitch (\sa fit_lattice()).
+ *
+ * Two grids made by Grid::fromFill() with the same cell shape qualify. Only the coefficients for
+ * the offsets between the lattices' nodes are evaluated: memory linear in the number of cells,
+ * every application O(n log n). The coefficients are evaluated at the exact offsets; the result
+ * matches the matrix's product up to rounding.
+ */
+std::unique_ptr<ConvolutionOperator> forces_to_displacements_convolution(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
   const bool  psi_exact
 );
 
+/**
+ * \brief   The matrix of forces_to_displacements_matrix() as a hierarchical matrix (\sa
+ *          HMatrixOperator), for grids of any layout.
+ * \param   tolerance   relative error of the blocks between far apart groups of cells, which
+ *                      are stored as low-rank products
+ * \param   num_threads \sa forces_to_displacements_matrix()
+ *
+ * Memory and every application O(n log n) in the number of cells; only the coefficients the
+ * cross approximation picks are evaluated for the far blocks.
+ */
+std::unique_ptr<HMatrixOperator> forces_to_displacements_hmatrix(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool  psi_exact,
+  const double tolerance,
+  const size_t num_threads = 1
+);
+
+/**
+ * \brief   The matrix of forces_to_displacements_matrix() with the coefficients between cells
+ *          further than radius apart dropped (\sa cutoff_operator()).
+ * \param   num_threads \sa forces_to_displacements_matrix()
+ *
+ * The coefficients decay as 1/distance beyond a few skin thicknesses: a radius of a few h keeps
+ * the ones above the sensors' noise, in memory linear in the number of cells.
+ */
+std::unique_ptr<SparseOperator> forces_to_displacements_sparse(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool  psi_exact,
+  const double radius,
+  const size_t num_threads = 1
+);
+
+/**
+ * \brief   The matrix of forces_to_displacements_matrix() in a file mapped into memory (\sa
+ *          MappedOperator), for matrices larger than the RAM.
+ * \param   path        file to keep the matrix in. If it already holds the matrix for the same
+ *                      grids and parameters (fingerprint: \sa model_fingerprint() of f, d and
+ *                      {E, nu, h, psi_exact}), it's mapped as is; otherwise it's replaced.
+ * \param   num_threads \sa forces_to_displacements_matrix()
+ *
+ * The columns are assembled straight into the mapping, a few dozen MB at a time, so only those
+ * have to be in memory while the file is written. Several processes computing with the same
+ * skin can share the file: the first one writes it, the others map it.
+ */
+std::unique_ptr<MappedOperator> forces_to_displacements_mapped(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool  psi_exact,
+  const std::string& path,
+  const size_t num_threads = 1
+);
+
 /**
  * \brief   Some even more hidden implementation details.
  */
@@ -119,24 +225,103 @@ struct CoeffsBouss {
 };
 
 /**
- * \brief   Calculate the 1D-forces -to- 1D-displacements matrix
+ * \brief   Quantities of the Boussinesq-Cerruti kernel which do not depend on the distance
+ *          between the points, i.e. are constant over a whole (forces, displacements) grid pair.
+ *
+ * CoeffsBouss recalculates all of those for every single pair of cells; the assembly of the
+ * matrices calculates them once and only evaluates the distance-dependent part per pair.
  */
-arma::mat f2d_11(const Grid& f, const Grid& d, const SkinAttributes& skin_attr);
+struct BoussInvariants {
+  /**
+   * \param   skin_attr   attributes of the skin
+   * \param   s           area of the forces' grid cell (for the approximate solution)
+   * \param   psi_exact   \sa CoeffsBouss
+   */
+  BoussInvariants(
+    const SkinAttributes& skin_attr,
+    const double s,
+    const bool   psi_exact
+  );
+  /**
+   * \brief Eq: $\frac{3}{4\pi E}$
+   */
+  const double c_3_4_pi_E;
+  /**
+   * \brief Thickness of the skin
+   */
+  const double h;
+  /**
+   * \brief Squared thickness of the skin
+   */
+  const double h2;
+  /**
+   * \brief Approximate solution, xx and yy components (\sa appro_xx())
+   */
+  const double a_xx;
+  /**
+   * \brief Approximate solution, zz component (\sa appro_zz())
+   */
+  const double a_zz;
+};
 
 /**
- * \brief   Calculate the 1D-forces -to- 3D-displacements matrix
+ * \brief   A tile of displacement cells for which the influence coefficients of a single force
+ *          cell are evaluated at once.
+ *
+ * Inputs (x,y) and outputs (m) are kept as separate arrays, so that the kernels below are plain
+ * loops over contiguous memory. The tile is small enough to stay in L1 cache while it is swept
+ * over all the forces' cells.
  */
-arma::mat f2d_13(const Grid& f, const Grid& d, const SkinAttributes& skin_attr);
+struct BoussTile {
+  /**
+   * \brief   Maximum number of displacement cells in a tile
+   */
+  static const size_t size = 128;
+  /**
+   * \brief   Distance between the points along the x axis (displacement.x - force.x)
+   */
+  double x[size];
+  /**
+   * \brief   Distance between the points along the y axis (displacement.y - force.y)
+   */
+  double y[size];
+  /**
+   * \brief   Influence coefficients; m[i][j] is the displacement along axis i caused by a unit
+   *          force along axis j (x = 0, y = 1, z = 2), with the exact/approximate selection already
+   *          applied.
+   */
+  double m[3][3][size];
+};
 
 /**
- * \brief   Calculate the 3D-forces -to- 1D-displacements matrix
+ * \name  Tile kernels
+ *
+ * Evaluate the influence coefficients for the first n entries of a tile; compiled for several
+ * instruction sets (\sa CM_VECTOR_CLONES). The kernels differ in which components of BoussTile::m
+ * they fill in:
+ *  - bouss_tile_zz()   -- m[2][2] only,
+ *  - bouss_tile_z()    -- m[2][0], m[2][1], m[2][2] (the zx, zy coefficients are equal to the xz,
+ *                         yz ones, so the same values serve both the 1-3 and 3-1 matrices),
+ *  - bouss_tile_full() -- all nine components.
  */
-arma::mat f2d_31(const Grid& f, const Grid& d, const SkinAttributes& skin_attr);
+/**\{*/
+void bouss_tile_zz(const BoussInvariants& inv, BoussTile& t, const size_t n);
+void bouss_tile_z(const BoussInvariants& inv, BoussTile& t, const size_t n);
+void bouss_tile_full(const BoussInvariants& inv, BoussTile& t, const size_t n);
+/**\}*/
 
 /**
- * \brief   Calculate the 3D-forces -to- 3D-displacements matrix
+ * \brief   Calculate the FDim-forces -to- DDim-displacements matrix
+ *
+ * Instantiated for FDim, DDim in {1, 3}; forces_to_displacements_matrix() picks the instance. The
+ * dimensionalities are template parameters so that the tile kernel and the layout of the result
+ * are fixed at compile time, with no branches or strides left to the inner loops. The skin's
+ * attributes, the psi mode and the cell's area only enter BoussInvariants, once per matrix, so
+ * they stay runtime parameters.
  */
-arma::mat f2d_33(const Grid& f, const Grid& d, const SkinAttributes& skin_attr);
+template <size_t FDim, size_t DDim>
+arma::mat f2d(const Grid& f, const Grid& d, const SkinAttributes& skin_attr, const bool psi_exact,
+  const size_t num_threads);
 
 /**
  * \brief   Calculate function Psi(x), as described in the thesis of Luca Muscari
@@ -1,7 +1,14 @@
 #ifndef ELASTIC_MODEL_LOVE_HPP
 #define ELASTIC_MODEL_LOVE_HPP
 
+#include <cstddef>
+#include <memory>
+
 #include "cm/details/external/armadillo.hpp"
+#include "cm/details/convolution_operator.hpp"
+#include "cm/details/hmatrix.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/sparse_operator.hpp"
 
 /**
  * \cond DEV
@@ -25,25 +32,133 @@ namespace details {
  *          displacements vector.
  * \param  p    pressures grid. Required for length and locations and such
  * \tparam d    displacements grid. Required for number of cells, locations, etc.
+ * \param  num_threads number of threads to assemble the matrix with (0: one per hardware
+ *                     thread). The columns are split among the threads; the result is the same
+ *                     for any number of threads.
+ * \param  surrogate_sampled_tol if > 0, the coefficients are interpolated from a table
+ *                     (\sa impl::LoveSurrogate) wherever their relative error is below this at
+ *                     samples of the table's cells, and evaluated exactly elsewhere: a sampled
+ *                     tolerance, not a bound. 0 evaluates all of them exactly.
  */
 arma::mat pressures_to_displacements_matrix(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const size_t num_threads = 1,
+  const double surrogate_sampled_tol = 0
+);
+
+/**
+ * \brief   The matrix of pressures_to_displacements_matrix(), as an operator which evaluates the
+ *          coefficients whenever it's applied instead of storing them.
+ * \param  num_threads number of threads to apply the operator with. The results are the same for
+ *                     any number of threads: apply() sums the columns up in chunks of a fixed
+ *                     size, in the same order.
+ * \param  surrogate_sampled_tol \sa pressures_to_displacements_matrix()
+ *
+ * Takes memory linear in the number of cells (the grids needn't outlive it). Every application
+ * evaluates the coefficients anew, with the same per-thread cache of the offsets as the assembly
+ * of the matrix: for a regular grid, most of them are found in there.
+ */
+std::unique_ptr<LinearOperator> pressures_to_displacements_operator(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const size_t num_threads = 1,
+  const double surrogate_sampled_tol = 0
+);
+
+/**
+ * \brief   The matrix of pressures_to_displacements_matrix() as a 2D convolution (\sa
+ *          ConvolutionOperator), or nullptr if the grids' cells don't lie on lattices of the
+ *          pressures' cells' pitch (\sa fit_lattice()).
+ *
+ * As forces_to_displacements_convolution(): the coefficients are evaluated exactly (there are
+ * only as many as there are offsets between the lattices' nodes), memory is linear in the number
+ * of cells and every application O(n log n).
+ */
+std::unique_ptr<ConvolutionOperator> pressures_to_displacements_convolution(
   const Grid& p,
   const Grid& d,
   const SkinAttributes& skin_attr
 );
 
+/**
+ * \brief   The matrix of pressures_to_displacements_matrix() as a hierarchical matrix (\sa
+ *          HMatrixOperator), for grids of any layout.
+ * \param   tolerance   relative error of the blocks between far apart groups of cells
+ * \param   num_threads \sa pressures_to_displacements_matrix()
+ *
+ * As forces_to_displacements_hmatrix(); the coefficients are evaluated exactly.
+ */
+std::unique_ptr<HMatrixOperator> pressures_to_displacements_hmatrix(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const double tolerance,
+  const size_t num_threads = 1
+);
+
+/**
+ * \brief   The matrix of pressures_to_displacements_matrix() with the coefficients between cells
+ *          further than radius apart dropped (\sa cutoff_operator()).
+ * \param   num_threads \sa pressures_to_displacements_matrix()
+ *
+ * As forces_to_displacements_sparse(); the coefficients are evaluated exactly.
+ */
+std::unique_ptr<SparseOperator> pressures_to_displacements_sparse(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const double radius,
+  const size_t num_threads = 1
+);
+
 /**
  * \brief   Calculate a matrix, which post-multiplied by the displacements vector will yield the
  *          pressures vector. (in least RMSE sense)
  * \param  p    pressures grid. Required for length and locations and such
  * \tparam d    displacements grid. Required for number of cells, locations, etc.
+ * \param  num_threads \sa pressures_to_displacements_matrix()
+ * \param  surrogate_sampled_tol \sa pressures_to_displacements_matrix()
  *
  * Basically returns a pinv of pressures_to_displacements_matrix()
  */
 arma::mat displacements_to_pressures_matrix(
   const Grid& d,
   const Grid& p,
-  const SkinAttributes& skin_attr
+  const SkinAttributes& skin_attr,
+  const size_t num_threads = 1,
+  const double surrogate_sampled_tol = 0
+);
+
+/**
+ * \brief   The matrix of pressures_to_displacements_matrix(), split into parts which don't depend
+ *          on the skin's material (\sa impl::love_terms_batch()).
+ *
+ * Kept by the algorithms in their parametric mode, so that a change of E or nu doesn't require
+ * assembling the matrix anew.
+ */
+struct LoveTermsMatrices {
+  arma::mat t_log;
+  arma::mat t_atan;
+
+  /**
+   * \brief   The matrix for the given material: love_c_log(E,nu) * t_log - love_c_atan(E,nu) * t_atan
+   */
+  arma::mat combine(const double E, const double nu) const;
+};
+
+/**
+ * \brief   Calculate the material-independent parts of pressures_to_displacements_matrix()
+ * \param   skin_attr   only the thickness (h) is used
+ * \param   num_threads \sa pressures_to_displacements_matrix()
+ */
+LoveTermsMatrices pressures_to_displacements_terms(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const size_t num_threads = 1
 );
 
 namespace impl {
@@ -76,6 +191,64 @@ double love_coeff(
   const double x, const double y, const double z
 );
 
+/**
+ * \brief   Batched influence coefficients: out[i] = love_coeff(dx,dy,E,nu,x[i],y[i],0)
+ *          - love_coeff(dx,dy,E,nu,x[i],y[i],h), i.e. the entries of
+ *          pressures_to_displacements_matrix() for n offsets at once.
+ * \param   h       Thickness of the skin
+ * \param   x,y     Arrays of n offsets (displacement point - pressure cell's origin)
+ * \param   out     Array of n results
+ *
+ * Evaluates the same formulae as love_coeff(), but:
+ *  - the radicals and ratios shared by the Lj's, the atan terms and the two depths are computed
+ *    once per point,
+ *  - differences prone to cancellation (r - |x|-like terms far from the cell) are evaluated in
+ *    their rationalised form,
+ *  - log and atan are evaluated by fast_log() and fast_atan(), and the loop is free of branches
+ *    and calls, so the compiler vectorises it.
+ *
+ * Accuracy (tested): within 10 cells' sizes of the pressure cell, the relative difference from
+ * love_coeff() is below 1e-8. Further away, the coefficients are orders of magnitude smaller than
+ * the terms they are summed from, and love_coeff() itself loses digits to the cancellation (up to
+ * ~1e-6 relative at 100 cells); there, the result is within 1e-7 of quad-precision reference values.
+ *
+ * Compiled for several instruction sets (\sa CM_VECTOR_CLONES); the AVX2 version is ~4x faster
+ * than love_coeff().
+ */
+void love_coeffs_batch(
+  const double dx, const double dy,
+  const double E, const double nu,
+  const double h,
+  const double* x, const double* y,
+  const size_t n,
+  double* out
+);
+
+/**
+ * \brief   The matrix entries of love_coeffs_batch(), split into terms which don't depend on E and
+ *          nu: love_coeffs_batch() == love_c_log(E,nu) * t_log - love_c_atan(E,nu) * t_atan
+ *
+ * Parameters as for love_coeffs_batch(); same accuracy.
+ */
+void love_terms_batch(
+  const double dx, const double dy,
+  const double h,
+  const double* x, const double* y,
+  const size_t n,
+  double* t_log,
+  double* t_atan
+);
+
+/**
+ * \brief   Coefficient of the log terms in love_coeff(): $\frac{1-\nu^2}{\pi E}$
+ */
+double love_c_log(const double E, const double nu);
+
+/**
+ * \brief   Coefficient of the atan terms in love_coeff(): $\frac{1+\nu}{2\pi E}$
+ */
+double love_c_atan(const double E, const double nu);
+
 /**
  * \brief   Helper functions for Love's problem.
  *
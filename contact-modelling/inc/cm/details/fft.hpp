@@ -0,0 +1,89 @@
+#ifndef DETAILS_FFT_HPP
+#define DETAILS_FFT_HPP
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Radix-2 fast Fourier transforms, for the convolutions of the elastic models on regular
+ *          grids (\sa ConvolutionOperator).
+ *
+ * Armadillo only gained its fft()/fft2() well after the version the library requires, hence these.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Smallest power of 2 >= n (1 for n == 0)
+ */
+size_t fft_size(const size_t n);
+
+/**
+ * \brief   In-place discrete Fourier transform of length n (a power of 2), applied to n elements
+ *          which are themselves vectors of m contiguous complex numbers: element k is
+ *          [k*m, (k+1)*m).
+ *
+ * With m == 1, that's the transform of a contiguous array; with m the row length of a row-major 2D
+ * array, it transforms all the columns at once, with the butterflies sweeping whole rows.
+ */
+class Fft1d {
+public:
+  explicit Fft1d(const size_t n);
+
+  size_t size() const { return n_; }
+
+  /**
+   * \brief   a[k] = sum_l a[l] * exp(-2*pi*i*k*l/n), or exp(+...) if inverse (unscaled either way)
+   */
+  void transform(std::complex<double>* a, const size_t m, const bool inverse) const;
+
+private:
+  size_t n_;
+  /**
+   * \brief   Bit-reversed indices
+   */
+  std::vector<size_t> rev_;
+  /**
+   * \brief   exp(-2*pi*i*k/n), k < n/2
+   */
+  std::vector<std::complex<double>> twiddles_;
+};
+
+/**
+ * \brief   In-place 2D discrete Fourier transform of an nx-by-ny row-major array (element (i,j) at
+ *          [i*ny + j]); nx, ny powers of 2.
+ */
+class Fft2d {
+public:
+  Fft2d(const size_t nx, const size_t ny);
+
+  size_t nx() const { return fx_.size(); }
+  size_t ny() const { return fy_.size(); }
+  size_t size() const { return nx() * ny(); }
+
+  void forward(std::complex<double>* a) const;
+
+  /**
+   * \brief   Inverse of forward(), including the 1/(nx*ny) factor
+   */
+  void inverse(std::complex<double>* a) const;
+
+private:
+  Fft1d fx_, fy_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_FFT_HPP */
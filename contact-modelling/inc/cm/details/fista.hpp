@@ -0,0 +1,87 @@
+#ifndef DETAILS_FISTA_HPP
+#define DETAILS_FISTA_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Non-negative least squares by an accelerated projected gradient, for grids too large
+ *          for an active set method.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   How fista() ended
+ */
+struct FistaReport {
+  /**
+   * \brief   Iterations done, each one a*v and a^T*w
+   */
+  size_t iterations = 0;
+  /**
+   * \brief   Times the momentum was reset
+   */
+  size_t restarts = 0;
+  /**
+   * \brief   Times the Lipschitz estimate was doubled, the step having overshot
+   */
+  size_t backtracks = 0;
+  /**
+   * \brief   The Lipschitz estimate the last step was taken with: the starting one, doubled
+   *          backtracks times
+   */
+  double lipschitz = 0;
+  /**
+   * \brief   The last step's gradient mapping, L ||x_k+1 - y_k||, relative to ||a^T b||
+   */
+  double relative_step = 0;
+  /**
+   * \brief   Whether relative_step got below the tolerance before max_iterations
+   */
+  bool converged = false;
+};
+
+/**
+ * \brief   Improve x towards min ||a x - b|| subject to x >= 0 by FISTA (Beck and Teboulle), with
+ *          O'Donoghue and Candes' adaptive restart: the momentum is reset whenever it points
+ *          against the last projected gradient step, and Beck and Teboulle's backtracking on the
+ *          step size.
+ * \param   lipschitz       the starting estimate of the Lipschitz constant of the gradient of
+ *                          ||a x - b||^2 / 2, the largest eigenvalue of a^T a (\sa
+ *                          largest_squared_singular_value()); the step is 1/lipschitz. An
+ *                          estimate from below is doubled as often as a step overshoots: the
+ *                          objective is higher than the quadratic model promised.
+ * \param   x               the starting point (e.g. the previous frame's solution; negative
+ *                          values are projected), and the result
+ * \param   max_iterations  iterations at most: with a and a^T's cost, a bound on the time taken
+ * \param   tolerance       stop once L ||x_k+1 - y_k|| is below this relative to ||a^T b||
+ *
+ * a's apply() and apply_transpose() are all there is to it: their threads are fista()'s. An
+ * iteration applies a once and a^T once, and a once more per backtrack.
+ */
+FistaReport fista(
+  const LinearOperator& a,
+  const double lipschitz,
+  const std::vector<double>& b,
+  std::vector<double>& x,
+  const size_t max_iterations,
+  const double tolerance
+);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_FISTA_HPP */
@@ -0,0 +1,114 @@
+#ifndef DETAILS_HMATRIX_HPP
+#define DETAILS_HMATRIX_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Hierarchical matrices: the elastic models on arbitrary grids, with the coefficients
+ *          between far apart groups of cells compressed to low rank.
+ */
+
+namespace cm {
+namespace details {
+
+struct CellCoordinates;
+
+/**
+ * \brief   A matrix from src_dim values per src cell to dst_dim values per dst cell (value a of
+ *          cell c at c*dim + a, as in the grids' raw values), stored as a hierarchical matrix.
+ *
+ * The cells of either grid are split recursively into clusters: halves of their bounding box at
+ * the median of its longer side, down to a few dozen cells. The blocks of the matrix are then
+ * the pairs of clusters which are far from each other relative to their sizes (admissible:
+ * min(diam) <= 2 * dist between their bounding boxes), or pairs of leaves. The admissible blocks
+ * are approximated to a relative tolerance by adaptive cross approximation with partial
+ * pivoting, which only evaluates the few rows and columns it picks; the others are stored dense.
+ *
+ * For kernels which decay smoothly with the distance (as the elastic models do beyond the
+ * neighbouring cells), the ranks stay small and bounded, so both the memory and the cost of
+ * apply() grow as O(n log n) in the number of cells -- whatever the layout of the cells, unlike
+ * ConvolutionOperator's.
+ */
+class HMatrixOperator : public LinearOperator {
+public:
+  /**
+   * \brief   Evaluates the coefficients of the matrix for dst cells dst[0..n_dst) (rows) and src
+   *          cells src[0..n_src) (columns) into block, which is already dst_dim*n_dst by
+   *          src_dim*n_src; laid out as in the full matrix.
+   *
+   * Called from several threads at once if num_threads > 1.
+   */
+  typedef std::function<void(
+    const size_t* src, const size_t n_src,
+    const size_t* dst, const size_t n_dst,
+    arma::mat& block
+  )> BlockFunction;
+
+  /**
+   * \param   tolerance   relative (Frobenius) error of every low-rank block
+   * \param   num_threads number of threads to build the blocks with (0: one per hardware
+   *                      thread); the result doesn't depend on it.
+   */
+  HMatrixOperator(
+    const CellCoordinates& src,
+    const CellCoordinates& dst,
+    const size_t src_dim,
+    const size_t dst_dim,
+    const BlockFunction& coefficients,
+    const double tolerance,
+    const size_t num_threads = 1
+  );
+
+  /**
+   * \brief   Number of coefficients stored in the blocks (for the full matrix: n_rows()*n_cols())
+   */
+  size_t stored_coefficients() const;
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+  /**
+   * \brief   From the blocks: the columns of the dense ones, and of u*v^T through u^T*u
+   */
+  std::vector<double> impl_column_norms() const;
+
+  /**
+   * \brief   Block of clusters: rows [dst_begin, dst_end) and columns [src_begin, src_end) of the
+   *          cells in tree order, either dense or u*v^T.
+   */
+  struct Block {
+    size_t src_begin, src_end;
+    size_t dst_begin, dst_end;
+    bool low_rank;
+    arma::mat dense;
+    arma::mat u, v;
+  };
+
+  size_t src_dim_, dst_dim_;
+  /**
+   * \brief   Cells in tree order: the original index of the i-th one, for either grid
+   */
+  std::vector<size_t> src_order_, dst_order_;
+  std::vector<Block> blocks_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_HMATRIX_HPP */
@@ -0,0 +1,111 @@
+#ifndef DETAILS_INVERSE_ENGINE_HPP
+#define DETAILS_INVERSE_ENGINE_HPP
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cm/details/string.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   The ways the inverse algorithms (AlgDisplacementsToPressures,
+ *          AlgDisplacementsToForces) reconstruct the tractions, and the checks of their flags
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   How an inverse algorithm reconstructs the tractions; a params_type chooses one
+ */
+enum class InverseEngine {
+  /**
+   * \brief   The pseudoinverse (or the Tikhonov inverse), stored as a matrix in some way
+   */
+  matrix,
+  deconvolution,
+  truncated_svd,
+  iterative,
+  coarse_to_fine
+};
+
+/**
+ * \brief   The engine chosen by p, one of the inverse algorithms' params_type.
+ *
+ * Throws std::runtime_error if p sets flags which contradict each other: two engines, a flag
+ * which only means something to another engine than the chosen one, or two of iterative's
+ * models. algorithm names the algorithm in the message.
+ */
+template <class Params>
+InverseEngine inverse_engine(const Params& p, const char* algorithm)
+{
+  std::vector<std::string> set;
+  InverseEngine ret = InverseEngine::matrix;
+  const auto engine = [&](const bool flag, const char* name, const InverseEngine e) {
+    if (flag) {
+      set.push_back(name);
+      ret = e;
+    }
+  };
+  engine(p.deconvolution, "deconvolution", InverseEngine::deconvolution);
+  engine(p.truncated_svd, "truncated_svd", InverseEngine::truncated_svd);
+  engine(p.iterative, "iterative", InverseEngine::iterative);
+  engine(p.coarse_to_fine, "coarse_to_fine", InverseEngine::coarse_to_fine);
+  if (set.size() > 1) {
+    throw std::runtime_error(sb() << algorithm << ": " << set[0] << " and " << set[1]
+      << " are two ways of inverting the model; set one at most");
+  }
+  const std::string engine_name = set.empty() ? std::string("the pseudoinverse") : set[0];
+
+  // the ways of storing the matrix
+  if (p.quantized && p.single_precision) {
+    throw std::runtime_error(sb() << algorithm
+      << ": quantized and single_precision are two ways of storing the inverse; set one at most");
+  }
+  if ((p.quantized || p.single_precision) && InverseEngine::matrix != ret) {
+    throw std::runtime_error(sb() << algorithm << ": "
+      << (p.quantized ? "quantized" : "single_precision") << " stores the inverse as a matrix; "
+      << engine_name << " doesn't");
+  }
+  if (p.tikhonov && InverseEngine::iterative == ret) {
+    throw std::runtime_error(sb() << algorithm << ": tikhonov doesn't apply to iterative");
+  }
+
+  // iterative's models
+  set.clear();
+  if (p.hierarchical) {
+    set.push_back("hierarchical");
+  }
+  if (p.cutoff_radius > 0) {
+    set.push_back("cutoff_radius");
+  }
+  if (p.matrix_free) {
+    set.push_back("matrix_free");
+  }
+  if (p.multigrid) {
+    set.push_back("multigrid");
+  }
+  if (!set.empty() && InverseEngine::iterative != ret) {
+    throw std::runtime_error(sb() << algorithm << ": " << set[0] << " only applies to iterative; "
+      << engine_name << " is set instead");
+  }
+  if (set.size() > 1 && "multigrid" != set[1]) {
+    throw std::runtime_error(sb() << algorithm << ": " << set[0] << " and " << set[1]
+      << " are two ways of storing the model; set one at most");
+  }
+  return ret;
+}
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_INVERSE_ENGINE_HPP */
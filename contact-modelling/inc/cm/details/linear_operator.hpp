@@ -0,0 +1,158 @@
+#ifndef DETAILS_LINEAR_OPERATOR_HPP
+#define DETAILS_LINEAR_OPERATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/parallel.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Linear maps which don't necessarily store their matrix.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   A linear map from R^n_cols() to R^n_rows(), i.e. a matrix A, of which only the products
+ *          A*x and A^T*y are available.
+ *
+ * The elastic models' matrices are dense, so storing them takes memory quadratic in the number of
+ * cells; implementations of this class may evaluate the coefficients whenever they're needed
+ * instead (\sa forces_to_displacements_operator(), pressures_to_displacements_operator()).
+ *
+ * Follows the non-virtual public interface idiom, as AlgInterface does.
+ */
+class LinearOperator {
+public:
+  virtual ~LinearOperator() = default;
+
+  /**
+   * \brief   Number of rows of A (the size of the result of apply())
+   */
+  size_t n_rows() const { return impl_n_rows(); }
+
+  /**
+   * \brief   Number of columns of A (the size of the result of apply_transpose())
+   */
+  size_t n_cols() const { return impl_n_cols(); }
+
+  /**
+   * \brief   y = A*x; x has n_cols() elements, y n_rows().
+   */
+  void apply(const double* x, double* y) const;
+
+  /**
+   * \brief   x = A^T*y; y has n_rows() elements, x n_cols().
+   */
+  void apply_transpose(const double* y, double* x) const;
+
+  /**
+   * \brief   A*x; throws std::runtime_error if x doesn't have n_cols() elements
+   */
+  std::vector<double> apply(const std::vector<double>& x) const;
+
+  /**
+   * \brief   A^T*y; throws std::runtime_error if y doesn't have n_rows() elements
+   */
+  std::vector<double> apply_transpose(const std::vector<double>& y) const;
+
+  /**
+   * \brief   The Euclidean norms of A's columns (e.g. for a diagonal preconditioner, \sa cgls())
+   */
+  std::vector<double> column_norms() const;
+
+  /**
+   * \brief   Some of A's columns, as an n_rows() x cols.size() matrix; throws std::runtime_error
+   *          if one is out of range
+   */
+  arma::mat columns(const std::vector<size_t>& cols) const;
+
+private:
+  virtual size_t impl_n_rows() const = 0;
+  virtual size_t impl_n_cols() const = 0;
+  virtual void impl_apply(const double* x, double* y) const = 0;
+  virtual void impl_apply_transpose(const double* y, double* x) const = 0;
+  /**
+   * \brief   By default, A applied to every unit vector: n_cols() applications. The operators
+   *          which store their coefficients do better.
+   */
+  virtual std::vector<double> impl_column_norms() const;
+  /**
+   * \brief   By default, A applied to the unit vectors of cols. The operators which store or
+   *          evaluate their coefficients only go through those columns'.
+   */
+  virtual arma::mat impl_columns(const std::vector<size_t>& cols) const;
+};
+
+/**
+ * \brief   LinearOperator backed by a stored matrix
+ *
+ * With a single thread, the products are armadillo's (BLAS); with more, as dense_apply() and
+ * dense_apply_transpose(), whose results don't depend on the number of threads but may differ
+ * from BLAS' in the last bits.
+ */
+class DenseOperator : public LinearOperator {
+public:
+  /**
+   * \param   num_threads number of threads to apply the matrix with (0: one per hardware thread)
+   */
+  explicit DenseOperator(arma::mat m, const size_t num_threads = 1);
+
+  /**
+   * \brief   The matrix
+   */
+  const arma::mat& matrix() const { return m_; }
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+  std::vector<double> impl_column_norms() const;
+  arma::mat impl_columns(const std::vector<size_t>& cols) const;
+
+  arma::mat m_;
+  std::shared_ptr<const WorkerPool> pool_;
+};
+
+/**
+ * \brief   y = m*x for the n_rows x n_cols column-major m, the rows split among pool's
+ *          threads; each element of y is summed up by a single thread in a fixed order.
+ */
+void dense_apply(
+  const double* m,
+  const size_t n_rows,
+  const size_t n_cols,
+  const double* x,
+  double* y,
+  const WorkerPool& pool
+);
+
+/**
+ * \brief   x = m^T*y, as dense_apply() with the columns split among the threads
+ */
+void dense_apply_transpose(
+  const double* m,
+  const size_t n_rows,
+  const size_t n_cols,
+  const double* y,
+  double* x,
+  const WorkerPool& pool
+);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_LINEAR_OPERATOR_HPP */
@@ -0,0 +1,159 @@
+#ifndef LOVE_SURROGATE_HPP
+#define LOVE_SURROGATE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Tabulated surrogate of the Love model's influence coefficients
+ */
+
+namespace cm {
+namespace details {
+namespace impl {
+
+/**
+ * \brief   Table of Love's influence coefficients (the matrix entries, \sa love_coeffs_batch())
+ *          for a given pressure cell, skin thickness and nu, interpolated instead of evaluating the
+ *          closed form.
+ *
+ * The coefficient is even in x and y, so only the quadrant x,y >= 0 is tabulated. The table's
+ * nodes are uniformly spaced in (log(1 + |x|/cell_x), log(1 + |y|/cell_y)): in the far field, the
+ * coefficients decay like a power of the distance, so their relative change between two nodes is
+ * about the same everywhere. Values are interpolated by tensor-product cubic Lagrange polynomials
+ * (4x4 nodes). The coefficient is inversely proportional to E; the table is for E = 1.
+ *
+ * Accuracy: the near field is evaluated exactly, i.e. the offsets within the larger of near_cells
+ * cells and 2h from the pressure cell in both directions. That covers the pressure cell's edges,
+ * where the coefficient isn't smooth. It also covers the ring where the coefficient changes its
+ * sign: at about h from the pressure cell for a skin thick relative to the cells, up to 1.7 h for
+ * a thin one. No relative error bound could hold there. Further out, a table cell is evaluated
+ * exactly as well if its interpolation's 4x4 nodes don't all have the same sign. It is also
+ * evaluated exactly if the interpolated coefficient is off the closed form by more than half of
+ * sampled_tol at any of 15 points: those of a lattice of a quarter of the table's step over the
+ * cell, but its corner node. The margin of half sampled_tol is for the error between the samples.
+ *
+ * That's a dense sampling, not a bound: nothing guarantees the error between the samples. Hence
+ * sampled_tol, and the algorithms which state an error bound of their own (e.g. a quantized
+ * inverse) don't take a surrogate.
+ */
+class LoveSurrogate
+{
+public:
+  /**
+   * \brief   Number of cells (in both directions) around the pressure cell evaluated exactly, at
+   *          least; more if the skin is thicker than that
+   */
+  static const size_t near_cells = 3;
+
+  /**
+   * \brief   Smallest sampled_tol accepted; the closed form itself isn't much more accurate than
+   *          that in the far field, where its terms cancel.
+   */
+  static constexpr double min_sampled_tol = 1e-7;
+
+  /**
+   * \brief   Build the table
+   * \param   dx,dy     0.5*dimensions of the pressure cell, \sa love_coeff()
+   * \param   h         Thickness of the skin
+   * \param   nu        Poisson's ratio
+   * \param   x_max,y_max   The table covers offsets with |x| <= x_max, |y| <= y_max
+   * \param   sampled_tol   Relative error allowed for the interpolated coefficients at the
+   *                        samples of every table cell; at least min_sampled_tol
+   */
+  LoveSurrogate(
+    const double dx, const double dy,
+    const double h,
+    const double nu,
+    const double x_max, const double y_max,
+    const double sampled_tol
+  );
+
+  /**
+   * \brief   A table for the given parameters, covering at least x_max, y_max; either one built
+   *          before by this function, or a new one.
+   *
+   * The last few tables built are kept around, so that e.g. repeated offline() calls for the same
+   * sensor don't rebuild them. Thread-safe.
+   */
+  static std::shared_ptr<const LoveSurrogate> get(
+    const double dx, const double dy,
+    const double h,
+    const double nu,
+    const double x_max, const double y_max,
+    const double sampled_tol
+  );
+
+  /**
+   * \brief   Interpolated coefficients at n offsets (x[k],y[k]), multiplied by E.
+   *
+   * served[k] is set to 0 if (x[k],y[k]) is to be evaluated exactly (near field, a marked cell, or
+   * outside of the table) -- coeff_times_E[k] is meaningless then -- and to 1 otherwise.
+   */
+  void lookup_batch(
+    const double* __restrict x, const double* __restrict y,
+    const size_t n,
+    double* __restrict coeff_times_E,
+    unsigned char* __restrict served
+  ) const;
+
+  /**
+   * \brief   Whether the table was built for those parameters and covers x_max, y_max
+   */
+  bool matches(
+    const double dx, const double dy,
+    const double h,
+    const double nu,
+    const double x_max, const double y_max,
+    const double sampled_tol
+  ) const;
+
+  /**
+   * \brief   Fraction of the table's cells which are evaluated exactly
+   */
+  double fraction_exact() const;
+
+private:
+  /**
+   * \brief   Interpolate at (s,t) (in units of step_) within table cell (i,j)
+   */
+  double interpolate(const double s, const double t, const size_t i, const size_t j) const;
+
+  double dx_, dy_, h_, nu_, x_max_, y_max_, sampled_tol_;
+  /**
+   * \brief   Spacing of the nodes in xi = log(1 + |x|/(2*dx)), eta = log(1 + |y|/(2*dy))
+   */
+  double step_, inv_step_;
+  double inv_cell_x_, inv_cell_y_;
+  /**
+   * \brief   Number of nodes along xi and eta
+   */
+  size_t nx_, ny_;
+  /**
+   * \brief   Values at the nodes for E = 1, including mirrored node -1 along both axes; node
+   *          (i,j) is at [(i+1)*(ny_+1) + j+1]
+   */
+  std::vector<double> values_;
+  /**
+   * \brief   Whether table cell (i,j) (between nodes i,i+1 and j,j+1) is evaluated exactly (1 or
+   *          0), at [i*(ny_+1) + j]; laid out like values_, for lookup_batch() to gather both
+   *          with the same indices.
+   */
+  std::vector<double> exact_;
+};
+
+} /* namespace impl */
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* LOVE_SURROGATE_HPP */
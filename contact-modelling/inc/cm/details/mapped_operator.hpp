@@ -0,0 +1,111 @@
+#ifndef DETAILS_MAPPED_OPERATOR_HPP
+#define DETAILS_MAPPED_OPERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Dense matrices kept in memory-mapped files, for models larger than the RAM.
+ */
+
+namespace cm {
+
+class Grid;
+
+namespace details {
+
+/**
+ * \brief   A dense matrix stored column-major in a file, which is mapped read-only for apply().
+ *
+ * The file starts with a 64-byte header -- a magic string, the matrix's size and a fingerprint
+ * of what it was computed from (\sa model_fingerprint()) -- followed by the coefficients. Only
+ * the pages being read need to be in memory, and every process mapping the same file shares
+ * them.
+ *
+ * A new file is written under a temporary name next to the final one, then renamed over it:
+ * processes which have the previous file mapped keep reading that one, whole and unchanged.
+ *
+ * apply() and apply_transpose() are dense_apply()'s and dense_apply_transpose().
+ */
+class MappedOperator : public LinearOperator {
+public:
+  /**
+   * \brief   Write a n_rows x n_cols matrix to path and map it.
+   * \param   fill  fills the matrix in, given an arma::mat using the mapped memory; whatever it
+   *                doesn't touch is 0. It may write a column at a time: only the pages it has
+   *                touched recently have to be in memory.
+   */
+  MappedOperator(
+    const std::string& path,
+    const size_t n_rows,
+    const size_t n_cols,
+    const uint64_t fingerprint,
+    const std::function<void(arma::mat&)>& fill,
+    const size_t num_threads = 1
+  );
+
+  /**
+   * \brief   Map the matrix previously written to path, if it's n_rows x n_cols and was computed
+   *          from fingerprint; nullptr otherwise (also if there's no such file).
+   */
+  static std::unique_ptr<MappedOperator> reuse(
+    const std::string& path,
+    const size_t n_rows,
+    const size_t n_cols,
+    const uint64_t fingerprint,
+    const size_t num_threads = 1
+  );
+
+  /**
+   * \brief   The coefficients, column-major
+   */
+  const double* data() const;
+
+private:
+  MappedOperator(const std::string& path, const size_t num_threads);
+
+  /**
+   * \brief   Map path and check its header
+   */
+  void open(const std::string& path);
+
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+
+  boost::iostreams::mapped_file_source file_;
+  size_t n_rows_, n_cols_;
+  uint64_t fingerprint_;
+  std::shared_ptr<const WorkerPool> pool_;
+};
+
+/**
+ * \brief   Hash (FNV-1a) of the layout of two grids -- dimensionality, cell shape and cell
+ *          coordinates -- and of some parameters: a matrix from src to dst computed with the same
+ *          parameters has the same fingerprint.
+ */
+uint64_t model_fingerprint(const Grid& src, const Grid& dst, const std::vector<double>& params);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_MAPPED_OPERATOR_HPP */
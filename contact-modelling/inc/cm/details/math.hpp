@@ -2,11 +2,28 @@
 #define DETAILS_MATH_HPP
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 /**
  * \cond DEV
  */
 
+/**
+ * \brief   Put in front of a function definition to have it compiled for several instruction set
+ *          extensions, the best one picked at load time.
+ *
+ * Meant for functions with loops that vectorise well (e.g. using the fast_* functions below); with
+ * AVX2/AVX-512 those run several times faster than with the baseline SSE2 of x86-64, without having
+ * to build the whole library with -march=native (\sa CM_NATIVE_ARCH in CMakeLists.txt). Only
+ * available with GCC on x86-64 Linux, a no-op elsewhere.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define CM_VECTOR_CLONES __attribute__((target_clones("avx512f", "arch=haswell", "default")))
+#else
+#define CM_VECTOR_CLONES
+#endif
+
 /**
  * \file 
  * \brief   Mathematical helpers.
@@ -22,6 +39,108 @@ inline bool eq_almost(double v1, double v2, double eps) {
   return std::abs(v1-v2) < std::abs(eps);
 }
 
+/**
+ * \name  Branch-free approximations of elementary functions
+ *
+ * Unlike their std:: counterparts, these are plain arithmetic (plus some bit twiddling) with no
+ * branches and no calls, so that a loop calling them can be vectorised by the compiler. They are
+ * meant for the batched kernels of the elastic models.
+ *
+ * Error bounds (checked by the unit tests against the std:: functions):
+ *  - fast_log(v):  relative error below 1e-15 for positive, normal, finite v. Zero, negative,
+ *                  subnormal and non-finite arguments give unspecified (but finite or NaN) results.
+ *  - fast_atan(v): relative error below 1e-15 for finite v.
+ */
+/**\{*/
+
+/**
+ * \brief   Natural logarithm. \sa The error bounds above.
+ *
+ * v = 2^k * m with m in [sqrt(2)/2, sqrt(2)); log(m) = 2*atanh(s) with s = (m-1)/(m+1), |s| < 0.172,
+ * evaluated by its Taylor series (11 terms leave a truncation error < 1e-18).
+ */
+inline double fast_log(const double v)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  // mantissa in [1,2)
+  const uint64_t m_bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+  // biased exponent converted to double without an int->double conversion (those don't vectorise
+  // without AVX-512): 2^52 + e has e in its lowest mantissa bits
+  const uint64_t e_bits = (bits >> 52) | 0x4330000000000000ull;
+  double m, e;
+  std::memcpy(&m, &m_bits, sizeof(m));
+  std::memcpy(&e, &e_bits, sizeof(e));
+  e -= 4503599627370496.0 + 1023.0;
+
+  const bool   big = m > 1.4142135623730951;
+  m = big ? 0.5*m : m;
+  e = big ? e + 1.0 : e;
+
+  const double s  = (m - 1.0) / (m + 1.0);
+  const double z  = s*s;
+  double p = 1.0/21;
+  p = p*z + 1.0/19;
+  p = p*z + 1.0/17;
+  p = p*z + 1.0/15;
+  p = p*z + 1.0/13;
+  p = p*z + 1.0/11;
+  p = p*z + 1.0/9;
+  p = p*z + 1.0/7;
+  p = p*z + 1.0/5;
+  p = p*z + 1.0/3;
+  const double log_m = 2*s + 2*s*z*p;
+
+  // ln(2) split into a part exactly representable when multiplied by e, and the rest
+  const double ln2_hi = 6.93147180369123816490e-01;
+  const double ln2_lo = 1.90821492927058770002e-10;
+  return e*ln2_hi + (log_m + e*ln2_lo);
+}
+
+/**
+ * \brief   Arc tangent. \sa The error bounds above.
+ *
+ * The argument is reduced to |t| <= tan(pi/8) (with a single division) via
+ * atan(v) = pi/4 + atan((v-1)/(v+1)) and atan(v) = pi/2 + atan(-1/v); atan(t) is then evaluated by
+ * its Taylor series (21 terms leave a truncation error < 1e-17).
+ */
+inline double fast_atan(const double v)
+{
+  const double a   = std::fabs(v);
+  const bool   mid = a > 0.41421356237309503;   // tan(pi/8)
+  const bool   big = a > 2.4142135623730949;    // tan(3*pi/8)
+  const double num = big ? -1.0 : (mid ? a - 1.0 : a);
+  const double den = big ? a    : (mid ? a + 1.0 : 1.0);
+  const double t   = num / den;
+
+  const double z = t*t;
+  double p = -1.0/41;
+  p = p*z + 1.0/39;
+  p = p*z - 1.0/37;
+  p = p*z + 1.0/35;
+  p = p*z - 1.0/33;
+  p = p*z + 1.0/31;
+  p = p*z - 1.0/29;
+  p = p*z + 1.0/27;
+  p = p*z - 1.0/25;
+  p = p*z + 1.0/23;
+  p = p*z - 1.0/21;
+  p = p*z + 1.0/19;
+  p = p*z - 1.0/17;
+  p = p*z + 1.0/15;
+  p = p*z - 1.0/13;
+  p = p*z + 1.0/11;
+  p = p*z - 1.0/9;
+  p = p*z + 1.0/7;
+  p = p*z - 1.0/5;
+  p = p*z + 1.0/3;
+  const double offset = big ? 1.5707963267948966 : (mid ? 0.78539816339744831 : 0.0);
+  const double r = offset + (t - t*z*p);
+  return std::copysign(r, v);
+}
+
+/**\}*/
+
 } /* namespace details */
 } /* namespace cm */
 
@@ -0,0 +1,167 @@
+#ifndef DETAILS_MULTIGRID_HPP
+#define DETAILS_MULTIGRID_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/convolution_operator.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Multigrid for the regularised normal equations of the models on regular grids.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Solves (a^T a + lambda I) x = a^T b for the tractions x on the cells of a lattice, by
+ *          conjugate gradients preconditioned with multigrid V-cycles.
+ *
+ * Level 0 has the traction cells; the cells of level l+1 are those of the lattice of twice level
+ * l's pitch (as Grid::fromFill() would place them over the same area) which contain some of level
+ * l's. Prolongation copies a cell's values to the cells it contains, restriction is its transpose
+ * (it sums them up), and level l's operator is the Galerkin one, N_l = R N_0 P, applied through
+ * level 0's. The coarsest level is factorised.
+ *
+ * The models smooth: a^T a is small on the oscillating tractions, and a smoother's usual job of
+ * damping them is lambda's. The smoother is rather a damped Jacobi step restricted to the
+ * complement of the next level (W-orthogonally, W being N_0's diagonal summed up over the
+ * cells), whose eigenvalues lie in a band about one level of frequencies wide: the condition
+ * number of the preconditioned system grows slowly with the number of levels, and doesn't with
+ * a smaller lambda. The steps' lengths are estimated by power iteration in the constructor; the
+ * diagonal costs a column_norms() of a.
+ *
+ * A V-cycle costs two applications of a and of a^T per level: O(n log^2 n) with a
+ * ConvolutionOperator, as against the pseudoinverse's O(n^3) offline.
+ */
+class Multigrid {
+public:
+  /**
+   * \param   lattice         the nodes of a's columns' cells (\sa fit_lattice())
+   * \param   dim             values per cell: a has dim*lattice.node.size() columns
+   * \param   regularisation  lambda relative to the largest eigenvalue of a^T a, as estimated
+   *                          by largest_squared_singular_value() to three digits
+   * \param   coarsest        values at most on the coarsest level, factorised
+   * \param   num_threads     threads to assemble the coarsest level with
+   */
+  Multigrid(
+    std::shared_ptr<const LinearOperator> a,
+    const Lattice& lattice,
+    const size_t dim,
+    const double regularisation,
+    const size_t coarsest = 128,
+    const size_t num_threads = 1
+  );
+
+  /**
+   * \brief   Number of levels, the cells' own included
+   */
+  size_t levels() const { return cells_.size(); }
+
+  /**
+   * \brief   Number of cells of a level
+   */
+  size_t cells(const size_t level) const { return cells_.at(level); }
+
+  /**
+   * \brief   The absolute lambda
+   */
+  double lambda() const { return lambda_; }
+
+  /**
+   * \brief   One V-cycle: e approximates (a^T a + lambda I)^-1 r. A symmetric positive definite
+   *          preconditioner for the iterative solvers.
+   */
+  void vcycle(const double* r, double* e) const;
+
+  /**
+   * \brief   Improve x towards the solution for b by preconditioned conjugate gradients
+   * \param   x               the starting point (e.g. the previous frame's solution), and the
+   *                          result
+   * \param   max_iterations  iterations at most, each one a V-cycle and a*v, a^T*w
+   * \param   tolerance       stop once the residual is below this relative to ||a^T b||
+   * \return  the number of iterations done
+   */
+  size_t solve(
+    const std::vector<double>& b,
+    std::vector<double>& x,
+    const size_t max_iterations,
+    const double tolerance
+  ) const;
+
+private:
+  /**
+   * \brief   y = N_level x
+   */
+  void normal(const size_t level, const double* x, double* y) const;
+
+  /**
+   * \brief   Level level's values of the next level's x
+   */
+  void prolong(const size_t level, const double* x, double* y) const;
+
+  /**
+   * \brief   Next level's values of level level's y: sums over its cells
+   */
+  void coarsen(const size_t level, const double* y, double* x) const;
+
+  /**
+   * \brief   out = W^-1 r - P (W_next)^-1 P^T r, W the weights (W_next = P^T W P): a Jacobi step
+   *          for r, minus its component on the next level
+   */
+  void complement(const size_t level, const double* r, double* out) const;
+
+  /**
+   * \brief   e += omega_level times r's complement
+   */
+  void smooth(const size_t level, const double* r, double* e) const;
+
+  void cycle(const size_t level, const double* r, double* e) const;
+
+  /**
+   * \brief   e = N_coarsest^-1 r, from the factor
+   */
+  void coarsest_solve(const double* r, double* e) const;
+
+  std::shared_ptr<const LinearOperator> a_;
+  size_t dim_;
+  double lambda_;
+  /**
+   * \brief   Cells of every level
+   */
+  std::vector<size_t> cells_;
+  /**
+   * \brief   parent_[l][c]: the cell of level l+1 containing cell c of level l
+   */
+  std::vector<std::vector<size_t>> parent_;
+  /**
+   * \brief   weight_[l]: the diagonal of N_0 for level 0, and the sums of the values' weights over
+   *          every cell for the next levels
+   */
+  std::vector<std::vector<double>> weight_;
+  /**
+   * \brief   Length of the Richardson step of every level but the coarsest
+   */
+  std::vector<double> omega_;
+  /**
+   * \brief   Upper triangular, r^T r = N_coarsest
+   */
+  arma::mat factor_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_MULTIGRID_HPP */
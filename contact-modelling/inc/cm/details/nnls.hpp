@@ -0,0 +1,109 @@
+#ifndef DETAILS_NNLS_HPP
+#define DETAILS_NNLS_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Non-negative least squares, warm-started from the previous solution.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Where NonnegativeLeastSquares::solve() left off: the solution, the passive set (the
+ *          variables free to be positive) and the Cholesky factor of its block of a^T a.
+ *
+ * Default-constructed, it starts with all the variables at 0.
+ */
+struct NnlsState {
+  /**
+   * \brief   The solution; 0 outside the passive set
+   */
+  std::vector<double> x;
+  /**
+   * \brief   The passive set, in the order of r's rows and columns
+   */
+  std::vector<size_t> passive;
+  /**
+   * \brief   Upper triangular, r^T r = (a^T a)(passive, passive); only the first
+   *          passive.size() rows and columns are meaningful
+   */
+  arma::mat r;
+};
+
+/**
+ * \brief   min ||a x - b|| subject to x >= 0, by Lawson and Hanson's active set method on the
+ *          normal equations (as Bro and de Jong's fast NNLS): a^T a is computed once, and so is
+ *          a^T b for every b.
+ *
+ * The Cholesky factor of a^T a's block for the passive set is updated when a variable joins the
+ * set, and downdated by Givens rotations when one leaves it: O(k^2) per change for k passive
+ * variables, instead of a factorisation. solve() starts from the passive set and factor it was
+ * given (those of the previous frame): between similar frames, a few changes of the set suffice.
+ */
+class NonnegativeLeastSquares {
+public:
+  /**
+   * \brief   Computes a^T a: by a BLAS product for a DenseOperator, otherwise from a applied
+   *          to every unit vector (with num_threads threads)
+   */
+  explicit NonnegativeLeastSquares(
+    std::shared_ptr<const LinearOperator> a,
+    const size_t num_threads = 1
+  );
+
+  size_t n_rows() const { return a_->n_rows(); }
+  size_t n_cols() const { return a_->n_cols(); }
+
+  /**
+   * \brief   The solution for b, starting from and updating state
+   * \param   tolerance   the solution is optimal once no variable of the active set decreases
+   *                      ||a x - b||^2 / 2 faster than tolerance times the largest of |a^T b|
+   *                      (how fast any variable does at x = 0)
+   * \return  the number of changes of the passive set
+   *
+   * A variable whose column is (numerically) a combination of the passive ones' is left out.
+   */
+  size_t solve(const double* b, NnlsState& state, const double tolerance = 1e-10) const;
+
+private:
+  /**
+   * \brief   Adds variable j at the end of the passive set, unless its column depends on the
+   *          passive ones'
+   */
+  bool add(const size_t j, NnlsState& state) const;
+
+  /**
+   * \brief   Removes the q-th variable of the passive set
+   */
+  void remove(const size_t q, NnlsState& state) const;
+
+  /**
+   * \brief   The unconstrained solution on the passive set, in its order
+   */
+  void solve_passive(const NnlsState& state, const std::vector<double>& atb,
+    std::vector<double>& z) const;
+
+  std::shared_ptr<const LinearOperator> a_;
+  arma::mat gram_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_NNLS_HPP */
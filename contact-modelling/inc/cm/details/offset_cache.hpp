@@ -0,0 +1,204 @@
+#ifndef DETAILS_OFFSET_CACHE_HPP
+#define DETAILS_OFFSET_CACHE_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Cache of influence coefficients keyed by the offset between two cells.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   An offset (x,y) between two cells, quantized and split into magnitude and signs.
+ *
+ * The elastic kernels only depend on the offset between the cells and are even or odd in x and
+ * y, so a cache needs to store coefficients for |x|, |y| only. The kernels are always evaluated at
+ * the quantized magnitudes (x,y below), not at the offset the key was made from; that way, the
+ * coefficient for a given key doesn't depend on which pair of cells happened to get evaluated
+ * first.
+ */
+struct OffsetKey {
+  /**
+   * \brief   |x| and |y| in units of the quantum
+   */
+  int64_t qx, qy;
+  /**
+   * \brief   Quantized |x| and |y|; the offset to evaluate the kernels at
+   */
+  double x, y;
+  /**
+   * \brief   Signs of the original offset, -1 or +1 (+1 for zero)
+   */
+  double sx, sy;
+};
+
+/**
+ * \brief   Open-addressing hash table from OffsetKey to a coefficient (or a set of those) V.
+ *
+ * The table grows as needed, up to max_entries; once full, get() keeps evaluating the kernel, but
+ * doesn't store the result anymore. It is not thread-safe -- give every thread its own cache.
+ */
+template <class V>
+class OffsetCache
+{
+public:
+  /**
+   * \param   quantum       Offsets closer than this are considered equal. Should be a tiny
+   *                        fraction of the grid's pitch.
+   * \param   max_entries   Upper bound on the number of offsets stored
+   */
+  OffsetCache(const double quantum, const size_t max_entries = (size_t(1) << 20))
+    : quantum_(quantum), inv_quantum_(1.0 / quantum), max_entries_(max_entries), num_entries_(0)
+  {
+    rehash(1024);
+  }
+
+  /**
+   * \brief   Make the key for offset (x,y).
+   */
+  OffsetKey key(const double x, const double y) const
+  {
+    OffsetKey k;
+    // |x| / quantum rounded to nearest; cheaper than llround() and the ties don't matter
+    k.qx = static_cast<int64_t>(std::fabs(x) * inv_quantum_ + 0.5);
+    k.qy = static_cast<int64_t>(std::fabs(y) * inv_quantum_ + 0.5);
+    k.x  = k.qx * quantum_;
+    k.y  = k.qy * quantum_;
+    k.sx = (x < 0) ? -1.0 : 1.0;
+    k.sy = (y < 0) ? -1.0 : 1.0;
+    return k;
+  }
+
+  /**
+   * \brief   Cached value for k, or nullptr if there is none yet.
+   */
+  const V* find(const OffsetKey& k) const
+  {
+    for (size_t i = slot(k);; i = (i + 1) & mask_) {
+      if (qx_[i] == empty) {
+        return nullptr;
+      }
+      if (qx_[i] == k.qx && qy_[i] == k.qy) {
+        return &values_[i];
+      }
+    }
+  }
+
+  /**
+   * \brief   Store v for k (unless the cache is full). k mustn't be in the cache already.
+   */
+  void insert(const OffsetKey& k, const V& v)
+  {
+    if (num_entries_ >= max_entries_) {
+      return;
+    }
+    if (2 * (num_entries_ + 1) > qx_.size()) {
+      rehash(2 * qx_.size());
+    }
+    size_t i = slot(k);
+    while (qx_[i] != empty) {
+      i = (i + 1) & mask_;
+    }
+    qx_[i] = k.qx;
+    qy_[i] = k.qy;
+    values_[i] = v;
+    ++num_entries_;
+  }
+
+  /**
+   * \brief   Cached value for k; if there is none, evaluate eval(k.x, k.y) and cache it.
+   */
+  template <class Eval>
+  V get(const OffsetKey& k, Eval eval)
+  {
+    const V* cached = find(k);
+    if (cached) {
+      return *cached;
+    }
+    const V v = eval(k.x, k.y);
+    insert(k, v);
+    return v;
+  }
+
+  /**
+   * \brief   Number of offsets stored
+   */
+  size_t size() const { return num_entries_; }
+
+private:
+  static const int64_t empty = -1;
+
+  size_t slot(const OffsetKey& k) const
+  {
+    uint64_t h = static_cast<uint64_t>(k.qx) * 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<uint64_t>(k.qy) + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+    h *= 0xBF58476D1CE4E5B9ull;
+    return static_cast<size_t>(h ^ (h >> 31)) & mask_;
+  }
+
+  void rehash(const size_t new_size)
+  {
+    std::vector<int64_t> old_qx;
+    std::vector<int64_t> old_qy;
+    std::vector<V>       old_values;
+    old_qx.swap(qx_);
+    old_qy.swap(qy_);
+    old_values.swap(values_);
+
+    qx_.assign(new_size, empty);
+    qy_.assign(new_size, empty);
+    values_.resize(new_size);
+    mask_ = new_size - 1;
+    num_entries_ = 0;
+    for (size_t i = 0; i < old_qx.size(); ++i) {
+      if (old_qx[i] != empty) {
+        OffsetKey k;
+        k.qx = old_qx[i];
+        k.qy = old_qy[i];
+        insert(k, old_values[i]);
+      }
+    }
+  }
+
+  double quantum_;
+  double inv_quantum_;
+  size_t max_entries_;
+  size_t num_entries_;
+  size_t mask_;
+  std::vector<int64_t> qx_;
+  std::vector<int64_t> qy_;
+  std::vector<V>       values_;
+};
+
+template <class V>
+const int64_t OffsetCache<V>::empty;
+
+/**
+ * \brief   Quantum for an OffsetCache on grids with cells of size dx * dy.
+ *
+ * 2^-30 of the smaller dimension: far below anything that could tell the coefficients apart, far
+ * above the rounding noise of differences of cells' coordinates.
+ */
+inline double offset_quantum(const double dx, const double dy)
+{
+  return std::ldexp((dx < dy) ? dx : dy, -30);
+}
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_OFFSET_CACHE_HPP */
@@ -0,0 +1,111 @@
+#ifndef DETAILS_PARALLEL_HPP
+#define DETAILS_PARALLEL_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Minimal helpers for splitting embarrassingly parallel work among threads.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Number of threads to actually use when `requested` were asked for.
+ *
+ * 0 stands for "as many as the hardware supports" (falls back to 1 if that can't be determined).
+ */
+size_t resolve_num_threads(const size_t requested);
+
+/**
+ * \brief   Call body(begin, end) for contiguous blocks [begin, end) covering [0, n), using up to
+ *          `num_threads` threads.
+ * \param   n           Number of items (e.g. columns of a matrix)
+ * \param   num_threads Number of threads; see resolve_num_threads(). With 1 (or when there is not
+ *                      enough work to split), body is called once, from the calling thread.
+ * \param   block_size  Number of items per block; if 0, a size is chosen so that every thread
+ *                      gets a few blocks.
+ *
+ * Blocks are handed out to the threads dynamically, so body must only touch data belonging to
+ * its own block. Whatever block a thread happens to get, the items are processed the same way,
+ * i.e. the results don't depend on the number of threads.
+ *
+ * If body throws, the remaining blocks are skipped and the first exception is rethrown in the
+ * calling thread once all the threads have finished.
+ *
+ * The threads are started and joined by every call: for one-off work, e.g. offline(). What runs
+ * at every run() (an operator's apply()) takes a WorkerPool instead.
+ */
+void parallel_for_blocks(
+  const size_t n,
+  const size_t num_threads,
+  const size_t block_size,
+  const std::function<void(size_t, size_t)>& body
+);
+
+/**
+ * \brief   Threads kept for the parallel_for_blocks() of an operator's every apply(), or of an
+ *          algorithm's every run(): no thread is started or joined per call.
+ *
+ * The workers are started by the first call which has work for them, and wait for the next one
+ * in between. One call is run at a time: a call from another thread waits for the current one to
+ * finish. A call from within a body (on one of the pool's threads) runs serially on the calling
+ * thread instead.
+ */
+class WorkerPool {
+public:
+  /**
+   * \param   num_threads the calling thread and num_threads - 1 workers; see
+   *                      resolve_num_threads()
+   */
+  explicit WorkerPool(const size_t num_threads);
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * \brief   Stop and join the workers
+   */
+  ~WorkerPool();
+
+  /**
+   * \brief   Number of threads, the calling one included (resolved: never 0)
+   */
+  size_t num_threads() const { return num_threads_; }
+
+private:
+  friend void parallel_for_blocks(const size_t, const WorkerPool&, const size_t,
+    const std::function<void(size_t, size_t)>&);
+
+  struct State;
+
+  size_t num_threads_;
+  std::unique_ptr<State> state_;
+};
+
+/**
+ * \brief   parallel_for_blocks() on pool's threads: the same blocks, and so the same results, as
+ *          with pool.num_threads() threads of their own
+ */
+void parallel_for_blocks(
+  const size_t n,
+  const WorkerPool& pool,
+  const size_t block_size,
+  const std::function<void(size_t, size_t)>& body
+);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_PARALLEL_HPP */
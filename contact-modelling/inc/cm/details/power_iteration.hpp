@@ -0,0 +1,51 @@
+#ifndef DETAILS_POWER_ITERATION_HPP
+#define DETAILS_POWER_ITERATION_HPP
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Largest eigenvalues by power iteration, for the regularisations and the step sizes.
+ */
+
+namespace cm {
+namespace details {
+
+class LinearOperator;
+
+/**
+ * \brief   The largest eigenvalue of a symmetric positive semi-definite n x n matrix, given by its
+ *          product with a vector: product(v, w) sets w to the matrix times v.
+ *
+ * Power iteration from a fixed pseudo-random vector (almost surely not orthogonal to the dominant
+ * eigenvector, and the same estimate every time), until the Rayleigh quotient changes by less
+ * than a relative tolerance, or for 1000 iterations if the largest eigenvalues are that close
+ * together. The Rayleigh quotient is never above the largest eigenvalue: it's an estimate from
+ * below. A tolerance of 1e-3 is plenty for the scale of a regularisation; a step size wants
+ * more digits.
+ */
+double power_iteration(
+  const size_t n,
+  const std::function<void(const double*, double*)>& product,
+  const double tolerance = 1e-6
+);
+
+/**
+ * \brief   The largest eigenvalue of a^T a, by power_iteration() through a's apply() and
+ *          apply_transpose(): without forming a^T a
+ */
+double largest_squared_singular_value(const LinearOperator& a, const double tolerance = 1e-6);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_POWER_ITERATION_HPP */
@@ -0,0 +1,85 @@
+#ifndef DETAILS_QUANTIZED_OPERATOR_HPP
+#define DETAILS_QUANTIZED_OPERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Precomputed matrices stored as 16-bit integers.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   A dense matrix stored column-major as 16-bit integers, with a scale per block of
+ *          block_rows rows of every column: m(i,j) ~= scale(i / block_rows, j) * q(i,j), the
+ *          largest coefficient of every block at +-32767.
+ *
+ * About a quarter of the memory of the doubles (64 integers and a float per block), and of the
+ * memory traffic of apply(), which is all its cost once the matrix doesn't fit in the caches.
+ * Every coefficient is off by at most half a step of its block, i.e. 1.5e-5 times the block's
+ * largest one. Scales per block rather than per column keep the small coefficients far from a
+ * column's peak (those of the pseudoinverses, which are concentrated around the diagonal) about as
+ * accurate as the large ones.
+ *
+ * apply() folds the scales into the operand, splits the rows among the threads and widens the
+ * integers on the fly (\sa CM_VECTOR_CLONES), summing up in double precision: the products add
+ * no error of their own to the rounding of the coefficients. apply_transpose() splits the
+ * columns.
+ */
+class QuantizedOperator : public LinearOperator {
+public:
+  /**
+   * \param   num_threads number of threads to apply() the matrix with (0: one per hardware
+   *                      thread); the result doesn't depend on it.
+   */
+  explicit QuantizedOperator(const arma::mat& m, const size_t num_threads = 1);
+
+  /**
+   * \brief   Frobenius norm of the rounding error, relative to that of the matrix
+   */
+  double relative_error() const { return relative_error_; }
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+
+  /**
+   * \brief   Rows per scale
+   */
+  static const size_t block_rows = 64;
+
+  size_t n_rows_, n_cols_;
+  /**
+   * \brief   Number of blocks of rows (the last one may be shorter)
+   */
+  size_t n_blocks_;
+  std::vector<int16_t> q_;
+  /**
+   * \brief   Scales of the blocks: of column j's block b at j*n_blocks_ + b
+   */
+  std::vector<float> scale_;
+  double relative_error_;
+  std::shared_ptr<const WorkerPool> pool_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_QUANTIZED_OPERATOR_HPP */
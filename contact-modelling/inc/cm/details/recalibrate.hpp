@@ -0,0 +1,71 @@
+#ifndef DETAILS_RECALIBRATE_HPP
+#define DETAILS_RECALIBRATE_HPP
+
+#include "cm/skin/attributes.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Helpers for the algorithms' recalibrate() (\sa AlgInterface::recalibrate())
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   Whether the skins differ in their material (E, nu) only, if at all.
+ *
+ * Only then can precomputed data be adapted instead of computed anew: all the models' coefficients
+ * are proportional to 1/E, and Love's are a combination of two nu-dependent terms.
+ */
+inline bool same_geometry(const SkinAttributes& a, const SkinAttributes& b)
+{
+  return a.h == b.h && a.taxelRadius == b.taxelRadius;
+}
+
+/**
+ * \brief   How data precomputed by one of Love's algorithms can be adapted to new parameters
+ */
+enum class LoveRecalibration {
+  /**
+   * \brief   It can't; offline() again.
+   */
+  offline,
+  /**
+   * \brief   Only E changed: scale by the ratio of the old to the new one (or its inverse).
+   */
+  rescale,
+  /**
+   * \brief   nu changed: combine the matrix's material-independent parts anew.
+   */
+  recombine
+};
+
+/**
+ * \brief   LoveRecalibration from p to np; Params is one of the Love algorithms' params_type.
+ */
+template <class Params>
+LoveRecalibration love_recalibration(const Params& p, const Params& np)
+{
+  // the surrogate's table depends on nu, but is merely scaled by E
+  if (p.parametric != np.parametric || p.surrogate_sampled_tol != np.surrogate_sampled_tol
+      || !same_geometry(p.skin_props, np.skin_props)) {
+    return LoveRecalibration::offline;
+  }
+  if (p.skin_props.nu == np.skin_props.nu) {
+    return LoveRecalibration::rescale;
+  }
+  return np.parametric ? LoveRecalibration::recombine : LoveRecalibration::offline;
+}
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_RECALIBRATE_HPP */
@@ -0,0 +1,118 @@
+#ifndef DETAILS_REGION_DECOMPOSITION_HPP
+#define DETAILS_REGION_DECOMPOSITION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cm/grid/cell.hpp"
+#include "cm/grid/grid.hpp"
+#include "cm/details/parallel.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   The skin split into regions whose tractions are solved for independently.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   The displacements' and the tractions' cells split into regions, each with its own
+ *          grids, and the tractions of the regions blended back into one grid.
+ *
+ * A cell is in the region of the nearest of the regions' positions (e.g. their taxels, \sa
+ * SkinRegions::positions()). A region's grids also take in the cells of the others within
+ * overlap of its own, its halo. A traction is the weighted mean of its own region's and of the
+ * halos' it's in: 1 for its own region, falling linearly from 1 to 0 across a halo, so that the
+ * regions' tractions blend into each other across their borders.
+ *
+ * The models of the regions' grids are a partition of the whole one, with the coefficients
+ * between regions further apart than overlap dropped: the offline phase costs sum O(n_i^2) of
+ * memory and sum O(n_i^3) of time for the inverses, instead of O(n^2) and O(n^3).
+ */
+class RegionDecomposition {
+public:
+  /**
+   * \param   regions   the positions of every region; those with no displacements or no
+   *                    tractions of their own are left out
+   * \param   overlap   width of the halos [m]; 0: none
+   */
+  RegionDecomposition(
+    const Grid& disps,
+    const Grid& tractions,
+    const std::vector<std::vector<GridCell>>& regions,
+    const double overlap
+  );
+
+  /**
+   * \brief   Number of regions
+   */
+  size_t size() const { return parts_.size(); }
+
+  /**
+   * \brief   The displacements' grid of a region, without values
+   */
+  const Grid& disps(const size_t region) const { return *parts_.at(region).disps; }
+
+  /**
+   * \brief   The tractions' grid of a region, without values
+   */
+  const Grid& tractions(const size_t region) const { return *parts_.at(region).tractions; }
+
+  /**
+   * \brief   Whether the decomposition was made for these regions and overlap
+   */
+  bool matches(const std::vector<std::vector<GridCell>>& regions, const double overlap) const;
+
+  /**
+   * \brief   The tractions for the displacements d: solve_region(r, disps, tractions) sets a
+   *          region's tractions from its displacements, for every region, on pool's threads; then
+   *          they're blended
+   */
+  std::vector<double> solve(
+    const std::vector<double>& d,
+    const WorkerPool& pool,
+    const std::function<void(size_t, const Grid&, Grid&)>& solve_region
+  ) const;
+
+private:
+  struct part_type {
+    std::unique_ptr<Grid> disps;
+    std::unique_ptr<Grid> tractions;
+    /**
+     * \brief   The cells of the whole grids, in the order of the region's
+     */
+    std::vector<size_t> disps_cells;
+    std::vector<size_t> tractions_cells;
+    /**
+     * \brief   The weight of every one of the region's tractions
+     */
+    std::vector<double> weights;
+  };
+
+  std::vector<std::vector<GridCell>> regions_;
+  double overlap_;
+  size_t disps_dim_;
+  size_t tractions_dim_;
+  size_t num_disps_;
+  std::vector<part_type> parts_;
+  /**
+   * \brief   The sum of the weights of every traction cell over the regions
+   */
+  std::vector<double> total_weights_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_REGION_DECOMPOSITION_HPP */
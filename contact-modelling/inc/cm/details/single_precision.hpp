@@ -0,0 +1,43 @@
+#ifndef DETAILS_SINGLE_PRECISION_HPP
+#define DETAILS_SINGLE_PRECISION_HPP
+
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Precomputed matrices stored in single precision.
+ *
+ * The sensors give about 12 significant bits, far fewer than a float's 24: the matrices the
+ * algorithms apply on every run() can be stored as floats, for half the memory and half the
+ * memory traffic of the product (which is all its cost, once the matrix doesn't fit in the
+ * caches). They are computed in double precision all the same, and rounded once at the end.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   m rounded to single precision; m itself is freed.
+ */
+arma::fmat to_single_precision(arma::mat& m);
+
+/**
+ * \brief   m * x, in single precision: x is rounded to floats and the product (BLAS' sgemv)
+ *          converted back to doubles.
+ */
+std::vector<double> multiply_single(const arma::fmat& m, const std::vector<double>& x);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_SINGLE_PRECISION_HPP */
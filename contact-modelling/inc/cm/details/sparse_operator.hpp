@@ -0,0 +1,115 @@
+#ifndef DETAILS_SPARSE_OPERATOR_HPP
+#define DETAILS_SPARSE_OPERATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/hmatrix.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   The elastic models with the coefficients between distant cells dropped, stored sparse.
+ */
+
+namespace cm {
+namespace details {
+
+struct CellCoordinates;
+
+/**
+ * \brief   A matrix from src_dim values per src cell to dst_dim values per dst cell (value a of
+ *          cell c at c*dim + a, as in the grids' raw values), of which only some (dst cell, src
+ *          cell) blocks are non-zero: block-compressed rows.
+ *
+ * Row block i (dst cell i) has the non-zero blocks [row_begin[i], row_begin[i+1]), in increasing
+ * order of their src cells cols[k]; block k's coefficients are
+ * values[k*dst_dim*src_dim, (k+1)*dst_dim*src_dim), row-major. With 1-valued cells on both sides
+ * that's plain CSR; for the 3D models, the 3x3 blocks keep the index overhead at one per 9
+ * coefficients.
+ *
+ * apply() splits the rows among the threads. apply_transpose() splits them in chunks of
+ * transpose_chunk dst cells, whatever the number of threads, each scattered into partial sums of
+ * its own (n_cols() values per chunk) which are then added up in order: the result doesn't
+ * depend on the number of threads.
+ */
+class SparseOperator : public LinearOperator {
+public:
+  SparseOperator(
+    const size_t n_src,
+    const size_t src_dim,
+    const size_t dst_dim,
+    std::vector<size_t> row_begin,
+    std::vector<size_t> cols,
+    std::vector<double> values,
+    const size_t num_threads = 1
+  );
+
+  /**
+   * \brief   Number of non-zero blocks
+   */
+  size_t nonzero_blocks() const { return cols_.size(); }
+
+  /**
+   * \brief   Number of dst cells per chunk of apply_transpose()
+   */
+  static const size_t transpose_chunk = 2048;
+
+  /**
+   * \brief   The coefficients as compressed columns, with int indices: column j has the
+   *          coefficients values[col_begin[j], col_begin[j+1]), in rows row_ind[...], increasing.
+   */
+  void compressed_columns(
+    std::vector<int>& col_begin,
+    std::vector<int>& row_ind,
+    std::vector<double>& values
+  ) const;
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+  std::vector<double> impl_column_norms() const;
+
+  size_t n_src_;
+  size_t src_dim_, dst_dim_;
+  std::vector<size_t> row_begin_;
+  std::vector<size_t> cols_;
+  std::vector<double> values_;
+  std::shared_ptr<const WorkerPool> pool_;
+};
+
+/**
+ * \brief   The matrix whose coefficients are given by `coefficients` (\sa
+ *          HMatrixOperator::BlockFunction) for the cells no further than radius apart, and 0
+ *          for the others.
+ * \param   num_threads number of threads to evaluate the coefficients with, and to apply() the
+ *                      result with (0: one per hardware thread)
+ *
+ * The pairs of cells are found through buckets of about radius by radius: time and memory
+ * linear in the number of non-zero blocks.
+ */
+std::unique_ptr<SparseOperator> cutoff_operator(
+  const CellCoordinates& src,
+  const CellCoordinates& dst,
+  const size_t src_dim,
+  const size_t dst_dim,
+  const HMatrixOperator::BlockFunction& coefficients,
+  const double radius,
+  const size_t num_threads = 1
+);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_SPARSE_OPERATOR_HPP */
@@ -0,0 +1,99 @@
+#ifndef DETAILS_SYMMETRIC_OPERATOR_HPP
+#define DETAILS_SYMMETRIC_OPERATOR_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   The models between coinciding grids, which are symmetric, and their inverses.
+ */
+
+namespace cm {
+
+class Grid;
+
+namespace details {
+
+/**
+ * \brief   Whether the grids have the same cells, in the same order, of the same shape and
+ *          dimensionality (e.g. one was made by the other's clone_structure()).
+ *
+ * The 1-valued models between two such grids -- normal forces by Boussinesq, pressures by Love
+ * -- are symmetric: a coefficient depends on the distance of two cells, or on the offset of two
+ * cells of the same shape, symmetric under reflection.
+ */
+bool coincide(const Grid& a, const Grid& b);
+
+/**
+ * \brief   The pseudoinverse of the symmetric a, or its Tikhonov-regularised inverse, through
+ *          a's eigendecomposition (arma::eig_sym(), which reads a single triangle of a).
+ * \param   regularisation  0 for the pseudoinverse, otherwise lambda relative to the largest
+ *                          squared eigenvalue (\sa tikhonov_inverse())
+ *
+ * With eigenvalues e and eigenvectors q, q * diag(filter(e)) * q^T with the filter of the
+ * pseudoinverse (1/e for |e| above arma::pinv()'s tolerance, 0 otherwise) or Tikhonov's,
+ * e / (e^2 + lambda). The symmetric eigendecomposition takes about half the time of the SVD of
+ * arma::pinv().
+ */
+arma::mat symmetric_inverse(const arma::mat& a, const double regularisation = 0);
+
+/**
+ * \brief   A symmetric matrix of which only the upper triangle is stored, packed: column j's
+ *          rows [0, j] at j*(j+1)/2. Half the memory and memory traffic of the dense matrix.
+ *
+ * apply() (as apply_transpose()) splits the rows among the threads in blocks of block_rows: a
+ * block reads the upper triangle's columns to its right in contiguous pieces of block_rows, and
+ * its rows' columns of the triangle for those to its left. Every coefficient is read once (those
+ * of the diagonal blocks twice); the result doesn't depend on the number of threads.
+ */
+class SymmetricOperator : public LinearOperator {
+public:
+  /**
+   * \brief   The upper triangle of the square m
+   * \param   num_threads number of threads to apply() the matrix with (0: one per hardware
+   *                      thread)
+   */
+  explicit SymmetricOperator(const arma::mat& m, const size_t num_threads = 1);
+
+  /**
+   * \brief   other times scale
+   */
+  SymmetricOperator(const SymmetricOperator& other, const double scale);
+
+  /**
+   * \brief   The packed upper triangle
+   */
+  const std::vector<double>& packed() const { return packed_; }
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+
+  /**
+   * \brief   Rows per block of apply()
+   */
+  static const size_t block_rows = 64;
+
+  size_t n_;
+  std::vector<double> packed_;
+  std::shared_ptr<const WorkerPool> pool_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_SYMMETRIC_OPERATOR_HPP */
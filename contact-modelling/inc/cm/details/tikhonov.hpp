@@ -0,0 +1,54 @@
+#ifndef DETAILS_TIKHONOV_HPP
+#define DETAILS_TIKHONOV_HPP
+
+#include <cstddef>
+
+#include "cm/details/external/armadillo.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   Tikhonov-regularised inverses through a Cholesky factorisation, instead of the
+ *          pseudoinverse's SVD.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   The largest eigenvalue of the symmetric positive semi-definite g, to a relative 1e-6
+ *          (\sa power_iteration())
+ */
+double largest_eigenvalue(const arma::mat& g);
+
+/**
+ * \brief   The Tikhonov-regularised inverse of a: (a^T a + lambda I)^-1 a^T.
+ * \param   regularisation  lambda relative to the largest eigenvalue of a^T a (the largest
+ *                          squared singular value of a), like the deconvolution's (\sa
+ *                          ConvolutionOperator::regularised_inverse())
+ *
+ * The Gram matrix is factorised by Cholesky, of the smaller side: if a has fewer rows than
+ * columns, the same inverse is computed as a^T (a a^T + lambda I)^-1. Along with forming the Gram
+ * matrix and the two triangular solves for the explicit inverse (by LAPACK, over all the columns
+ * at once), that's several times cheaper than the SVD of arma::pinv(). Singular values of a well
+ * above sqrt(lambda) are inverted as by the pseudoinverse; those below are damped rather than
+ * amplified, so noise in the displacements doesn't blow up into the tractions.
+ *
+ * The largest eigenvalue is estimated by power iteration (\sa largest_eigenvalue()).
+ */
+arma::mat tikhonov_inverse(
+  const arma::mat& a,
+  const double regularisation
+);
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_TIKHONOV_HPP */
@@ -0,0 +1,122 @@
+#ifndef DETAILS_TRUNCATED_SVD_HPP
+#define DETAILS_TRUNCATED_SVD_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+
+/**
+ * \cond DEV
+ */
+
+/**
+ * \file
+ * \brief   The models' singular value decompositions, kept to invert them with any filter of the
+ *          singular values.
+ */
+
+namespace cm {
+namespace details {
+
+/**
+ * \brief   The k largest singular values of a matrix a, and their singular vectors:
+ *          a ~= u * diag(s) * v^T.
+ */
+struct TruncatedSVD {
+  /**
+   * \brief   Left singular vectors, a.n_rows x k
+   */
+  arma::mat u;
+  /**
+   * \brief   Singular values, decreasing
+   */
+  arma::colvec s;
+  /**
+   * \brief   Right singular vectors, a.n_cols x k
+   */
+  arma::mat v;
+  /**
+   * \brief   Whether these are all the singular values
+   */
+  bool complete;
+
+  /**
+   * \brief   Whether a SpectralInverseOperator of the given rank can be made of these
+   */
+  bool covers(const size_t rank) const
+  {
+    return complete || (rank > 0 && rank <= s.n_elem);
+  }
+};
+
+/**
+ * \brief   The rank largest singular values of a; all of them if rank is 0 or not less than the
+ *          smaller side of a.
+ *
+ * All of them come from arma::svd_econ(). Fewer come from a randomized range finder (Halko,
+ * Martinsson and Tropp): a is applied to rank + 10 random vectors, twice more to the results
+ * (a^T, then a) to sharpen the decay of the singular values, which are then those of the small
+ * projection of a onto the range found. O(m n k) instead of the SVD's O(m n min(m,n)); the random
+ * vectors are seeded the same every time, so is the result.
+ */
+TruncatedSVD truncated_svd(const arma::mat& a, const size_t rank);
+
+/**
+ * \brief   The inverse of a model through its singular value decomposition:
+ *          v * diag(filter(s)) * u^T, applied in O((m+n) k) for k singular values.
+ *
+ * The filter is that of the pseudoinverse, 1/s for the singular values above its tolerance
+ * (max(m,n) s_max times the machine epsilon) and 0 for the others; or that of Tikhonov's
+ * regularisation, s / (s^2 + lambda) with lambda relative to s_max^2 (\sa tikhonov_inverse()).
+ * Only the rank largest singular values are used (all those stored if 0).
+ *
+ * The decomposition is shared, so that operators of other ranks, filters or scales (\sa
+ * svd()) cost O(k) to make. apply() splits the rows among the threads, so does apply_transpose();
+ * the result doesn't depend on their number.
+ */
+class SpectralInverseOperator : public LinearOperator {
+public:
+  /**
+   * \param   scale           the model is scale times the decomposed matrix (e.g. the ratio of
+   *                          the old to the new E)
+   * \param   regularisation  0 for the pseudoinverse's filter, otherwise Tikhonov's
+   * \param   num_threads     number of threads to apply() the operator with (0: one per hardware
+   *                          thread)
+   */
+  SpectralInverseOperator(
+    std::shared_ptr<const TruncatedSVD> svd,
+    const size_t rank,
+    const double regularisation,
+    const double scale = 1,
+    const size_t num_threads = 1
+  );
+
+  const std::shared_ptr<const TruncatedSVD>& svd() const { return svd_; }
+  double scale() const { return scale_; }
+
+private:
+  size_t impl_n_rows() const;
+  size_t impl_n_cols() const;
+  void impl_apply(const double* x, double* y) const;
+  void impl_apply_transpose(const double* y, double* x) const;
+
+  std::shared_ptr<const TruncatedSVD> svd_;
+  double scale_;
+  /**
+   * \brief   The filtered inverses of the singular values used
+   */
+  std::vector<double> filter_;
+  std::shared_ptr<const WorkerPool> pool_;
+};
+
+} /* namespace details */
+} /* namespace cm */
+
+/**
+ * \endcond
+ */
+
+#endif /* DETAILS_TRUNCATED_SVD_HPP */
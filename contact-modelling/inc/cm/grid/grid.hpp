@@ -18,6 +18,24 @@
 
 namespace cm {
 
+/**
+ * \brief   Orders of a grid's cells, \sa Grid::reorderCells()
+ */
+enum class CellOrder {
+  /**
+   * the order the cells were constructed in
+   */
+  original,
+  /**
+   * along the Z-order curve: the bits of the cells' coordinates interleaved
+   */
+  morton,
+  /**
+   * along the Hilbert curve: as local as the Z-order, without its long jumps between quadrants
+   */
+  hilbert
+};
+
 /**
  * \brief   Structure of 'cells' at which forces/pressure/displacements can be
  * determined.
@@ -309,6 +327,45 @@ public:
    */
         bad_cells_type& getBadCells();
 
+  /**
+   * \brief   Sort the cells (and their values and metadata) along a space-filling curve.
+   * \param   order   the curve; CellOrder::original restores the order of construction
+   *
+   * Cells are ordered however they came in: Grid::fromFill() goes x-major, the skin providers
+   * follow their files. Along a space-filling curve, the cells close to each other in space are
+   * mostly close in the grid as well -- and so are the coefficients for nearby cells in the
+   * elastic models' matrices, near their diagonals. That's better use of the caches in the
+   * assembly and in the interpolators, and more compressible blocks for the hierarchical and
+   * sparse storage (\sa AlgForcesToDisplacements::params_type).
+   *
+   * The curve goes through the cells' bounding box, quantised to 2^16 x 2^16; cells in the same
+   * quantum keep their relative order. The permutation is kept (\sa getPermutation()), so the
+   * values can still be exchanged in the original order, e.g. with a skin provider (\sa
+   * setRawValuesInOriginalOrder()); dumpForPlot() dumps in the original order as well.
+   *
+   * \warning Reorder the grids before the offline phase of the interpolators and algorithms
+   * that use them: the precomputed data (and the metadata of an interpolator's target grid)
+   * refer to the cells by their positions at that time.
+   */
+  void reorderCells(const CellOrder order);
+
+  /**
+   * \brief   Cell i had position getPermutation()[i] in the order of construction; empty if the
+   *          cells have never been reordered.
+   */
+  const std::vector<size_t>& getPermutation() const;
+
+  /**
+   * \brief   The values, cell after cell in the order of construction (\sa reorderCells())
+   */
+  values_container getRawValuesInOriginalOrder() const;
+
+  /**
+   * \brief   Assign new values, given cell after cell in the order of construction (\sa
+   *          reorderCells()). Bounds-safe.
+   */
+  void setRawValuesInOriginalOrder(const values_container& other);
+
   /**
    * \brief   Remove cells (and their associated values and metadata) from the grid
    * \param   indices  A sorted vector of unique IDs of points to be erased
@@ -439,6 +496,12 @@ private:
    */
   bad_cells_type      bad_cells_;  
 
+  /**
+   * \brief   Position of every cell in the order of construction, if reordered; \sa
+   *          getPermutation()
+   */
+  std::vector<size_t> permutation_;
+
   /**
    * \brief   Shape of each of the grid's cells.
    */
@@ -0,0 +1,64 @@
+#ifndef REGIONS_HPP
+#define REGIONS_HPP
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "cm/grid/cell.hpp"
+
+/**
+ * \file
+ * \brief   Definition of SkinRegions struct
+ */
+
+namespace cm {
+
+class Grid;
+
+/**
+ * \brief   A partition of the skin's taxels into regions, as described by SkinWare's
+ * regionalisation cache (e.g. `data/regionalisation.cache`).
+ *
+ * The cache lists the taxels of every sensor type, the sub-regions as ranges of those lists and
+ * the regions as sets of sub-regions:
+\verbatim
+sensors-count  sensor-types-count
+(sensor-types-count lines) sensors-of-type-count  sensor-id...
+sub-regions-count
+(sub-regions-count lines) sensors-begin  sensors-end (sensor-types-count pairs)
+regions-count  total-sub-region-indices-count
+(regions-count lines) sub-regions-of-region-count  sub-region...
+\endverbatim
+ * Anything after that is ignored.
+ */
+struct SkinRegions {
+  /**
+   * \brief   taxels[r]: the taxels of region r, increasing. A taxel is numbered by its position in
+   * the calibration cache, i.e. by the order of construction of a skin provider's grid.
+   */
+  std::vector<std::vector<size_t>> taxels;
+
+  /**
+   * \brief   Read a regionalisation cache; throws std::runtime_error if it's malformed.
+   */
+  static SkinRegions fromCache(const std::string& path);
+
+  /**
+   * \brief   Read a regionalisation cache from a stream
+   */
+  static SkinRegions fromCache(std::istream& in);
+
+  /**
+   * \brief   The positions of every region's taxels, taken from a grid of the taxels (e.g. made
+   * by SkinProviderInterface::createGrid()), reordered or not (\sa Grid::reorderCells()): the
+   * regions of the algorithms that decompose the skin (\sa
+   * AlgDisplacementsToPressures::params_type::regions).
+   */
+  std::vector<std::vector<GridCell>> positions(const Grid& taxels_grid) const;
+};
+
+} /* namespace cm */
+
+#endif /* REGIONS_HPP */
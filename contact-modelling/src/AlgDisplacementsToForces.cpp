@@ -1,17 +1,163 @@
 #include "cm/algorithm/displacements_to_forces.hpp"
 
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "cm/grid/grid.hpp"
 
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/cgls.hpp"
+#include "cm/details/coarse_to_fine.hpp"
 #include "cm/details/elastic_model_boussinesq.hpp"
+#include "cm/details/inverse_engine.hpp"
+#include "cm/details/multigrid.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/details/quantized_operator.hpp"
+#include "cm/details/recalibrate.hpp"
+#include "cm/details/region_decomposition.hpp"
+#include "cm/details/single_precision.hpp"
 #include "cm/details/string.hpp"
+#include "cm/details/symmetric_operator.hpp"
+#include "cm/details/tikhonov.hpp"
+#include "cm/details/truncated_svd.hpp"
 #include "cm/details/external/armadillo.hpp"
+#include "cm/log/log.hpp"
 
 namespace cm {
 using details::sb;
 
-typedef arma::mat   precomputed_type;
+namespace {
+struct precomputed_type {
+  /**
+   * \brief   The pseudoinverse
+   */
+  arma::mat m;
+  /**
+   * \brief   The pseudoinverse in single precision, used instead of it if single_precision
+   */
+  arma::fmat m_single;
+  /**
+   * \brief   Used instead of m when deconvolving, mapped, quantized or symmetric
+   */
+  std::shared_ptr<const details::LinearOperator> op;
+  /**
+   * \brief   The model itself, if iterative
+   */
+  std::shared_ptr<const details::LinearOperator> forward;
+  /**
+   * \brief   The preconditioner of cgls() for forward
+   */
+  std::vector<double> scaling;
+  /**
+   * \brief   Used instead of cgls() if multigrid and the forces' grid is regular
+   */
+  std::shared_ptr<const details::Multigrid> multigrid;
+  /**
+   * \brief   Used instead of the inverse if coarse_to_fine
+   */
+  std::shared_ptr<const details::CoarseToFine> windows;
+  /**
+   * \brief   The last run()'s forces, the next one's starting point
+   */
+  std::shared_ptr<std::vector<double>> last;
+  /**
+   * \brief   The regions, if regions; every one's precomputed data is in parts
+   */
+  std::shared_ptr<const details::RegionDecomposition> regions;
+  std::vector<boost::any> parts;
+  /**
+   * \brief   The threads the regions are solved on at every run(), if regions
+   */
+  std::shared_ptr<const details::WorkerPool> pool;
+};
+
+/**
+ * \brief   The parameters of every region's inverse, if regions
+ */
+AlgDisplacementsToForces::params_type region_params(
+  const AlgDisplacementsToForces::params_type& p
+)
+{
+  AlgDisplacementsToForces::params_type ret = p;
+  ret.regions.clear();
+  ret.num_threads = 1;
+  return ret;
+}
+
+/**
+ * \brief   The engine chosen by p (\sa details::inverse_engine()), which a mapped_file is one
+ *          more way of storing the matrix of
+ */
+details::InverseEngine check_params(const AlgDisplacementsToForces::params_type& p)
+{
+  const details::InverseEngine ret = details::inverse_engine(p, "AlgDisplacementsToForces");
+  if (!p.mapped_file.empty()) {
+    if (details::InverseEngine::matrix != ret || p.quantized || p.single_precision) {
+      throw std::runtime_error("AlgDisplacementsToForces: mapped_file only stores the "
+        "pseudoinverse (or the Tikhonov inverse) in double precision");
+    }
+    if (!p.regions.empty()) {
+      throw std::runtime_error("AlgDisplacementsToForces: mapped_file can't hold the inverses "
+        "of several regions");
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief   Whether the model is symmetric: normal forces and displacements on the same cells
+ */
+bool symmetric(
+  const Grid& disps,
+  const Grid& forces
+)
+{
+  return 1 == disps.dim() && 1 == forces.dim() && details::coincide(disps, forces);
+}
+
+/**
+ * \brief   The pseudoinverse, or the Tikhonov-regularised inverse if p.tikhonov
+ */
+arma::mat inverse_matrix(
+  const Grid& disps,
+  const Grid& forces,
+  const AlgDisplacementsToForces::params_type& p
+)
+{
+  if (symmetric(disps, forces)) {
+    using cm::details::forces_to_displacements_matrix;
+    return details::symmetric_inverse(
+      forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact, p.num_threads),
+      p.tikhonov ? p.regularisation : 0);
+  }
+  if (p.tikhonov) {
+    using cm::details::forces_to_displacements_matrix;
+    return details::tikhonov_inverse(
+      forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact, p.num_threads),
+      p.regularisation);
+  }
+  using cm::details::displacements_to_forces_matrix;
+  return displacements_to_forces_matrix(disps, forces, p.skin_props, p.psi_exact, p.num_threads);
+}
+
+/**
+ * \brief   The inverse of the model through its truncated SVD
+ */
+std::shared_ptr<const details::LinearOperator> spectral_inverse(
+  const Grid& disps,
+  const Grid& forces,
+  const AlgDisplacementsToForces::params_type& p
+)
+{
+  using cm::details::forces_to_displacements_matrix;
+  return std::make_shared<const details::SpectralInverseOperator>(
+    std::make_shared<const details::TruncatedSVD>(details::truncated_svd(
+      forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact, p.num_threads),
+      p.svd_rank)),
+    p.svd_rank, p.tikhonov ? p.regularisation : 0, 1, p.num_threads);
+}
+} /* anonymous namespace */
 
 boost::any AlgDisplacementsToForces::impl_offline(
   const Grid& disps,
@@ -32,8 +178,126 @@ boost::any AlgDisplacementsToForces::impl_offline(
     );
 
   const params_type& p = boost::any_cast<const params_type&>(params);
-  using cm::details::displacements_to_forces_matrix;
-  return displacements_to_forces_matrix(disps, forces, p.skin_props, p.psi_exact);
+  check_params(p);
+  precomputed_type ret;
+  if (!p.regions.empty()) {
+    ret.regions = std::make_shared<const details::RegionDecomposition>(disps, forces, p.regions,
+      p.region_overlap);
+    ret.pool = std::make_shared<const details::WorkerPool>(p.num_threads);
+    const params_type part = region_params(p);
+    ret.parts.resize(ret.regions->size());
+    details::parallel_for_blocks(ret.parts.size(), p.num_threads, 1,
+      [&](const size_t begin, const size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+          ret.parts[r] = impl_offline(ret.regions->disps(r), ret.regions->tractions(r), part);
+        }
+      });
+    return ret;
+  }
+  if (p.iterative) {
+    // the multigrid needs the cells on a lattice; the model is then a convolution, usually
+    details::Lattice lattice;
+    const bool regular = p.multigrid && details::fit_lattice(details::CellCoordinates(forces),
+      forces.getCellShape().dx(), forces.getCellShape().dy(), lattice);
+    if (p.multigrid && !regular) {
+      LOG(DEBUG) << "AlgDisplacementsToForces: the grid isn't regular, no multigrid.";
+    }
+    if (regular && !(p.cutoff_radius > 0)) {
+      using cm::details::forces_to_displacements_convolution;
+      ret.forward = forces_to_displacements_convolution(forces, disps, p.skin_props, p.psi_exact);
+    }
+    if (!ret.forward) {
+      if (p.hierarchical) {
+        using cm::details::forces_to_displacements_hmatrix;
+        ret.forward = forces_to_displacements_hmatrix(forces, disps, p.skin_props, p.psi_exact,
+          p.hierarchical_tolerance, p.num_threads);
+      } else if (p.cutoff_radius > 0) {
+        using cm::details::forces_to_displacements_sparse;
+        ret.forward = forces_to_displacements_sparse(forces, disps, p.skin_props, p.psi_exact,
+          p.cutoff_radius, p.num_threads);
+      } else if (p.matrix_free) {
+        using cm::details::forces_to_displacements_operator;
+        ret.forward = forces_to_displacements_operator(forces, disps, p.skin_props, p.psi_exact,
+          p.num_threads);
+      } else {
+        using cm::details::forces_to_displacements_matrix;
+        ret.forward = std::make_shared<const details::DenseOperator>(
+          forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact, p.num_threads));
+      }
+    }
+    if (regular) {
+      ret.multigrid = std::make_shared<const details::Multigrid>(ret.forward, lattice,
+        forces.dim(), p.regularisation, 128, p.num_threads);
+    } else {
+      ret.scaling = details::column_scaling(*ret.forward);
+    }
+    ret.last = std::make_shared<std::vector<double>>(ret.forward->n_cols(), 0.0);
+    return ret;
+  }
+  if (p.coarse_to_fine) {
+    const double dx = p.coarse_factor * forces.getCellShape().dx();
+    const double dy = p.coarse_factor * forces.getCellShape().dy();
+    const std::unique_ptr<const Grid> coarse(Grid::fromFill(forces.dim(), Rectangle(dx, dy),
+      forces));
+    using cm::details::forces_to_displacements_operator;
+    ret.windows = std::make_shared<const details::CoarseToFine>(
+      forces_to_displacements_operator(forces, disps, p.skin_props, p.psi_exact, p.num_threads),
+      inverse_matrix(disps, *coarse, p), details::CellCoordinates(forces),
+      details::CellCoordinates(*coarse), forces.dim(), (0.5 + p.window_dilation) * dx,
+      (0.5 + p.window_dilation) * dy, p.contact_threshold, p.regularisation);
+    return ret;
+  }
+  if (p.deconvolution) {
+    using cm::details::forces_to_displacements_convolution;
+    std::shared_ptr<const details::ConvolutionOperator> forward =
+      forces_to_displacements_convolution(forces, disps, p.skin_props, p.psi_exact);
+    if (forward) {
+      ret.op = std::make_shared<const details::DeconvolutionOperator>(forward, p.regularisation,
+        p.refinement_steps);
+      return ret;
+    }
+    LOG(DEBUG) << "AlgDisplacementsToForces: the grids aren't regular, no deconvolution.";
+  }
+  if (p.truncated_svd) {
+    ret.op = spectral_inverse(disps, forces, p);
+    return ret;
+  }
+  if (p.mapped_file.empty()) {
+    ret.m = inverse_matrix(disps, forces, p);
+    if (p.quantized) {
+      const auto q = std::make_shared<const details::QuantizedOperator>(ret.m, p.num_threads);
+      LOG(INFO) << "AlgDisplacementsToForces: quantized the pseudoinverse, relative error "
+        << q->relative_error();
+      ret.op = q;
+      ret.m.reset();
+    } else if (p.single_precision) {
+      ret.m_single = details::to_single_precision(ret.m);
+    } else if (symmetric(disps, forces)) {
+      ret.op = std::make_shared<const details::SymmetricOperator>(ret.m, p.num_threads);
+      ret.m.reset();
+    }
+    return ret;
+  }
+
+  using cm::details::MappedOperator;
+  const size_t n_rows = forces.dim() * forces.num_cells();
+  const size_t n_cols = disps.dim() * disps.num_cells();
+  // the fifth parameter tells it from the forward model's matrix between the same grids, and the
+  // pseudoinverse (1) from the Tikhonov inverse (2)
+  std::vector<double> fingerprinted = {p.skin_props.E, p.skin_props.nu, p.skin_props.h,
+    double(p.psi_exact), p.tikhonov ? 2.0 : 1.0};
+  if (p.tikhonov) {
+    fingerprinted.push_back(p.regularisation);
+  }
+  const uint64_t fingerprint = details::model_fingerprint(disps, forces, fingerprinted);
+  ret.op = MappedOperator::reuse(p.mapped_file, n_rows, n_cols, fingerprint, p.num_threads);
+  if (!ret.op) {
+    ret.op = std::make_shared<const MappedOperator>(p.mapped_file, n_rows, n_cols, fingerprint,
+      [&](arma::mat& m) { m = inverse_matrix(disps, forces, p); },
+      p.num_threads
+    );
+  }
+  return ret;
 }
 
 void AlgDisplacementsToForces::impl_run(
@@ -55,11 +319,119 @@ void AlgDisplacementsToForces::impl_run(
             << disps.dim() << "; supported dimensionalities: (1,3)"
     );
 
-  const precomputed_type& pre = boost::any_cast<precomputed_type>(precomputed);
+  const params_type& p = boost::any_cast<const params_type&>(params);
+  const precomputed_type& pre = boost::any_cast<const precomputed_type&>(precomputed);
+  if (pre.regions) {
+    const params_type part = region_params(p);
+    forces.setRawValues(pre.regions->solve(disps.getRawValues(), *pre.pool,
+      [&](const size_t r, const Grid& d, Grid& t) { impl_run(d, t, part, pre.parts[r]); }));
+    return;
+  }
+  if (pre.multigrid) {
+    const size_t iterations = pre.multigrid->solve(disps.getRawValues(), *pre.last,
+      p.max_iterations, p.iterative_tolerance);
+    LOG(DEBUG) << "AlgDisplacementsToForces: " << iterations << " multigrid iterations";
+    forces.setRawValues(*pre.last);
+    return;
+  }
+  if (pre.forward) {
+    const size_t iterations = details::cgls(*pre.forward, pre.scaling, disps.getRawValues(),
+      *pre.last, p.max_iterations, p.iterative_tolerance);
+    LOG(DEBUG) << "AlgDisplacementsToForces: " << iterations << " CGLS iterations";
+    forces.setRawValues(*pre.last);
+    return;
+  }
+  if (pre.windows) {
+    size_t window = 0;
+    forces.setRawValues(pre.windows->solve(disps.getRawValues(), &window));
+    LOG(DEBUG) << "AlgDisplacementsToForces: solved for " << window << " of "
+      << forces.num_cells() << " cells";
+    return;
+  }
+  if (pre.op) {
+    forces.setRawValues(pre.op->apply(disps.getRawValues()));
+    return;
+  }
+  if (!pre.m_single.is_empty()) {
+    forces.setRawValues(details::multiply_single(pre.m_single, disps.getRawValues()));
+    return;
+  }
   std::vector<double> tmp = arma::conv_to<std::vector<double>>::from(
-      pre * arma::conv_to<arma::colvec>::from(disps.getRawValues())
+      pre.m * arma::conv_to<arma::colvec>::from(disps.getRawValues())
     );
   forces.setRawValues(std::move(tmp));
 }
 
+boost::any AlgDisplacementsToForces::impl_recalibrate(
+  const Grid& disps,
+  const Grid& forces,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  const params_type& p  = boost::any_cast<const params_type&>(params);
+  const params_type& np = boost::any_cast<const params_type&>(new_params);
+  const precomputed_type& pre = boost::any_cast<const precomputed_type&>(precomputed);
+  const details::InverseEngine engine = check_params(np);
+  // every region's precomputed data is recalibrated on its own
+  if (pre.regions || !np.regions.empty()) {
+    if (!pre.regions || !pre.regions->matches(np.regions, np.region_overlap)) {
+      return impl_offline(disps, forces, new_params);
+    }
+    precomputed_type ret;
+    ret.regions = pre.regions;
+    ret.pool = std::make_shared<const details::WorkerPool>(np.num_threads);
+    ret.parts.resize(pre.parts.size());
+    const params_type part = region_params(p);
+    const params_type new_part = region_params(np);
+    details::parallel_for_blocks(ret.parts.size(), np.num_threads, 1,
+      [&](const size_t begin, const size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+          ret.parts[r] = impl_recalibrate(pre.regions->disps(r), pre.regions->tractions(r), part,
+            pre.parts[r], new_part);
+        }
+      });
+    return ret;
+  }
+  // only E may change, and so the model's scale
+  if (engine != check_params(p) || p.psi_exact != np.psi_exact
+      || !details::same_geometry(p.skin_props, np.skin_props)) {
+    return impl_offline(disps, forces, new_params);
+  }
+  // a kept decomposition is filtered anew, whatever the rank (down to the stored one), the filter
+  // or E
+  if (details::InverseEngine::truncated_svd == engine) {
+    const auto spectral =
+      std::dynamic_pointer_cast<const details::SpectralInverseOperator>(pre.op);
+    if (!spectral || !spectral->svd()->covers(np.svd_rank)) {
+      return impl_offline(disps, forces, new_params);
+    }
+    precomputed_type ret;
+    ret.op = std::make_shared<const details::SpectralInverseOperator>(spectral->svd(),
+      np.svd_rank, np.tikhonov ? np.regularisation : 0,
+      spectral->scale() * (p.skin_props.E / np.skin_props.E), np.num_threads);
+    return ret;
+  }
+  // the deconvolution's offline() is cheap; the model to iterate on or the windows' are computed
+  // anew, and so is a mapped or quantized pseudoinverse; a symmetric one is rescaled
+  const auto symmetric = std::dynamic_pointer_cast<const details::SymmetricOperator>(pre.op);
+  if (details::InverseEngine::matrix != engine || (pre.op && !symmetric)
+      || !np.mapped_file.empty() || np.quantized || p.single_precision != np.single_precision
+      || p.tikhonov != np.tikhonov || (np.tikhonov && p.regularisation != np.regularisation)) {
+    return impl_offline(disps, forces, new_params);
+  }
+  // the (pseudo- or Tikhonov, with a relative lambda) inverse of a matrix proportional to 1/E,
+  // independent of nu
+  precomputed_type ret;
+  if (symmetric) {
+    ret.op = std::make_shared<const details::SymmetricOperator>(*symmetric,
+      np.skin_props.E / p.skin_props.E);
+    return ret;
+  }
+  ret.m = pre.m * (np.skin_props.E / p.skin_props.E);
+  ret.m_single = pre.m_single * float(np.skin_props.E / p.skin_props.E);
+  return ret;
+}
+
 } /* namespace cm */
@@ -7,10 +7,13 @@
 #include <functional>
 
 #include "cm/details/external/armadillo.hpp"
-#include "libtsnnls/tsnnls.h"
 
 #include "cm/grid/grid.hpp"
 #include "cm/log/log.hpp"
+#include "cm/details/fista.hpp"
+#include "cm/details/nnls.hpp"
+#include "cm/details/power_iteration.hpp"
+#include "cm/details/recalibrate.hpp"
 #include "cm/details/string.hpp"
 #include "cm/details/elastic_model_boussinesq.hpp"
 
@@ -21,10 +24,32 @@ using details::sb;
  * \cond DEV
  */
 namespace details {
+namespace {
 struct precomputed_type {
-  typedef std::shared_ptr<taucs_ccs_matrix> sh_ptr_type;
-  sh_ptr_type taucs_m;
+  /**
+   * \brief   The active set solver, unless fista
+   */
+  std::shared_ptr<const NonnegativeLeastSquares> nnls;
+  /**
+   * \brief   The matrix, for fista
+   */
+  std::shared_ptr<const LinearOperator> forward;
+  /**
+   * \brief   The largest eigenvalue of forward^T forward, for fista: its starting Lipschitz
+   *          estimate
+   */
+  double lipschitz = 0;
+  /**
+   * \brief   The last run()'s solution (and passive set), the next one's starting point
+   */
+  std::shared_ptr<NnlsState> state;
+  /**
+   * \brief   Factor to multiply the solution by; the matrix is shared by all the recalibrated
+   *          copies, which differ in E only.
+   */
+  double solution_scale = 1;
 };
+} /* anonymous namespace */
 }
 /**
  * \endcond
@@ -48,26 +73,26 @@ boost::any AlgDisplacementsToNonnegativeNormalForces::impl_offline(
             << disps.dim() << "; supported dimensionalities: (1,)"
     );
 
-  using cm::details::forces_to_displacements_matrix;
   const params_type& p = boost::any_cast<const params_type&>(params);
-  arma::mat fd_matrix  = forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact);
-  // 1st : taucs_construct_sorted_ccs_matrix requires row-major ordering (as per README of
-  // libtsnnls).
-  std::vector<double> tempvec;
-  tempvec.reserve(fd_matrix.size());
-  std::for_each(
-    fd_matrix.begin_row(0),
-    fd_matrix.end_row(fd_matrix.n_rows - 1),
-    [&](double value) {
-      tempvec.push_back(value);
-    }
-  );
-
   details::precomputed_type ret;
-  ret.taucs_m = details::precomputed_type::sh_ptr_type(
-    taucs_construct_sorted_ccs_matrix(tempvec.data(), fd_matrix.n_cols, fd_matrix.n_rows),
-    taucs_ccs_free
-  );
+  std::shared_ptr<const details::LinearOperator> forward;
+  if (p.cutoff_radius > 0) {
+    using cm::details::forces_to_displacements_sparse;
+    forward = forces_to_displacements_sparse(forces, disps, p.skin_props, p.psi_exact,
+      p.cutoff_radius, p.num_threads);
+  } else {
+    using cm::details::forces_to_displacements_matrix;
+    forward = std::make_shared<const details::DenseOperator>(
+      forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact, p.num_threads),
+      p.num_threads);
+  }
+  if (p.fista) {
+    ret.forward = forward;
+    ret.lipschitz = details::largest_squared_singular_value(*forward);
+  } else {
+    ret.nnls = std::make_shared<const details::NonnegativeLeastSquares>(forward, p.num_threads);
+  }
+  ret.state = std::make_shared<details::NnlsState>();
 
   return ret;
 }
@@ -91,31 +116,48 @@ void AlgDisplacementsToNonnegativeNormalForces::impl_run(
             << disps.dim() << "; supported dimensionalities: (1,)"
     );
 
-  const details::precomputed_type& pre = boost::any_cast<details::precomputed_type>(precomputed);
-  // taucs_double is just double (as per taucs.h:117
-  // so when we have to pass taucs_double* as b, we can take the data from disps.getRawValues()
-  // (which is std::vector<double>)
-  double residualNorm;
-  // libtsnnls requires double* instead of const double* (meh), so we either have to const_cast the
-  // stuff or create a local copy
-  std::vector<double> d_vals;
-  d_vals.assign(disps.getRawValues().cbegin(), disps.getRawValues().cend());
-  double* solution = t_snnls(pre.taucs_m.get(), d_vals.data(), &residualNorm, -1, 1);
-  if (!solution) {
-    throw std::runtime_error(
-      sb() << "libtsnnls returned nullptr as the solution"
-    );
+  const details::precomputed_type& pre =
+    boost::any_cast<const details::precomputed_type&>(precomputed);
+  if (pre.forward) {
+    const params_type& p = boost::any_cast<const params_type&>(params);
+    const details::FistaReport report = details::fista(*pre.forward, pre.lipschitz,
+      disps.getRawValues(), pre.state->x, p.max_iterations, p.iterative_tolerance);
+    LOG(DEBUG) << "fista: " << report.iterations << " iterations, " << report.restarts
+      << " restarts, " << report.backtracks << " backtracks, relative step "
+      << report.relative_step
+      << (report.converged ? "" : " (not converged)");
+  } else {
+    const size_t changes = pre.nnls->solve(disps.getRawValues().data(), *pre.state);
+    LOG(DEBUG) << "nnls: " << changes << " changes of the passive set";
   }
-  LOG(DEBUG) << "nnls residual norm: " << residualNorm;
 
-  std::vector<double> tmp;
-  tmp.reserve(pre.taucs_m->n);
-  for (size_t i = 0; i < (size_t)pre.taucs_m->n; ++i) {
-    tmp.push_back(*(solution+i));
+  std::vector<double> tmp(pre.state->x);
+  for (double& v : tmp) {
+    v *= pre.solution_scale;
   }
   forces.setRawValues(std::move(tmp));
+}
 
-  free(solution);
+boost::any AlgDisplacementsToNonnegativeNormalForces::impl_recalibrate(
+  const Grid& disps,
+  const Grid& forces,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  const params_type& p  = boost::any_cast<const params_type&>(params);
+  const params_type& np = boost::any_cast<const params_type&>(new_params);
+  if (p.psi_exact != np.psi_exact || p.cutoff_radius != np.cutoff_radius || p.fista != np.fista
+      || !details::same_geometry(p.skin_props, np.skin_props)) {
+    return impl_offline(disps, forces, new_params);
+  }
+  // the matrix is proportional to 1/E, so is the solution to E (nonnegativity is preserved); the
+  // copy starts where the original is
+  details::precomputed_type ret = boost::any_cast<details::precomputed_type>(precomputed);
+  ret.state = std::make_shared<details::NnlsState>(*ret.state);
+  ret.solution_scale *= np.skin_props.E / p.skin_props.E;
+  return ret;
 }
 
 } /* namespace cm */
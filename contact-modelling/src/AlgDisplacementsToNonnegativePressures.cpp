@@ -7,10 +7,13 @@
 #include <functional>
 
 #include "cm/details/external/armadillo.hpp"
-#include "libtsnnls/tsnnls.h"
 
 #include "cm/log/log.hpp"
 #include "cm/grid/grid.hpp"
+#include "cm/details/fista.hpp"
+#include "cm/details/nnls.hpp"
+#include "cm/details/power_iteration.hpp"
+#include "cm/details/recalibrate.hpp"
 #include "cm/details/string.hpp"
 #include "cm/details/elastic_model_love.hpp"
 
@@ -21,10 +24,55 @@ using details::sb;
  * \cond DEV
  */
 namespace details {
+namespace {
 struct precomputed_type {
-  typedef std::shared_ptr<taucs_ccs_matrix> sh_ptr_type;
-  sh_ptr_type taucs_m;
+  /**
+   * \brief   The active set solver, unless fista
+   */
+  std::shared_ptr<const NonnegativeLeastSquares> nnls;
+  /**
+   * \brief   The matrix, for fista
+   */
+  std::shared_ptr<const LinearOperator> forward;
+  /**
+   * \brief   The largest eigenvalue of forward^T forward, for fista: its starting Lipschitz
+   *          estimate
+   */
+  double lipschitz = 0;
+  /**
+   * \brief   The last run()'s solution (and passive set), the next one's starting point
+   */
+  std::shared_ptr<NnlsState> state;
+  /**
+   * \brief   Factor to multiply the solution by; the matrix is shared by all the recalibrated
+   *          copies which differ in E only.
+   */
+  double solution_scale = 1;
+  /**
+   * \brief   The parts of the matrix, in parametric mode; shared by the recalibrated copies
+   */
+  std::shared_ptr<const LoveTermsMatrices> terms;
 };
+
+/**
+ * \brief   The solver for the matrix: its active set solver, or what fista needs
+ */
+void set_solver(
+  std::shared_ptr<const LinearOperator> forward,
+  const bool fista,
+  const size_t num_threads,
+  precomputed_type& pre
+)
+{
+  if (fista) {
+    pre.lipschitz = largest_squared_singular_value(*forward);
+    pre.forward = std::move(forward);
+  } else {
+    pre.nnls = std::make_shared<const NonnegativeLeastSquares>(std::move(forward), num_threads);
+  }
+  pre.state = std::make_shared<NnlsState>();
+}
+} /* anonymous namespace */
 }
 /**
  * \endcond
@@ -48,25 +96,28 @@ boost::any AlgDisplacementsToNonnegativePressures::impl_offline(
             << disps.dim() << "; supported dimensionalities: (1,)"
     );
 
-  using cm::details::pressures_to_displacements_matrix;
   const params_type& p = boost::any_cast<const params_type&>(params);
-  arma::mat pd_matrix  = pressures_to_displacements_matrix(pressures, disps, p.skin_props);
-  // taucs_construct_sorted_ccs_matrix requires row-major ordering (as per README of libtsnnls).
-  std::vector<double> tempvec;
-  tempvec.reserve(pd_matrix.size());
-  std::for_each(
-    pd_matrix.begin_row(0),
-    pd_matrix.end_row(pd_matrix.n_rows - 1),
-    [&](double value) {
-      tempvec.push_back(value);
-    }
-  );
-
   details::precomputed_type ret;
-  ret.taucs_m = details::precomputed_type::sh_ptr_type(
-    taucs_construct_sorted_ccs_matrix(tempvec.data(), pd_matrix.n_cols, pd_matrix.n_rows),
-    taucs_ccs_free
-  );
+  std::shared_ptr<const details::LinearOperator> forward;
+  if (p.cutoff_radius > 0) {
+    using cm::details::pressures_to_displacements_sparse;
+    forward = pressures_to_displacements_sparse(pressures, disps, p.skin_props, p.cutoff_radius,
+      p.num_threads);
+  } else if (p.parametric) {
+    using cm::details::pressures_to_displacements_terms;
+    ret.terms = std::make_shared<const details::LoveTermsMatrices>(
+      pressures_to_displacements_terms(pressures, disps, p.skin_props, p.num_threads)
+    );
+    forward = std::make_shared<const details::DenseOperator>(
+      ret.terms->combine(p.skin_props.E, p.skin_props.nu), p.num_threads);
+  } else {
+    using cm::details::pressures_to_displacements_matrix;
+    forward = std::make_shared<const details::DenseOperator>(
+      pressures_to_displacements_matrix(pressures, disps, p.skin_props, p.num_threads,
+        p.surrogate_sampled_tol),
+      p.num_threads);
+  }
+  details::set_solver(forward, p.fista, p.num_threads, ret);
 
   return ret;
 }
@@ -90,31 +141,62 @@ void AlgDisplacementsToNonnegativePressures::impl_run(
             << disps.dim() << "; supported dimensionalities: (1,)"
     );
 
-  const details::precomputed_type& pre = boost::any_cast<details::precomputed_type>(precomputed);
-  // taucs_double is just double (as per taucs.h:117
-  // so when we have to pass taucs_double* as b, we can take the data from disps.getRawValues()
-  // (which is std::vector<double>)
-  double residualNorm;
-  // libtsnnls requires double* instead of const double* (meh), so we either have to const_cast the
-  // stuff or create a local copy
-  std::vector<double> d_vals;
-  d_vals.assign(disps.getRawValues().cbegin(), disps.getRawValues().cend());
-  double* solution = t_snnls(pre.taucs_m.get(), d_vals.data(), &residualNorm, -1, 1);
-  if (!solution) {
-    throw std::runtime_error(
-      sb() << "libtsnnls returned nullptr as the solution"
-    );
+  const details::precomputed_type& pre =
+    boost::any_cast<const details::precomputed_type&>(precomputed);
+  if (pre.forward) {
+    const params_type& p = boost::any_cast<const params_type&>(params);
+    const details::FistaReport report = details::fista(*pre.forward, pre.lipschitz,
+      disps.getRawValues(), pre.state->x, p.max_iterations, p.iterative_tolerance);
+    LOG(DEBUG) << "fista: " << report.iterations << " iterations, " << report.restarts
+      << " restarts, " << report.backtracks << " backtracks, relative step "
+      << report.relative_step
+      << (report.converged ? "" : " (not converged)");
+  } else {
+    const size_t changes = pre.nnls->solve(disps.getRawValues().data(), *pre.state);
+    LOG(DEBUG) << "nnls: " << changes << " changes of the passive set";
   }
-  LOG(DEBUG) << "nnls residual norm: " << residualNorm;
 
-  std::vector<double> tmp;
-  tmp.reserve(pre.taucs_m->n);
-  for (size_t i = 0; i < (size_t)pre.taucs_m->n; ++i) {
-    tmp.push_back(*(solution+i));
+  std::vector<double> tmp(pre.state->x);
+  for (double& v : tmp) {
+    v *= pre.solution_scale;
   }
   pressures.setRawValues(std::move(tmp));
+}
 
-  free(solution);
+boost::any AlgDisplacementsToNonnegativePressures::impl_recalibrate(
+  const Grid& disps,
+  const Grid& pressures,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  const params_type& p  = boost::any_cast<const params_type&>(params);
+  const params_type& np = boost::any_cast<const params_type&>(new_params);
+  details::precomputed_type ret = boost::any_cast<details::precomputed_type>(precomputed);
+  // the sparse matrix has no parts to recombine
+  if (p.cutoff_radius != np.cutoff_radius || p.fista != np.fista
+      || (np.cutoff_radius > 0 && p.skin_props.nu != np.skin_props.nu)) {
+    return impl_offline(disps, pressures, new_params);
+  }
+  switch (details::love_recalibration(p, np)) {
+    case details::LoveRecalibration::rescale:
+      // the matrix is proportional to 1/E, so is the solution to E; the copy starts where the
+      // original is
+      ret.state = std::make_shared<details::NnlsState>(*ret.state);
+      ret.solution_scale *= np.skin_props.E / p.skin_props.E;
+      return ret;
+    case details::LoveRecalibration::recombine:
+      ret.nnls.reset();
+      ret.forward.reset();
+      details::set_solver(std::make_shared<const details::DenseOperator>(
+          ret.terms->combine(np.skin_props.E, np.skin_props.nu), np.num_threads),
+        np.fista, np.num_threads, ret);
+      ret.solution_scale = 1;
+      return ret;
+    default:
+      return impl_offline(disps, pressures, new_params);
+  }
 }
 
 } /* namespace cm */
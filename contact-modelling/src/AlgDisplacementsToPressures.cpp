@@ -1,11 +1,27 @@
 #include "cm/algorithm/displacements_to_pressures.hpp"
 
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "cm/grid/grid.hpp"
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/cgls.hpp"
+#include "cm/details/coarse_to_fine.hpp"
 #include "cm/details/external/armadillo.hpp"
+#include "cm/details/inverse_engine.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/details/recalibrate.hpp"
+#include "cm/details/region_decomposition.hpp"
+#include "cm/details/single_precision.hpp"
 #include "cm/details/string.hpp"
+#include "cm/details/symmetric_operator.hpp"
+#include "cm/details/tikhonov.hpp"
+#include "cm/details/truncated_svd.hpp"
 #include "cm/details/elastic_model_love.hpp"
+#include "cm/details/multigrid.hpp"
+#include "cm/details/quantized_operator.hpp"
+#include "cm/log/log.hpp"
 
 namespace cm {
 using details::sb;
@@ -14,7 +30,119 @@ using details::sb;
  * \cond DEV
  */
 namespace details {
-typedef arma::mat   precomputed_type;
+namespace {
+struct precomputed_type {
+  /**
+   * \brief   The pseudoinverse
+   */
+  arma::mat m;
+  /**
+   * \brief   The pseudoinverse in single precision, used instead of it if single_precision
+   */
+  arma::fmat m_single;
+  /**
+   * \brief   The parts of the forward matrix, in parametric mode; shared by the recalibrated copies
+   */
+  std::shared_ptr<const LoveTermsMatrices> terms;
+  /**
+   * \brief   Used instead of m when deconvolving, quantized or symmetric
+   */
+  std::shared_ptr<const LinearOperator> op;
+  /**
+   * \brief   The model itself, if iterative
+   */
+  std::shared_ptr<const LinearOperator> forward;
+  /**
+   * \brief   The preconditioner of cgls() for forward
+   */
+  std::vector<double> scaling;
+  /**
+   * \brief   Used instead of cgls() if multigrid and the pressures' grid is regular
+   */
+  std::shared_ptr<const Multigrid> multigrid;
+  /**
+   * \brief   Used instead of the inverse if coarse_to_fine
+   */
+  std::shared_ptr<const CoarseToFine> windows;
+  /**
+   * \brief   The last run()'s pressures, the next one's starting point
+   */
+  std::shared_ptr<std::vector<double>> last;
+  /**
+   * \brief   The regions, if regions; every one's precomputed data is in parts
+   */
+  std::shared_ptr<const RegionDecomposition> regions;
+  std::vector<boost::any> parts;
+  /**
+   * \brief   The threads the regions are solved on at every run(), if regions
+   */
+  std::shared_ptr<const WorkerPool> pool;
+};
+
+/**
+ * \brief   The parameters of every region's inverse, if regions
+ */
+AlgDisplacementsToPressures::params_type region_params(
+  const AlgDisplacementsToPressures::params_type& p
+)
+{
+  AlgDisplacementsToPressures::params_type ret = p;
+  ret.regions.clear();
+  ret.num_threads = 1;
+  return ret;
+}
+
+/**
+ * \brief   The engine chosen by p (\sa inverse_engine()); parametric keeps the parts of the
+ *          matrix to invert, or to decompose
+ */
+InverseEngine check_params(const AlgDisplacementsToPressures::params_type& p)
+{
+  const InverseEngine ret = inverse_engine(p, "AlgDisplacementsToPressures");
+  if (p.parametric && InverseEngine::matrix != ret && InverseEngine::truncated_svd != ret) {
+    throw std::runtime_error("AlgDisplacementsToPressures: parametric only applies to the "
+      "pseudoinverse, the Tikhonov inverse or truncated_svd");
+  }
+  // the surrogate's error isn't bounded, the stored inverse's is
+  if (p.surrogate_sampled_tol > 0 && (p.quantized || p.single_precision)) {
+    throw std::runtime_error(sb() << "AlgDisplacementsToPressures: surrogate_sampled_tol doesn't "
+      "go with " << (p.quantized ? "quantized" : "single_precision") << "'s error bound");
+  }
+  return ret;
+}
+
+/**
+ * \brief   The pseudoinverse of forward, or its Tikhonov-regularised inverse if p.tikhonov;
+ *          through the eigendecomposition if forward is symmetric (\sa coincide())
+ */
+arma::mat inverse_matrix(
+  const arma::mat& forward,
+  const AlgDisplacementsToPressures::params_type& p,
+  const bool symmetric
+)
+{
+  if (symmetric) {
+    return symmetric_inverse(forward, p.tikhonov ? p.regularisation : 0);
+  }
+  if (p.tikhonov) {
+    return tikhonov_inverse(forward, p.regularisation);
+  }
+  return arma::pinv(forward);
+}
+
+/**
+ * \brief   The inverse of forward through its truncated SVD
+ */
+std::shared_ptr<const LinearOperator> spectral_inverse(
+  const arma::mat& forward,
+  const AlgDisplacementsToPressures::params_type& p
+)
+{
+  return std::make_shared<const SpectralInverseOperator>(
+    std::make_shared<const TruncatedSVD>(truncated_svd(forward, p.svd_rank)), p.svd_rank,
+    p.tikhonov ? p.regularisation : 0, 1, p.num_threads);
+}
+} /* anonymous namespace */
 }
 /**
  * \endcond
@@ -39,8 +167,129 @@ boost::any AlgDisplacementsToPressures::impl_offline(
     );
 
   const params_type& p = boost::any_cast<const params_type&>(params);
-  using cm::details::displacements_to_pressures_matrix;
-  return displacements_to_pressures_matrix(disps, pressures, p.skin_props);
+  details::check_params(p);
+  details::precomputed_type ret;
+  if (!p.regions.empty()) {
+    ret.regions = std::make_shared<const details::RegionDecomposition>(disps, pressures, p.regions,
+      p.region_overlap);
+    ret.pool = std::make_shared<const details::WorkerPool>(p.num_threads);
+    const params_type part = details::region_params(p);
+    ret.parts.resize(ret.regions->size());
+    details::parallel_for_blocks(ret.parts.size(), p.num_threads, 1,
+      [&](const size_t begin, const size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+          ret.parts[r] = impl_offline(ret.regions->disps(r), ret.regions->tractions(r), part);
+        }
+      });
+    return ret;
+  }
+  if (p.iterative) {
+    // the multigrid needs the cells on a lattice; the model is then a convolution, usually
+    details::Lattice lattice;
+    const bool regular = p.multigrid && details::fit_lattice(details::CellCoordinates(pressures),
+      pressures.getCellShape().dx(), pressures.getCellShape().dy(), lattice);
+    if (p.multigrid && !regular) {
+      LOG(DEBUG) << "AlgDisplacementsToPressures: the grid isn't regular, no multigrid.";
+    }
+    if (regular && !(p.cutoff_radius > 0)) {
+      using cm::details::pressures_to_displacements_convolution;
+      ret.forward = pressures_to_displacements_convolution(pressures, disps, p.skin_props);
+    }
+    if (!ret.forward) {
+      if (p.hierarchical) {
+        using cm::details::pressures_to_displacements_hmatrix;
+        ret.forward = pressures_to_displacements_hmatrix(pressures, disps, p.skin_props,
+          p.hierarchical_tolerance, p.num_threads);
+      } else if (p.cutoff_radius > 0) {
+        using cm::details::pressures_to_displacements_sparse;
+        ret.forward = pressures_to_displacements_sparse(pressures, disps, p.skin_props,
+          p.cutoff_radius, p.num_threads);
+      } else if (p.matrix_free) {
+        using cm::details::pressures_to_displacements_operator;
+        ret.forward = pressures_to_displacements_operator(pressures, disps, p.skin_props,
+          p.num_threads, p.surrogate_sampled_tol);
+      } else {
+        using cm::details::pressures_to_displacements_matrix;
+        ret.forward = std::make_shared<const details::DenseOperator>(
+          pressures_to_displacements_matrix(pressures, disps, p.skin_props, p.num_threads,
+            p.surrogate_sampled_tol));
+      }
+    }
+    if (regular) {
+      ret.multigrid = std::make_shared<const details::Multigrid>(ret.forward, lattice,
+        pressures.dim(), p.regularisation, 128, p.num_threads);
+    } else {
+      ret.scaling = details::column_scaling(*ret.forward);
+    }
+    ret.last = std::make_shared<std::vector<double>>(ret.forward->n_cols(), 0.0);
+    return ret;
+  }
+  if (p.coarse_to_fine) {
+    const double dx = p.coarse_factor * pressures.getCellShape().dx();
+    const double dy = p.coarse_factor * pressures.getCellShape().dy();
+    const std::unique_ptr<const Grid> coarse(Grid::fromFill(1, Rectangle(dx, dy), pressures));
+    using cm::details::pressures_to_displacements_matrix;
+    using cm::details::pressures_to_displacements_operator;
+    ret.windows = std::make_shared<const details::CoarseToFine>(
+      pressures_to_displacements_operator(pressures, disps, p.skin_props, p.num_threads,
+        p.surrogate_sampled_tol),
+      details::inverse_matrix(pressures_to_displacements_matrix(*coarse, disps, p.skin_props,
+        p.num_threads, p.surrogate_sampled_tol), p, false),
+      details::CellCoordinates(pressures), details::CellCoordinates(*coarse), 1,
+      (0.5 + p.window_dilation) * dx, (0.5 + p.window_dilation) * dy, p.contact_threshold,
+      p.regularisation);
+    return ret;
+  }
+  if (p.deconvolution) {
+    using cm::details::pressures_to_displacements_convolution;
+    std::shared_ptr<const details::ConvolutionOperator> forward =
+      pressures_to_displacements_convolution(pressures, disps, p.skin_props);
+    if (forward) {
+      ret.op = std::make_shared<const details::DeconvolutionOperator>(forward, p.regularisation,
+        p.refinement_steps);
+      return ret;
+    }
+    LOG(DEBUG) << "AlgDisplacementsToPressures: the grids aren't regular, no deconvolution.";
+  }
+  const bool symmetric = details::coincide(disps, pressures);
+  if (p.parametric) {
+    using cm::details::pressures_to_displacements_terms;
+    ret.terms = std::make_shared<const details::LoveTermsMatrices>(
+      pressures_to_displacements_terms(pressures, disps, p.skin_props, p.num_threads)
+    );
+    const arma::mat forward = ret.terms->combine(p.skin_props.E, p.skin_props.nu);
+    if (p.truncated_svd) {
+      ret.op = details::spectral_inverse(forward, p);
+      return ret;
+    }
+    ret.m = details::inverse_matrix(forward, p, symmetric);
+  } else if (p.tikhonov || p.truncated_svd || symmetric) {
+    using cm::details::pressures_to_displacements_matrix;
+    const arma::mat forward = pressures_to_displacements_matrix(pressures, disps, p.skin_props,
+      p.num_threads, p.surrogate_sampled_tol);
+    if (p.truncated_svd) {
+      ret.op = details::spectral_inverse(forward, p);
+      return ret;
+    }
+    ret.m = details::inverse_matrix(forward, p, symmetric);
+  } else {
+    using cm::details::displacements_to_pressures_matrix;
+    ret.m = displacements_to_pressures_matrix(disps, pressures, p.skin_props, p.num_threads,
+      p.surrogate_sampled_tol);
+  }
+  if (p.quantized) {
+    const auto q = std::make_shared<const details::QuantizedOperator>(ret.m, p.num_threads);
+    LOG(INFO) << "AlgDisplacementsToPressures: quantized the pseudoinverse, relative error "
+      << q->relative_error();
+    ret.op = q;
+    ret.m.reset();
+  } else if (p.single_precision) {
+    ret.m_single = details::to_single_precision(ret.m);
+  } else if (symmetric) {
+    ret.op = std::make_shared<const details::SymmetricOperator>(ret.m, p.num_threads);
+    ret.m.reset();
+  }
+  return ret;
 }
 
 void AlgDisplacementsToPressures::impl_run(
@@ -62,13 +311,139 @@ void AlgDisplacementsToPressures::impl_run(
             << disps.dim() << "; supported dimensionalities: (1,)"
     );
 
-  const details::precomputed_type& pre = boost::any_cast<details::precomputed_type>(precomputed);
+  const params_type& p = boost::any_cast<const params_type&>(params);
+  const details::precomputed_type& pre =
+    boost::any_cast<const details::precomputed_type&>(precomputed);
+  if (pre.regions) {
+    const params_type part = details::region_params(p);
+    pressures.setRawValues(pre.regions->solve(disps.getRawValues(), *pre.pool,
+      [&](const size_t r, const Grid& d, Grid& t) { impl_run(d, t, part, pre.parts[r]); }));
+    return;
+  }
+  if (pre.multigrid) {
+    const size_t iterations = pre.multigrid->solve(disps.getRawValues(), *pre.last,
+      p.max_iterations, p.iterative_tolerance);
+    LOG(DEBUG) << "AlgDisplacementsToPressures: " << iterations << " multigrid iterations";
+    pressures.setRawValues(*pre.last);
+    return;
+  }
+  if (pre.forward) {
+    const size_t iterations = details::cgls(*pre.forward, pre.scaling, disps.getRawValues(),
+      *pre.last, p.max_iterations, p.iterative_tolerance);
+    LOG(DEBUG) << "AlgDisplacementsToPressures: " << iterations << " CGLS iterations";
+    pressures.setRawValues(*pre.last);
+    return;
+  }
+  if (pre.windows) {
+    size_t window = 0;
+    pressures.setRawValues(pre.windows->solve(disps.getRawValues(), &window));
+    LOG(DEBUG) << "AlgDisplacementsToPressures: solved for " << window << " of "
+      << pressures.num_cells() << " cells";
+    return;
+  }
+  if (pre.op) {
+    pressures.setRawValues(pre.op->apply(disps.getRawValues()));
+    return;
+  }
+  if (!pre.m_single.is_empty()) {
+    pressures.setRawValues(details::multiply_single(pre.m_single, disps.getRawValues()));
+    return;
+  }
   std::vector<double> tmp = arma::conv_to<std::vector<double>>::from(
-      pre * arma::conv_to<arma::colvec>::from(disps.getRawValues())
+      pre.m * arma::conv_to<arma::colvec>::from(disps.getRawValues())
     );
   pressures.setRawValues(
      std::move(tmp) 
   );
 }
 
+boost::any AlgDisplacementsToPressures::impl_recalibrate(
+  const Grid& disps,
+  const Grid& pressures,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  const params_type& p  = boost::any_cast<const params_type&>(params);
+  const params_type& np = boost::any_cast<const params_type&>(new_params);
+  const details::precomputed_type& pre =
+    boost::any_cast<const details::precomputed_type&>(precomputed);
+  const details::InverseEngine engine = details::check_params(np);
+  // every region's precomputed data is recalibrated on its own
+  if (pre.regions || !np.regions.empty()) {
+    if (!pre.regions || !pre.regions->matches(np.regions, np.region_overlap)) {
+      return impl_offline(disps, pressures, new_params);
+    }
+    details::precomputed_type ret;
+    ret.regions = pre.regions;
+    ret.pool = std::make_shared<const details::WorkerPool>(np.num_threads);
+    ret.parts.resize(pre.parts.size());
+    const params_type part = details::region_params(p);
+    const params_type new_part = details::region_params(np);
+    details::parallel_for_blocks(ret.parts.size(), np.num_threads, 1,
+      [&](const size_t begin, const size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+          ret.parts[r] = impl_recalibrate(pre.regions->disps(r), pre.regions->tractions(r), part,
+            pre.parts[r], new_part);
+        }
+      });
+    return ret;
+  }
+  if (engine != details::check_params(p)) {
+    return impl_offline(disps, pressures, new_params);
+  }
+  // a kept decomposition is filtered anew, whatever the rank (down to the stored one), the filter
+  // or E
+  if (details::InverseEngine::truncated_svd == engine) {
+    const auto spectral =
+      std::dynamic_pointer_cast<const details::SpectralInverseOperator>(pre.op);
+    if (!spectral || !spectral->svd()->covers(np.svd_rank)
+        || details::love_recalibration(p, np) != details::LoveRecalibration::rescale) {
+      return impl_offline(disps, pressures, new_params);
+    }
+    details::precomputed_type ret;
+    ret.terms = pre.terms;
+    ret.op = std::make_shared<const details::SpectralInverseOperator>(spectral->svd(),
+      np.svd_rank, np.tikhonov ? np.regularisation : 0,
+      spectral->scale() * (p.skin_props.E / np.skin_props.E), np.num_threads);
+    return ret;
+  }
+  // the deconvolution's offline() is cheap; the model to iterate on or the windows' are computed
+  // anew, and so is a quantized pseudoinverse; a symmetric one is rescaled or recombined
+  const auto symmetric = std::dynamic_pointer_cast<const details::SymmetricOperator>(pre.op);
+  if (details::InverseEngine::matrix != engine || (pre.op && !symmetric) || np.quantized
+      || p.single_precision != np.single_precision
+      || p.tikhonov != np.tikhonov || (np.tikhonov && p.regularisation != np.regularisation)) {
+    return impl_offline(disps, pressures, new_params);
+  }
+  details::precomputed_type ret;
+  ret.terms = pre.terms;
+  switch (details::love_recalibration(p, np)) {
+    case details::LoveRecalibration::rescale:
+      // the (pseudo- or Tikhonov, with a relative lambda) inverse of a matrix proportional to 1/E
+      if (symmetric) {
+        ret.op = std::make_shared<const details::SymmetricOperator>(*symmetric,
+          np.skin_props.E / p.skin_props.E);
+        return ret;
+      }
+      ret.m = pre.m * (np.skin_props.E / p.skin_props.E);
+      ret.m_single = pre.m_single * float(np.skin_props.E / p.skin_props.E);
+      return ret;
+    case details::LoveRecalibration::recombine:
+      // no assembly, but the pseudoinverse is to be computed anew
+      ret.m = details::inverse_matrix(pre.terms->combine(np.skin_props.E, np.skin_props.nu), np,
+        details::coincide(disps, pressures));
+      if (np.single_precision) {
+        ret.m_single = details::to_single_precision(ret.m);
+      } else if (symmetric) {
+        ret.op = std::make_shared<const details::SymmetricOperator>(ret.m, np.num_threads);
+        ret.m.reset();
+      }
+      return ret;
+    default:
+      return impl_offline(disps, pressures, new_params);
+  }
+}
+
 } /* namespace cm */
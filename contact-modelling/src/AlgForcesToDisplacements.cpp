@@ -1,16 +1,32 @@
 #include "cm/algorithm/forces_to_displacements.hpp"
 
+#include <memory>
 #include <stdexcept>
 
 #include "cm/grid/grid.hpp"
 #include "cm/details/external/armadillo.hpp"
+#include "cm/details/recalibrate.hpp"
+#include "cm/details/single_precision.hpp"
 #include "cm/details/string.hpp"
 #include "cm/details/elastic_model_boussinesq.hpp"
+#include "cm/log/log.hpp"
 
 namespace cm {
 using details::sb;
 
-typedef arma::mat   precomputed_type;
+namespace {
+struct precomputed_type {
+  arma::mat m;
+  /**
+   * \brief   m in single precision, used instead of it if single_precision
+   */
+  arma::fmat m_single;
+  /**
+   * \brief   Used instead of m when matrix-free, convolving, hierarchical, sparse or mapped
+   */
+  std::shared_ptr<const details::LinearOperator> op;
+};
+} /* anonymous namespace */
 
 boost::any AlgForcesToDisplacements::impl_offline(
   const Grid& forces,
@@ -31,8 +47,40 @@ boost::any AlgForcesToDisplacements::impl_offline(
     );
 
   const params_type& p = boost::any_cast<const params_type&>(params);
-  using cm::details::forces_to_displacements_matrix;
-  return forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact);
+  precomputed_type ret;
+  if (p.convolution) {
+    using cm::details::forces_to_displacements_convolution;
+    ret.op = forces_to_displacements_convolution(forces, disps, p.skin_props, p.psi_exact);
+    if (ret.op) {
+      return ret;
+    }
+    LOG(DEBUG) << "AlgForcesToDisplacements: the grids aren't regular, no convolution.";
+  }
+  if (p.hierarchical) {
+    using cm::details::forces_to_displacements_hmatrix;
+    ret.op = forces_to_displacements_hmatrix(forces, disps, p.skin_props, p.psi_exact,
+      p.hierarchical_tolerance, p.num_threads);
+  } else if (p.cutoff_radius > 0) {
+    using cm::details::forces_to_displacements_sparse;
+    ret.op = forces_to_displacements_sparse(forces, disps, p.skin_props, p.psi_exact,
+      p.cutoff_radius, p.num_threads);
+  } else if (!p.mapped_file.empty()) {
+    using cm::details::forces_to_displacements_mapped;
+    ret.op = forces_to_displacements_mapped(forces, disps, p.skin_props, p.psi_exact,
+      p.mapped_file, p.num_threads);
+  } else if (p.matrix_free) {
+    using cm::details::forces_to_displacements_operator;
+    ret.op = forces_to_displacements_operator(forces, disps, p.skin_props, p.psi_exact,
+      p.num_threads);
+  } else {
+    using cm::details::forces_to_displacements_matrix;
+    ret.m = forces_to_displacements_matrix(forces, disps, p.skin_props, p.psi_exact,
+      p.num_threads);
+    if (p.single_precision) {
+      ret.m_single = details::to_single_precision(ret.m);
+    }
+  }
+  return ret;
 }
 
 void AlgForcesToDisplacements::impl_run(
@@ -56,10 +104,44 @@ void AlgForcesToDisplacements::impl_run(
 
   const precomputed_type& pre = boost::any_cast<const precomputed_type&>(precomputed);
 
+  if (pre.op) {
+    disps.setRawValues(pre.op->apply(forces.getRawValues()));
+    return;
+  }
+  if (!pre.m_single.is_empty()) {
+    disps.setRawValues(details::multiply_single(pre.m_single, forces.getRawValues()));
+    return;
+  }
   std::vector<double> tmp = arma::conv_to<std::vector<double>>::from(
-      pre * arma::conv_to<arma::colvec>::from(forces.getRawValues())
+      pre.m * arma::conv_to<arma::colvec>::from(forces.getRawValues())
     );
   disps.setRawValues(std::move(tmp));
 }
 
+boost::any AlgForcesToDisplacements::impl_recalibrate(
+  const Grid& forces,
+  const Grid& disps,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  const params_type& p  = boost::any_cast<const params_type&>(params);
+  const params_type& np = boost::any_cast<const params_type&>(new_params);
+  const precomputed_type& pre = boost::any_cast<const precomputed_type&>(precomputed);
+  // without a dense matrix in memory (matrix-free, convolution, hierarchical, sparse or
+  // mapped), offline() is cheap -- or at least doesn't need more than the RAM
+  if (p.psi_exact != np.psi_exact || pre.op || np.matrix_free || np.convolution
+      || np.hierarchical || np.cutoff_radius > 0 || !np.mapped_file.empty()
+      || p.single_precision != np.single_precision
+      || !details::same_geometry(p.skin_props, np.skin_props)) {
+    return impl_offline(forces, disps, new_params);
+  }
+  // proportional to 1/E, independent of nu
+  precomputed_type ret;
+  ret.m = pre.m * (p.skin_props.E / np.skin_props.E);
+  ret.m_single = pre.m_single * float(p.skin_props.E / np.skin_props.E);
+  return ret;
+}
+
 } /* namespace cm */
@@ -22,4 +22,26 @@ void AlgInterface::run(
   impl_run(input,output,params,precomputed);
 }
 
+boost::any AlgInterface::recalibrate(
+  const Grid& input,
+  const Grid& output,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  return impl_recalibrate(input, output, params, precomputed, new_params);
+}
+
+boost::any AlgInterface::impl_recalibrate(
+  const Grid& input,
+  const Grid& output,
+  const boost::any& /* params */,
+  const boost::any& /* precomputed */,
+  const boost::any& new_params
+)
+{
+  return impl_offline(input, output, new_params);
+}
+
 } /* namespace cm */
@@ -1,17 +1,37 @@
 #include "cm/algorithm/pressures_to_displacements.hpp"
 
+#include <memory>
 #include <stdexcept>
 #include <typeinfo>
 
 #include "cm/grid/grid.hpp"
 #include "cm/details/external/armadillo.hpp"
+#include "cm/details/recalibrate.hpp"
+#include "cm/details/single_precision.hpp"
 #include "cm/details/string.hpp"
 #include "cm/details/elastic_model_love.hpp"
+#include "cm/log/log.hpp"
 
 namespace cm {
 using details::sb;
 
-typedef arma::mat   precomputed_type;
+namespace {
+struct precomputed_type {
+  arma::mat m;
+  /**
+   * \brief   m in single precision, used instead of it if single_precision
+   */
+  arma::fmat m_single;
+  /**
+   * \brief   The parts m is combined from, in parametric mode; shared by the recalibrated copies
+   */
+  std::shared_ptr<const details::LoveTermsMatrices> terms;
+  /**
+   * \brief   Used instead of m when matrix-free, convolving or sparse
+   */
+  std::shared_ptr<const details::LinearOperator> op;
+};
+} /* anonymous namespace */
 
 boost::any AlgPressuresToDisplacements::impl_offline(
   const Grid& pressures,
@@ -32,8 +52,43 @@ boost::any AlgPressuresToDisplacements::impl_offline(
     );
 
   const params_type& p = boost::any_cast<const params_type&>(params);
-  using cm::details::pressures_to_displacements_matrix;
-  return pressures_to_displacements_matrix(pressures, disps, p.skin_props);
+  // the surrogate's error isn't bounded, the stored matrix's is
+  if (p.surrogate_sampled_tol > 0 && p.single_precision) {
+    throw std::runtime_error("AlgPressuresToDisplacements: surrogate_sampled_tol doesn't go with "
+      "single_precision's error bound");
+  }
+  precomputed_type ret;
+  if (p.convolution) {
+    using cm::details::pressures_to_displacements_convolution;
+    ret.op = pressures_to_displacements_convolution(pressures, disps, p.skin_props);
+    if (ret.op) {
+      return ret;
+    }
+    LOG(DEBUG) << "AlgPressuresToDisplacements: the grids aren't regular, no convolution.";
+  }
+  if (p.cutoff_radius > 0) {
+    using cm::details::pressures_to_displacements_sparse;
+    ret.op = pressures_to_displacements_sparse(pressures, disps, p.skin_props, p.cutoff_radius,
+      p.num_threads);
+  } else if (p.matrix_free) {
+    using cm::details::pressures_to_displacements_operator;
+    ret.op = pressures_to_displacements_operator(pressures, disps, p.skin_props, p.num_threads,
+      p.surrogate_sampled_tol);
+  } else if (p.parametric) {
+    using cm::details::pressures_to_displacements_terms;
+    ret.terms = std::make_shared<const details::LoveTermsMatrices>(
+      pressures_to_displacements_terms(pressures, disps, p.skin_props, p.num_threads)
+    );
+    ret.m = ret.terms->combine(p.skin_props.E, p.skin_props.nu);
+  } else {
+    using cm::details::pressures_to_displacements_matrix;
+    ret.m = pressures_to_displacements_matrix(pressures, disps, p.skin_props, p.num_threads,
+      p.surrogate_sampled_tol);
+  }
+  if (p.single_precision) {
+    ret.m_single = details::to_single_precision(ret.m);
+  }
+  return ret;
 }
 
 void AlgPressuresToDisplacements::impl_run(
@@ -57,10 +112,52 @@ void AlgPressuresToDisplacements::impl_run(
 
   const precomputed_type& pre = boost::any_cast<const precomputed_type&>(precomputed);
 
+  if (pre.op) {
+    disps.setRawValues(pre.op->apply(pressures.getRawValues()));
+    return;
+  }
+  if (!pre.m_single.is_empty()) {
+    disps.setRawValues(details::multiply_single(pre.m_single, pressures.getRawValues()));
+    return;
+  }
   std::vector<double> tmp = arma::conv_to<std::vector<double>>::from(
-      pre * arma::conv_to<arma::colvec>::from(pressures.getRawValues())
+      pre.m * arma::conv_to<arma::colvec>::from(pressures.getRawValues())
     );
   disps.setRawValues(std::move(tmp));
 }
 
+boost::any AlgPressuresToDisplacements::impl_recalibrate(
+  const Grid& pressures,
+  const Grid& disps,
+  const boost::any& params,
+  const boost::any& precomputed,
+  const boost::any& new_params
+)
+{
+  const params_type& p  = boost::any_cast<const params_type&>(params);
+  const params_type& np = boost::any_cast<const params_type&>(new_params);
+  const precomputed_type& pre = boost::any_cast<const precomputed_type&>(precomputed);
+  // without a dense matrix (matrix-free, convolution or sparse), offline() is cheap
+  if (pre.op || np.matrix_free || np.convolution || np.cutoff_radius > 0
+      || p.single_precision != np.single_precision) {
+    return impl_offline(pressures, disps, new_params);
+  }
+  precomputed_type ret;
+  ret.terms = pre.terms;
+  switch (details::love_recalibration(p, np)) {
+    case details::LoveRecalibration::rescale:
+      ret.m = pre.m * (p.skin_props.E / np.skin_props.E);
+      ret.m_single = pre.m_single * float(p.skin_props.E / np.skin_props.E);
+      return ret;
+    case details::LoveRecalibration::recombine:
+      ret.m = pre.terms->combine(np.skin_props.E, np.skin_props.nu);
+      if (np.single_precision) {
+        ret.m_single = details::to_single_precision(ret.m);
+      }
+      return ret;
+    default:
+      return impl_offline(pressures, disps, new_params);
+  }
+}
+
 } /* namespace cm */
@@ -1,8 +1,10 @@
 #include "cm/grid/grid.hpp"
 
 #include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <limits>
+#include <numeric>
 #include <stdexcept>
 #include <tuple>
 
@@ -16,6 +18,60 @@ using cm::details::sb;
 
 namespace cm {
 
+namespace {
+
+/**
+ * \brief   Number of bits of either coordinate the space-filling curves go through
+ */
+const unsigned curve_bits = 16;
+
+uint64_t morton_key(const uint32_t x, const uint32_t y)
+{
+  uint64_t key = 0;
+  for (unsigned b = 0; b < curve_bits; ++b) {
+    key |= uint64_t((x >> b) & 1) << (2*b + 1);
+    key |= uint64_t((y >> b) & 1) << (2*b);
+  }
+  return key;
+}
+
+uint64_t hilbert_key(uint32_t x, uint32_t y)
+{
+  const uint32_t n = uint32_t(1) << curve_bits;
+  uint64_t key = 0;
+  for (uint32_t s = n/2; s > 0; s /= 2) {
+    const uint32_t rx = (x & s) > 0;
+    const uint32_t ry = (y & s) > 0;
+    key += uint64_t(s) * s * ((3 * rx) ^ ry);
+    // rotate the quadrant, so that the curve within it starts where the previous one ended
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n-1 - x;
+        y = n-1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return key;
+}
+
+/**
+ * \brief   Apply the permutation to a container of stride values per cell: cell i of the result
+ *          is cell order[i] of c.
+ */
+template <class C>
+void permute(C& c, const std::vector<size_t>& order, const size_t stride = 1)
+{
+  C tmp(c.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    std::copy(c.begin() + order[i]*stride, c.begin() + (order[i]+1)*stride,
+      tmp.begin() + i*stride);
+  }
+  c.swap(tmp);
+}
+
+} /* anonymous namespace */
+
 Grid::Grid(const size_t dim, const GridCellShape& cell_shape)
   : dim_(dim), cell_shape_(cell_shape.clone())
 {}
@@ -131,6 +187,7 @@ void Grid::clone_structure(const Grid& clone_from)
 
   metadata_.resize(clone_from.num_cells());
   values_.resize(dim_ * clone_from.num_cells());
+  permutation_ = clone_from.permutation_;
 
   generateMinMax();
 }
@@ -257,9 +314,119 @@ void Grid::erase(const std::vector<size_t>& indices)
   erase_by_indices(cells_,      indices);
   erase_by_indices(metadata_,   indices);
   erase_by_indices(values_,     indices, dim_);
+  if (!permutation_.empty()) {
+    // the remaining cells, numbered in their original order again
+    erase_by_indices(permutation_, indices);
+    std::vector<size_t> by_original(permutation_.size());
+    std::iota(by_original.begin(), by_original.end(), 0);
+    std::sort(by_original.begin(), by_original.end(), [&](const size_t a, const size_t b) {
+      return permutation_[a] < permutation_[b];
+    });
+    for (size_t rank = 0; rank < by_original.size(); ++rank) {
+      permutation_[by_original[rank]] = rank;
+    }
+  }
   generateMinMax();
 }
 
+void Grid::reorderCells(const CellOrder order)
+{
+  const size_t n = num_cells();
+  std::vector<size_t> new_order(n);
+  std::iota(new_order.begin(), new_order.end(), 0);
+  if (order == CellOrder::original) {
+    if (permutation_.empty()) {
+      return;
+    }
+    std::sort(new_order.begin(), new_order.end(), [&](const size_t a, const size_t b) {
+      return permutation_[a] < permutation_[b];
+    });
+  } else {
+    double x0 = std::numeric_limits<double>::max();
+    double y0 = std::numeric_limits<double>::max();
+    double x1 = std::numeric_limits<double>::lowest();
+    double y1 = std::numeric_limits<double>::lowest();
+    for (const cell_type& c : cells_) {
+      x0 = std::min(x0, c.x);
+      y0 = std::min(y0, c.y);
+      x1 = std::max(x1, c.x);
+      y1 = std::max(y1, c.y);
+    }
+    // the same scale along both axes: the curve's quadrants stay square
+    const double max_coord = double((uint32_t(1) << curve_bits) - 1);
+    const double extent = std::max(x1 - x0, y1 - y0);
+    const double scale = extent > 0 ? max_coord / extent : 0;
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+      const uint32_t qx = uint32_t((cells_[i].x - x0) * scale + 0.5);
+      const uint32_t qy = uint32_t((cells_[i].y - y0) * scale + 0.5);
+      keys[i] = order == CellOrder::morton ? morton_key(qx, qy) : hilbert_key(qx, qy);
+    }
+    std::stable_sort(new_order.begin(), new_order.end(), [&](const size_t a, const size_t b) {
+      return keys[a] < keys[b];
+    });
+  }
+
+  permute(cells_,     new_order);
+  permute(metadata_,  new_order);
+  permute(values_,    new_order, dim_);
+
+  std::vector<size_t> new_position(n);
+  for (size_t i = 0; i < n; ++i) {
+    new_position[new_order[i]] = i;
+  }
+  for (size_t& b : bad_cells_) {
+    b = new_position.at(b);
+  }
+  std::sort(bad_cells_.begin(), bad_cells_.end());
+
+  if (order == CellOrder::original) {
+    permutation_.clear();
+  } else {
+    if (permutation_.empty()) {
+      permutation_ = new_order;
+    } else {
+      permute(permutation_, new_order);
+    }
+  }
+}
+
+const std::vector<size_t>& Grid::getPermutation() const
+{
+  return permutation_;
+}
+
+Grid::values_container Grid::getRawValuesInOriginalOrder() const
+{
+  if (permutation_.empty()) {
+    return values_;
+  }
+  values_container ret(values_.size());
+  for (size_t i = 0; i < permutation_.size(); ++i) {
+    std::copy(values_.begin() + i*dim_, values_.begin() + (i+1)*dim_,
+      ret.begin() + permutation_[i]*dim_);
+  }
+  return ret;
+}
+
+void Grid::setRawValuesInOriginalOrder(const values_container& other)
+{
+  if (permutation_.empty()) {
+    setRawValues(other);
+    return;
+  }
+  if (other.size() != values_.size()) {
+    throw std::runtime_error(sb()
+      << "Grid::setRawValuesInOriginalOrder: passed values of different size. "
+      << "My size: " << values_.size() << ", other size: " << other.size()
+    );
+  }
+  for (size_t i = 0; i < permutation_.size(); ++i) {
+    std::copy(other.begin() + permutation_[i]*dim_, other.begin() + (permutation_[i]+1)*dim_,
+      values_.begin() + i*dim_);
+  }
+}
+
 void Grid::generateMinMax()
 {
   const double extra_x = cell_shape_->isCircular() ? cell_shape_->r() : 0.5*cell_shape_->dx();
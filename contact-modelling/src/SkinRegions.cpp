@@ -0,0 +1,105 @@
+#include "cm/skin/regions.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "cm/details/string.hpp"
+#include "cm/grid/grid.hpp"
+
+namespace cm {
+using details::sb;
+
+namespace {
+
+/**
+ * \brief   The next number of the cache, which must be below bound
+ */
+size_t read_index(std::istream& in, const size_t bound, const char* what)
+{
+  long long value = 0;
+  if (!(in >> value)) {
+    throw std::runtime_error(sb() << "SkinRegions: the regionalisation cache ends before "
+      << what);
+  }
+  if (value < 0 || size_t(value) >= bound) {
+    throw std::runtime_error(sb() << "SkinRegions: " << what << " " << value
+      << " out of range; expected below " << bound);
+  }
+  return size_t(value);
+}
+
+} /* anonymous namespace */
+
+SkinRegions SkinRegions::fromCache(const std::string& path)
+{
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error(sb() << "SkinRegions: could not open " << path);
+  }
+  return fromCache(in);
+}
+
+SkinRegions SkinRegions::fromCache(std::istream& in)
+{
+  const size_t any = size_t(-1);
+  const size_t num_sensors = read_index(in, any, "the number of sensors");
+  const size_t num_types = read_index(in, any, "the number of sensor types");
+  std::vector<std::vector<size_t>> sensor_map(num_types);
+  for (auto& sensors : sensor_map) {
+    sensors.resize(read_index(in, num_sensors + 1, "the number of sensors of a type"));
+    for (size_t& s : sensors) {
+      s = read_index(in, num_sensors, "sensor");
+    }
+  }
+
+  // every sub-region's sensors, type after type
+  std::vector<std::vector<size_t>> sub_regions(read_index(in, any, "the number of sub-regions"));
+  for (auto& sub_region : sub_regions) {
+    for (const auto& sensors : sensor_map) {
+      const size_t begin = read_index(in, sensors.size() + 1, "a sub-region's beginning");
+      const size_t end = read_index(in, sensors.size() + 1, "a sub-region's end");
+      for (size_t i = begin; i < end; ++i) {
+        sub_region.push_back(sensors[i]);
+      }
+    }
+  }
+
+  SkinRegions ret;
+  ret.taxels.resize(read_index(in, any, "the number of regions"));
+  read_index(in, any, "the number of the regions' sub-regions");
+  for (auto& region : ret.taxels) {
+    const size_t count = read_index(in, sub_regions.size() + 1, "a region's sub-regions");
+    for (size_t k = 0; k < count; ++k) {
+      const auto& sub_region = sub_regions[read_index(in, sub_regions.size(), "sub-region")];
+      region.insert(region.end(), sub_region.begin(), sub_region.end());
+    }
+    std::sort(region.begin(), region.end());
+    region.erase(std::unique(region.begin(), region.end()), region.end());
+  }
+  return ret;
+}
+
+std::vector<std::vector<GridCell>> SkinRegions::positions(const Grid& taxels_grid) const
+{
+  // cell of every taxel
+  const std::vector<size_t>& permutation = taxels_grid.getPermutation();
+  std::vector<size_t> cell(taxels_grid.num_cells());
+  for (size_t c = 0; c < cell.size(); ++c) {
+    cell[permutation.empty() ? c : permutation[c]] = c;
+  }
+
+  std::vector<std::vector<GridCell>> ret(taxels.size());
+  for (size_t r = 0; r < taxels.size(); ++r) {
+    for (const size_t t : taxels[r]) {
+      if (t >= cell.size()) {
+        throw std::runtime_error(sb() << "SkinRegions: taxel " << t << " of region " << r
+          << " isn't in the grid of " << cell.size() << " taxels");
+      }
+      ret[r].push_back(taxels_grid.cell(cell[t]));
+    }
+  }
+  return ret;
+}
+
+} /* namespace cm */
@@ -0,0 +1,106 @@
+#include "cm/details/cgls.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+double squared_norm(const std::vector<double>& v)
+{
+  double sum = 0;
+  for (const double e : v) {
+    sum += e * e;
+  }
+  return sum;
+}
+
+} /* anonymous namespace */
+
+size_t cgls(
+  const LinearOperator& a,
+  const std::vector<double>& d,
+  const std::vector<double>& b,
+  std::vector<double>& x,
+  const size_t max_iterations,
+  const double tolerance
+)
+{
+  const size_t m = a.n_rows();
+  const size_t n = a.n_cols();
+  if (b.size() != m || d.size() != n) {
+    throw std::runtime_error(sb() << "cgls: " << b.size() << " right-hand sides and "
+      << d.size() << " scales for a " << m << "x" << n << " operator");
+  }
+  x.resize(n, 0.0);
+
+  // s = d .* a^T b: the scale of the gradients
+  std::vector<double> s(n);
+  a.apply_transpose(b.data(), s.data());
+  for (size_t j = 0; j < n; ++j) {
+    s[j] *= d[j];
+  }
+  const double threshold = tolerance * tolerance * squared_norm(s);
+
+  // r = b - a x
+  std::vector<double> r(m);
+  a.apply(x.data(), r.data());
+  for (size_t i = 0; i < m; ++i) {
+    r[i] = b[i] - r[i];
+  }
+  // s = d .* a^T r, the gradient of the scaled problem
+  a.apply_transpose(r.data(), s.data());
+  for (size_t j = 0; j < n; ++j) {
+    s[j] *= d[j];
+  }
+  double gamma = squared_norm(s);
+
+  std::vector<double> p(s);
+  std::vector<double> dp(n);
+  std::vector<double> q(m);
+  size_t k = 0;
+  for (; k < max_iterations && gamma > threshold; ++k) {
+    for (size_t j = 0; j < n; ++j) {
+      dp[j] = d[j] * p[j];
+    }
+    a.apply(dp.data(), q.data());
+    const double q_norm = squared_norm(q);
+    if (!(q_norm > 0)) {
+      break;
+    }
+    const double alpha = gamma / q_norm;
+    for (size_t j = 0; j < n; ++j) {
+      x[j] += alpha * dp[j];
+    }
+    for (size_t i = 0; i < m; ++i) {
+      r[i] -= alpha * q[i];
+    }
+    a.apply_transpose(r.data(), s.data());
+    for (size_t j = 0; j < n; ++j) {
+      s[j] *= d[j];
+    }
+    const double gamma_new = squared_norm(s);
+    const double beta = gamma_new / gamma;
+    gamma = gamma_new;
+    for (size_t j = 0; j < n; ++j) {
+      p[j] = s[j] + beta * p[j];
+    }
+  }
+  return k;
+}
+
+std::vector<double> column_scaling(const LinearOperator& a)
+{
+  std::vector<double> ret = a.column_norms();
+  for (double& v : ret) {
+    v = v > 0 ? 1 / v : 0;
+  }
+  return ret;
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,122 @@
+#include "cm/details/coarse_to_fine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/power_iteration.hpp"
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+CoarseToFine::CoarseToFine(
+  std::shared_ptr<const LinearOperator> forward,
+  arma::mat coarse_inverse,
+  const CellCoordinates& fine,
+  const CellCoordinates& coarse,
+  const size_t dim,
+  const double reach_x,
+  const double reach_y,
+  const double threshold,
+  const double regularisation
+)
+:
+  dim_(dim),
+  threshold_(threshold),
+  forward_(std::move(forward)),
+  coarse_inverse_(std::move(coarse_inverse)),
+  reachable_(coarse.size())
+{
+  if (forward_->n_cols() != dim_ * fine.size() || coarse_inverse_.n_rows != dim_ * coarse.size()
+    || coarse_inverse_.n_cols != forward_->n_rows()) {
+    throw std::runtime_error(sb() << "CoarseToFine: a " << forward_->n_rows() << "x"
+      << forward_->n_cols() << " model and a " << coarse_inverse_.n_rows << "x"
+      << coarse_inverse_.n_cols << " coarse inverse for " << fine.size() << " fine and "
+      << coarse.size() << " coarse cells of " << dim_ << " values");
+  }
+  if (!(regularisation > 0)) {
+    throw std::runtime_error(sb() << "CoarseToFine: the regularisation must be positive; got "
+      << regularisation);
+  }
+  lambda_ = regularisation * largest_squared_singular_value(*forward_, 1e-3);
+
+  for (size_t k = 0; k < coarse.size(); ++k) {
+    for (size_t c = 0; c < fine.size(); ++c) {
+      if (std::fabs(fine.x[c] - coarse.x[k]) <= reach_x
+        && std::fabs(fine.y[c] - coarse.y[k]) <= reach_y) {
+        reachable_[k].push_back(c);
+      }
+    }
+  }
+}
+
+std::vector<double> CoarseToFine::solve(const std::vector<double>& d, size_t* window) const
+{
+  if (d.size() != forward_->n_rows()) {
+    throw std::runtime_error(sb() << "CoarseToFine::solve: " << d.size()
+      << " displacements; expected " << forward_->n_rows());
+  }
+  const arma::colvec dv(d);
+  const arma::colvec coarse = coarse_inverse_ * dv;
+
+  // the coarse cells in contact, and the fine cells within their reach
+  std::vector<double> magnitude(reachable_.size(), 0.0);
+  double largest = 0;
+  for (size_t k = 0; k < magnitude.size(); ++k) {
+    for (size_t a = 0; a < dim_; ++a) {
+      magnitude[k] += coarse(dim_*k + a) * coarse(dim_*k + a);
+    }
+    magnitude[k] = std::sqrt(magnitude[k]);
+    largest = std::max(largest, magnitude[k]);
+  }
+  std::vector<char> in_window(forward_->n_cols() / std::max<size_t>(dim_, 1), 0);
+  if (largest > 0) {
+    for (size_t k = 0; k < magnitude.size(); ++k) {
+      if (magnitude[k] >= threshold_ * largest) {
+        for (const size_t c : reachable_[k]) {
+          in_window[c] = 1;
+        }
+      }
+    }
+  }
+  std::vector<size_t> columns;
+  for (size_t c = 0; c < in_window.size(); ++c) {
+    if (in_window[c]) {
+      for (size_t a = 0; a < dim_; ++a) {
+        columns.push_back(dim_*c + a);
+      }
+    }
+  }
+  if (window) {
+    *window = columns.size() / std::max<size_t>(dim_, 1);
+  }
+
+  std::vector<double> ret(forward_->n_cols(), 0.0);
+  const size_t w = columns.size();
+  if (0 == w) {
+    return ret;
+  }
+  const arma::mat a_w = forward_->columns(columns);
+  arma::mat g = a_w.t() * a_w;
+  for (size_t j = 0; j < w; ++j) {
+    g(j, j) += lambda_;
+  }
+  const arma::colvec rhs = a_w.t() * dv;
+  // g is symmetric positive definite: Cholesky, and two triangular solves
+  arma::mat r;
+  if (!arma::chol(r, g)) {
+    throw std::runtime_error(sb() << "CoarseToFine::solve: the Cholesky factorisation of the "
+      << w << " values' window failed");
+  }
+  const arma::colvec y = arma::solve(arma::trimatl(r.t()), rhs);
+  const arma::colvec x = arma::solve(arma::trimatu(r), y);
+  for (size_t j = 0; j < w; ++j) {
+    ret[columns[j]] = x(j);
+  }
+  return ret;
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,431 @@
+#include "cm/details/convolution_operator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/string.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   Lattice coordinate of u (in units of the pitch), or -1 if u is off the lattice
+ */
+long lattice_index(const double u)
+{
+  const double r = std::floor(u + 0.5);
+  return (std::fabs(u - r) <= 1e-6) ? static_cast<long>(r) : -1;
+}
+
+} /* anonymous namespace */
+
+bool fit_lattice(const CellCoordinates& c, const double px, const double py, Lattice& ret)
+{
+  if (c.size() == 0 || !(px > 0) || !(py > 0)) {
+    return false;
+  }
+  ret.x0 = *std::min_element(c.x.begin(), c.x.end());
+  ret.y0 = *std::min_element(c.y.begin(), c.y.end());
+  ret.px = px;
+  ret.py = py;
+  std::vector<long> ix(c.size());
+  std::vector<long> iy(c.size());
+  long max_ix = 0;
+  long max_iy = 0;
+  for (size_t k = 0; k < c.size(); ++k) {
+    ix[k] = lattice_index((c.x[k] - ret.x0) / px);
+    iy[k] = lattice_index((c.y[k] - ret.y0) / py);
+    if (ix[k] < 0 || iy[k] < 0) {
+      return false;
+    }
+    max_ix = std::max(max_ix, ix[k]);
+    max_iy = std::max(max_iy, iy[k]);
+  }
+  ret.nx = max_ix + 1;
+  ret.ny = max_iy + 1;
+  if (ret.nx * ret.ny > 4 * c.size()) {
+    return false;
+  }
+
+  std::vector<char> taken(ret.nx * ret.ny, 0);
+  ret.node.resize(c.size());
+  for (size_t k = 0; k < c.size(); ++k) {
+    ret.node[k] = ix[k] * ret.ny + iy[k];
+    if (taken[ret.node[k]]) {
+      return false;
+    }
+    taken[ret.node[k]] = 1;
+  }
+  return true;
+}
+
+void ConvolutionOperator::stencil_offsets(
+  const Lattice& src,
+  const Lattice& dst,
+  std::vector<double>& x,
+  std::vector<double>& y
+)
+{
+  const long di_min = -static_cast<long>(src.nx - 1);
+  const long dj_min = -static_cast<long>(src.ny - 1);
+  const long di_end = static_cast<long>(dst.nx);
+  const long dj_end = static_cast<long>(dst.ny);
+  const double snap_x = 1e-9 * src.px;
+  const double snap_y = 1e-9 * src.py;
+  x.clear();
+  y.clear();
+  x.reserve((di_end - di_min) * (dj_end - dj_min));
+  y.reserve((di_end - di_min) * (dj_end - dj_min));
+  for (long di = di_min; di < di_end; ++di) {
+    const double ox = (dst.x0 - src.x0) + di * src.px;
+    for (long dj = dj_min; dj < dj_end; ++dj) {
+      const double oy = (dst.y0 - src.y0) + dj * src.py;
+      x.push_back((std::fabs(ox) < snap_x) ? 0.0 : ox);
+      y.push_back((std::fabs(oy) < snap_y) ? 0.0 : oy);
+    }
+  }
+}
+
+ConvolutionOperator::ConvolutionOperator(
+  const Lattice& src,
+  const Lattice& dst,
+  const size_t src_dim,
+  const size_t dst_dim,
+  const std::vector<std::vector<double>>& stencils
+)
+:
+  src_dim_(src_dim),
+  dst_dim_(dst_dim),
+  fft_(fft_size(src.nx + dst.nx - 1), fft_size(src.ny + dst.ny - 1)),
+  src_pos_(src.node.size()),
+  dst_pos_(dst.node.size()),
+  spectra_(stencils.size())
+{
+  const size_t sx = src.nx + dst.nx - 1;
+  const size_t sy = src.ny + dst.ny - 1;
+  if (stencils.size() != src_dim * dst_dim) {
+    throw std::runtime_error(sb()
+      << "ConvolutionOperator: " << stencils.size() << " stencils given; expected "
+      << src_dim * dst_dim
+    );
+  }
+  for (size_t k = 0; k < src.node.size(); ++k) {
+    src_pos_[k] = (src.node[k] / src.ny) * fft_.ny() + src.node[k] % src.ny;
+  }
+  for (size_t k = 0; k < dst.node.size(); ++k) {
+    dst_pos_[k] = (dst.node[k] / dst.ny) * fft_.ny() + dst.node[k] % dst.ny;
+  }
+
+  for (size_t s = 0; s < stencils.size(); ++s) {
+    if (stencils[s].size() != sx * sy) {
+      throw std::runtime_error(sb()
+        << "ConvolutionOperator: stencil " << s << " has " << stencils[s].size()
+        << " coefficients; expected " << sx * sy
+      );
+    }
+    // offset (di, dj) goes to (di mod nx, dj mod ny) of the circulant
+    std::vector<complex_type>& c = spectra_[s];
+    c.assign(fft_.size(), 0.0);
+    for (size_t u = 0; u < sx; ++u) {
+      const size_t i = (u + fft_.nx() - (src.nx - 1)) % fft_.nx();
+      for (size_t v = 0; v < sy; ++v) {
+        const size_t j = (v + fft_.ny() - (src.ny - 1)) % fft_.ny();
+        c[i*fft_.ny() + j] = stencils[s][u*sy + v];
+      }
+    }
+    fft_.forward(c.data());
+  }
+}
+
+ConvolutionOperator::ConvolutionOperator(
+  const size_t src_dim,
+  const size_t dst_dim,
+  const Fft2d& fft,
+  const std::vector<size_t>& src_pos,
+  const std::vector<size_t>& dst_pos,
+  std::vector<std::vector<complex_type>> spectra
+)
+:
+  src_dim_(src_dim),
+  dst_dim_(dst_dim),
+  fft_(fft),
+  src_pos_(src_pos),
+  dst_pos_(dst_pos),
+  spectra_(std::move(spectra))
+{
+}
+
+std::unique_ptr<ConvolutionOperator> ConvolutionOperator::regularised_inverse(
+  const double regularisation
+) const
+{
+  if (!(regularisation >= 0)) {
+    throw std::runtime_error(sb()
+      << "ConvolutionOperator::regularised_inverse: invalid regularisation: " << regularisation
+    );
+  }
+  const size_t nf = src_dim_;
+  const size_t nd = dst_dim_;
+
+  double max_trace = 0;
+  for (size_t w = 0; w < fft_.size(); ++w) {
+    double trace = 0;
+    for (const auto& k : spectra_) {
+      trace += std::norm(k[w]);
+    }
+    max_trace = std::max(max_trace, trace);
+  }
+  const double lambda = regularisation * max_trace;
+
+  // (K^H K + lambda I)^-1 K^H per frequency; the inverse's stencils are src_dim rows of
+  // dst_dim, (b,a) at [b*dst_dim + a]
+  std::vector<std::vector<complex_type>> inv(nf * nd, std::vector<complex_type>(fft_.size()));
+  std::vector<complex_type> m(nf * nf);
+  std::vector<complex_type> r(nf * nd);
+  for (size_t w = 0; w < fft_.size(); ++w) {
+    for (size_t b = 0; b < nf; ++b) {
+      for (size_t c = 0; c < nf; ++c) {
+        complex_type sum = (b == c) ? lambda : 0.0;
+        for (size_t a = 0; a < nd; ++a) {
+          sum += std::conj(spectra_[a*nf + b][w]) * spectra_[a*nf + c][w];
+        }
+        m[b*nf + c] = sum;
+      }
+      for (size_t a = 0; a < nd; ++a) {
+        r[b*nd + a] = std::conj(spectra_[a*nf + b][w]);
+      }
+    }
+    // Gauss-Jordan elimination with partial pivoting; m is at most 3x3
+    for (size_t k = 0; k < nf; ++k) {
+      size_t piv = k;
+      for (size_t i = k + 1; i < nf; ++i) {
+        if (std::abs(m[i*nf + k]) > std::abs(m[piv*nf + k])) {
+          piv = i;
+        }
+      }
+      if (m[piv*nf + k] == 0.0) {
+        // K vanishes at this frequency and lambda is 0: leave it out of the solution
+        continue;
+      }
+      if (piv != k) {
+        std::swap_ranges(m.begin() + k*nf, m.begin() + (k + 1)*nf, m.begin() + piv*nf);
+        std::swap_ranges(r.begin() + k*nd, r.begin() + (k + 1)*nd, r.begin() + piv*nd);
+      }
+      for (size_t i = 0; i < nf; ++i) {
+        if (i == k) {
+          continue;
+        }
+        const complex_type f = m[i*nf + k] / m[k*nf + k];
+        for (size_t j = k; j < nf; ++j) {
+          m[i*nf + j] -= f * m[k*nf + j];
+        }
+        for (size_t a = 0; a < nd; ++a) {
+          r[i*nd + a] -= f * r[k*nd + a];
+        }
+      }
+    }
+    for (size_t b = 0; b < nf; ++b) {
+      for (size_t a = 0; a < nd; ++a) {
+        inv[b*nd + a][w] = (m[b*nf + b] == 0.0) ? 0.0 : r[b*nd + a] / m[b*nf + b];
+      }
+    }
+  }
+
+  return std::unique_ptr<ConvolutionOperator>(
+    new ConvolutionOperator(nd, nf, fft_, dst_pos_, src_pos_, std::move(inv))
+  );
+}
+
+size_t ConvolutionOperator::impl_n_rows() const
+{
+  return dst_dim_ * dst_pos_.size();
+}
+
+size_t ConvolutionOperator::impl_n_cols() const
+{
+  return src_dim_ * src_pos_.size();
+}
+
+void ConvolutionOperator::impl_apply(const double* x, double* y) const
+{
+  convolve(x, src_pos_, src_dim_, y, dst_pos_, dst_dim_, false);
+}
+
+void ConvolutionOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  convolve(y, dst_pos_, dst_dim_, x, src_pos_, src_dim_, true);
+}
+
+std::vector<double> ConvolutionOperator::impl_column_norms() const
+{
+  // the squared norm of value b of the src cell at p is the sum over the dst cells d of the
+  // squared stencils at d - p: the squared stencils correlated with dst's cells
+  const size_t n = fft_.size();
+  std::vector<complex_type> mask(n);
+  for (const size_t pos : dst_pos_) {
+    mask[pos] = 1;
+  }
+  fft_.forward(mask.data());
+  std::vector<double> ret(n_cols());
+  std::vector<complex_type> squares(n);
+  std::vector<complex_type> stencil(n);
+  for (size_t b = 0; b < src_dim_; ++b) {
+    std::fill(squares.begin(), squares.end(), 0.0);
+    for (size_t a = 0; a < dst_dim_; ++a) {
+      stencil = spectra_[a*src_dim_ + b];
+      fft_.inverse(stencil.data());
+      for (size_t l = 0; l < n; ++l) {
+        squares[l] += stencil[l].real() * stencil[l].real();
+      }
+    }
+    fft_.forward(squares.data());
+    for (size_t l = 0; l < n; ++l) {
+      squares[l] = std::conj(squares[l]) * mask[l];
+    }
+    fft_.inverse(squares.data());
+    for (size_t k = 0; k < src_pos_.size(); ++k) {
+      ret[k*src_dim_ + b] = std::sqrt(std::max(0.0, squares[src_pos_[k]].real()));
+    }
+  }
+  return ret;
+}
+
+void ConvolutionOperator::convolve(
+  const double* in, const std::vector<size_t>& in_pos, const size_t in_dim,
+  double* out, const std::vector<size_t>& out_pos, const size_t out_dim,
+  const bool transpose
+) const
+{
+  const size_t n = fft_.size();
+  std::vector<std::vector<complex_type>> in_hat(in_dim, std::vector<complex_type>(n));
+  for (size_t b = 0; b < in_dim; ++b) {
+    for (size_t k = 0; k < in_pos.size(); ++k) {
+      in_hat[b][in_pos[k]] = in[k*in_dim + b];
+    }
+    fft_.forward(in_hat[b].data());
+  }
+
+  // the transpose correlates: conj(spectrum) for a real stencil
+  const double sign = transpose ? -1.0 : 1.0;
+  std::vector<complex_type> acc(n);
+  for (size_t a = 0; a < out_dim; ++a) {
+    std::fill(acc.begin(), acc.end(), 0.0);
+    double* __restrict r = reinterpret_cast<double*>(acc.data());
+    for (size_t b = 0; b < in_dim; ++b) {
+      const size_t s = transpose ? b*src_dim_ + a : a*src_dim_ + b;
+      const double* __restrict c = reinterpret_cast<const double*>(spectra_[s].data());
+      const double* __restrict v = reinterpret_cast<const double*>(in_hat[b].data());
+      for (size_t l = 0; l < 2*n; l += 2) {
+        const double ci = sign * c[l+1];
+        r[l]   += c[l]*v[l] - ci*v[l+1];
+        r[l+1] += c[l]*v[l+1] + ci*v[l];
+      }
+    }
+    fft_.inverse(acc.data());
+    for (size_t k = 0; k < out_pos.size(); ++k) {
+      out[k*out_dim + a] = acc[out_pos[k]].real();
+    }
+  }
+}
+
+DeconvolutionOperator::DeconvolutionOperator(
+  std::shared_ptr<const ConvolutionOperator> forward,
+  const double regularisation,
+  const size_t steps
+)
+:
+  forward_(std::move(forward)),
+  inverse_(forward_->regularised_inverse(regularisation)),
+  steps_(steps)
+{
+  if (steps_ == 0 || forward_->n_cols() == 0) {
+    return;
+  }
+  // The error of the solution goes through I - W K at every step: estimate how much that
+  // shrinks a vector by a few rounds of power iteration.
+  const size_t rounds = 12;
+  std::vector<double> v(forward_->n_cols());
+  for (size_t i = 0; i < v.size(); ++i) {
+    v[i] = std::sin(1.0 + i);
+  }
+  std::vector<double> kv(forward_->n_rows());
+  std::vector<double> wkv(forward_->n_cols());
+  double rate = 0;
+  for (size_t k = 0; k < rounds; ++k) {
+    double norm_v = 0;
+    double norm_e = 0;
+    forward_->apply(v.data(), kv.data());
+    inverse_->apply(kv.data(), wkv.data());
+    for (size_t i = 0; i < v.size(); ++i) {
+      norm_v += v[i] * v[i];
+      v[i] -= wkv[i];
+      norm_e += v[i] * v[i];
+    }
+    if (norm_e == 0) {
+      return;
+    }
+    rate = std::sqrt(norm_e / norm_v);
+    const double scale = 1.0 / std::sqrt(norm_e);
+    for (double& e : v) {
+      e *= scale;
+    }
+  }
+  if (rate > 0.9) {
+    LOG(WARN) << "DeconvolutionOperator: the refinement wouldn't converge (the error would be "
+      << "multiplied by ~" << rate << " per step); not refining.";
+    steps_ = 0;
+  }
+}
+
+size_t DeconvolutionOperator::impl_n_rows() const
+{
+  return forward_->n_cols();
+}
+
+size_t DeconvolutionOperator::impl_n_cols() const
+{
+  return forward_->n_rows();
+}
+
+void DeconvolutionOperator::impl_apply(const double* x, double* y) const
+{
+  inverse_->apply(x, y);
+  std::vector<double> r(forward_->n_rows());
+  std::vector<double> dy(forward_->n_cols());
+  for (size_t s = 0; s < steps_; ++s) {
+    forward_->apply(y, r.data());
+    for (size_t i = 0; i < r.size(); ++i) {
+      r[i] = x[i] - r[i];
+    }
+    inverse_->apply(r.data(), dy.data());
+    for (size_t i = 0; i < dy.size(); ++i) {
+      y[i] += dy[i];
+    }
+  }
+}
+
+void DeconvolutionOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  // apply() is sum_k (I - W K)^k W, k = 0..steps; its transpose W^T sum_k (I - K^T W^T)^k,
+  // the sum evaluated by Horner's scheme
+  std::vector<double> v(y, y + forward_->n_cols());
+  std::vector<double> w(forward_->n_rows());
+  std::vector<double> kw(forward_->n_cols());
+  for (size_t s = 0; s < steps_; ++s) {
+    inverse_->apply_transpose(v.data(), w.data());
+    forward_->apply_transpose(w.data(), kw.data());
+    for (size_t i = 0; i < v.size(); ++i) {
+      v[i] = y[i] + v[i] - kw[i];
+    }
+  }
+  inverse_->apply_transpose(v.data(), x);
+}
+
+} /* namespace details */
+} /* namespace cm */
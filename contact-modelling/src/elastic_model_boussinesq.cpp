@@ -1,12 +1,18 @@
 #include "cm/details/elastic_model_boussinesq.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "cm/skin/attributes.hpp"
 #include "cm/grid/grid.hpp"
 
+#include "cm/details/cell_coordinates.hpp"
 #include "cm/details/math.hpp"
+#include "cm/details/parallel.hpp"
 #include "cm/details/string.hpp"
 #include "cm/log/log.hpp"
 
@@ -109,170 +115,847 @@ double appro_zz(const SkinAttributes& sa, const CoeffsBouss& cb)
   return cb.c_9_2_pi_E_psi_z0h;
 }
 
-arma::mat f2d_11(const Grid& f, const Grid& d, const SkinAttributes& skin_attr, const bool psi_exact)
-{
-  arma::mat ret(d.num_cells(), f.num_cells());
-  for (size_t ind_d = 0; ind_d < d.num_cells(); ++ind_d) {
-    for (size_t ind_f = 0; ind_f < f.num_cells(); ++ind_f) {
-      const double x = d.cell(ind_d).x - f.cell(ind_f).x;
-      const double y = d.cell(ind_d).y - f.cell(ind_f).y;
-      const CoeffsBouss cb(skin_attr.E, x, y, skin_attr.h, f.getCellShape().area(), psi_exact);
-      const double a_zz = appro_zz(skin_attr, cb);
-      const double b_zz = bouss_zz(skin_attr, cb, x,y);
-      if ((x == 0 && y == 0) || std::fabs(a_zz) < std::fabs(b_zz)) {
-        ret(ind_d, ind_f) = a_zz;
-      } else {
-        ret(ind_d, ind_f) = b_zz;
+BoussInvariants::BoussInvariants(
+  const SkinAttributes& skin_attr,
+  const double s,
+  const bool   psi_exact
+)
+:
+  c_3_4_pi_E(3.0/(4.0 * M_PI * skin_attr.E)),
+  h(skin_attr.h),
+  h2(skin_attr.h * skin_attr.h),
+  a_xx(
+    (psi_exact) ?
+      ((9.0/(4*M_PI*skin_attr.E)) * (psi(skin_attr.h/z0h(s))/z0h(s)))
+      :
+      ((9.0/(4*M_PI*skin_attr.E)) * (0.25/z0h(s)))
+  ),
+  a_zz(2*a_xx)
+{
+
+}
+
+// The kernels below are the tile-wise equivalents of bouss_*() and appro_*(); the branches are
+// written as selections so that the loops stay vectorisable. At x == y == 0 the exact solution
+// evaluates to inf/nan, but it is never selected there.
+
+CM_VECTOR_CLONES
+void bouss_tile_zz(const BoussInvariants& inv, BoussTile& t, const size_t n)
+{
+  const double c    = inv.c_3_4_pi_E;
+  const double h2   = inv.h2;
+  const double a_zz = inv.a_zz;
+  double* __restrict zz = t.m[2][2];
+  for (size_t i = 0; i < n; ++i) {
+    const double x = t.x[i];
+    const double y = t.y[i];
+    const double r2   = x*x + y*y;
+    const double rh2  = r2 + h2;
+    const double c_xy     = c / std::sqrt(r2);
+    const double c_xyh3   = c / (rh2 * std::sqrt(rh2));
+    const double b_zz = c_xy - (r2 + 2*h2) * c_xyh3;
+    const bool appro  = (x == 0 && y == 0) || std::fabs(a_zz) < std::fabs(b_zz);
+    zz[i] = appro ? a_zz : b_zz;
+  }
+}
+
+CM_VECTOR_CLONES
+void bouss_tile_z(const BoussInvariants& inv, BoussTile& t, const size_t n)
+{
+  const double c    = inv.c_3_4_pi_E;
+  const double h    = inv.h;
+  const double h2   = inv.h2;
+  const double a_zz = inv.a_zz;
+  double* __restrict zx = t.m[2][0];
+  double* __restrict zy = t.m[2][1];
+  double* __restrict zz = t.m[2][2];
+  for (size_t i = 0; i < n; ++i) {
+    const double x = t.x[i];
+    const double y = t.y[i];
+    const double r2   = x*x + y*y;
+    const double rh2  = r2 + h2;
+    const double c_xy     = c / std::sqrt(r2);
+    const double c_xyh3   = c / (rh2 * std::sqrt(rh2));
+    const double b_zz = c_xy - (r2 + 2*h2) * c_xyh3;
+    const bool appro  = (x == 0 && y == 0) || std::fabs(a_zz) < std::fabs(b_zz);
+    zx[i] = appro ? 0.0 : - (x*h) * c_xyh3;
+    zy[i] = appro ? 0.0 : - (y*h) * c_xyh3;
+    zz[i] = appro ? a_zz : b_zz;
+  }
+}
+
+CM_VECTOR_CLONES
+void bouss_tile_full(const BoussInvariants& inv, BoussTile& t, const size_t n)
+{
+  const double c    = inv.c_3_4_pi_E;
+  const double h    = inv.h;
+  const double h2   = inv.h2;
+  const double a_xx = inv.a_xx;
+  const double a_yy = inv.a_xx;
+  const double a_zz = inv.a_zz;
+  // restrict-qualified locals: otherwise the clones don't vectorise, the nine outputs might alias
+  const double* __restrict tx = t.x;
+  const double* __restrict ty = t.y;
+  double* __restrict xx = t.m[0][0];
+  double* __restrict xy = t.m[0][1];
+  double* __restrict xz = t.m[0][2];
+  double* __restrict yx = t.m[1][0];
+  double* __restrict yy = t.m[1][1];
+  double* __restrict yz = t.m[1][2];
+  double* __restrict zx = t.m[2][0];
+  double* __restrict zy = t.m[2][1];
+  double* __restrict zz = t.m[2][2];
+  for (size_t i = 0; i < n; ++i) {
+    const double x = tx[i];
+    const double y = ty[i];
+    const bool   origin = (x == 0) & (y == 0);
+    const double r2   = x*x + y*y;
+    const double rh2  = r2 + h2;
+    const double c_xy     = c / std::sqrt(r2);
+    const double c_xy3    = c_xy / r2;
+    const double c_xyh3   = c / (rh2 * std::sqrt(rh2));
+
+    const double b_xx = (2*x*x + y*y) * c_xy3 - (2*x*x + y*y + h2) * c_xyh3;
+    const double b_xy = (x*y) * c_xy3 - (x*y) * c_xyh3;
+    const double b_xz = - (x*h) * c_xyh3;
+    const double b_yy = (x*x + 2*y*y) * c_xy3 - (x*x + 2*y*y + h2) * c_xyh3;
+    const double b_yz = - (y*h) * c_xyh3;
+    const double b_zz = c_xy - (r2 + 2*h2) * c_xyh3;
+
+    const bool appro_x = origin | (std::fabs(a_xx) < std::fabs(b_xx));
+    const bool appro_y = origin | (std::fabs(a_yy) < std::fabs(b_yy));
+    const bool appro_z = origin | (std::fabs(a_zz) < std::fabs(b_zz));
+
+    xx[i] = appro_x ? a_xx : b_xx;
+    xy[i] = appro_x ? 0.0  : b_xy;
+    xz[i] = appro_x ? 0.0  : b_xz;
+
+    yx[i] = appro_y ? 0.0  : b_xy;
+    yy[i] = appro_y ? a_yy : b_yy;
+    yz[i] = appro_y ? 0.0  : b_yz;
+
+    zx[i] = appro_z ? 0.0  : b_xz;
+    zy[i] = appro_z ? 0.0  : b_yz;
+    zz[i] = appro_z ? a_zz : b_zz;
+  }
+}
+
+namespace {
+
+/**
+ * \brief   Fill the tile's distances for displacement cells [d0, d0+n) and force cell (fx,fy)
+ */
+void load_tile(
+  BoussTile& t,
+  const CellCoordinates& d,
+  const size_t d0,
+  const size_t n,
+  const double fx,
+  const double fy
+)
+{
+  const double* __restrict dx = d.x.data() + d0;
+  const double* __restrict dy = d.y.data() + d0;
+  for (size_t i = 0; i < n; ++i) {
+    t.x[i] = dx[i] - fx;
+    t.y[i] = dy[i] - fy;
+  }
+}
+
+/**
+ * \brief   Sweep all (displacement, force) cell pairs for force cells [f_first, f_last) in tiles,
+ *          calling kernel_and_store(tile, d0, n, k) once a tile has been loaded with the
+ *          distances of displacement cells [d0, d0+n) to force cell f_first + k.
+ *
+ * The forces' cells, i.e. columns of the result, are split into blocks among the threads. Within
+ * a block, the displacement cells are swept in tiles (the outer loop) and for each tile all the
+ * block's forces' cells are gone through. The result is column-major, so every tile lands in a
+ * contiguous stretch of a column.
+ */
+template <class F>
+void sweep_tiles(
+  const CellCoordinates& fc,
+  const CellCoordinates& dc,
+  const size_t f_first,
+  const size_t f_last,
+  const size_t num_threads,
+  F kernel_and_store
+)
+{
+  parallel_for_blocks(f_last - f_first, num_threads, 0,
+    [&](const size_t k_begin, const size_t k_end) {
+      BoussTile t;
+      for (size_t d0 = 0; d0 < dc.size(); d0 += BoussTile::size) {
+        const size_t n = std::min(BoussTile::size, dc.size() - d0);
+        for (size_t k = k_begin; k < k_end; ++k) {
+          load_tile(t, dc, d0, n, fc.x[f_first + k], fc.y[f_first + k]);
+          kernel_and_store(t, d0, n, k);
+        }
       }
     }
+  );
+}
+
+/**
+ * \brief   Compile-time layout of an FDim-forces -to- DDim-displacements matrix: which tile kernel
+ *          fills the coefficients in and where they go in the result.
+ *
+ * component(t, a, b) is the tile's row of coefficients for displacement component a (of DDim) and
+ * force component b (of FDim). store() writes the tile computed for force cell ind_f and
+ * displacement cells [d0, d0+n) into the result; all the strides are constants, so the copies are
+ * straight (or unrolled) loops.
+ */
+template <size_t FDim, size_t DDim>
+struct BoussLayout;
+
+template <>
+struct BoussLayout<1,1> {
+  static const double* component(const BoussTile& t, const size_t /* a */, const size_t /* b */)
+  {
+    return t.m[2][2];
   }
 
-  return ret;
-}
+  static void kernel(const BoussInvariants& inv, BoussTile& t, const size_t n)
+  {
+    bouss_tile_zz(inv, t, n);
+  }
+
+  static void store(const BoussTile& t, const size_t n, arma::mat& ret, const size_t d0,
+    const size_t ind_f)
+  {
+    std::copy(t.m[2][2], t.m[2][2] + n, ret.colptr(ind_f) + d0);
+  }
+};
+
+template <>
+struct BoussLayout<1,3> {
+  static const double* component(const BoussTile& t, const size_t a, const size_t /* b */)
+  {
+    return t.m[2][a];
+  }
+
+  static void kernel(const BoussInvariants& inv, BoussTile& t, const size_t n)
+  {
+    bouss_tile_z(inv, t, n);
+  }
+
+  static void store(const BoussTile& t, const size_t n, arma::mat& ret, const size_t d0,
+    const size_t ind_f)
+  {
+    // xz == zx, yz == zy
+    double* __restrict col = ret.colptr(ind_f) + 3*d0;
+    for (size_t i = 0; i < n; ++i) {
+      col[3*i + 0] = t.m[2][0][i];
+      col[3*i + 1] = t.m[2][1][i];
+      col[3*i + 2] = t.m[2][2][i];
+    }
+  }
+};
+
+template <>
+struct BoussLayout<3,1> {
+  static const double* component(const BoussTile& t, const size_t /* a */, const size_t b)
+  {
+    return t.m[2][b];
+  }
+
+  static void kernel(const BoussInvariants& inv, BoussTile& t, const size_t n)
+  {
+    bouss_tile_z(inv, t, n);
+  }
+
+  static void store(const BoussTile& t, const size_t n, arma::mat& ret, const size_t d0,
+    const size_t ind_f)
+  {
+    for (size_t j = 0; j < 3; ++j) {
+      std::copy(t.m[2][j], t.m[2][j] + n, ret.colptr(3*ind_f + j) + d0);
+    }
+  }
+};
 
-arma::mat f2d_13(const Grid& f, const Grid& d, const SkinAttributes& skin_attr, const bool psi_exact)
-{
-  arma::mat ret(3*d.num_cells(), f.num_cells());
-  for (size_t ind_d = 0; ind_d < d.num_cells(); ++ind_d) {
-    for (size_t ind_f = 0; ind_f < f.num_cells(); ++ind_f) {
-      const double x = d.cell(ind_d).x - f.cell(ind_f).x;
-      const double y = d.cell(ind_d).y - f.cell(ind_f).y;
-      const CoeffsBouss cb(skin_attr.E, x, y, skin_attr.h, f.getCellShape().area(), psi_exact);
-      const double b_zz = bouss_zz(skin_attr, cb, x, y);
-      const double a_zz = appro_zz(skin_attr, cb);
-
-      if ((x == 0 && y == 0) || std::fabs(a_zz) < std::fabs(b_zz)) {
-        ret(3*ind_d +0, ind_f) = 0;
-        ret(3*ind_d +1, ind_f) = 0;
-        ret(3*ind_d +2, ind_f) = a_zz;
-      } else {
-        ret(3*ind_d +0, ind_f) = bouss_xz(skin_attr, cb, x, y);
-        ret(3*ind_d +1, ind_f) = bouss_yz(skin_attr, cb, x, y);
-        ret(3*ind_d +2, ind_f) = b_zz;
+template <>
+struct BoussLayout<3,3> {
+  static const double* component(const BoussTile& t, const size_t a, const size_t b)
+  {
+    return t.m[a][b];
+  }
+
+  static void kernel(const BoussInvariants& inv, BoussTile& t, const size_t n)
+  {
+    bouss_tile_full(inv, t, n);
+  }
+
+  static void store(const BoussTile& t, const size_t n, arma::mat& ret, const size_t d0,
+    const size_t ind_f)
+  {
+    for (size_t j = 0; j < 3; ++j) {
+      double* __restrict col = ret.colptr(3*ind_f + j) + 3*d0;
+      for (size_t i = 0; i < n; ++i) {
+        col[3*i + 0] = t.m[0][j][i];
+        col[3*i + 1] = t.m[1][j][i];
+        col[3*i + 2] = t.m[2][j][i];
       }
     }
   }
+};
+
+/**
+ * \brief   The matrix of f2d<FDim,DDim>(), evaluated tile by tile whenever it's applied.
+ *
+ * apply() splits the displacements' cells (rows) among the threads, apply_transpose() the forces'
+ * cells (columns); either way every element of the result is summed up by a single thread in a
+ * fixed order, so the results don't depend on the number of threads.
+ */
+template <size_t FDim, size_t DDim>
+class BoussinesqOperator : public LinearOperator {
+public:
+  BoussinesqOperator(const Grid& f, const Grid& d, const SkinAttributes& skin_attr,
+    const bool psi_exact, const size_t num_threads)
+  :
+    inv_(skin_attr, f.getCellShape().area(), psi_exact),
+    fc_(f),
+    dc_(d),
+    pool_(std::make_shared<WorkerPool>(num_threads))
+  {
+  }
+
+private:
+  typedef BoussLayout<FDim, DDim> layout;
+
+  size_t impl_n_rows() const
+  {
+    return DDim * dc_.size();
+  }
+
+  size_t impl_n_cols() const
+  {
+    return FDim * fc_.size();
+  }
+
+  void impl_apply(const double* x, double* y) const
+  {
+    const size_t num_tiles = (dc_.size() + BoussTile::size - 1) / BoussTile::size;
+    parallel_for_blocks(num_tiles, *pool_, 0, [&](const size_t t_begin, const size_t t_end) {
+      BoussTile t;
+      const size_t d_end = std::min(dc_.size(), t_end * BoussTile::size);
+      for (size_t d0 = t_begin * BoussTile::size; d0 < d_end; d0 += BoussTile::size) {
+        const size_t n = std::min(BoussTile::size, dc_.size() - d0);
+        double* __restrict y_tile = y + DDim*d0;
+        std::fill(y_tile, y_tile + DDim*n, 0.0);
+        for (size_t ind_f = 0; ind_f < fc_.size(); ++ind_f) {
+          load_tile(t, dc_, d0, n, fc_.x[ind_f], fc_.y[ind_f]);
+          layout::kernel(inv_, t, n);
+          for (size_t b = 0; b < FDim; ++b) {
+            const double x_b = x[FDim*ind_f + b];
+            for (size_t a = 0; a < DDim; ++a) {
+              const double* __restrict m = layout::component(t, a, b);
+              for (size_t i = 0; i < n; ++i) {
+                y_tile[DDim*i + a] += m[i] * x_b;
+              }
+            }
+          }
+        }
+      }
+    });
+  }
+
+  void impl_apply_transpose(const double* y, double* x) const
+  {
+    parallel_for_blocks(fc_.size(), *pool_, 0, [&](const size_t f_begin, const size_t f_end) {
+      BoussTile t;
+      for (size_t ind_f = f_begin; ind_f < f_end; ++ind_f) {
+        double sums[FDim] = {};
+        for (size_t d0 = 0; d0 < dc_.size(); d0 += BoussTile::size) {
+          const size_t n = std::min(BoussTile::size, dc_.size() - d0);
+          const double* __restrict y_tile = y + DDim*d0;
+          load_tile(t, dc_, d0, n, fc_.x[ind_f], fc_.y[ind_f]);
+          layout::kernel(inv_, t, n);
+          for (size_t b = 0; b < FDim; ++b) {
+            for (size_t a = 0; a < DDim; ++a) {
+              const double* __restrict m = layout::component(t, a, b);
+              for (size_t i = 0; i < n; ++i) {
+                sums[b] += m[i] * y_tile[DDim*i + a];
+              }
+            }
+          }
+        }
+        std::copy(sums, sums + FDim, x + FDim*ind_f);
+      }
+    });
+  }
+
+  /**
+   * \brief   As apply_transpose(), summing up the squares of the coefficients: a single sweep
+   */
+  std::vector<double> impl_column_norms() const
+  {
+    std::vector<double> ret(FDim * fc_.size());
+    parallel_for_blocks(fc_.size(), *pool_, 0, [&](const size_t f_begin, const size_t f_end) {
+      BoussTile t;
+      for (size_t ind_f = f_begin; ind_f < f_end; ++ind_f) {
+        double sums[FDim] = {};
+        for (size_t d0 = 0; d0 < dc_.size(); d0 += BoussTile::size) {
+          const size_t n = std::min(BoussTile::size, dc_.size() - d0);
+          load_tile(t, dc_, d0, n, fc_.x[ind_f], fc_.y[ind_f]);
+          layout::kernel(inv_, t, n);
+          for (size_t b = 0; b < FDim; ++b) {
+            for (size_t a = 0; a < DDim; ++a) {
+              const double* __restrict m = layout::component(t, a, b);
+              for (size_t i = 0; i < n; ++i) {
+                sums[b] += m[i] * m[i];
+              }
+            }
+          }
+        }
+        for (size_t b = 0; b < FDim; ++b) {
+          ret[FDim*ind_f + b] = std::sqrt(sums[b]);
+        }
+      }
+    });
+    return ret;
+  }
+
+  /**
+   * \brief   Every column swept on its own: the force cell's coefficients for all the
+   *          displacement cells, tile by tile
+   */
+  arma::mat impl_columns(const std::vector<size_t>& cols) const
+  {
+    arma::mat ret(DDim * dc_.size(), cols.size());
+    parallel_for_blocks(cols.size(), *pool_, 0,
+      [&](const size_t k_begin, const size_t k_end) {
+        BoussTile t;
+        for (size_t k = k_begin; k < k_end; ++k) {
+          const size_t ind_f = cols[k] / FDim;
+          const size_t b = cols[k] % FDim;
+          double* __restrict col = ret.colptr(k);
+          for (size_t d0 = 0; d0 < dc_.size(); d0 += BoussTile::size) {
+            const size_t n = std::min(BoussTile::size, dc_.size() - d0);
+            load_tile(t, dc_, d0, n, fc_.x[ind_f], fc_.y[ind_f]);
+            layout::kernel(inv_, t, n);
+            for (size_t a = 0; a < DDim; ++a) {
+              const double* __restrict m = layout::component(t, a, b);
+              for (size_t i = 0; i < n; ++i) {
+                col[DDim*(d0 + i) + a] = m[i];
+              }
+            }
+          }
+        }
+      }
+    );
+    return ret;
+  }
 
+  const BoussInvariants inv_;
+  const CellCoordinates fc_;
+  const CellCoordinates dc_;
+  const std::shared_ptr<const WorkerPool> pool_;
+};
+
+/**
+ * \brief   The stencils of a ConvolutionOperator for f2d<FDim,DDim>(): the coefficients at offsets
+ *          (x[k], y[k]), evaluated tile by tile.
+ */
+template <size_t FDim, size_t DDim>
+std::vector<std::vector<double>> bouss_stencils(
+  const BoussInvariants& inv,
+  const std::vector<double>& x,
+  const std::vector<double>& y
+)
+{
+  typedef BoussLayout<FDim, DDim> layout;
+  std::vector<std::vector<double>> ret(DDim*FDim, std::vector<double>(x.size()));
+  BoussTile t;
+  for (size_t k0 = 0; k0 < x.size(); k0 += BoussTile::size) {
+    const size_t n = std::min(BoussTile::size, x.size() - k0);
+    std::copy(x.begin() + k0, x.begin() + k0 + n, t.x);
+    std::copy(y.begin() + k0, y.begin() + k0 + n, t.y);
+    layout::kernel(inv, t, n);
+    for (size_t a = 0; a < DDim; ++a) {
+      for (size_t b = 0; b < FDim; ++b) {
+        const double* m = layout::component(t, a, b);
+        std::copy(m, m + n, ret[a*FDim + b].begin() + k0);
+      }
+    }
+  }
   return ret;
 }
 
-arma::mat f2d_31(const Grid& f, const Grid& d, const SkinAttributes& skin_attr, const bool psi_exact)
-{
-  arma::mat ret(d.num_cells(), 3*f.num_cells());
-  for (size_t ind_d = 0; ind_d < d.num_cells(); ++ind_d) {
-    for (size_t ind_f = 0; ind_f < f.num_cells(); ++ind_f) {
-      const double x = d.cell(ind_d).x - f.cell(ind_f).x;
-      const double y = d.cell(ind_d).y - f.cell(ind_f).y;
-      const CoeffsBouss cb(skin_attr.E, x, y, skin_attr.h, f.getCellShape().area(), psi_exact);
-      const double b_zz = bouss_zz(skin_attr, cb, x, y);
-      const double a_zz = appro_zz(skin_attr, cb);
-
-      if ((x == 0 && y == 0) || std::fabs(a_zz) < std::fabs(b_zz)) {
-        ret(ind_d, 3*ind_f +0) = 0;
-        ret(ind_d, 3*ind_f +1) = 0;
-        ret(ind_d, 3*ind_f +2) = a_zz;
-      } else {
-        ret(ind_d, 3*ind_f +0) = bouss_zx(skin_attr, cb, x, y);
-        ret(ind_d, 3*ind_f +1) = bouss_zy(skin_attr, cb, x, y);
-        ret(ind_d, 3*ind_f +2) = b_zz;
+/**
+ * \brief   ConvolutionOperator for f2d<FDim,DDim>() on lattices fl, dl
+ */
+template <size_t FDim, size_t DDim>
+std::unique_ptr<ConvolutionOperator> bouss_convolution(
+  const Lattice& fl,
+  const Lattice& dl,
+  const BoussInvariants& inv
+)
+{
+  std::vector<double> x, y;
+  ConvolutionOperator::stencil_offsets(fl, dl, x, y);
+  return std::unique_ptr<ConvolutionOperator>(
+    new ConvolutionOperator(fl, dl, FDim, DDim, bouss_stencils<FDim, DDim>(inv, x, y))
+  );
+}
+
+/**
+ * \brief   The coefficients of f2d<FDim,DDim>() for force cells f[0..n_f) and displacement
+ *          cells d[0..n_d), into block (\sa HMatrixOperator::BlockFunction).
+ *
+ * The tiles run along whichever of the two lists is longer: a single row or column of the block
+ * is as vectorised as a whole one.
+ */
+template <size_t FDim, size_t DDim>
+void bouss_block(
+  const BoussInvariants& inv,
+  const CellCoordinates& fc,
+  const CellCoordinates& dc,
+  const size_t* f, const size_t n_f,
+  const size_t* d, const size_t n_d,
+  arma::mat& block
+)
+{
+  typedef BoussLayout<FDim, DDim> layout;
+  BoussTile t;
+  if (n_d >= n_f) {
+    for (size_t d0 = 0; d0 < n_d; d0 += BoussTile::size) {
+      const size_t n = std::min(BoussTile::size, n_d - d0);
+      for (size_t k = 0; k < n_f; ++k) {
+        for (size_t i = 0; i < n; ++i) {
+          t.x[i] = dc.x[d[d0 + i]] - fc.x[f[k]];
+          t.y[i] = dc.y[d[d0 + i]] - fc.y[f[k]];
+        }
+        layout::kernel(inv, t, n);
+        layout::store(t, n, block, d0, k);
+      }
+    }
+    return;
+  }
+  for (size_t f0 = 0; f0 < n_f; f0 += BoussTile::size) {
+    const size_t n = std::min(BoussTile::size, n_f - f0);
+    for (size_t k = 0; k < n_d; ++k) {
+      for (size_t i = 0; i < n; ++i) {
+        t.x[i] = dc.x[d[k]] - fc.x[f[f0 + i]];
+        t.y[i] = dc.y[d[k]] - fc.y[f[f0 + i]];
+      }
+      layout::kernel(inv, t, n);
+      for (size_t a = 0; a < DDim; ++a) {
+        for (size_t b = 0; b < FDim; ++b) {
+          const double* m = layout::component(t, a, b);
+          for (size_t i = 0; i < n; ++i) {
+            block(DDim*k + a, FDim*(f0 + i) + b) = m[i];
+          }
+        }
       }
     }
   }
+}
 
-  return ret;
+/**
+ * \brief   HMatrixOperator for f2d<FDim,DDim>()
+ */
+template <size_t FDim, size_t DDim>
+std::unique_ptr<HMatrixOperator> bouss_hmatrix(
+  const CellCoordinates& fc,
+  const CellCoordinates& dc,
+  const BoussInvariants& inv,
+  const double tolerance,
+  const size_t num_threads
+)
+{
+  return std::unique_ptr<HMatrixOperator>(new HMatrixOperator(fc, dc, FDim, DDim,
+    [&](const size_t* f, const size_t n_f, const size_t* d, const size_t n_d, arma::mat& block) {
+      bouss_block<FDim, DDim>(inv, fc, dc, f, n_f, d, n_d, block);
+    },
+    tolerance, num_threads
+  ));
 }
 
-arma::mat f2d_33(const Grid& f, const Grid& d, const SkinAttributes& skin_attr, const bool psi_exact)
-{
-  arma::mat ret(3*d.num_cells(), 3*f.num_cells());
-  for (size_t ind_d = 0; ind_d < d.num_cells(); ++ind_d) {
-    for (size_t ind_f = 0; ind_f < f.num_cells(); ++ind_f) {
-      const double x = d.cell(ind_d).x - f.cell(ind_f).x;
-      const double y = d.cell(ind_d).y - f.cell(ind_f).y;
-      const CoeffsBouss cb(skin_attr.E, x, y, skin_attr.h, f.getCellShape().area(), psi_exact);
-
-      const double b_xx = bouss_xx(skin_attr, cb, x, y);
-      const double a_xx = appro_xx(skin_attr, cb);
-      if ((x == 0 && y == 0) || std::fabs(a_xx) < std::fabs(b_xx)) {
-        ret(3*ind_d +0, 3*ind_f +0) = a_xx;
-        ret(3*ind_d +0, 3*ind_f +1) = 0;
-        ret(3*ind_d +0, 3*ind_f +2) = 0;
-      } else {
-        ret(3*ind_d +0, 3*ind_f +0) = b_xx;
-        ret(3*ind_d +0, 3*ind_f +1) = bouss_xy(skin_attr, cb,  x, y);
-        ret(3*ind_d +0, 3*ind_f +2) = bouss_xz(skin_attr, cb,  x, y);
-      }
+/**
+ * \brief   SparseOperator for f2d<FDim,DDim>(), cut off at radius
+ */
+template <size_t FDim, size_t DDim>
+std::unique_ptr<SparseOperator> bouss_sparse(
+  const CellCoordinates& fc,
+  const CellCoordinates& dc,
+  const BoussInvariants& inv,
+  const double radius,
+  const size_t num_threads
+)
+{
+  return cutoff_operator(fc, dc, FDim, DDim,
+    [&](const size_t* f, const size_t n_f, const size_t* d, const size_t n_d, arma::mat& block) {
+      bouss_block<FDim, DDim>(inv, fc, dc, f, n_f, d, n_d, block);
+    },
+    radius, num_threads
+  );
+}
 
-      const double b_yy = bouss_yy(skin_attr, cb, x, y);
-      const double a_yy = appro_yy(skin_attr, cb);
-      if ((x == 0 && y == 0) || std::fabs(a_yy) < std::fabs(b_yy)) {
-        ret(3*ind_d +1, 3*ind_f +0) = 0;
-        ret(3*ind_d +1, 3*ind_f +1) = a_yy;
-        ret(3*ind_d +1, 3*ind_f +2) = 0;
-      } else {
-        ret(3*ind_d +1, 3*ind_f +0) = bouss_yx(skin_attr, cb,  x, y);
-        ret(3*ind_d +1, 3*ind_f +1) = b_yy;
-        ret(3*ind_d +1, 3*ind_f +2) = bouss_yz(skin_attr, cb,  x, y);
+/**
+ * \brief   MappedOperator for f2d<FDim,DDim>(), written to path a few dozen MB of columns at a
+ *          time: the mapped pages written in a pass can be flushed to the file during the next.
+ */
+template <size_t FDim, size_t DDim>
+std::unique_ptr<MappedOperator> bouss_mapped(
+  const CellCoordinates& fc,
+  const CellCoordinates& dc,
+  const BoussInvariants& inv,
+  const std::string& path,
+  const uint64_t fingerprint,
+  const size_t num_threads
+)
+{
+  typedef BoussLayout<FDim, DDim> layout;
+  const size_t n_rows = DDim*dc.size();
+  const size_t pass = std::max<size_t>(1, (size_t(64) << 20) / (sizeof(double)*n_rows*FDim));
+  return std::unique_ptr<MappedOperator>(new MappedOperator(path, n_rows, FDim*fc.size(),
+    fingerprint,
+    [&](arma::mat& m) {
+      for (size_t f0 = 0; f0 < fc.size(); f0 += pass) {
+        const size_t f1 = std::min(fc.size(), f0 + pass);
+        arma::mat columns(m.colptr(FDim*f0), n_rows, FDim*(f1 - f0), false, true);
+        sweep_tiles(fc, dc, f0, f1, num_threads,
+          [&](BoussTile& t, const size_t d0, const size_t n, const size_t k) {
+            layout::kernel(inv, t, n);
+            layout::store(t, n, columns, d0, k);
+          }
+        );
       }
+    },
+    num_threads
+  ));
+}
 
-      const double b_zz = bouss_zz(skin_attr, cb, x, y);
-      const double a_zz = appro_zz(skin_attr, cb);
-      if ((x == 0 && y == 0) || std::fabs(a_zz) < std::fabs(b_zz)) {
-        ret(3*ind_d +2, 3*ind_f +0) = 0;
-        ret(3*ind_d +2, 3*ind_f +1) = 0;
-        ret(3*ind_d +2, 3*ind_f +2) = a_zz;
-      } else {
-        ret(3*ind_d +2, 3*ind_f +0) = bouss_zx(skin_attr, cb,  x, y);
-        ret(3*ind_d +2, 3*ind_f +1) = bouss_zy(skin_attr, cb,  x, y);
-        ret(3*ind_d +2, 3*ind_f +2) = b_zz;
-      }
+} /* anonymous namespace */
+
+template <size_t FDim, size_t DDim>
+arma::mat f2d(const Grid& f, const Grid& d, const SkinAttributes& skin_attr, const bool psi_exact,
+  const size_t num_threads)
+{
+  typedef BoussLayout<FDim, DDim> layout;
+  const BoussInvariants inv(skin_attr, f.getCellShape().area(), psi_exact);
+  const CellCoordinates fc(f);
+  const CellCoordinates dc(d);
+  arma::mat ret(DDim*d.num_cells(), FDim*f.num_cells());
+  sweep_tiles(fc, dc, 0, fc.size(), num_threads,
+    [&](BoussTile& t, const size_t d0, const size_t n, const size_t ind_f) {
+      layout::kernel(inv, t, n);
+      layout::store(t, n, ret, d0, ind_f);
     }
-  }
+  );
 
   return ret;
 }
 
-}
+template arma::mat f2d<1,1>(const Grid&, const Grid&, const SkinAttributes&, const bool,
+  const size_t);
+template arma::mat f2d<1,3>(const Grid&, const Grid&, const SkinAttributes&, const bool,
+  const size_t);
+template arma::mat f2d<3,1>(const Grid&, const Grid&, const SkinAttributes&, const bool,
+  const size_t);
+template arma::mat f2d<3,3>(const Grid&, const Grid&, const SkinAttributes&, const bool,
+  const size_t);
 
-arma::mat forces_to_displacements_matrix(
+namespace {
+
+/**
+ * \brief   The checks and the warning common to every forces-to-displacements model, then
+ *          functor's operator()<FDim,DDim>() for f's and d's dimensionalities: the only runtime
+ *          dispatch, everything below it is specialised for the dimensionalities.
+ */
+template <class Functor>
+typename Functor::result_type dispatch_dims(
   const Grid& f,
   const Grid& d,
   const SkinAttributes& skin_attr,
-  const bool psi_exact
+  const Functor& functor
 )
 {
-  using cm::details::eq_almost;
   if (!eq_almost(skin_attr.nu, 0.5, 1e-3)) {
     LOG(WARN) << "The equations implemented for the forces-to-displacements model are only valid for nu=0.5";
   }
-  impl::sanity_checks_forces_to_displacements(f,d);
+  sanity_checks_forces_to_displacements(f,d);
+
+  if (1 == f.dim() && 1 == d.dim()) {
+    return functor.template operator()<1,1>();
+  }
 
-  const size_t f_dim = f.dim();
-  const size_t d_dim = d.dim();
+  if (1 == f.dim() && 3 == d.dim()) {
+    return functor.template operator()<1,3>();
+  }
 
-  if (1 == f_dim && 1 == d_dim) {
-    return impl::f2d_11(f,d,skin_attr,psi_exact);
+  if (3 == f.dim() && 1 == d.dim()) {
+    return functor.template operator()<3,1>();
   }
-  
-  if (1 == f_dim && 3 == d_dim) {
-    return impl::f2d_13(f,d,skin_attr,psi_exact);
+
+  return functor.template operator()<3,3>();
+}
+
+/**
+ * \brief   dispatch_dims() functor for forces_to_displacements_matrix()
+ */
+struct MatrixFactory {
+  typedef arma::mat result_type;
+
+  template <size_t FDim, size_t DDim>
+  result_type operator()() const
+  {
+    return f2d<FDim,DDim>(f, d, skin_attr, psi_exact, num_threads);
   }
-  
-  if (3 == f_dim && 1 == d_dim) {
-    return impl::f2d_31(f,d,skin_attr,psi_exact);
+
+  const Grid& f;
+  const Grid& d;
+  const SkinAttributes& skin_attr;
+  const bool psi_exact;
+  const size_t num_threads;
+};
+
+/**
+ * \brief   dispatch_dims() functor for forces_to_displacements_operator()
+ */
+struct OperatorFactory {
+  typedef std::unique_ptr<LinearOperator> result_type;
+
+  template <size_t FDim, size_t DDim>
+  result_type operator()() const
+  {
+    return result_type(new BoussinesqOperator<FDim,DDim>(f, d, skin_attr, psi_exact,
+      num_threads));
   }
-  
-  return impl::f2d_33(f,d,skin_attr,psi_exact);
+
+  const Grid& f;
+  const Grid& d;
+  const SkinAttributes& skin_attr;
+  const bool psi_exact;
+  const size_t num_threads;
+};
+
+/**
+ * \brief   dispatch_dims() functor for forces_to_displacements_convolution(): null unless both
+ *          grids fit a lattice of f's cell pitch
+ */
+struct ConvolutionFactory {
+  typedef std::unique_ptr<ConvolutionOperator> result_type;
+
+  template <size_t FDim, size_t DDim>
+  result_type operator()() const
+  {
+    const double px = f.getCellShape().dx();
+    const double py = f.getCellShape().dy();
+    Lattice fl, dl;
+    if (!fit_lattice(CellCoordinates(f), px, py, fl)
+      || !fit_lattice(CellCoordinates(d), px, py, dl)) {
+      return nullptr;
+    }
+    const BoussInvariants inv(skin_attr, f.getCellShape().area(), psi_exact);
+    return bouss_convolution<FDim,DDim>(fl, dl, inv);
+  }
+
+  const Grid& f;
+  const Grid& d;
+  const SkinAttributes& skin_attr;
+  const bool psi_exact;
+};
+
+/**
+ * \brief   dispatch_dims() functor for forces_to_displacements_hmatrix()
+ */
+struct HMatrixFactory {
+  typedef std::unique_ptr<HMatrixOperator> result_type;
+
+  template <size_t FDim, size_t DDim>
+  result_type operator()() const
+  {
+    const BoussInvariants inv(skin_attr, f.getCellShape().area(), psi_exact);
+    return bouss_hmatrix<FDim,DDim>(CellCoordinates(f), CellCoordinates(d), inv, tolerance,
+      num_threads);
+  }
+
+  const Grid& f;
+  const Grid& d;
+  const SkinAttributes& skin_attr;
+  const bool psi_exact;
+  const double tolerance;
+  const size_t num_threads;
+};
+
+/**
+ * \brief   dispatch_dims() functor for forces_to_displacements_sparse()
+ */
+struct SparseFactory {
+  typedef std::unique_ptr<SparseOperator> result_type;
+
+  template <size_t FDim, size_t DDim>
+  result_type operator()() const
+  {
+    const BoussInvariants inv(skin_attr, f.getCellShape().area(), psi_exact);
+    return bouss_sparse<FDim,DDim>(CellCoordinates(f), CellCoordinates(d), inv, radius,
+      num_threads);
+  }
+
+  const Grid& f;
+  const Grid& d;
+  const SkinAttributes& skin_attr;
+  const bool psi_exact;
+  const double radius;
+  const size_t num_threads;
+};
+
+/**
+ * \brief   dispatch_dims() functor for forces_to_displacements_mapped(): the file at path if it
+ *          holds the model already, written otherwise
+ */
+struct MappedFactory {
+  typedef std::unique_ptr<MappedOperator> result_type;
+
+  template <size_t FDim, size_t DDim>
+  result_type operator()() const
+  {
+    const uint64_t fingerprint = model_fingerprint(f, d,
+      {skin_attr.E, skin_attr.nu, skin_attr.h, double(psi_exact)});
+    result_type ret = MappedOperator::reuse(path, DDim*d.num_cells(), FDim*f.num_cells(),
+      fingerprint, num_threads);
+    if (ret) {
+      return ret;
+    }
+    const BoussInvariants inv(skin_attr, f.getCellShape().area(), psi_exact);
+    return bouss_mapped<FDim,DDim>(CellCoordinates(f), CellCoordinates(d), inv, path,
+      fingerprint, num_threads);
+  }
+
+  const Grid& f;
+  const Grid& d;
+  const SkinAttributes& skin_attr;
+  const bool psi_exact;
+  const std::string& path;
+  const size_t num_threads;
+};
+
+} /* anonymous namespace */
+
+}
+
+arma::mat forces_to_displacements_matrix(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool psi_exact,
+  const size_t num_threads
+)
+{
+  return impl::dispatch_dims(f, d, skin_attr,
+    impl::MatrixFactory{f, d, skin_attr, psi_exact, num_threads});
 }
 
 arma::mat displacements_to_forces_matrix(
   const Grid& d,
   const Grid& f,
   const SkinAttributes& skin_attr,
-  const bool psi_exact
+  const bool psi_exact,
+  const size_t num_threads
 )
 {
-  arma::mat orig = forces_to_displacements_matrix(f,d,skin_attr,psi_exact);
+  arma::mat orig = forces_to_displacements_matrix(f,d,skin_attr,psi_exact,num_threads);
   arma::mat ret = arma::pinv(orig);
   IFLOG(DEBUG2) {
     static size_t sn = 0;
@@ -287,6 +970,68 @@ arma::mat displacements_to_forces_matrix(
   return ret;
 }
 
+std::unique_ptr<LinearOperator> forces_to_displacements_operator(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool psi_exact,
+  const size_t num_threads
+)
+{
+  return impl::dispatch_dims(f, d, skin_attr,
+    impl::OperatorFactory{f, d, skin_attr, psi_exact, num_threads});
+}
+
+std::unique_ptr<ConvolutionOperator> forces_to_displacements_convolution(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool psi_exact
+)
+{
+  return impl::dispatch_dims(f, d, skin_attr,
+    impl::ConvolutionFactory{f, d, skin_attr, psi_exact});
+}
+
+std::unique_ptr<HMatrixOperator> forces_to_displacements_hmatrix(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool psi_exact,
+  const double tolerance,
+  const size_t num_threads
+)
+{
+  return impl::dispatch_dims(f, d, skin_attr,
+    impl::HMatrixFactory{f, d, skin_attr, psi_exact, tolerance, num_threads});
+}
+
+std::unique_ptr<SparseOperator> forces_to_displacements_sparse(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool psi_exact,
+  const double radius,
+  const size_t num_threads
+)
+{
+  return impl::dispatch_dims(f, d, skin_attr,
+    impl::SparseFactory{f, d, skin_attr, psi_exact, radius, num_threads});
+}
+
+std::unique_ptr<MappedOperator> forces_to_displacements_mapped(
+  const Grid& f,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const bool psi_exact,
+  const std::string& path,
+  const size_t num_threads
+)
+{
+  return impl::dispatch_dims(f, d, skin_attr,
+    impl::MappedFactory{f, d, skin_attr, psi_exact, path, num_threads});
+}
+
 namespace impl {
 
 /**
@@ -1,50 +1,504 @@
 #include "cm/details/elastic_model_love.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include "cm/skin/attributes.hpp"
 #include "cm/grid/grid.hpp"
 
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/love_surrogate.hpp"
 #include "cm/details/math.hpp"
+#include "cm/details/offset_cache.hpp"
+#include "cm/details/parallel.hpp"
 #include "cm/details/string.hpp"
 #include "cm/log/log.hpp"
 
 namespace cm {
 namespace details {
 
+namespace {
+
+/**
+ * \brief   Largest |b[j] - a[i]|
+ */
+double max_offset(const std::vector<double>& a, const std::vector<double>& b)
+{
+  const auto ra = std::minmax_element(a.begin(), a.end());
+  const auto rb = std::minmax_element(b.begin(), b.end());
+  return std::max(*rb.second - *ra.first, *ra.second - *rb.first);
+}
+
+/**
+ * \brief   Evaluates the coefficients of pressures_to_displacements_matrix(), a pressure cell
+ *          (column) at a time.
+ *
+ * The coefficient is even in both x and y; the signs of the offset don't matter. Offsets not
+ * found in the cache are gathered and evaluated in one batch per column -- looked up in the
+ * surrogate first if there is one, then the rest exactly.
+ */
+class LoveColumns {
+public:
+  /**
+   * \brief   Per-thread state: the cache and the buffers of the misses
+   */
+  struct Scratch {
+    explicit Scratch(const LoveColumns& c)
+    :
+      cache(c.quantum_),
+      keys(c.dc_.size()),
+      miss_ind(c.dc_.size()),
+      miss_x(c.dc_.size()),
+      miss_y(c.dc_.size()),
+      miss_coeff(c.dc_.size()),
+      served(c.surrogate_ ? c.dc_.size() : 0)
+    {
+    }
+
+    OffsetCache<double>    cache;
+    std::vector<OffsetKey> keys;
+    std::vector<size_t>    miss_ind;
+    std::vector<double>    miss_x;
+    std::vector<double>    miss_y;
+    std::vector<double>    miss_coeff;
+    std::vector<unsigned char> served;
+  };
+
+  LoveColumns(const Grid& p, const Grid& d, const SkinAttributes& skin_attr,
+    const double surrogate_sampled_tol)
+  :
+    load_cell_dx_(p.getCellShape().dx()/2.0),
+    load_cell_dy_(p.getCellShape().dy()/2.0),
+    E_(skin_attr.E),
+    nu_(skin_attr.nu),
+    h_(skin_attr.h),
+    pc_(p),
+    dc_(d),
+    quantum_(offset_quantum(p.getCellShape().dx(), p.getCellShape().dy()))
+  {
+    if (surrogate_sampled_tol > 0 && pc_.size() > 0 && dc_.size() > 0) {
+      surrogate_ = impl::LoveSurrogate::get(load_cell_dx_, load_cell_dy_, h_, nu_,
+        max_offset(pc_.x, dc_.x), max_offset(pc_.y, dc_.y), surrogate_sampled_tol);
+    }
+  }
+
+  size_t num_rows() const { return dc_.size(); }
+  size_t num_cols() const { return pc_.size(); }
+
+  /**
+   * \brief   Coefficients of column ip (all the displacement cells) into col
+   */
+  void column(const size_t ip, Scratch& s, double* col) const
+  {
+    const double inv_E = 1.0 / E_;
+    size_t num_misses = 0;
+    for (size_t id = 0; id < dc_.size(); ++id) {
+      s.keys[id] = s.cache.key(dc_.x[id] - pc_.x[ip], dc_.y[id] - pc_.y[ip]);
+      const double* cached = s.cache.find(s.keys[id]);
+      if (cached) {
+        col[id] = *cached;
+      } else {
+        s.miss_ind[num_misses] = id;
+        s.miss_x[num_misses] = s.keys[id].x;
+        s.miss_y[num_misses] = s.keys[id].y;
+        ++num_misses;
+      }
+    }
+
+    if (surrogate_) {
+      surrogate_->lookup_batch(s.miss_x.data(), s.miss_y.data(), num_misses, s.miss_coeff.data(),
+        s.served.data());
+      size_t num_exact = 0;
+      for (size_t l = 0; l < num_misses; ++l) {
+        if (s.served[l]) {
+          const OffsetKey& key = s.keys[s.miss_ind[l]];
+          col[s.miss_ind[l]] = s.miss_coeff[l] * inv_E;
+          if (!s.cache.find(key)) {
+            s.cache.insert(key, col[s.miss_ind[l]]);
+          }
+        } else {
+          s.miss_ind[num_exact] = s.miss_ind[l];
+          s.miss_x[num_exact] = s.miss_x[l];
+          s.miss_y[num_exact] = s.miss_y[l];
+          ++num_exact;
+        }
+      }
+      num_misses = num_exact;
+    }
+
+    impl::love_coeffs_batch(load_cell_dx_, load_cell_dy_, E_, nu_, h_,
+      s.miss_x.data(), s.miss_y.data(), num_misses, s.miss_coeff.data());
+    for (size_t l = 0; l < num_misses; ++l) {
+      const OffsetKey& key = s.keys[s.miss_ind[l]];
+      col[s.miss_ind[l]] = s.miss_coeff[l];
+      // the same offset might have been missed more than once within this column
+      if (!s.cache.find(key)) {
+        s.cache.insert(key, s.miss_coeff[l]);
+      }
+    }
+  }
+
+private:
+  double load_cell_dx_, load_cell_dy_;
+  double E_, nu_, h_;
+  CellCoordinates pc_;
+  CellCoordinates dc_;
+  double quantum_;
+  std::shared_ptr<const impl::LoveSurrogate> surrogate_;
+};
+
+/**
+ * \brief   The matrix of pressures_to_displacements_matrix(), evaluated a column at a time
+ *          whenever it's applied.
+ *
+ * Both apply() and apply_transpose() split the columns among the threads. apply_transpose() has
+ * every thread fill in its own elements of the result; apply() gives every chunk of apply_chunk
+ * columns a partial sum of its own, and adds those up in the order of the chunks: whatever the
+ * number of threads, the result is the same to the bit.
+ */
+class LoveOperator : public LinearOperator {
+public:
+  /**
+   * \brief   Number of columns per partial sum of apply()
+   */
+  static const size_t apply_chunk = 256;
+
+
+  LoveOperator(const Grid& p, const Grid& d, const SkinAttributes& skin_attr,
+    const size_t num_threads, const double surrogate_sampled_tol)
+  :
+    columns_(p, d, skin_attr, surrogate_sampled_tol),
+    pool_(std::make_shared<WorkerPool>(num_threads))
+  {
+  }
+
+private:
+  size_t impl_n_rows() const
+  {
+    return columns_.num_rows();
+  }
+
+  size_t impl_n_cols() const
+  {
+    return columns_.num_cols();
+  }
+
+  void impl_apply(const double* x, double* y) const
+  {
+    const size_t n_rows = columns_.num_rows();
+    const size_t n_cols = columns_.num_cols();
+    const size_t n_chunks = (n_cols + apply_chunk - 1) / apply_chunk;
+    std::vector<std::vector<double>> partial(n_chunks);
+    parallel_for_blocks(n_chunks, *pool_, 1, [&](const size_t c_begin, const size_t c_end) {
+      LoveColumns::Scratch s(columns_);
+      std::vector<double> col(n_rows);
+      for (size_t c = c_begin; c < c_end; ++c) {
+        std::vector<double>& sum = partial[c];
+        sum.assign(n_rows, 0.0);
+        for (size_t ip = c * apply_chunk; ip < std::min(n_cols, (c + 1) * apply_chunk); ++ip) {
+          columns_.column(ip, s, col.data());
+          const double x_p = x[ip];
+          for (size_t id = 0; id < n_rows; ++id) {
+            sum[id] += col[id] * x_p;
+          }
+        }
+      }
+    });
+    std::fill(y, y + n_rows, 0.0);
+    for (const auto& sum : partial) {
+      for (size_t id = 0; id < sum.size(); ++id) {
+        y[id] += sum[id];
+      }
+    }
+  }
+
+  void impl_apply_transpose(const double* y, double* x) const
+  {
+    const size_t n_rows = columns_.num_rows();
+    parallel_for_blocks(columns_.num_cols(), *pool_, 0,
+      [&](const size_t p_begin, const size_t p_end) {
+        LoveColumns::Scratch s(columns_);
+        std::vector<double> col(n_rows);
+        for (size_t ip = p_begin; ip < p_end; ++ip) {
+          columns_.column(ip, s, col.data());
+          double dot = 0;
+          for (size_t id = 0; id < n_rows; ++id) {
+            dot += col[id] * y[id];
+          }
+          x[ip] = dot;
+        }
+      }
+    );
+  }
+
+  /**
+   * \brief   As apply_transpose(): every column evaluated once
+   */
+  std::vector<double> impl_column_norms() const
+  {
+    const size_t n_rows = columns_.num_rows();
+    std::vector<double> ret(columns_.num_cols());
+    parallel_for_blocks(ret.size(), *pool_, 0,
+      [&](const size_t p_begin, const size_t p_end) {
+        LoveColumns::Scratch s(columns_);
+        std::vector<double> col(n_rows);
+        for (size_t ip = p_begin; ip < p_end; ++ip) {
+          columns_.column(ip, s, col.data());
+          double sum = 0;
+          for (size_t id = 0; id < n_rows; ++id) {
+            sum += col[id] * col[id];
+          }
+          ret[ip] = std::sqrt(sum);
+        }
+      }
+    );
+    return ret;
+  }
+
+  arma::mat impl_columns(const std::vector<size_t>& cols) const
+  {
+    arma::mat ret(columns_.num_rows(), cols.size());
+    parallel_for_blocks(cols.size(), *pool_, 0,
+      [&](const size_t k_begin, const size_t k_end) {
+        LoveColumns::Scratch s(columns_);
+        for (size_t k = k_begin; k < k_end; ++k) {
+          columns_.column(cols[k], s, ret.colptr(k));
+        }
+      }
+    );
+    return ret;
+  }
+
+  const LoveColumns columns_;
+  const std::shared_ptr<const WorkerPool> pool_;
+};
+
+} /* anonymous namespace */
+
 arma::mat pressures_to_displacements_matrix(
   const Grid& p,
   const Grid& d,
-  const SkinAttributes& skin_attr
+  const SkinAttributes& skin_attr,
+  const size_t num_threads,
+  const double surrogate_sampled_tol
 )
 {
   impl::sanity_checks_pressures_to_displacements(p,d);
   arma::mat ret(d.getRawValues().size(), p.getRawValues().size());
+  const LoveColumns columns(p, d, skin_attr, surrogate_sampled_tol);
+  // every column (pressure cell) is filled by exactly one thread; every block of columns has its
+  // own cache of the coefficients
+  parallel_for_blocks(columns.num_cols(), num_threads, 0,
+    [&](const size_t p_begin, const size_t p_end) {
+      LoveColumns::Scratch s(columns);
+      for (size_t ip = p_begin; ip < p_end; ++ip) {
+        columns.column(ip, s, ret.colptr(ip));
+      }
+    }
+  );
+  return ret;
+}
+
+std::unique_ptr<LinearOperator> pressures_to_displacements_operator(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const size_t num_threads,
+  const double surrogate_sampled_tol
+)
+{
+  impl::sanity_checks_pressures_to_displacements(p,d);
+  return std::unique_ptr<LinearOperator>(
+    new LoveOperator(p, d, skin_attr, num_threads, surrogate_sampled_tol)
+  );
+}
+
+std::unique_ptr<ConvolutionOperator> pressures_to_displacements_convolution(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr
+)
+{
+  impl::sanity_checks_pressures_to_displacements(p,d);
+  const double px = p.getCellShape().dx();
+  const double py = p.getCellShape().dy();
+  Lattice pl, dl;
+  if (!fit_lattice(CellCoordinates(p), px, py, pl)
+    || !fit_lattice(CellCoordinates(d), px, py, dl)) {
+    return nullptr;
+  }
+
+  std::vector<double> x, y;
+  ConvolutionOperator::stencil_offsets(pl, dl, x, y);
+  // even in x and y; evaluated at the magnitudes, as the matrix's coefficients are
+  for (size_t k = 0; k < x.size(); ++k) {
+    x[k] = std::fabs(x[k]);
+    y[k] = std::fabs(y[k]);
+  }
+  std::vector<std::vector<double>> stencils(1, std::vector<double>(x.size()));
+  impl::love_coeffs_batch(px/2.0, py/2.0, skin_attr.E, skin_attr.nu, skin_attr.h,
+    x.data(), y.data(), x.size(), stencils[0].data());
+  return std::unique_ptr<ConvolutionOperator>(new ConvolutionOperator(pl, dl, 1, 1, stencils));
+}
+
+namespace {
+
+/**
+ * \brief   The coefficients of pressures_to_displacements_matrix() for displacement cells
+ *          ds[0..n_d) and pressure cells ps[0..n_p), evaluated exactly, as a block of the blocked
+ *          operators (\sa cutoff_operator(), HMatrixOperator::BlockFunction)
+ */
+void love_block(
+  const CellCoordinates& pc,
+  const CellCoordinates& dc,
+  const SkinAttributes& skin_attr,
+  const double dx,
+  const double dy,
+  const size_t* ps,
+  const size_t n_p,
+  const size_t* ds,
+  const size_t n_d,
+  arma::mat& block
+)
+{
+  // even in x and y; evaluated at the magnitudes, as the matrix's coefficients are
+  std::vector<double> x(n_p), y(n_p), coeffs(n_p);
+  for (size_t i = 0; i < n_d; ++i) {
+    for (size_t j = 0; j < n_p; ++j) {
+      x[j] = std::fabs(dc.x[ds[i]] - pc.x[ps[j]]);
+      y[j] = std::fabs(dc.y[ds[i]] - pc.y[ps[j]]);
+    }
+    impl::love_coeffs_batch(dx, dy, skin_attr.E, skin_attr.nu, skin_attr.h,
+      x.data(), y.data(), n_p, coeffs.data());
+    for (size_t j = 0; j < n_p; ++j) {
+      block(i, j) = coeffs[j];
+    }
+  }
+}
+
+} /* anonymous namespace */
+
+std::unique_ptr<HMatrixOperator> pressures_to_displacements_hmatrix(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const double tolerance,
+  const size_t num_threads
+)
+{
+  impl::sanity_checks_pressures_to_displacements(p,d);
+  const double dx = p.getCellShape().dx()/2.0;
+  const double dy = p.getCellShape().dy()/2.0;
+  const CellCoordinates pc(p);
+  const CellCoordinates dc(d);
+  return std::unique_ptr<HMatrixOperator>(new HMatrixOperator(pc, dc, 1, 1,
+    [&](const size_t* ps, const size_t n_p, const size_t* ds, const size_t n_d, arma::mat& block) {
+      love_block(pc, dc, skin_attr, dx, dy, ps, n_p, ds, n_d, block);
+    },
+    tolerance, num_threads
+  ));
+}
+
+std::unique_ptr<SparseOperator> pressures_to_displacements_sparse(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const double radius,
+  const size_t num_threads
+)
+{
+  impl::sanity_checks_pressures_to_displacements(p,d);
+  const double dx = p.getCellShape().dx()/2.0;
+  const double dy = p.getCellShape().dy()/2.0;
+  const CellCoordinates pc(p);
+  const CellCoordinates dc(d);
+  return cutoff_operator(pc, dc, 1, 1,
+    [&](const size_t* ps, const size_t n_p, const size_t* ds, const size_t n_d, arma::mat& block) {
+      love_block(pc, dc, skin_attr, dx, dy, ps, n_p, ds, n_d, block);
+    },
+    radius, num_threads
+  );
+}
+
+arma::mat LoveTermsMatrices::combine(const double E, const double nu) const
+{
+  return impl::love_c_log(E, nu) * t_log - impl::love_c_atan(E, nu) * t_atan;
+}
+
+LoveTermsMatrices pressures_to_displacements_terms(
+  const Grid& p,
+  const Grid& d,
+  const SkinAttributes& skin_attr,
+  const size_t num_threads
+)
+{
+  impl::sanity_checks_pressures_to_displacements(p,d);
+  LoveTermsMatrices ret;
+  ret.t_log.set_size(d.getRawValues().size(), p.getRawValues().size());
+  ret.t_atan.set_size(d.getRawValues().size(), p.getRawValues().size());
   const double load_cell_dx = p.getCellShape().dx()/2.0;
   const double load_cell_dy = p.getCellShape().dy()/2.0;
-  const double E = skin_attr.E;
-  const double nu = skin_attr.nu;
   const double h = skin_attr.h;
-  for (size_t id = 0; id < d.num_cells(); ++id) {
-    for (size_t ip = 0; ip < p.num_cells(); ++ip) {
-      const double x = d.cell(id).x - p.cell(ip).x;
-      const double y = d.cell(id).y - p.cell(ip).y;
-      ret(id,ip) = 
-        impl::love_coeff(load_cell_dx, load_cell_dy, E, nu, x, y, 0)
-        - impl::love_coeff(load_cell_dx, load_cell_dy, E, nu, x, y, h);
+  const CellCoordinates pc(p);
+  const CellCoordinates dc(d);
+  const double quantum = offset_quantum(p.getCellShape().dx(), p.getCellShape().dy());
+  // same scheme as pressures_to_displacements_matrix(), two terms per offset
+  typedef std::pair<double, double> terms_type;
+  parallel_for_blocks(pc.size(), num_threads, 0, [&](const size_t p_begin, const size_t p_end) {
+    OffsetCache<terms_type> cache(quantum);
+    std::vector<OffsetKey> keys(dc.size());
+    std::vector<size_t>    miss_ind(dc.size());
+    std::vector<double>    miss_x(dc.size());
+    std::vector<double>    miss_y(dc.size());
+    std::vector<double>    miss_log(dc.size());
+    std::vector<double>    miss_atan(dc.size());
+    for (size_t ip = p_begin; ip < p_end; ++ip) {
+      double* col_log  = ret.t_log.colptr(ip);
+      double* col_atan = ret.t_atan.colptr(ip);
+      size_t num_misses = 0;
+      for (size_t id = 0; id < dc.size(); ++id) {
+        keys[id] = cache.key(dc.x[id] - pc.x[ip], dc.y[id] - pc.y[ip]);
+        const terms_type* cached = cache.find(keys[id]);
+        if (cached) {
+          col_log[id]  = cached->first;
+          col_atan[id] = cached->second;
+        } else {
+          miss_ind[num_misses] = id;
+          miss_x[num_misses] = keys[id].x;
+          miss_y[num_misses] = keys[id].y;
+          ++num_misses;
+        }
+      }
+
+      impl::love_terms_batch(load_cell_dx, load_cell_dy, h,
+        miss_x.data(), miss_y.data(), num_misses, miss_log.data(), miss_atan.data());
+      for (size_t l = 0; l < num_misses; ++l) {
+        const OffsetKey& key = keys[miss_ind[l]];
+        col_log[miss_ind[l]]  = miss_log[l];
+        col_atan[miss_ind[l]] = miss_atan[l];
+        if (!cache.find(key)) {
+          cache.insert(key, terms_type(miss_log[l], miss_atan[l]));
+        }
+      }
     }
-  }
+  });
   return ret;
 }
 
 arma::mat displacements_to_pressures_matrix(
   const Grid& d,
   const Grid& p,
-  const SkinAttributes& skin_attr
+  const SkinAttributes& skin_attr,
+  const size_t num_threads,
+  const double surrogate_sampled_tol
 )
 {
-  arma::mat orig = pressures_to_displacements_matrix(p,d,skin_attr);
+  arma::mat orig =
+    pressures_to_displacements_matrix(p,d,skin_attr,num_threads,surrogate_sampled_tol);
   arma::mat ret = arma::pinv(orig);
   IFLOG(DEBUG2) {
     static size_t sn = 0;
@@ -113,6 +567,148 @@ double love_coeff(
   return ret;
 }
 
+namespace {
+
+/**
+ * \brief   safe_log() for the batched kernel; `log_arg` is the already evaluated logarithm
+ */
+inline double safe_log_batch(const double coeff, const double log_arg)
+{
+  return (std::fabs(coeff) < 1e-8) ? 0.0 : coeff * log_arg;
+}
+
+/**
+ * \brief   Lj(yp) without its -(yp-y) term (which cancels out in L1 - L2), for the batched kernel.
+ * \param   v       j_pm*a - x, i.e. a - x for j == 1 and -a - x for j == 2
+ * \param   dyp     yp - y
+ * \param   w       betaj0^2 = v^2 + z^2
+ * \param   beta    betaj0
+ * \param   r       rj0
+ * \param   z2      z^2
+ * \param   z       z, or 0 if the atan term is to be skipped
+ * \param   inv_z   1/z, or 0 if the atan term is to be skipped
+ */
+inline double Lj_batch(const double v, const double dyp, const double w, const double beta,
+  const double r, const double z2, const double z, const double inv_z)
+{
+  const double psi  = dyp / (r + beta);
+
+  // v + r; for v < 0 it's (r^2 - v^2)/(r - v)
+  const double v_r  = (v >= 0) ? v + r : (dyp*dyp + z2)/(r - v);
+  // (1+psi)/(1-psi) = (r+beta+dyp)/(r+beta-dyp); the one of them which could cancel out is
+  // expressed using (r-|dyp|)(r+|dyp|) = w
+  const double q    = w / (r + std::fabs(dyp));
+  const double num  = (dyp >= 0) ? r + beta + dyp : beta + q;
+  const double den  = (dyp >= 0) ? beta + q       : r + beta - dyp;
+
+  // z*psi/(v + beta); for v < 0 it's psi*(beta - v)/z
+  const double atan_arg = (v >= 0) ? z*psi/(v + beta) : psi*(beta - v)*inv_z;
+
+  // at a corner of the cell with z == 0, psi is 0/0; the atan term must not see it
+  return safe_log_batch(dyp, fast_log(v_r))
+    + safe_log_batch(v, fast_log(num/den))
+    + ((inv_z != 0) ? 2*z*fast_atan(atan_arg) : 0.0);
+}
+
+/**
+ * \brief   love_coeff() for the batched kernel, split into the E- and nu-independent sums it is
+ *          made of: love_coeff() == (1-nu^2)/(pi*E) * sum_log + (1+nu)/(2*pi*E) * sum_atan
+ * \param   v1,v2   a - x, -a - x
+ * \param   dp,dm   b - y, -b - y
+ */
+inline void love_batch(const double v1, const double v2, const double dp, const double dm,
+  const double z_in, double& sum_log, double& sum_atan)
+{
+  const bool   has_z = std::fabs(z_in) >= 1e-8;
+  const double z     = has_z ? z_in : 0.0;
+  const double inv_z = has_z ? 1.0/z_in : 0.0;
+  const double z2    = z*z;
+
+  const double w1    = v1*v1 + z2;
+  const double w2    = v2*v2 + z2;
+  const double beta1 = std::sqrt(w1);
+  const double beta2 = std::sqrt(w2);
+  const double r1p   = std::sqrt(w1 + dp*dp);
+  const double r2p   = std::sqrt(w2 + dp*dp);
+  const double r1m   = std::sqrt(w1 + dm*dm);
+  const double r2m   = std::sqrt(w2 + dm*dm);
+
+  sum_log =
+      (Lj_batch(v1, dp, w1, beta1, r1p, z2, z, inv_z) - Lj_batch(v2, dp, w2, beta2, r2p, z2, z, inv_z))
+    - (Lj_batch(v1, dm, w1, beta1, r1m, z2, z, inv_z) - Lj_batch(v2, dm, w2, beta2, r2m, z2, z, inv_z));
+  sum_atan = 0;
+  if (has_z) {
+    // (a+x) == -v2
+    sum_atan = z * (
+        fast_atan(v1*dp*inv_z/r1p) + fast_atan(-v2*dp*inv_z/r2p)
+      - fast_atan(v1*dm*inv_z/r1m) - fast_atan(-v2*dm*inv_z/r2m)
+    );
+  }
+}
+
+/**
+ * \brief   The E- and nu-independent terms of a matrix entry, \sa love_terms_batch()
+ */
+inline void love_terms(const double dx, const double dy, const double h, const double x,
+  const double y, double& t_log, double& t_atan)
+{
+  const double v1 =  dx - x;
+  const double v2 = -dx - x;
+  const double dp =  dy - y;
+  const double dm = -dy - y;
+  double sum_log_0, sum_atan_0, sum_log_h, sum_atan_h;
+  love_batch(v1, v2, dp, dm, 0, sum_log_0, sum_atan_0);
+  love_batch(v1, v2, dp, dm, h, sum_log_h, sum_atan_h);
+  t_log  = sum_log_0 - sum_log_h;
+  t_atan = sum_atan_h;
+}
+
+} /* anonymous namespace */
+
+CM_VECTOR_CLONES
+void love_coeffs_batch(
+  const double dx, const double dy,
+  const double E, const double nu,
+  const double h,
+  const double* __restrict x, const double* __restrict y,
+  const size_t n,
+  double* __restrict out
+)
+{
+  const double c_log  = love_c_log(E, nu);
+  const double c_atan = love_c_atan(E, nu);
+  for (size_t i = 0; i < n; ++i) {
+    double t_log, t_atan;
+    love_terms(dx, dy, h, x[i], y[i], t_log, t_atan);
+    out[i] = c_log * t_log - c_atan * t_atan;
+  }
+}
+
+CM_VECTOR_CLONES
+void love_terms_batch(
+  const double dx, const double dy,
+  const double h,
+  const double* __restrict x, const double* __restrict y,
+  const size_t n,
+  double* __restrict t_log,
+  double* __restrict t_atan
+)
+{
+  for (size_t i = 0; i < n; ++i) {
+    love_terms(dx, dy, h, x[i], y[i], t_log[i], t_atan[i]);
+  }
+}
+
+double love_c_log(const double E, const double nu)
+{
+  return (1-nu*nu)/(M_PI*E);
+}
+
+double love_c_atan(const double E, const double nu)
+{
+  return (1+nu)/(2*M_PI*E);
+}
+
 namespace love {
 
 // plus-minus sign choosing according to j. j == 1 -> upper sign. j == 2 -> lower sign
@@ -0,0 +1,108 @@
+#include "cm/details/fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+size_t fft_size(const size_t n)
+{
+  size_t ret = 1;
+  while (ret < n) {
+    ret <<= 1;
+  }
+  return ret;
+}
+
+Fft1d::Fft1d(const size_t n)
+:
+  n_(n),
+  rev_(n),
+  twiddles_(n / 2)
+{
+  if (n == 0 || (n & (n - 1)) != 0) {
+    throw std::runtime_error(sb() << "Fft1d: the length must be a power of 2; got " << n);
+  }
+  size_t bits = 0;
+  while ((size_t(1) << bits) < n) {
+    ++bits;
+  }
+  for (size_t k = 0; k < n; ++k) {
+    size_t r = 0;
+    for (size_t b = 0; b < bits; ++b) {
+      r |= ((k >> b) & 1) << (bits - 1 - b);
+    }
+    rev_[k] = r;
+  }
+  for (size_t k = 0; k < n / 2; ++k) {
+    const double phi = -2 * M_PI * k / n;
+    twiddles_[k] = std::complex<double>(std::cos(phi), std::sin(phi));
+  }
+}
+
+void Fft1d::transform(std::complex<double>* a, const size_t m, const bool inverse) const
+{
+  for (size_t k = 0; k < n_; ++k) {
+    if (k < rev_[k]) {
+      std::swap_ranges(a + k*m, a + (k + 1)*m, a + rev_[k]*m);
+    }
+  }
+  // interleaved (re, im) pairs; the products are spelled out, std::complex's operator* checks
+  // for inf/nan and doesn't vectorise
+  double* const d = reinterpret_cast<double*>(a);
+  const double sign = inverse ? -1.0 : 1.0;
+  for (size_t len = 2; len <= n_; len <<= 1) {
+    const size_t half = len / 2;
+    const size_t step = n_ / len;
+    for (size_t k0 = 0; k0 < n_; k0 += len) {
+      for (size_t k = 0; k < half; ++k) {
+        const double wr = twiddles_[k*step].real();
+        const double wi = sign * twiddles_[k*step].imag();
+        double* __restrict u = d + 2*(k0 + k)*m;
+        double* __restrict v = d + 2*(k0 + k + half)*m;
+        for (size_t l = 0; l < 2*m; l += 2) {
+          const double tr = wr*v[l] - wi*v[l+1];
+          const double ti = wr*v[l+1] + wi*v[l];
+          v[l]   = u[l] - tr;
+          v[l+1] = u[l+1] - ti;
+          u[l]   += tr;
+          u[l+1] += ti;
+        }
+      }
+    }
+  }
+}
+
+Fft2d::Fft2d(const size_t nx, const size_t ny)
+:
+  fx_(nx),
+  fy_(ny)
+{
+}
+
+void Fft2d::forward(std::complex<double>* a) const
+{
+  for (size_t i = 0; i < nx(); ++i) {
+    fy_.transform(a + i*ny(), 1, false);
+  }
+  fx_.transform(a, ny(), false);
+}
+
+void Fft2d::inverse(std::complex<double>* a) const
+{
+  for (size_t i = 0; i < nx(); ++i) {
+    fy_.transform(a + i*ny(), 1, true);
+  }
+  fx_.transform(a, ny(), true);
+  const double scale = 1.0 / size();
+  for (size_t k = 0; k < size(); ++k) {
+    a[k] *= scale;
+  }
+}
+
+} /* namespace details */
+} /* namespace cm */
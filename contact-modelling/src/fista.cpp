@@ -0,0 +1,139 @@
+#include "cm/details/fista.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+double norm(const std::vector<double>& v)
+{
+  double sum = 0;
+  for (const double e : v) {
+    sum += e * e;
+  }
+  return std::sqrt(sum);
+}
+
+} /* anonymous namespace */
+
+FistaReport fista(
+  const LinearOperator& a,
+  const double lipschitz,
+  const std::vector<double>& b,
+  std::vector<double>& x,
+  const size_t max_iterations,
+  const double tolerance
+)
+{
+  const size_t m = a.n_rows();
+  const size_t n = a.n_cols();
+  if (b.size() != m) {
+    throw std::runtime_error(sb() << "fista: " << b.size() << " right-hand sides for a " << m
+      << "x" << n << " operator");
+  }
+  FistaReport report;
+  report.lipschitz = lipschitz;
+  x.resize(n, 0.0);
+  for (double& e : x) {
+    e = std::max(e, 0.0);
+  }
+  if (!(lipschitz > 0)) {
+    std::fill(x.begin(), x.end(), 0.0);
+    report.converged = true;
+    return report;
+  }
+
+  std::vector<double> atb(n);
+  a.apply_transpose(b.data(), atb.data());
+  const double atb_norm = norm(atb);
+  const double threshold = tolerance * atb_norm;
+  // rounding in the sufficient decrease test: relative to ||b||^2 / 2, the objective at 0
+  const double slack = 1e-12 * 0.5 * norm(b) * norm(b);
+
+  // a x and a y are kept along with x and y: with a's linearity, a y is a combination of the
+  // a x_k, so an iteration is a single a*v (at x_k+1) and a^T*w, backtracking aside
+  std::vector<double> y(x);
+  std::vector<double> ax(m);
+  a.apply(x.data(), ax.data());
+  std::vector<double> ay(ax);
+  std::vector<double> x_next(n);
+  std::vector<double> ax_next(m);
+  std::vector<double> r(m);
+  std::vector<double> g(n);
+  double lipschitz_k = lipschitz;
+  double t = 1;
+  while (report.iterations < max_iterations) {
+    ++report.iterations;
+    // the gradient at y, a^T (a y - b)
+    double f_y = 0;
+    for (size_t i = 0; i < m; ++i) {
+      r[i] = ay[i] - b[i];
+      f_y += 0.5 * r[i] * r[i];
+    }
+    a.apply_transpose(r.data(), g.data());
+    // the projected step from there; until the quadratic model with lipschitz_k is above the
+    // objective at x_next (Beck and Teboulle's backtracking), lipschitz_k is too low
+    double step = 0;
+    while (true) {
+      double model = f_y;
+      step = 0;
+      for (size_t j = 0; j < n; ++j) {
+        x_next[j] = std::max(0.0, y[j] - g[j] / lipschitz_k);
+        const double d = x_next[j] - y[j];
+        model += g[j] * d;
+        step += d * d;
+      }
+      model += 0.5 * lipschitz_k * step;
+      a.apply(x_next.data(), ax_next.data());
+      double f_next = 0;
+      for (size_t i = 0; i < m; ++i) {
+        f_next += 0.5 * (ax_next[i] - b[i]) * (ax_next[i] - b[i]);
+      }
+      if (f_next <= model + slack) {
+        break;
+      }
+      lipschitz_k *= 2;
+      ++report.backtracks;
+    }
+    double momentum_against_step = 0;
+    for (size_t j = 0; j < n; ++j) {
+      momentum_against_step += (y[j] - x_next[j]) * (x_next[j] - x[j]);
+    }
+    report.relative_step = lipschitz_k * std::sqrt(step);
+    if (report.relative_step <= threshold) {
+      x.swap(x_next);
+      report.converged = true;
+      break;
+    }
+    if (momentum_against_step > 0) {
+      ++report.restarts;
+      t = 1;
+      y = x_next;
+      ay = ax_next;
+    } else {
+      const double t_next = (1 + std::sqrt(1 + 4*t*t)) / 2;
+      const double beta = (t - 1) / t_next;
+      for (size_t j = 0; j < n; ++j) {
+        y[j] = x_next[j] + beta * (x_next[j] - x[j]);
+      }
+      for (size_t i = 0; i < m; ++i) {
+        ay[i] = ax_next[i] + beta * (ax_next[i] - ax[i]);
+      }
+      t = t_next;
+    }
+    x.swap(x_next);
+    ax.swap(ax_next);
+  }
+  report.lipschitz = lipschitz_k;
+  report.relative_step = atb_norm > 0 ? report.relative_step / atb_norm : 0;
+  return report;
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,422 @@
+#include "cm/details/hmatrix.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   Clusters of at most that many cells aren't split any further
+ */
+const size_t leaf_size = 32;
+
+/**
+ * \brief   Two clusters are far enough apart for low rank once the smaller's diameter is at most
+ *          that many times the distance between them
+ */
+const double eta = 2;
+
+/**
+ * \brief   Cells [begin, end) of the tree order, and their bounding box
+ */
+struct Cluster {
+  size_t begin, end;
+  double x_min, x_max, y_min, y_max;
+  /**
+   * \brief   Indices of the halves in the tree; 0 (the root's) for a leaf
+   */
+  size_t child[2];
+
+  bool leaf() const { return child[0] == 0; }
+
+  double diameter() const { return std::hypot(x_max - x_min, y_max - y_min); }
+};
+
+/**
+ * \brief   Append the cluster of cells order[begin, end) to tree, then its halves, recursively
+ *          (reordering order as it goes).
+ * \return  its index in tree
+ */
+size_t add_cluster(
+  const CellCoordinates& c,
+  std::vector<size_t>& order,
+  const size_t begin,
+  const size_t end,
+  std::vector<Cluster>& tree
+)
+{
+  Cluster cl;
+  cl.begin = begin;
+  cl.end = end;
+  cl.x_min = cl.y_min = HUGE_VAL;
+  cl.x_max = cl.y_max = -HUGE_VAL;
+  for (size_t i = begin; i < end; ++i) {
+    cl.x_min = std::min(cl.x_min, c.x[order[i]]);
+    cl.x_max = std::max(cl.x_max, c.x[order[i]]);
+    cl.y_min = std::min(cl.y_min, c.y[order[i]]);
+    cl.y_max = std::max(cl.y_max, c.y[order[i]]);
+  }
+  cl.child[0] = cl.child[1] = 0;
+  const size_t ret = tree.size();
+  tree.push_back(cl);
+  if (end - begin <= leaf_size) {
+    return ret;
+  }
+
+  const std::vector<double>& coord = (cl.x_max - cl.x_min >= cl.y_max - cl.y_min) ? c.x : c.y;
+  const size_t mid = begin + (end - begin) / 2;
+  std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+    [&](const size_t a, const size_t b) { return coord[a] < coord[b]; });
+  const size_t c0 = add_cluster(c, order, begin, mid, tree);
+  const size_t c1 = add_cluster(c, order, mid, end, tree);
+  tree[ret].child[0] = c0;
+  tree[ret].child[1] = c1;
+  return ret;
+}
+
+std::vector<Cluster> cluster_tree(const CellCoordinates& c, std::vector<size_t>& order)
+{
+  order.resize(c.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::vector<Cluster> ret;
+  add_cluster(c, order, 0, c.size(), ret);
+  return ret;
+}
+
+bool admissible(const Cluster& a, const Cluster& b)
+{
+  const double dx = std::max(0.0, std::max(a.x_min - b.x_max, b.x_min - a.x_max));
+  const double dy = std::max(0.0, std::max(a.y_min - b.y_max, b.y_min - a.y_max));
+  const double dist = std::hypot(dx, dy);
+  return dist > 0 && std::min(a.diameter(), b.diameter()) <= eta * dist;
+}
+
+/**
+ * \brief   Adaptive cross approximation with partial pivoting of the block of src cells
+ *          src[0..n_src) and dst cells dst[0..n_dst): block ~= u*v^T, to a relative tolerance.
+ * \return  false if the rank would get so high that storing the block dense takes less memory
+ *
+ * Picks a row, takes its largest remaining coefficient as the pivot and subtracts the cross of
+ * that row and the pivot's column; the next row is the one with the largest coefficient in that
+ * column. Stops once the latest cross is below tolerance times the (estimated) Frobenius norm of
+ * the approximation.
+ */
+bool aca(
+  const HMatrixOperator::BlockFunction& coefficients,
+  const size_t* src, const size_t n_src, const size_t src_dim,
+  const size_t* dst, const size_t n_dst, const size_t dst_dim,
+  const double tolerance,
+  arma::mat& u,
+  arma::mat& v
+)
+{
+  const size_t m = dst_dim * n_dst;
+  const size_t n = src_dim * n_src;
+  const size_t max_rank = (m * n) / (m + n);
+  std::vector<std::vector<double>> us, vs;
+  std::vector<bool> used_rows(m, false);
+  arma::mat tmp;
+  std::vector<double> row(n), col(m);
+  double norm2 = 0;
+  size_t i = 0;
+  for (;;) {
+    if (us.size() >= max_rank) {
+      return false;
+    }
+    used_rows[i] = true;
+    tmp.set_size(dst_dim, n);
+    coefficients(src, n_src, dst + i / dst_dim, 1, tmp);
+    for (size_t j = 0; j < n; ++j) {
+      row[j] = tmp(i % dst_dim, j);
+    }
+    for (size_t l = 0; l < us.size(); ++l) {
+      const double u_il = us[l][i];
+      for (size_t j = 0; j < n; ++j) {
+        row[j] -= u_il * vs[l][j];
+      }
+    }
+    size_t j_max = 0;
+    for (size_t j = 1; j < n; ++j) {
+      if (std::abs(row[j]) > std::abs(row[j_max])) {
+        j_max = j;
+      }
+    }
+    if (row[j_max] == 0) {
+      // already reproduced exactly: try another row
+      const auto next = std::find(used_rows.begin(), used_rows.end(), false);
+      if (next == used_rows.end()) {
+        break;
+      }
+      i = next - used_rows.begin();
+      continue;
+    }
+
+    tmp.set_size(m, src_dim);
+    coefficients(src + j_max / src_dim, 1, dst, n_dst, tmp);
+    for (size_t r = 0; r < m; ++r) {
+      col[r] = tmp(r, j_max % src_dim);
+    }
+    for (size_t l = 0; l < us.size(); ++l) {
+      const double v_jl = vs[l][j_max];
+      for (size_t r = 0; r < m; ++r) {
+        col[r] -= v_jl * us[l][r];
+      }
+    }
+    const double pivot = row[j_max];
+    for (double& e : row) {
+      e /= pivot;
+    }
+
+    // ||S + u v^T||^2 = ||S||^2 + 2 sum_l (u.u_l)(v.v_l) + ||u||^2 ||v||^2
+    const double uu = std::inner_product(col.begin(), col.end(), col.begin(), 0.0);
+    const double vv = std::inner_product(row.begin(), row.end(), row.begin(), 0.0);
+    for (size_t l = 0; l < us.size(); ++l) {
+      norm2 += 2 * std::inner_product(col.begin(), col.end(), us[l].begin(), 0.0)
+        * std::inner_product(row.begin(), row.end(), vs[l].begin(), 0.0);
+    }
+    norm2 += uu * vv;
+    us.push_back(col);
+    vs.push_back(row);
+    if (uu * vv <= tolerance * tolerance * norm2) {
+      break;
+    }
+
+    bool found = false;
+    for (size_t r = 0; r < m; ++r) {
+      if (!used_rows[r] && (!found || std::abs(col[r]) > std::abs(col[i]))) {
+        i = r;
+        found = true;
+      }
+    }
+    if (!found) {
+      break;
+    }
+  }
+
+  u.set_size(m, us.size());
+  v.set_size(n, vs.size());
+  for (size_t l = 0; l < us.size(); ++l) {
+    std::copy(us[l].begin(), us[l].end(), u.colptr(l));
+    std::copy(vs[l].begin(), vs[l].end(), v.colptr(l));
+  }
+  return true;
+}
+
+} /* anonymous namespace */
+
+HMatrixOperator::HMatrixOperator(
+  const CellCoordinates& src,
+  const CellCoordinates& dst,
+  const size_t src_dim,
+  const size_t dst_dim,
+  const BlockFunction& coefficients,
+  const double tolerance,
+  const size_t num_threads
+)
+:
+  src_dim_(src_dim),
+  dst_dim_(dst_dim)
+{
+  if (src.size() == 0 || dst.size() == 0) {
+    src_order_.resize(src.size());
+    dst_order_.resize(dst.size());
+    return;
+  }
+  const std::vector<Cluster> st = cluster_tree(src, src_order_);
+  const std::vector<Cluster> dt = cluster_tree(dst, dst_order_);
+
+  // the block tree's leaves
+  std::function<void(size_t, size_t)> partition = [&](const size_t s, const size_t d) {
+    const bool low_rank = admissible(st[s], dt[d]);
+    if (low_rank || st[s].leaf() || dt[d].leaf()) {
+      Block b;
+      b.src_begin = st[s].begin;
+      b.src_end = st[s].end;
+      b.dst_begin = dt[d].begin;
+      b.dst_end = dt[d].end;
+      b.low_rank = low_rank;
+      blocks_.push_back(std::move(b));
+      return;
+    }
+    for (const size_t sc : st[s].child) {
+      for (const size_t dc : dt[d].child) {
+        partition(sc, dc);
+      }
+    }
+  };
+  partition(0, 0);
+
+  parallel_for_blocks(blocks_.size(), num_threads, 1, [&](const size_t begin, const size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      Block& b = blocks_[k];
+      const size_t* s = src_order_.data() + b.src_begin;
+      const size_t* d = dst_order_.data() + b.dst_begin;
+      const size_t ns = b.src_end - b.src_begin;
+      const size_t nd = b.dst_end - b.dst_begin;
+      if (b.low_rank) {
+        b.low_rank = aca(coefficients, s, ns, src_dim_, d, nd, dst_dim_, tolerance, b.u, b.v);
+      }
+      if (!b.low_rank) {
+        b.dense.set_size(dst_dim_ * nd, src_dim_ * ns);
+        coefficients(s, ns, d, nd, b.dense);
+      }
+    }
+  });
+
+  LOG(DEBUG) << "HMatrixOperator: " << blocks_.size() << " blocks, "
+    << stored_coefficients() << " coefficients stored out of " << n_rows() * n_cols() << ".";
+}
+
+size_t HMatrixOperator::stored_coefficients() const
+{
+  size_t ret = 0;
+  for (const auto& b : blocks_) {
+    ret += b.dense.n_elem + b.u.n_elem + b.v.n_elem;
+  }
+  return ret;
+}
+
+size_t HMatrixOperator::impl_n_rows() const
+{
+  return dst_dim_ * dst_order_.size();
+}
+
+size_t HMatrixOperator::impl_n_cols() const
+{
+  return src_dim_ * src_order_.size();
+}
+
+void HMatrixOperator::impl_apply(const double* x, double* y) const
+{
+  // in tree order, each block's values are contiguous
+  std::vector<double> xs(n_cols());
+  for (size_t i = 0; i < src_order_.size(); ++i) {
+    std::copy(x + src_dim_*src_order_[i], x + src_dim_*(src_order_[i] + 1), &xs[src_dim_*i]);
+  }
+  std::vector<double> ys(n_rows(), 0.0);
+  std::vector<double> t;
+  for (const auto& b : blocks_) {
+    const double* __restrict in = xs.data() + src_dim_*b.src_begin;
+    double* __restrict out = ys.data() + dst_dim_*b.dst_begin;
+    const size_t m = dst_dim_ * (b.dst_end - b.dst_begin);
+    const size_t n = src_dim_ * (b.src_end - b.src_begin);
+    if (!b.low_rank) {
+      for (size_t j = 0; j < n; ++j) {
+        const double* __restrict col = b.dense.colptr(j);
+        for (size_t i = 0; i < m; ++i) {
+          out[i] += col[i] * in[j];
+        }
+      }
+      continue;
+    }
+    t.assign(b.u.n_cols, 0.0);
+    for (size_t l = 0; l < t.size(); ++l) {
+      const double* __restrict v = b.v.colptr(l);
+      for (size_t j = 0; j < n; ++j) {
+        t[l] += v[j] * in[j];
+      }
+    }
+    for (size_t l = 0; l < t.size(); ++l) {
+      const double* __restrict u = b.u.colptr(l);
+      for (size_t i = 0; i < m; ++i) {
+        out[i] += u[i] * t[l];
+      }
+    }
+  }
+  for (size_t i = 0; i < dst_order_.size(); ++i) {
+    std::copy(&ys[dst_dim_*i], &ys[dst_dim_*(i + 1)], y + dst_dim_*dst_order_[i]);
+  }
+}
+
+void HMatrixOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  std::vector<double> ys(n_rows());
+  for (size_t i = 0; i < dst_order_.size(); ++i) {
+    std::copy(y + dst_dim_*dst_order_[i], y + dst_dim_*(dst_order_[i] + 1), &ys[dst_dim_*i]);
+  }
+  std::vector<double> xs(n_cols(), 0.0);
+  std::vector<double> t;
+  for (const auto& b : blocks_) {
+    const double* __restrict in = ys.data() + dst_dim_*b.dst_begin;
+    double* __restrict out = xs.data() + src_dim_*b.src_begin;
+    const size_t m = dst_dim_ * (b.dst_end - b.dst_begin);
+    const size_t n = src_dim_ * (b.src_end - b.src_begin);
+    if (!b.low_rank) {
+      for (size_t j = 0; j < n; ++j) {
+        const double* __restrict col = b.dense.colptr(j);
+        double dot = 0;
+        for (size_t i = 0; i < m; ++i) {
+          dot += col[i] * in[i];
+        }
+        out[j] += dot;
+      }
+      continue;
+    }
+    t.assign(b.u.n_cols, 0.0);
+    for (size_t l = 0; l < t.size(); ++l) {
+      const double* __restrict u = b.u.colptr(l);
+      for (size_t i = 0; i < m; ++i) {
+        t[l] += u[i] * in[i];
+      }
+    }
+    for (size_t l = 0; l < t.size(); ++l) {
+      const double* __restrict v = b.v.colptr(l);
+      for (size_t j = 0; j < n; ++j) {
+        out[j] += v[j] * t[l];
+      }
+    }
+  }
+  for (size_t i = 0; i < src_order_.size(); ++i) {
+    std::copy(&xs[src_dim_*i], &xs[src_dim_*(i + 1)], x + src_dim_*src_order_[i]);
+  }
+}
+
+std::vector<double> HMatrixOperator::impl_column_norms() const
+{
+  // squared norms in tree order
+  std::vector<double> sums(n_cols(), 0.0);
+  for (const auto& b : blocks_) {
+    double* __restrict out = sums.data() + src_dim_*b.src_begin;
+    const size_t n = src_dim_ * (b.src_end - b.src_begin);
+    if (!b.low_rank) {
+      for (size_t j = 0; j < n; ++j) {
+        const double* __restrict col = b.dense.colptr(j);
+        double sum = 0;
+        for (size_t i = 0; i < b.dense.n_rows; ++i) {
+          sum += col[i] * col[i];
+        }
+        out[j] += sum;
+      }
+      continue;
+    }
+    // column j of u*v^T is u*v(j,:)^T: its squared norm v(j,:) * u^T*u * v(j,:)^T
+    const arma::mat g = b.u.t() * b.u;
+    for (size_t j = 0; j < n; ++j) {
+      double sum = 0;
+      for (size_t k = 0; k < g.n_cols; ++k) {
+        for (size_t l = 0; l < g.n_rows; ++l) {
+          sum += b.v(j, l) * g(l, k) * b.v(j, k);
+        }
+      }
+      out[j] += std::max(sum, 0.0);
+    }
+  }
+  std::vector<double> ret(n_cols());
+  for (size_t i = 0; i < src_order_.size(); ++i) {
+    for (size_t a = 0; a < src_dim_; ++a) {
+      ret[src_dim_*src_order_[i] + a] = std::sqrt(sums[src_dim_*i + a]);
+    }
+  }
+  return ret;
+}
+
+} /* namespace details */
+} /* namespace cm */
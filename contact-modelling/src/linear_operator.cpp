@@ -0,0 +1,201 @@
+#include "cm/details/linear_operator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+void LinearOperator::apply(const double* x, double* y) const
+{
+  impl_apply(x, y);
+}
+
+void LinearOperator::apply_transpose(const double* y, double* x) const
+{
+  impl_apply_transpose(y, x);
+}
+
+std::vector<double> LinearOperator::apply(const std::vector<double>& x) const
+{
+  if (x.size() != n_cols()) {
+    throw std::runtime_error(sb()
+      << "LinearOperator::apply: the operand has " << x.size() << " elements; expected "
+      << n_cols()
+    );
+  }
+  std::vector<double> y(n_rows());
+  impl_apply(x.data(), y.data());
+  return y;
+}
+
+std::vector<double> LinearOperator::apply_transpose(const std::vector<double>& y) const
+{
+  if (y.size() != n_rows()) {
+    throw std::runtime_error(sb()
+      << "LinearOperator::apply_transpose: the operand has " << y.size()
+      << " elements; expected " << n_rows()
+    );
+  }
+  std::vector<double> x(n_cols());
+  impl_apply_transpose(y.data(), x.data());
+  return x;
+}
+
+std::vector<double> LinearOperator::column_norms() const
+{
+  return impl_column_norms();
+}
+
+std::vector<double> LinearOperator::impl_column_norms() const
+{
+  std::vector<double> ret(n_cols());
+  std::vector<double> e(n_cols(), 0.0);
+  std::vector<double> column(n_rows());
+  for (size_t j = 0; j < ret.size(); ++j) {
+    e[j] = 1;
+    impl_apply(e.data(), column.data());
+    e[j] = 0;
+    double sum = 0;
+    for (const double c : column) {
+      sum += c * c;
+    }
+    ret[j] = std::sqrt(sum);
+  }
+  return ret;
+}
+
+arma::mat LinearOperator::columns(const std::vector<size_t>& cols) const
+{
+  for (const size_t j : cols) {
+    if (j >= n_cols()) {
+      throw std::runtime_error(sb()
+        << "LinearOperator::columns: column " << j << " of " << n_cols()
+      );
+    }
+  }
+  return impl_columns(cols);
+}
+
+arma::mat LinearOperator::impl_columns(const std::vector<size_t>& cols) const
+{
+  arma::mat ret(n_rows(), cols.size());
+  std::vector<double> e(n_cols(), 0.0);
+  for (size_t k = 0; k < cols.size(); ++k) {
+    e[cols[k]] = 1;
+    impl_apply(e.data(), ret.colptr(k));
+    e[cols[k]] = 0;
+  }
+  return ret;
+}
+
+DenseOperator::DenseOperator(arma::mat m, const size_t num_threads)
+  : m_(std::move(m)), pool_(std::make_shared<WorkerPool>(num_threads))
+{
+}
+
+size_t DenseOperator::impl_n_rows() const
+{
+  return m_.n_rows;
+}
+
+size_t DenseOperator::impl_n_cols() const
+{
+  return m_.n_cols;
+}
+
+void DenseOperator::impl_apply(const double* x, double* y) const
+{
+  if (pool_->num_threads() != 1) {
+    dense_apply(m_.memptr(), m_.n_rows, m_.n_cols, x, y, *pool_);
+    return;
+  }
+  // armadillo's vectors over the caller's memory; no copies
+  const arma::colvec x_v(const_cast<double*>(x), m_.n_cols, false, true);
+  arma::colvec y_v(y, m_.n_rows, false, true);
+  y_v = m_ * x_v;
+}
+
+void DenseOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  if (pool_->num_threads() != 1) {
+    dense_apply_transpose(m_.memptr(), m_.n_rows, m_.n_cols, y, x, *pool_);
+    return;
+  }
+  const arma::colvec y_v(const_cast<double*>(y), m_.n_rows, false, true);
+  arma::colvec x_v(x, m_.n_cols, false, true);
+  x_v = m_.t() * y_v;
+}
+
+std::vector<double> DenseOperator::impl_column_norms() const
+{
+  std::vector<double> ret(m_.n_cols);
+  for (size_t j = 0; j < m_.n_cols; ++j) {
+    const double* c = m_.colptr(j);
+    double sum = 0;
+    for (size_t i = 0; i < m_.n_rows; ++i) {
+      sum += c[i] * c[i];
+    }
+    ret[j] = std::sqrt(sum);
+  }
+  return ret;
+}
+
+arma::mat DenseOperator::impl_columns(const std::vector<size_t>& cols) const
+{
+  arma::mat ret(m_.n_rows, cols.size());
+  for (size_t k = 0; k < cols.size(); ++k) {
+    std::copy(m_.colptr(cols[k]), m_.colptr(cols[k]) + m_.n_rows, ret.colptr(k));
+  }
+  return ret;
+}
+
+void dense_apply(
+  const double* m,
+  const size_t n_rows,
+  const size_t n_cols,
+  const double* x,
+  double* y,
+  const WorkerPool& pool
+)
+{
+  parallel_for_blocks(n_rows, pool, 0, [&](const size_t r_begin, const size_t r_end) {
+    std::fill(y + r_begin, y + r_end, 0.0);
+    for (size_t j = 0; j < n_cols; ++j) {
+      const double* __restrict col = m + j*n_rows;
+      const double x_j = x[j];
+      for (size_t i = r_begin; i < r_end; ++i) {
+        y[i] += col[i] * x_j;
+      }
+    }
+  });
+}
+
+void dense_apply_transpose(
+  const double* m,
+  const size_t n_rows,
+  const size_t n_cols,
+  const double* y,
+  double* x,
+  const WorkerPool& pool
+)
+{
+  parallel_for_blocks(n_cols, pool, 0, [&](const size_t c_begin, const size_t c_end) {
+    for (size_t j = c_begin; j < c_end; ++j) {
+      const double* __restrict col = m + j*n_rows;
+      double dot = 0;
+      for (size_t i = 0; i < n_rows; ++i) {
+        dot += col[i] * y[i];
+      }
+      x[j] = dot;
+    }
+  });
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,288 @@
+#include "cm/details/love_surrogate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+
+#include "cm/details/elastic_model_love.hpp"
+#include "cm/details/math.hpp"
+#include "cm/details/string.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+namespace impl {
+
+constexpr double LoveSurrogate::min_sampled_tol;
+
+namespace {
+
+/**
+ * \brief   Weights of the cubic Lagrange polynomial through nodes -1, 0, 1, 2, at t in [0,1)
+ */
+inline void cubic_weights(const double t, double w[4])
+{
+  const double tp = t + 1;
+  const double tm = t - 1;
+  const double tmm = t - 2;
+  w[0] = -t*tm*tmm * (1.0/6);
+  w[1] = tp*tm*tmm * 0.5;
+  w[2] = -tp*t*tmm * 0.5;
+  w[3] = tp*t*tm * (1.0/6);
+}
+
+/**
+ * \brief   Spacing of the table's nodes for a given tolerance
+ *
+ * In the far field the coefficients decay like r^-3, so the relative error of the interpolation
+ * on a log scale is about 2*step^4; with some margin for the cancellation between the two terms,
+ * 0.02 is the spacing for sampled_tol = 1e-6.
+ */
+double step_for(const double sampled_tol)
+{
+  return std::min(0.2, std::max(0.005, 0.02 * std::pow(sampled_tol / 1e-6, 0.25)));
+}
+
+/**
+ * \brief   Table coordinate of an offset of u cells, and back
+ */
+inline double to_table(const double u)
+{
+  // it's the absolute error which matters here; no need for log1p()
+  return fast_log(1.0 + u);
+}
+
+inline double from_table(const double xi)
+{
+  return std::expm1(xi);
+}
+
+} /* anonymous namespace */
+
+LoveSurrogate::LoveSurrogate(
+  const double dx, const double dy,
+  const double h,
+  const double nu,
+  const double x_max, const double y_max,
+  const double sampled_tol
+)
+:
+  dx_(dx), dy_(dy), h_(h), nu_(nu), x_max_(x_max), y_max_(y_max), sampled_tol_(sampled_tol),
+  step_(step_for(sampled_tol)), inv_step_(1.0 / step_),
+  inv_cell_x_(1.0 / (2*dx)), inv_cell_y_(1.0 / (2*dy))
+{
+  if (dx <= 0 || dy <= 0 || !(sampled_tol >= min_sampled_tol)) {
+    throw std::runtime_error(sb()
+      << "LoveSurrogate: invalid parameters; dx: " << dx << ", dy: " << dy
+      << ", sampled_tol: " << sampled_tol
+    );
+  }
+  nx_ = static_cast<size_t>(to_table(std::fabs(x_max) * inv_cell_x_) * inv_step_) + 4;
+  ny_ = static_cast<size_t>(to_table(std::fabs(y_max) * inv_cell_y_) * inv_step_) + 4;
+  // E is merely a scale factor; the table is for E = 1
+  const double c_log  = love_c_log(1, nu);
+  const double c_atan = love_c_atan(1, nu);
+
+  // --- values at the nodes
+  std::vector<double> x(nx_ * ny_);
+  std::vector<double> y(nx_ * ny_);
+  for (size_t i = 0; i < nx_; ++i) {
+    for (size_t j = 0; j < ny_; ++j) {
+      x[i*ny_ + j] = 2*dx * from_table(i*step_);
+      y[i*ny_ + j] = 2*dy * from_table(j*step_);
+    }
+  }
+  std::vector<double> t_log(x.size());
+  std::vector<double> t_atan(x.size());
+  love_terms_batch(dx, dy, h, x.data(), y.data(), x.size(), t_log.data(), t_atan.data());
+  // The coefficient is even in x and y; extending the table coordinates to negative offsets as
+  // odd functions, it is even in xi and eta too: node -1 mirrors node 1.
+  values_.resize((nx_ + 1) * (ny_ + 1));
+  for (size_t i = 0; i <= nx_; ++i) {
+    for (size_t j = 0; j <= ny_; ++j) {
+      const size_t src = ((i > 0) ? i - 1 : 1) * ny_ + ((j > 0) ? j - 1 : 1);
+      values_[i*(ny_ + 1) + j] = c_log * t_log[src] - c_atan * t_atan[src];
+    }
+  }
+
+  // --- near field: the pressure cell's edges, and the coefficient's change of sign at about h
+  exact_.assign(values_.size(), 0);
+  const double near_x = to_table(std::max(static_cast<double>(near_cells), 2*h * inv_cell_x_));
+  const double near_y = to_table(std::max(static_cast<double>(near_cells), 2*h * inv_cell_y_));
+  for (size_t i = 0; i < nx_; ++i) {
+    for (size_t j = 0; j < ny_; ++j) {
+      exact_[i*(ny_ + 1) + j] = (i*step_ < near_x) && (j*step_ < near_y);
+    }
+  }
+
+  // --- verify the rest at a lattice of a quarter step over every table cell, but its corner
+  const size_t num_cells_x = nx_ - 2;
+  const size_t num_cells_y = ny_ - 2;
+  const size_t lattice = 4;
+  const size_t num_checks = lattice * lattice - 1;
+  std::vector<double> cx, cy;
+  cx.reserve(num_checks * num_cells_x * num_cells_y);
+  cy.reserve(num_checks * num_cells_x * num_cells_y);
+  for (size_t i = 0; i < num_cells_x; ++i) {
+    for (size_t j = 0; j < num_cells_y; ++j) {
+      for (size_t k = 1; k <= num_checks; ++k) {
+        cx.push_back(2*dx * from_table((i + double(k / lattice) / lattice) * step_));
+        cy.push_back(2*dy * from_table((j + double(k % lattice) / lattice) * step_));
+      }
+    }
+  }
+  std::vector<double> c_t_log(cx.size());
+  std::vector<double> c_t_atan(cx.size());
+  love_terms_batch(dx, dy, h, cx.data(), cy.data(), cx.size(), c_t_log.data(), c_t_atan.data());
+
+  size_t ind = 0;
+  for (size_t i = 0; i < num_cells_x; ++i) {
+    for (size_t j = 0; j < num_cells_y; ++j) {
+      // the nodes the cell is interpolated from, nodes i-1 .. i+2 and j-1 .. j+2, of one sign
+      const double* v = values_.data() + i*(ny_ + 1) + j;
+      bool positive = false, negative = false;
+      for (size_t a = 0; a < 4; ++a, v += ny_ + 1) {
+        for (size_t b = 0; b < 4; ++b) {
+          positive = positive || v[b] > 0;
+          negative = negative || !(v[b] > 0);
+        }
+      }
+      bool ok = !(positive && negative);
+      for (size_t k = 1; k <= num_checks; ++k, ++ind) {
+        const double s = i + double(k / lattice) / lattice;
+        const double t = j + double(k % lattice) / lattice;
+        const double exact  = c_log * c_t_log[ind] - c_atan * c_t_atan[ind];
+        const double interp = interpolate(s, t, i, j);
+        ok = ok && (std::fabs(interp - exact) <= 0.5 * sampled_tol * std::fabs(exact));
+      }
+      exact_[i*(ny_ + 1) + j] = exact_[i*(ny_ + 1) + j] || !ok;
+    }
+  }
+
+  LOG(DEBUG) << "LoveSurrogate: " << nx_ << "x" << ny_ << " nodes, "
+    << (100 * fraction_exact()) << "% of the table's cells evaluated exactly.";
+}
+
+std::shared_ptr<const LoveSurrogate> LoveSurrogate::get(
+  const double dx, const double dy,
+  const double h,
+  const double nu,
+  const double x_max, const double y_max,
+  const double sampled_tol
+)
+{
+  static std::mutex mutex;
+  static std::vector<std::shared_ptr<const LoveSurrogate>> tables;
+  const size_t max_tables = 4;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& t : tables) {
+    if (t->matches(dx, dy, h, nu, x_max, y_max, sampled_tol)) {
+      return t;
+    }
+  }
+  auto ret = std::make_shared<const LoveSurrogate>(dx, dy, h, nu, x_max, y_max, sampled_tol);
+  if (tables.size() >= max_tables) {
+    tables.erase(tables.begin());
+  }
+  tables.push_back(ret);
+  return ret;
+}
+
+bool LoveSurrogate::matches(
+  const double dx, const double dy,
+  const double h,
+  const double nu,
+  const double x_max, const double y_max,
+  const double sampled_tol
+) const
+{
+  return dx == dx_ && dy == dy_ && h == h_ && nu == nu_ && sampled_tol == sampled_tol_
+    && std::fabs(x_max) <= x_max_ && std::fabs(y_max) <= y_max_;
+}
+
+double LoveSurrogate::fraction_exact() const
+{
+  size_t num_exact = 0;
+  for (size_t i = 0; i < nx_ - 2; ++i) {
+    for (size_t j = 0; j < ny_ - 2; ++j) {
+      num_exact += exact_[i*(ny_ + 1) + j] ? 1 : 0;
+    }
+  }
+  return static_cast<double>(num_exact) / ((nx_ - 2) * (ny_ - 2));
+}
+
+CM_VECTOR_CLONES
+void LoveSurrogate::lookup_batch(
+  const double* __restrict x, const double* __restrict y,
+  const size_t n,
+  double* __restrict coeff_times_E,
+  unsigned char* __restrict served
+) const
+{
+  const double* __restrict values = values_.data();
+  const double* __restrict exact = exact_.data();
+  // locals: served could alias the members as far as the compiler knows
+  const double inv_cell_x = inv_cell_x_;
+  const double inv_cell_y = inv_cell_y_;
+  const double inv_step = inv_step_;
+  const int ny = static_cast<int>(ny_);
+  const int stride = ny + 1;
+  const double s_end = static_cast<double>(nx_ - 2);
+  const double t_end = static_cast<double>(ny_ - 2);
+  for (size_t k = 0; k < n; ++k) {
+    const double s = to_table(std::fabs(x[k]) * inv_cell_x) * inv_step;
+    const double t = to_table(std::fabs(y[k]) * inv_cell_y) * inv_step;
+    // out of the table: interpolate anywhere within it, and throw that away
+    const bool inside = (s < s_end) & (t < t_end);
+    const double sc = inside ? s : 0.0;
+    const double tc = inside ? t : 0.0;
+    // int rather than size_t: converts to a vector of indices without AVX-512 as well
+    const int i = static_cast<int>(sc);
+    const int j = static_cast<int>(tc);
+
+    // cubic_weights(), spelled out so that the loop vectorises
+    const double u = sc - i;
+    const double w = tc - j;
+    const double wx0 = -u*(u-1)*(u-2) * (1.0/6);
+    const double wx1 = (u+1)*(u-1)*(u-2) * 0.5;
+    const double wx2 = -(u+1)*u*(u-2) * 0.5;
+    const double wx3 = (u+1)*u*(u-1) * (1.0/6);
+    const double wy0 = -w*(w-1)*(w-2) * (1.0/6);
+    const double wy1 = (w+1)*(w-1)*(w-2) * 0.5;
+    const double wy2 = -(w+1)*w*(w-2) * 0.5;
+    const double wy3 = (w+1)*w*(w-1) * (1.0/6);
+    // plain indices rather than pointers, so that the loads become gathers
+    const int v0 = i*stride + j;
+    const int v1 = v0 + stride;
+    const int v2 = v1 + stride;
+    const int v3 = v2 + stride;
+    served[k] = inside & (exact[v0] == 0);
+    const double ret =
+        wx0 * (wy0*values[v0] + wy1*values[v0+1] + wy2*values[v0+2] + wy3*values[v0+3])
+      + wx1 * (wy0*values[v1] + wy1*values[v1+1] + wy2*values[v1+2] + wy3*values[v1+3])
+      + wx2 * (wy0*values[v2] + wy1*values[v2+1] + wy2*values[v2+2] + wy3*values[v2+3])
+      + wx3 * (wy0*values[v3] + wy1*values[v3+1] + wy2*values[v3+2] + wy3*values[v3+3]);
+    coeff_times_E[k] = ret;
+  }
+}
+
+double LoveSurrogate::interpolate(const double s, const double t, const size_t i, const size_t j)
+  const
+{
+  double wx[4], wy[4];
+  cubic_weights(s - i, wx);
+  cubic_weights(t - j, wy);
+  // nodes i-1 .. i+2, j-1 .. j+2; the table starts at node -1
+  const double* v = values_.data() + i*(ny_ + 1) + j;
+  double ret = 0;
+  for (size_t a = 0; a < 4; ++a, v += ny_ + 1) {
+    ret += wx[a] * (wy[0]*v[0] + wy[1]*v[1] + wy[2]*v[2] + wy[3]*v[3]);
+  }
+  return ret;
+}
+
+} /* namespace impl */
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,209 @@
+#include "cm/details/mapped_operator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "cm/grid/grid.hpp"
+#include "cm/details/string.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+const char magic[8] = {'c', 'm', 'm', 'a', 't', 'r', 'x', '1'};
+
+struct Header {
+  char magic[8];
+  uint64_t n_rows;
+  uint64_t n_cols;
+  uint64_t fingerprint;
+  /**
+   * \brief   Up to 64 bytes: the coefficients start on a cache line
+   */
+  char padding[32];
+};
+static_assert(sizeof(Header) == 64, "the header of the mapped matrices must be 64 bytes long");
+
+/**
+ * \brief   FNV-1a
+ */
+class Hash {
+public:
+  void add(const void* data, const size_t n)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) {
+      value_ ^= bytes[i];
+      value_ *= 1099511628211ULL;
+    }
+  }
+
+  void add(const double v)
+  {
+    add(&v, sizeof(v));
+  }
+
+  void add(const uint64_t v)
+  {
+    add(&v, sizeof(v));
+  }
+
+  void add(const Grid& g)
+  {
+    add(uint64_t(g.dim()));
+    add(uint64_t(g.num_cells()));
+    add(g.getCellShape().dx());
+    add(g.getCellShape().dy());
+    add(g.getCellShape().area());
+    for (auto it = g.cells_cbegin(); it != g.cells_cend(); ++it) {
+      add(it->x);
+      add(it->y);
+    }
+  }
+
+  uint64_t value() const { return value_; }
+
+private:
+  uint64_t value_ = 14695981039346656037ULL;
+};
+
+} /* anonymous namespace */
+
+MappedOperator::MappedOperator(
+  const std::string& path,
+  const size_t n_rows,
+  const size_t n_cols,
+  const uint64_t fingerprint,
+  const std::function<void(arma::mat&)>& fill,
+  const size_t num_threads
+)
+:
+  pool_(std::make_shared<WorkerPool>(num_threads))
+{
+  const std::string tmp =
+    boost::filesystem::unique_path(path + ".%%%%-%%%%-%%%%").string();
+  try {
+    boost::iostreams::mapped_file_params params(tmp);
+    params.new_file_size = sizeof(Header) + n_rows * n_cols * sizeof(double);
+    params.flags = boost::iostreams::mapped_file::readwrite;
+    boost::iostreams::mapped_file out(params);
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::copy(magic, magic + sizeof(magic), h.magic);
+    h.n_rows = n_rows;
+    h.n_cols = n_cols;
+    h.fingerprint = fingerprint;
+    std::memcpy(out.data(), &h, sizeof(h));
+    arma::mat m(reinterpret_cast<double*>(out.data() + sizeof(Header)), n_rows, n_cols, false,
+      true);
+    fill(m);
+    out.close();
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      throw std::runtime_error(sb() << "MappedOperator: couldn't rename '" << tmp << "' to '"
+        << path << "'");
+    }
+  } catch (...) {
+    boost::system::error_code ignored;
+    boost::filesystem::remove(tmp, ignored);
+    throw;
+  }
+  open(path);
+}
+
+MappedOperator::MappedOperator(const std::string& path, const size_t num_threads)
+:
+  pool_(std::make_shared<WorkerPool>(num_threads))
+{
+  open(path);
+}
+
+void MappedOperator::open(const std::string& path)
+{
+  file_.open(path);
+  Header h;
+  if (file_.size() < sizeof(h)) {
+    throw std::runtime_error(sb() << "MappedOperator: '" << path << "' is too short");
+  }
+  std::memcpy(&h, file_.data(), sizeof(h));
+  if (!std::equal(magic, magic + sizeof(magic), h.magic)) {
+    throw std::runtime_error(sb() << "MappedOperator: '" << path << "' isn't a mapped matrix");
+  }
+  if (file_.size() != sizeof(h) + h.n_rows * h.n_cols * sizeof(double)) {
+    throw std::runtime_error(sb() << "MappedOperator: '" << path << "' has " << file_.size()
+      << " bytes, not those of a " << h.n_rows << "x" << h.n_cols << " matrix");
+  }
+  n_rows_ = h.n_rows;
+  n_cols_ = h.n_cols;
+  fingerprint_ = h.fingerprint;
+}
+
+std::unique_ptr<MappedOperator> MappedOperator::reuse(
+  const std::string& path,
+  const size_t n_rows,
+  const size_t n_cols,
+  const uint64_t fingerprint,
+  const size_t num_threads
+)
+{
+  if (!boost::filesystem::exists(path)) {
+    return nullptr;
+  }
+  std::unique_ptr<MappedOperator> ret;
+  try {
+    ret.reset(new MappedOperator(path, num_threads));
+  } catch (const std::exception& e) {
+    LOG(DEBUG) << "Not reusing '" << path << "': " << e.what();
+    return nullptr;
+  }
+  if (ret->n_rows_ != n_rows || ret->n_cols_ != n_cols || ret->fingerprint_ != fingerprint) {
+    LOG(DEBUG) << "Not reusing '" << path << "': computed for something else.";
+    return nullptr;
+  }
+  return ret;
+}
+
+const double* MappedOperator::data() const
+{
+  return reinterpret_cast<const double*>(file_.data() + sizeof(Header));
+}
+
+size_t MappedOperator::impl_n_rows() const
+{
+  return n_rows_;
+}
+
+size_t MappedOperator::impl_n_cols() const
+{
+  return n_cols_;
+}
+
+void MappedOperator::impl_apply(const double* x, double* y) const
+{
+  dense_apply(data(), n_rows_, n_cols_, x, y, *pool_);
+}
+
+void MappedOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  dense_apply_transpose(data(), n_rows_, n_cols_, y, x, *pool_);
+}
+
+uint64_t model_fingerprint(const Grid& src, const Grid& dst, const std::vector<double>& params)
+{
+  Hash h;
+  h.add(src);
+  h.add(dst);
+  h.add(uint64_t(params.size()));
+  for (const double p : params) {
+    h.add(p);
+  }
+  return h.value();
+}
+
+} /* namespace details */
+} /* namespace cm */
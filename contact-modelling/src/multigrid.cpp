@@ -0,0 +1,301 @@
+#include "cm/details/multigrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/power_iteration.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+double dot(const std::vector<double>& u, const std::vector<double>& v)
+{
+  double sum = 0;
+  for (size_t i = 0; i < u.size(); ++i) {
+    sum += u[i] * v[i];
+  }
+  return sum;
+}
+
+} /* anonymous namespace */
+
+Multigrid::Multigrid(
+  std::shared_ptr<const LinearOperator> a,
+  const Lattice& lattice,
+  const size_t dim,
+  const double regularisation,
+  const size_t coarsest,
+  const size_t num_threads
+)
+:
+  a_(std::move(a)),
+  dim_(dim)
+{
+  if (!a_ || a_->n_cols() != dim_ * lattice.node.size()) {
+    throw std::runtime_error(sb() << "Multigrid: " << lattice.node.size() << " cells of "
+      << dim_ << " values for " << (a_ ? a_->n_cols() : 0) << " columns");
+  }
+  lambda_ = regularisation * largest_squared_singular_value(*a_, 1e-3);
+
+  // every level's cells' nodes, on a lattice of nx by ny
+  std::vector<size_t> node = lattice.node;
+  size_t nx = lattice.nx;
+  size_t ny = lattice.ny;
+  cells_.push_back(node.size());
+  // Jacobi's weights: the diagonal of N_0
+  weight_.push_back(a_->column_norms());
+  for (double& w : weight_.back()) {
+    w = w * w + lambda_;
+  }
+  while (dim_ * cells_.back() > coarsest && (nx > 1 || ny > 1)) {
+    const size_t cnx = (nx + 1) / 2;
+    const size_t cny = (ny + 1) / 2;
+    // the coarse cells, numbered in the order of their nodes
+    const size_t none = std::numeric_limits<size_t>::max();
+    std::vector<size_t> index(cnx * cny, none);
+    for (const size_t v : node) {
+      index[(v / ny / 2) * cny + (v % ny) / 2] = 0;
+    }
+    std::vector<size_t> coarse_node;
+    for (size_t v = 0; v < index.size(); ++v) {
+      if (index[v] != none) {
+        index[v] = coarse_node.size();
+        coarse_node.push_back(v);
+      }
+    }
+    std::vector<size_t> parent(node.size());
+    for (size_t c = 0; c < node.size(); ++c) {
+      parent[c] = index[(node[c] / ny / 2) * cny + (node[c] % ny) / 2];
+    }
+    parent_.push_back(std::move(parent));
+    cells_.push_back(coarse_node.size());
+    weight_.push_back(std::vector<double>(dim_ * coarse_node.size()));
+    const size_t l = parent_.size() - 1;
+    coarsen(l, weight_[l].data(), weight_[l + 1].data());
+    node = std::move(coarse_node);
+    nx = cnx;
+    ny = cny;
+  }
+
+  // the largest eigenvalue of complement() N_l, by power iteration, from a vector in the range
+  // of complement()
+  for (size_t l = 0; l + 1 < levels(); ++l) {
+    const size_t n = dim_ * cells_[l];
+    std::vector<double> start(n);
+    for (size_t i = 0; i < n; ++i) {
+      start[i] = (i % 2) ? 1.0 : -0.5;
+    }
+    std::vector<double> v(n);
+    complement(l, start.data(), v.data());
+    std::vector<double> nv(n);
+    double largest = 0;
+    for (size_t k = 0; k < 20; ++k) {
+      const double v_norm = std::sqrt(dot(v, v));
+      if (!(v_norm > 0)) {
+        break;
+      }
+      for (double& e : v) {
+        e /= v_norm;
+      }
+      normal(l, v.data(), nv.data());
+      const double v_nv = dot(v, nv);
+      complement(l, nv.data(), v.data());
+      // the Rayleigh quotient in N_l's inner product
+      largest = dot(nv, v) / v_nv;
+    }
+    omega_.push_back(largest > 0 ? 1 / (1.01 * largest) : 0);
+  }
+
+  const size_t n = dim_ * cells_.back();
+  arma::mat coarse(n, n);
+  parallel_for_blocks(n, num_threads, 0, [&](const size_t j_begin, const size_t j_end) {
+    std::vector<double> e(n, 0.0);
+    for (size_t j = j_begin; j < j_end; ++j) {
+      e[j] = 1;
+      normal(levels() - 1, e.data(), coarse.colptr(j));
+      e[j] = 0;
+    }
+  });
+  if (!arma::chol(factor_, coarse)) {
+    throw std::runtime_error(sb() << "Multigrid: the coarsest level (" << n
+      << " values) isn't positive definite; is the regularisation positive?");
+  }
+  LOG(DEBUG) << "Multigrid: " << levels() << " levels, " << cells_.back()
+    << " cells on the coarsest";
+}
+
+void Multigrid::vcycle(const double* r, double* e) const
+{
+  cycle(0, r, e);
+}
+
+size_t Multigrid::solve(
+  const std::vector<double>& b,
+  std::vector<double>& x,
+  const size_t max_iterations,
+  const double tolerance
+) const
+{
+  const size_t n = a_->n_cols();
+  if (b.size() != a_->n_rows()) {
+    throw std::runtime_error(sb() << "Multigrid::solve: " << b.size() << " right-hand sides for a "
+      << a_->n_rows() << "x" << n << " operator");
+  }
+  x.resize(n, 0.0);
+
+  std::vector<double> r(n);
+  a_->apply_transpose(b.data(), r.data());
+  const double threshold = tolerance * tolerance * dot(r, r);
+  std::vector<double> q(n);
+  normal(0, x.data(), q.data());
+  for (size_t i = 0; i < n; ++i) {
+    r[i] -= q[i];
+  }
+  std::vector<double> z(n);
+  vcycle(r.data(), z.data());
+  std::vector<double> p(z);
+  double rz = dot(r, z);
+  size_t k = 0;
+  for (; k < max_iterations && dot(r, r) > threshold; ++k) {
+    normal(0, p.data(), q.data());
+    const double pq = dot(p, q);
+    if (!(pq > 0)) {
+      break;
+    }
+    const double alpha = rz / pq;
+    for (size_t i = 0; i < n; ++i) {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+    }
+    vcycle(r.data(), z.data());
+    const double rz_new = dot(r, z);
+    const double beta = rz_new / rz;
+    rz = rz_new;
+    for (size_t i = 0; i < n; ++i) {
+      p[i] = z[i] + beta * p[i];
+    }
+  }
+  return k;
+}
+
+void Multigrid::normal(const size_t level, const double* x, double* y) const
+{
+  if (0 == level) {
+    std::vector<double> ax(a_->n_rows());
+    a_->apply(x, ax.data());
+    a_->apply_transpose(ax.data(), y);
+    for (size_t i = 0; i < a_->n_cols(); ++i) {
+      y[i] += lambda_ * x[i];
+    }
+    return;
+  }
+  std::vector<double> fine(dim_ * cells_[level - 1]);
+  std::vector<double> n_fine(fine.size());
+  prolong(level - 1, x, fine.data());
+  normal(level - 1, fine.data(), n_fine.data());
+  coarsen(level - 1, n_fine.data(), y);
+}
+
+void Multigrid::prolong(const size_t level, const double* x, double* y) const
+{
+  const std::vector<size_t>& parent = parent_[level];
+  for (size_t c = 0; c < parent.size(); ++c) {
+    for (size_t a = 0; a < dim_; ++a) {
+      y[dim_*c + a] = x[dim_*parent[c] + a];
+    }
+  }
+}
+
+void Multigrid::coarsen(const size_t level, const double* y, double* x) const
+{
+  const std::vector<size_t>& parent = parent_[level];
+  std::fill(x, x + dim_ * cells_[level + 1], 0.0);
+  for (size_t c = 0; c < parent.size(); ++c) {
+    for (size_t a = 0; a < dim_; ++a) {
+      x[dim_*parent[c] + a] += y[dim_*c + a];
+    }
+  }
+}
+
+void Multigrid::complement(const size_t level, const double* r, double* out) const
+{
+  std::vector<double> coarse(dim_ * cells_[level + 1]);
+  coarsen(level, r, coarse.data());
+  const std::vector<double>& coarse_weight = weight_[level + 1];
+  for (size_t i = 0; i < coarse.size(); ++i) {
+    coarse[i] = coarse_weight[i] > 0 ? coarse[i] / coarse_weight[i] : 0;
+  }
+  const std::vector<size_t>& parent = parent_[level];
+  const std::vector<double>& weight = weight_[level];
+  for (size_t c = 0; c < parent.size(); ++c) {
+    for (size_t a = 0; a < dim_; ++a) {
+      const size_t i = dim_*c + a;
+      out[i] = (weight[i] > 0 ? r[i] / weight[i] : 0) - coarse[dim_*parent[c] + a];
+    }
+  }
+}
+
+void Multigrid::smooth(const size_t level, const double* r, double* e) const
+{
+  const size_t n = dim_ * cells_[level];
+  std::vector<double> step(n);
+  complement(level, r, step.data());
+  for (size_t i = 0; i < n; ++i) {
+    e[i] += omega_[level] * step[i];
+  }
+}
+
+void Multigrid::cycle(const size_t level, const double* r, double* e) const
+{
+  if (level + 1 == levels()) {
+    coarsest_solve(r, e);
+    return;
+  }
+  const size_t n = dim_ * cells_[level];
+  std::fill(e, e + n, 0.0);
+  smooth(level, r, e);
+
+  // the residual's coarse component, solved for on the next level
+  std::vector<double> t(n);
+  normal(level, e, t.data());
+  for (size_t i = 0; i < n; ++i) {
+    t[i] = r[i] - t[i];
+  }
+  std::vector<double> rc(dim_ * cells_[level + 1]);
+  std::vector<double> ec(rc.size());
+  coarsen(level, t.data(), rc.data());
+  cycle(level + 1, rc.data(), ec.data());
+  const std::vector<size_t>& parent = parent_[level];
+  for (size_t c = 0; c < parent.size(); ++c) {
+    for (size_t a = 0; a < dim_; ++a) {
+      e[dim_*c + a] += ec[dim_*parent[c] + a];
+    }
+  }
+
+  // the smoothing again, after the correction: the V-cycle is symmetric
+  normal(level, e, t.data());
+  for (size_t i = 0; i < n; ++i) {
+    t[i] = r[i] - t[i];
+  }
+  smooth(level, t.data(), e);
+}
+
+void Multigrid::coarsest_solve(const double* r, double* e) const
+{
+  const size_t n = factor_.n_rows;
+  // factor^T y = r, then factor e = y: armadillo's (LAPACK's) triangular solves
+  const arma::mat y = arma::solve(arma::trimatl(factor_.t()), arma::mat(r, n, 1));
+  const arma::mat x = arma::solve(arma::trimatu(factor_), y);
+  std::copy(x.memptr(), x.memptr() + n, e);
+}
+
+} /* namespace details */
+} /* namespace cm */
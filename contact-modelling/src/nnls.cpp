@@ -0,0 +1,248 @@
+#include "cm/details/nnls.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+
+NonnegativeLeastSquares::NonnegativeLeastSquares(
+  std::shared_ptr<const LinearOperator> a,
+  const size_t num_threads
+)
+:
+  a_(std::move(a))
+{
+  if (!a_) {
+    throw std::runtime_error("NonnegativeLeastSquares: no matrix");
+  }
+  const auto dense = std::dynamic_pointer_cast<const DenseOperator>(a_);
+  if (dense) {
+    gram_ = dense->matrix().t() * dense->matrix();
+    return;
+  }
+  const size_t n = a_->n_cols();
+  gram_.set_size(n, n);
+  parallel_for_blocks(n, num_threads, 0, [&](const size_t j_begin, const size_t j_end) {
+    std::vector<double> e(n, 0.0);
+    std::vector<double> column(a_->n_rows());
+    for (size_t j = j_begin; j < j_end; ++j) {
+      e[j] = 1;
+      a_->apply(e.data(), column.data());
+      e[j] = 0;
+      a_->apply_transpose(column.data(), gram_.colptr(j));
+    }
+  });
+}
+
+size_t NonnegativeLeastSquares::solve(
+  const double* b,
+  NnlsState& state,
+  const double tolerance
+) const
+{
+  const size_t n = n_cols();
+  if (state.x.size() != n || state.r.n_rows != n || state.r.n_cols != n) {
+    state.x.assign(n, 0.0);
+    state.passive.clear();
+    state.r.set_size(n, n);
+  }
+  std::vector<double> atb(n);
+  a_->apply_transpose(b, atb.data());
+  double largest = 0;
+  for (const double v : atb) {
+    largest = std::max(largest, std::fabs(v));
+  }
+  const double threshold = tolerance * largest;
+
+  std::vector<double>& x = state.x;
+  std::vector<size_t>& passive = state.passive;
+  std::vector<char> is_passive(n, 0);
+  for (const size_t i : passive) {
+    is_passive[i] = 1;
+  }
+  // left out for depending on the passive set's columns, or for not becoming positive once added;
+  // only as long as the passive set stays as it is
+  std::vector<char> rejected(n, 0);
+  std::vector<double> z;
+  std::vector<double> w(n);
+  // Lawson and Hanson terminate, but not necessarily in finite precision
+  const size_t max_changes = 3 * n;
+  size_t changes = 0;
+  // the first time round, the previous frame's passive set is made feasible for this b
+  for (bool warm = true; ; warm = false) {
+    if (!warm) {
+      // the active variable with the steepest descent of ||a x - b||^2 joins the passive set
+      w = atb;
+      for (const size_t i : passive) {
+        const double* g = gram_.colptr(i);
+        const double x_i = x[i];
+        for (size_t j = 0; j < n; ++j) {
+          w[j] -= g[j] * x_i;
+        }
+      }
+      size_t best = n;
+      double best_w = threshold;
+      for (size_t j = 0; j < n; ++j) {
+        if (!is_passive[j] && !rejected[j] && w[j] > best_w) {
+          best = j;
+          best_w = w[j];
+        }
+      }
+      if (best == n) {
+        break;
+      }
+      if (!add(best, state)) {
+        rejected[best] = 1;
+        continue;
+      }
+      solve_passive(state, atb, z);
+      if (!(z.back() > 0)) {
+        remove(passive.size() - 1, state);
+        rejected[best] = 1;
+        continue;
+      }
+      is_passive[best] = 1;
+      std::fill(rejected.begin(), rejected.end(), 0);
+      ++changes;
+    } else {
+      solve_passive(state, atb, z);
+    }
+
+    // move towards the unconstrained solution on the passive set, as far as x stays feasible;
+    // the variables reaching 0 become active
+    for (;;) {
+      double alpha = 1;
+      size_t limiting = passive.size();
+      for (size_t q = 0; q < passive.size(); ++q) {
+        if (z[q] <= 0) {
+          const double x_i = x[passive[q]];
+          const double a = x_i / (x_i - z[q]);
+          if (a < alpha) {
+            alpha = a;
+            limiting = q;
+          }
+        }
+      }
+      if (limiting == passive.size()) {
+        break;
+      }
+      for (size_t q = 0; q < passive.size(); ++q) {
+        double& x_i = x[passive[q]];
+        x_i += alpha * (z[q] - x_i);
+      }
+      x[passive[limiting]] = 0;
+      for (size_t q = passive.size(); q-- > 0;) {
+        const size_t i = passive[q];
+        if (x[i] <= 0) {
+          x[i] = 0;
+          is_passive[i] = 0;
+          remove(q, state);
+          std::fill(rejected.begin(), rejected.end(), 0);
+          ++changes;
+        }
+      }
+      solve_passive(state, atb, z);
+    }
+    for (size_t q = 0; q < passive.size(); ++q) {
+      x[passive[q]] = z[q];
+    }
+
+    if (changes > max_changes) {
+      LOG(INFO) << "NonnegativeLeastSquares: gave up after " << changes
+        << " changes of the passive set";
+      break;
+    }
+  }
+  return changes;
+}
+
+bool NonnegativeLeastSquares::add(const size_t j, NnlsState& state) const
+{
+  const std::vector<size_t>& passive = state.passive;
+  const size_t k = passive.size();
+  arma::mat& r = state.r;
+  // r^T c = (a^T a)(passive, j), then the new diagonal element
+  double* c = r.colptr(k);
+  double sum = 0;
+  for (size_t i = 0; i < k; ++i) {
+    const double* r_i = r.colptr(i);
+    double s = gram_(passive[i], j);
+    for (size_t l = 0; l < i; ++l) {
+      s -= r_i[l] * c[l];
+    }
+    c[i] = s / r_i[i];
+    sum += c[i] * c[i];
+  }
+  const double d = gram_(j, j) - sum;
+  if (!(d > 1e-12 * gram_(j, j))) {
+    return false;
+  }
+  c[k] = std::sqrt(d);
+  state.passive.push_back(j);
+  return true;
+}
+
+void NonnegativeLeastSquares::remove(const size_t q, NnlsState& state) const
+{
+  const size_t k = state.passive.size();
+  arma::mat& r = state.r;
+  // without column q, r is upper Hessenberg from q on: rotate rows j and j+1 to clear the
+  // subdiagonal
+  for (size_t j = q; j + 1 < k; ++j) {
+    std::copy(r.colptr(j + 1), r.colptr(j + 1) + j + 2, r.colptr(j));
+  }
+  for (size_t j = q; j + 1 < k; ++j) {
+    const double a = r(j, j);
+    const double b = r(j + 1, j);
+    const double h = std::hypot(a, b);
+    const double c = a / h;
+    const double s = b / h;
+    r(j, j) = h;
+    r(j + 1, j) = 0;
+    for (size_t l = j + 1; l + 1 < k; ++l) {
+      const double t1 = r(j, l);
+      const double t2 = r(j + 1, l);
+      r(j, l) = c * t1 + s * t2;
+      r(j + 1, l) = c * t2 - s * t1;
+    }
+  }
+  state.passive.erase(state.passive.begin() + q);
+}
+
+void NonnegativeLeastSquares::solve_passive(
+  const NnlsState& state,
+  const std::vector<double>& atb,
+  std::vector<double>& z
+) const
+{
+  const std::vector<size_t>& passive = state.passive;
+  const size_t k = passive.size();
+  const arma::mat& r = state.r;
+  z.resize(k);
+  // r^T y = atb(passive), then r z = y
+  for (size_t i = 0; i < k; ++i) {
+    const double* r_i = r.colptr(i);
+    double s = atb[passive[i]];
+    for (size_t l = 0; l < i; ++l) {
+      s -= r_i[l] * z[l];
+    }
+    z[i] = s / r_i[i];
+  }
+  for (size_t i = k; i-- > 0;) {
+    double s = z[i];
+    for (size_t l = i + 1; l < k; ++l) {
+      s -= r(i, l) * z[l];
+    }
+    z[i] = s / r(i, i);
+  }
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,250 @@
+#include "cm/details/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   The blocks of a parallel_for_blocks() call, handed out to whichever thread asks first
+ */
+class Blocks {
+public:
+  Blocks(
+    const size_t n,
+    const size_t num_threads,
+    const size_t block_size,
+    const std::function<void(size_t, size_t)>& body
+  )
+  :
+    n_(n),
+    // a few blocks per thread, so that a slow block doesn't hold up everyone else
+    block_((block_size > 0) ? block_size : std::max<size_t>(1, n / (4 * num_threads))),
+    num_blocks_((n + block_ - 1) / block_),
+    body_(body),
+    next_block_(0)
+  {
+  }
+
+  size_t num_blocks() const { return num_blocks_; }
+
+  /**
+   * \brief   Run blocks until there are none left
+   */
+  void work()
+  {
+    for (;;) {
+      const size_t ib = next_block_++;
+      if (ib >= num_blocks_) {
+        return;
+      }
+      try {
+        const size_t begin = ib * block_;
+        body_(begin, std::min(n_, begin + block_));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+        // make all the workers run out of blocks
+        next_block_ = num_blocks_;
+        return;
+      }
+    }
+  }
+
+  /**
+   * \brief   Rethrow the first exception of a body, if any; once all the threads are done
+   */
+  void rethrow() const
+  {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+private:
+  const size_t n_;
+  const size_t block_;
+  const size_t num_blocks_;
+  const std::function<void(size_t, size_t)>& body_;
+  std::atomic<size_t> next_block_;
+  std::exception_ptr error_;
+  std::mutex error_mutex_;
+};
+
+} /* anonymous namespace */
+
+/**
+ * \brief   What the workers share with the calling thread
+ */
+struct WorkerPool::State {
+  /**
+   * \brief   One parallel_for_blocks() at a time
+   */
+  std::mutex call;
+  /**
+   * \brief   Guards everything below
+   */
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::vector<std::thread> workers;
+  /**
+   * \brief   The current call's blocks, if workers may still join it
+   */
+  Blocks* blocks = nullptr;
+  /**
+   * \brief   Counts the calls, for the workers to tell a new one from the one they've done
+   */
+  size_t generation = 0;
+  /**
+   * \brief   Workers running the current call's blocks
+   */
+  size_t busy = 0;
+  bool stop = false;
+
+  void work()
+  {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [&]() { return stop || (blocks && generation != seen); });
+      if (stop) {
+        return;
+      }
+      seen = generation;
+      Blocks* const b = blocks;
+      ++busy;
+      lock.unlock();
+      current = this;
+      b->work();
+      current = nullptr;
+      lock.lock();
+      if (0 == --busy) {
+        done.notify_all();
+      }
+    }
+  }
+
+  /**
+   * \brief   The pool whose blocks this thread is running, if any
+   */
+  static thread_local const State* current;
+};
+
+thread_local const WorkerPool::State* WorkerPool::State::current = nullptr;
+
+WorkerPool::WorkerPool(const size_t num_threads)
+:
+  num_threads_(resolve_num_threads(num_threads)),
+  state_(new State)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stop = true;
+  }
+  state_->wake.notify_all();
+  for (auto& t : state_->workers) {
+    t.join();
+  }
+}
+
+size_t resolve_num_threads(const size_t requested)
+{
+  if (requested > 0) {
+    return requested;
+  }
+  const size_t hw = std::thread::hardware_concurrency();
+  return (hw > 0) ? hw : 1;
+}
+
+void parallel_for_blocks(
+  const size_t n,
+  const size_t num_threads,
+  const size_t block_size,
+  const std::function<void(size_t, size_t)>& body
+)
+{
+  if (n == 0) {
+    return;
+  }
+  const size_t threads_wanted = resolve_num_threads(num_threads);
+  Blocks blocks(n, threads_wanted, block_size, body);
+  const size_t threads = std::min(threads_wanted, blocks.num_blocks());
+
+  if (threads <= 1) {
+    body(0, n);
+    return;
+  }
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t i = 1; i < threads; ++i) {
+    pool.emplace_back([&]() { blocks.work(); });
+  }
+  blocks.work();
+  for (auto& t : pool) {
+    t.join();
+  }
+  blocks.rethrow();
+}
+
+void parallel_for_blocks(
+  const size_t n,
+  const WorkerPool& pool,
+  const size_t block_size,
+  const std::function<void(size_t, size_t)>& body
+)
+{
+  if (n == 0) {
+    return;
+  }
+  WorkerPool::State& state = *pool.state_;
+  Blocks blocks(n, pool.num_threads(), block_size, body);
+  const size_t threads = std::min(pool.num_threads(), blocks.num_blocks());
+
+  // a body calling back into its own pool would wait for itself
+  if (threads <= 1 || WorkerPool::State::current == &state) {
+    body(0, n);
+    return;
+  }
+
+  std::lock_guard<std::mutex> call(state.call);
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    while (state.workers.size() + 1 < threads) {
+      state.workers.emplace_back([&state]() { state.work(); });
+    }
+    state.blocks = &blocks;
+    ++state.generation;
+  }
+  state.wake.notify_all();
+  // a body may run another pool's blocks, from this pool's thread or another's
+  const WorkerPool::State* const outer = WorkerPool::State::current;
+  WorkerPool::State::current = &state;
+  blocks.work();
+  WorkerPool::State::current = outer;
+  {
+    // no worker joins once the blocks have run out; wait for those which have joined
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.blocks = nullptr;
+    state.done.wait(lock, [&]() { return 0 == state.busy; });
+  }
+  blocks.rethrow();
+}
+
+} /* namespace details */
+} /* namespace cm */
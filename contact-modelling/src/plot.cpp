@@ -3,6 +3,7 @@
 #include "cm/grid/grid.hpp"
 
 #include <stdexcept>
+#include <vector>
 
 namespace cm {
 
@@ -20,24 +21,31 @@ dumpForPlot(const Grid& m, std::ostream& s)
   // that sstream to s. It *should* be faster.
   // But listen to Donald Knuth.
 
+  // in the order the cells were constructed in, even if they have been reordered since
+  std::vector<size_t> at(m.num_cells());
+  const std::vector<size_t>& permutation = m.getPermutation();
+  for (size_t n = 0; n < at.size(); ++n) {
+    at[permutation.empty() ? n : permutation[n]] = n;
+  }
+
   // dump all xs
-  s << m.cell(0).x;
+  s << m.cell(at[0]).x;
   for (size_t n = 1; n < m.num_cells(); ++n) {
-    s << " " << m.cell(n).x;
+    s << " " << m.cell(at[n]).x;
   }
   s << "\n";
 
   // dump all ys
-  s << m.cell(0).y;
+  s << m.cell(at[0]).y;
   for (size_t n = 1; n < m.num_cells(); ++n) {
-    s << " " << m.cell(n).y;
+    s << " " << m.cell(at[n]).y;
   }
   s << "\n";
 
   for (size_t d = 0; d < m.dim(); ++d) {
-    s << m.getValue(0, d);
+    s << m.getValue(at[0], d);
     for (size_t n = 1; n < m.num_cells(); ++n) {
-      s << " " << m.getValue(n, d);
+      s << " " << m.getValue(at[n], d);
     }
     s << "\n";
   }
@@ -0,0 +1,74 @@
+#include "cm/details/power_iteration.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "cm/details/linear_operator.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   The power iteration stops after that many iterations at most
+ */
+const size_t max_power_iterations = 1000;
+
+double dot(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+} /* anonymous namespace */
+
+double power_iteration(
+  const size_t n,
+  const std::function<void(const double*, double*)>& product,
+  const double tolerance
+)
+{
+  std::mt19937 generator(5489u);
+  std::normal_distribution<double> normal;
+  std::vector<double> v(n);
+  for (double& e : v) {
+    e = normal(generator);
+  }
+  std::vector<double> w(n);
+  double lambda = 0;
+  for (size_t i = 0; i < max_power_iterations; ++i) {
+    const double v_norm = std::sqrt(dot(v, v));
+    if (!(v_norm > 0)) {
+      return 0;
+    }
+    for (double& e : v) {
+      e /= v_norm;
+    }
+    product(v.data(), w.data());
+    // the Rayleigh quotient; for a symmetric matrix, its error shrinks twice as fast as v's
+    const double previous = lambda;
+    lambda = dot(v, w);
+    if (i > 0 && std::fabs(lambda - previous) <= tolerance * std::fabs(lambda)) {
+      break;
+    }
+    v.swap(w);
+  }
+  return lambda;
+}
+
+double largest_squared_singular_value(const LinearOperator& a, const double tolerance)
+{
+  std::vector<double> av(a.n_rows());
+  return power_iteration(a.n_cols(), [&](const double* v, double* w) {
+    a.apply(v, av.data());
+    a.apply_transpose(av.data(), w);
+  }, tolerance);
+}
+
+} /* namespace details */
+} /* namespace cm */
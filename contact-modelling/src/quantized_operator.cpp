@@ -0,0 +1,142 @@
+#include "cm/details/quantized_operator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "cm/details/math.hpp"
+#include "cm/details/parallel.hpp"
+
+namespace cm {
+namespace details {
+
+namespace impl {
+
+/**
+ * \brief   y[0..n) += s * q[0..n)
+ */
+CM_VECTOR_CLONES
+void quantized_axpy(const int16_t* __restrict q, const double s, const size_t n,
+  double* __restrict y)
+{
+  for (size_t i = 0; i < n; ++i) {
+    y[i] += s * q[i];
+  }
+}
+
+/**
+ * \brief   Sum of q[i]*y[i] over [0, n), in 8 interleaved partial sums (which vectorise without
+ *          reordering the additions)
+ */
+CM_VECTOR_CLONES
+double quantized_dot(const int16_t* __restrict q, const double* __restrict y, const size_t n)
+{
+  const size_t lanes = 8;
+  double sums[lanes] = {};
+  size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    for (size_t l = 0; l < lanes; ++l) {
+      sums[l] += q[i + l] * y[i + l];
+    }
+  }
+  double ret = 0;
+  for (; i < n; ++i) {
+    ret += q[i] * y[i];
+  }
+  for (size_t l = 0; l < lanes; ++l) {
+    ret += sums[l];
+  }
+  return ret;
+}
+
+} /* namespace impl */
+
+const size_t QuantizedOperator::block_rows;
+
+QuantizedOperator::QuantizedOperator(const arma::mat& m, const size_t num_threads)
+:
+  n_rows_(m.n_rows),
+  n_cols_(m.n_cols),
+  n_blocks_((m.n_rows + block_rows - 1) / block_rows),
+  q_(m.n_elem),
+  scale_(n_blocks_ * m.n_cols),
+  pool_(std::make_shared<WorkerPool>(num_threads))
+{
+  double error = 0;
+  double norm = 0;
+  for (size_t j = 0; j < n_cols_; ++j) {
+    for (size_t b = 0; b < n_blocks_; ++b) {
+      const size_t r_begin = b * block_rows;
+      const size_t n = std::min(block_rows, n_rows_ - r_begin);
+      const double* col = m.colptr(j) + r_begin;
+      double largest = 0;
+      for (size_t i = 0; i < n; ++i) {
+        largest = std::max(largest, std::fabs(col[i]));
+      }
+      scale_[j*n_blocks_ + b] = float(largest / 32767);
+      const double scale = scale_[j*n_blocks_ + b];
+      const double inv_scale = (scale > 0) ? 1 / scale : 0;
+      int16_t* q = q_.data() + j*n_rows_ + r_begin;
+      for (size_t i = 0; i < n; ++i) {
+        q[i] = int16_t(std::lround(col[i] * inv_scale));
+        const double diff = scale * q[i] - col[i];
+        error += diff * diff;
+        norm += col[i] * col[i];
+      }
+    }
+  }
+  relative_error_ = (norm > 0) ? std::sqrt(error / norm) : 0;
+}
+
+size_t QuantizedOperator::impl_n_rows() const
+{
+  return n_rows_;
+}
+
+size_t QuantizedOperator::impl_n_cols() const
+{
+  return n_cols_;
+}
+
+void QuantizedOperator::impl_apply(const double* x, double* y) const
+{
+  // a tile of the result stays in L1 while the columns stream past it
+  const size_t tile = 8;
+  parallel_for_blocks(n_blocks_, *pool_, 0, [&](const size_t b_begin, const size_t b_end) {
+    std::vector<double> acc(tile * block_rows);
+    for (size_t t0 = b_begin; t0 < b_end; t0 += tile) {
+      const size_t r_begin = t0 * block_rows;
+      const size_t r_end = std::min(n_rows_, std::min(b_end, t0 + tile) * block_rows);
+      std::fill(acc.begin(), acc.end(), 0.0);
+      for (size_t j = 0; j < n_cols_; ++j) {
+        if (x[j] == 0) {
+          continue;
+        }
+        const float* scale = &scale_[j*n_blocks_];
+        for (size_t r = r_begin; r < r_end; r += block_rows) {
+          impl::quantized_axpy(q_.data() + j*n_rows_ + r, scale[r / block_rows] * x[j],
+            std::min(block_rows, r_end - r), acc.data() + (r - r_begin));
+        }
+      }
+      std::copy(acc.begin(), acc.begin() + (r_end - r_begin), y + r_begin);
+    }
+  });
+}
+
+void QuantizedOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  parallel_for_blocks(n_cols_, *pool_, 0, [&](const size_t c_begin, const size_t c_end) {
+    for (size_t j = c_begin; j < c_end; ++j) {
+      const float* scale = &scale_[j*n_blocks_];
+      double sum = 0;
+      for (size_t b = 0; b < n_blocks_; ++b) {
+        const size_t r = b * block_rows;
+        const size_t n = std::min(block_rows, n_rows_ - r);
+        sum += scale[b] * impl::quantized_dot(q_.data() + j*n_rows_ + r, y + r, n);
+      }
+      x[j] = sum;
+    }
+  });
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,234 @@
+#include "cm/details/region_decomposition.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+#include "cm/log/log.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   The region of the nearest position, for every cell
+ */
+std::vector<size_t> nearest_region(
+  const CellCoordinates& cells,
+  const std::vector<std::vector<GridCell>>& regions
+)
+{
+  std::vector<size_t> ret(cells.size(), 0);
+  for (size_t c = 0; c < cells.size(); ++c) {
+    double nearest = std::numeric_limits<double>::infinity();
+    for (size_t r = 0; r < regions.size(); ++r) {
+      for (const GridCell& position : regions[r]) {
+        const double dx = cells.x[c] - position.x;
+        const double dy = cells.y[c] - position.y;
+        const double d2 = dx*dx + dy*dy;
+        if (d2 < nearest) {
+          nearest = d2;
+          ret[c] = r;
+        }
+      }
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief   The cells of a region and its halo, increasing, along with every one's distance to the
+ *          nearest of the region's own (0 for those)
+ */
+std::vector<std::pair<size_t, double>> region_cells(
+  const CellCoordinates& cells,
+  const std::vector<size_t>& region,
+  const size_t r,
+  const double overlap
+)
+{
+  std::vector<size_t> own;
+  double x0 = std::numeric_limits<double>::infinity();
+  double y0 = x0;
+  double x1 = -x0;
+  double y1 = -x0;
+  for (size_t c = 0; c < cells.size(); ++c) {
+    if (region[c] == r) {
+      own.push_back(c);
+      x0 = std::min(x0, cells.x[c]);
+      y0 = std::min(y0, cells.y[c]);
+      x1 = std::max(x1, cells.x[c]);
+      y1 = std::max(y1, cells.y[c]);
+    }
+  }
+  std::vector<std::pair<size_t, double>> ret;
+  for (size_t c = 0; c < cells.size(); ++c) {
+    if (region[c] == r) {
+      ret.push_back(std::make_pair(c, 0.0));
+      continue;
+    }
+    if (!(overlap > 0) || cells.x[c] < x0 - overlap || cells.x[c] > x1 + overlap
+      || cells.y[c] < y0 - overlap || cells.y[c] > y1 + overlap) {
+      continue;
+    }
+    double nearest = std::numeric_limits<double>::infinity();
+    for (const size_t o : own) {
+      const double dx = cells.x[c] - cells.x[o];
+      const double dy = cells.y[c] - cells.y[o];
+      nearest = std::min(nearest, dx*dx + dy*dy);
+    }
+    if (nearest <= overlap * overlap) {
+      ret.push_back(std::make_pair(c, std::sqrt(nearest)));
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief   A grid of some of g's cells, increasing, without values
+ */
+std::unique_ptr<Grid> sub_grid(const Grid& g, const std::vector<size_t>& cells)
+{
+  std::unique_ptr<Grid> ret(Grid::fromEmpty(g.dim(), g.getCellShape()));
+  ret->clone_structure(g);
+  std::vector<size_t> others;
+  size_t k = 0;
+  for (size_t c = 0; c < g.num_cells(); ++c) {
+    if (k < cells.size() && cells[k] == c) {
+      ++k;
+    } else {
+      others.push_back(c);
+    }
+  }
+  ret->erase(others);
+  return ret;
+}
+
+} /* anonymous namespace */
+
+RegionDecomposition::RegionDecomposition(
+  const Grid& disps,
+  const Grid& tractions,
+  const std::vector<std::vector<GridCell>>& regions,
+  const double overlap
+)
+:
+  regions_(regions),
+  overlap_(overlap),
+  disps_dim_(disps.dim()),
+  tractions_dim_(tractions.dim()),
+  num_disps_(disps.num_cells()),
+  total_weights_(tractions.num_cells(), 0.0)
+{
+  if (overlap < 0) {
+    throw std::runtime_error(sb() << "RegionDecomposition: a negative overlap, " << overlap);
+  }
+  const CellCoordinates disps_cells(disps);
+  const CellCoordinates tractions_cells(tractions);
+  const std::vector<size_t> disps_region = nearest_region(disps_cells, regions);
+  const std::vector<size_t> tractions_region = nearest_region(tractions_cells, regions);
+  for (size_t r = 0; r < regions.size(); ++r) {
+    const auto d = region_cells(disps_cells, disps_region, r, overlap);
+    const auto t = region_cells(tractions_cells, tractions_region, r, overlap);
+    const auto own = [](const std::pair<size_t, double>& cell) { return 0 == cell.second; };
+    if (std::none_of(d.begin(), d.end(), own) || std::none_of(t.begin(), t.end(), own)) {
+      LOG(DEBUG) << "RegionDecomposition: region " << r << " has no cells of its own, left out.";
+      continue;
+    }
+    part_type part;
+    for (const auto& cell : d) {
+      part.disps_cells.push_back(cell.first);
+    }
+    for (const auto& cell : t) {
+      // the halo's furthest cells, with a weight of 0, are only needed for the displacements
+      const double weight = overlap > 0 ? 1 - cell.second / overlap : 1;
+      if (weight > 0) {
+        part.tractions_cells.push_back(cell.first);
+        part.weights.push_back(weight);
+        total_weights_[cell.first] += weight;
+      }
+    }
+    part.disps = sub_grid(disps, part.disps_cells);
+    part.tractions = sub_grid(tractions, part.tractions_cells);
+    parts_.push_back(std::move(part));
+  }
+  LOG(DEBUG) << "RegionDecomposition: " << parts_.size() << " regions";
+}
+
+bool RegionDecomposition::matches(
+  const std::vector<std::vector<GridCell>>& regions,
+  const double overlap
+) const
+{
+  if (overlap != overlap_ || regions.size() != regions_.size()) {
+    return false;
+  }
+  for (size_t r = 0; r < regions.size(); ++r) {
+    if (regions[r].size() != regions_[r].size() || !std::equal(regions[r].begin(),
+        regions[r].end(), regions_[r].begin(),
+        [](const GridCell& a, const GridCell& b) { return a.x == b.x && a.y == b.y; })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<double> RegionDecomposition::solve(
+  const std::vector<double>& d,
+  const WorkerPool& pool,
+  const std::function<void(size_t, const Grid&, Grid&)>& solve_region
+) const
+{
+  if (d.size() != disps_dim_ * num_disps_) {
+    throw std::runtime_error(sb() << "RegionDecomposition::solve: " << d.size()
+      << " displacements; expected " << disps_dim_ * num_disps_);
+  }
+  std::vector<std::vector<double>> solved(parts_.size());
+  parallel_for_blocks(parts_.size(), pool, 1, [&](const size_t begin, const size_t end) {
+    for (size_t r = begin; r < end; ++r) {
+      const part_type& part = parts_[r];
+      std::unique_ptr<Grid> region_disps(Grid::fromEmpty(disps_dim_, part.disps->getCellShape()));
+      region_disps->clone_structure(*part.disps);
+      std::vector<double> values(disps_dim_ * part.disps_cells.size());
+      for (size_t k = 0; k < part.disps_cells.size(); ++k) {
+        for (size_t a = 0; a < disps_dim_; ++a) {
+          values[disps_dim_*k + a] = d[disps_dim_*part.disps_cells[k] + a];
+        }
+      }
+      region_disps->setRawValues(std::move(values));
+      std::unique_ptr<Grid> region_tractions(Grid::fromEmpty(tractions_dim_,
+        part.tractions->getCellShape()));
+      region_tractions->clone_structure(*part.tractions);
+      solve_region(r, *region_disps, *region_tractions);
+      solved[r] = region_tractions->getRawValues();
+    }
+  });
+
+  std::vector<double> ret(tractions_dim_ * total_weights_.size(), 0.0);
+  for (size_t r = 0; r < parts_.size(); ++r) {
+    const part_type& part = parts_[r];
+    for (size_t k = 0; k < part.tractions_cells.size(); ++k) {
+      const size_t c = part.tractions_cells[k];
+      for (size_t a = 0; a < tractions_dim_; ++a) {
+        ret[tractions_dim_*c + a] += part.weights[k] * solved[r][tractions_dim_*k + a];
+      }
+    }
+  }
+  for (size_t c = 0; c < total_weights_.size(); ++c) {
+    for (size_t a = 0; a < tractions_dim_; ++a) {
+      if (total_weights_[c] > 0) {
+        ret[tractions_dim_*c + a] /= total_weights_[c];
+      }
+    }
+  }
+  return ret;
+}
+
+} /* namespace details */
+} /* namespace cm */
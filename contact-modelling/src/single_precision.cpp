@@ -0,0 +1,28 @@
+#include "cm/details/single_precision.hpp"
+
+#include <stdexcept>
+
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+arma::fmat to_single_precision(arma::mat& m)
+{
+  arma::fmat ret = arma::conv_to<arma::fmat>::from(m);
+  m.reset();
+  return ret;
+}
+
+std::vector<double> multiply_single(const arma::fmat& m, const std::vector<double>& x)
+{
+  if (x.size() != m.n_cols) {
+    throw std::runtime_error(sb() << "multiply_single: the operand has " << x.size()
+      << " elements; expected " << m.n_cols);
+  }
+  const arma::fvec y = m * arma::conv_to<arma::fvec>::from(x);
+  return std::vector<double>(y.memptr(), y.memptr() + y.n_elem);
+}
+
+} /* namespace details */
+} /* namespace cm */
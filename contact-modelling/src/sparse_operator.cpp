@@ -0,0 +1,266 @@
+#include "cm/details/sparse_operator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+const size_t SparseOperator::transpose_chunk;
+
+SparseOperator::SparseOperator(
+  const size_t n_src,
+  const size_t src_dim,
+  const size_t dst_dim,
+  std::vector<size_t> row_begin,
+  std::vector<size_t> cols,
+  std::vector<double> values,
+  const size_t num_threads
+)
+:
+  n_src_(n_src),
+  src_dim_(src_dim),
+  dst_dim_(dst_dim),
+  row_begin_(std::move(row_begin)),
+  cols_(std::move(cols)),
+  values_(std::move(values)),
+  pool_(std::make_shared<WorkerPool>(num_threads))
+{
+  if (row_begin_.empty() || row_begin_.back() != cols_.size()
+    || values_.size() != cols_.size() * src_dim_ * dst_dim_) {
+    throw std::runtime_error(sb() << "SparseOperator: inconsistent sizes: " << row_begin_.size()
+      << " row offsets, " << cols_.size() << " blocks, " << values_.size() << " values");
+  }
+}
+
+void SparseOperator::compressed_columns(
+  std::vector<int>& col_begin,
+  std::vector<int>& row_ind,
+  std::vector<double>& values
+) const
+{
+  const size_t block = src_dim_ * dst_dim_;
+  col_begin.assign(n_cols() + 1, 0);
+  for (const size_t c : cols_) {
+    for (size_t b = 0; b < src_dim_; ++b) {
+      col_begin[src_dim_*c + b + 1] += dst_dim_;
+    }
+  }
+  for (size_t j = 0; j < n_cols(); ++j) {
+    col_begin[j + 1] += col_begin[j];
+  }
+  // filled in row order, so the rows come out sorted within every column
+  std::vector<int> next(col_begin.begin(), col_begin.end() - 1);
+  row_ind.resize(values_.size());
+  values.resize(values_.size());
+  for (size_t i = 0; i + 1 < row_begin_.size(); ++i) {
+    for (size_t a = 0; a < dst_dim_; ++a) {
+      for (size_t k = row_begin_[i]; k < row_begin_[i + 1]; ++k) {
+        for (size_t b = 0; b < src_dim_; ++b) {
+          const int pos = next[src_dim_*cols_[k] + b]++;
+          row_ind[pos] = dst_dim_*i + a;
+          values[pos] = values_[k*block + a*src_dim_ + b];
+        }
+      }
+    }
+  }
+}
+
+size_t SparseOperator::impl_n_rows() const
+{
+  return dst_dim_ * (row_begin_.size() - 1);
+}
+
+size_t SparseOperator::impl_n_cols() const
+{
+  return src_dim_ * n_src_;
+}
+
+void SparseOperator::impl_apply(const double* x, double* y) const
+{
+  const size_t block = src_dim_ * dst_dim_;
+  parallel_for_blocks(row_begin_.size() - 1, *pool_, 0,
+    [&](const size_t i_begin, const size_t i_end) {
+      for (size_t i = i_begin; i < i_end; ++i) {
+        for (size_t a = 0; a < dst_dim_; ++a) {
+          double sum = 0;
+          for (size_t k = row_begin_[i]; k < row_begin_[i + 1]; ++k) {
+            const double* v = &values_[k*block + a*src_dim_];
+            const double* xc = x + src_dim_*cols_[k];
+            for (size_t b = 0; b < src_dim_; ++b) {
+              sum += v[b] * xc[b];
+            }
+          }
+          y[dst_dim_*i + a] = sum;
+        }
+      }
+    }
+  );
+}
+
+void SparseOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  const size_t block = src_dim_ * dst_dim_;
+  const size_t n_dst = row_begin_.size() - 1;
+  const size_t n = n_cols();
+  // the contributions of dst cells [i_begin, i_end) added to out
+  const auto scatter = [&](const size_t i_begin, const size_t i_end, double* out) {
+    for (size_t i = i_begin; i < i_end; ++i) {
+      for (size_t k = row_begin_[i]; k < row_begin_[i + 1]; ++k) {
+        double* xc = out + src_dim_*cols_[k];
+        for (size_t a = 0; a < dst_dim_; ++a) {
+          const double* v = &values_[k*block + a*src_dim_];
+          const double y_a = y[dst_dim_*i + a];
+          for (size_t b = 0; b < src_dim_; ++b) {
+            xc[b] += v[b] * y_a;
+          }
+        }
+      }
+    }
+  };
+  std::fill(x, x + n, 0.0);
+  const size_t n_chunks = (n_dst + transpose_chunk - 1) / transpose_chunk;
+  if (n_chunks <= 1) {
+    scatter(0, n_dst, x);
+    return;
+  }
+  // fixed chunks of rows, whatever the number of threads, each into its own partial sums, which
+  // are then added up in the chunks' order
+  std::vector<double> partial(n_chunks * n, 0.0);
+  parallel_for_blocks(n_chunks, *pool_, 1, [&](const size_t c_begin, const size_t c_end) {
+    for (size_t c = c_begin; c < c_end; ++c) {
+      scatter(c * transpose_chunk, std::min(n_dst, (c + 1) * transpose_chunk), &partial[c * n]);
+    }
+  });
+  parallel_for_blocks(n, *pool_, 0, [&](const size_t j_begin, const size_t j_end) {
+    for (size_t c = 0; c < n_chunks; ++c) {
+      const double* p = &partial[c * n];
+      for (size_t j = j_begin; j < j_end; ++j) {
+        x[j] += p[j];
+      }
+    }
+  });
+}
+
+std::vector<double> SparseOperator::impl_column_norms() const
+{
+  const size_t block = src_dim_ * dst_dim_;
+  std::vector<double> ret(n_cols(), 0.0);
+  for (size_t k = 0; k < cols_.size(); ++k) {
+    for (size_t a = 0; a < dst_dim_; ++a) {
+      for (size_t b = 0; b < src_dim_; ++b) {
+        const double v = values_[k*block + a*src_dim_ + b];
+        ret[src_dim_*cols_[k] + b] += v * v;
+      }
+    }
+  }
+  for (double& r : ret) {
+    r = std::sqrt(r);
+  }
+  return ret;
+}
+
+std::unique_ptr<SparseOperator> cutoff_operator(
+  const CellCoordinates& src,
+  const CellCoordinates& dst,
+  const size_t src_dim,
+  const size_t dst_dim,
+  const HMatrixOperator::BlockFunction& coefficients,
+  const double radius,
+  const size_t num_threads
+)
+{
+  if (!(radius > 0)) {
+    throw std::runtime_error(sb() << "cutoff_operator: the radius must be positive; got "
+      << radius);
+  }
+
+  // buckets of src cells, at least radius wide (so that the neighbours of a cell are within the
+  // 3x3 buckets around its own), but no more of them than about the number of cells
+  std::vector<std::vector<size_t>> neighbours(dst.size());
+  if (src.size() > 0) {
+    const auto rx = std::minmax_element(src.x.begin(), src.x.end());
+    const auto ry = std::minmax_element(src.y.begin(), src.y.end());
+    const double x0 = *rx.first;
+    const double y0 = *ry.first;
+    const double width = std::max(radius,
+      std::max(*rx.second - x0, *ry.second - y0) / (std::sqrt(double(src.size())) + 1));
+    const size_t nx = size_t((*rx.second - x0) / width) + 1;
+    const size_t ny = size_t((*ry.second - y0) / width) + 1;
+    std::vector<size_t> bucket_begin(nx*ny + 1, 0);
+    std::vector<size_t> bucket(src.size());
+    for (size_t j = 0; j < src.size(); ++j) {
+      bucket[j] = size_t((src.x[j] - x0) / width) * ny + size_t((src.y[j] - y0) / width);
+      ++bucket_begin[bucket[j] + 1];
+    }
+    for (size_t b = 0; b < nx*ny; ++b) {
+      bucket_begin[b + 1] += bucket_begin[b];
+    }
+    std::vector<size_t> members(src.size());
+    std::vector<size_t> next(bucket_begin.begin(), bucket_begin.end() - 1);
+    for (size_t j = 0; j < src.size(); ++j) {
+      members[next[bucket[j]]++] = j;
+    }
+
+    const double r2 = radius * radius;
+    parallel_for_blocks(dst.size(), num_threads, 0, [&](const size_t i_begin, const size_t i_end) {
+      for (size_t i = i_begin; i < i_end; ++i) {
+        const double bx = std::floor((dst.x[i] - x0) / width);
+        const double by = std::floor((dst.y[i] - y0) / width);
+        for (double ix = std::max(0.0, bx - 1); ix <= std::min(nx - 1.0, bx + 1); ++ix) {
+          for (double iy = std::max(0.0, by - 1); iy <= std::min(ny - 1.0, by + 1); ++iy) {
+            const size_t b = size_t(ix) * ny + size_t(iy);
+            for (size_t m = bucket_begin[b]; m < bucket_begin[b + 1]; ++m) {
+              const size_t j = members[m];
+              const double dx = dst.x[i] - src.x[j];
+              const double dy = dst.y[i] - src.y[j];
+              if (dx*dx + dy*dy <= r2) {
+                neighbours[i].push_back(j);
+              }
+            }
+          }
+        }
+        std::sort(neighbours[i].begin(), neighbours[i].end());
+      }
+    });
+  }
+
+  std::vector<size_t> row_begin(dst.size() + 1, 0);
+  for (size_t i = 0; i < dst.size(); ++i) {
+    row_begin[i + 1] = row_begin[i] + neighbours[i].size();
+  }
+  std::vector<size_t> cols(row_begin.back());
+  const size_t block = src_dim * dst_dim;
+  std::vector<double> values(cols.size() * block);
+  parallel_for_blocks(dst.size(), num_threads, 0, [&](const size_t i_begin, const size_t i_end) {
+    arma::mat tmp;
+    for (size_t i = i_begin; i < i_end; ++i) {
+      const std::vector<size_t>& nb = neighbours[i];
+      if (nb.empty()) {
+        continue;
+      }
+      tmp.set_size(dst_dim, src_dim * nb.size());
+      coefficients(nb.data(), nb.size(), &i, 1, tmp);
+      std::copy(nb.begin(), nb.end(), cols.begin() + row_begin[i]);
+      for (size_t k = 0; k < nb.size(); ++k) {
+        for (size_t a = 0; a < dst_dim; ++a) {
+          for (size_t b = 0; b < src_dim; ++b) {
+            values[(row_begin[i] + k)*block + a*src_dim + b] = tmp(a, src_dim*k + b);
+          }
+        }
+      }
+    }
+  });
+
+  return std::unique_ptr<SparseOperator>(new SparseOperator(src.size(), src_dim, dst_dim,
+    std::move(row_begin), std::move(cols), std::move(values), num_threads));
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,143 @@
+#include "cm/details/symmetric_operator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "cm/grid/grid.hpp"
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+bool coincide(const Grid& a, const Grid& b)
+{
+  if (a.dim() != b.dim() || a.num_cells() != b.num_cells()
+      || a.getCellShape().dx() != b.getCellShape().dx()
+      || a.getCellShape().dy() != b.getCellShape().dy()
+      || a.getCellShape().isCircular() != b.getCellShape().isCircular()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.num_cells(); ++i) {
+    if (a.cell(i).x != b.cell(i).x || a.cell(i).y != b.cell(i).y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+arma::mat symmetric_inverse(const arma::mat& a, const double regularisation)
+{
+  if (a.n_rows != a.n_cols) {
+    throw std::runtime_error(sb() << "symmetric_inverse: the matrix is " << a.n_rows << "x"
+      << a.n_cols << ", not square");
+  }
+  if (!(regularisation >= 0)) {
+    throw std::runtime_error(sb() << "symmetric_inverse: invalid regularisation: "
+      << regularisation);
+  }
+  arma::colvec e;
+  arma::mat q;
+  if (!arma::eig_sym(e, q, a)) {
+    throw std::runtime_error("symmetric_inverse: the eigendecomposition failed");
+  }
+  double e_max = 0;
+  for (size_t i = 0; i < e.n_elem; ++i) {
+    e_max = std::max(e_max, std::fabs(e(i)));
+  }
+  const double tol = a.n_rows * e_max * std::numeric_limits<double>::epsilon();
+  const double lambda = regularisation * e_max * e_max;
+  // q * diag(filter(e)), then times q^T
+  arma::mat scaled = q;
+  for (size_t j = 0; j < e.n_elem; ++j) {
+    double f = 0;
+    if (regularisation > 0) {
+      f = e(j) / (e(j)*e(j) + lambda);
+    } else if (std::fabs(e(j)) > tol) {
+      f = 1 / e(j);
+    }
+    double* c = scaled.colptr(j);
+    for (size_t i = 0; i < scaled.n_rows; ++i) {
+      c[i] *= f;
+    }
+  }
+  return scaled * q.t();
+}
+
+const size_t SymmetricOperator::block_rows;
+
+SymmetricOperator::SymmetricOperator(const arma::mat& m, const size_t num_threads)
+:
+  n_(m.n_rows),
+  packed_(m.n_rows * (m.n_rows + 1) / 2),
+  pool_(std::make_shared<WorkerPool>(num_threads))
+{
+  if (m.n_rows != m.n_cols) {
+    throw std::runtime_error(sb() << "SymmetricOperator: the matrix is " << m.n_rows << "x"
+      << m.n_cols << ", not square");
+  }
+  for (size_t j = 0; j < n_; ++j) {
+    std::copy(m.colptr(j), m.colptr(j) + j + 1, packed_.begin() + j*(j+1)/2);
+  }
+}
+
+SymmetricOperator::SymmetricOperator(const SymmetricOperator& other, const double scale)
+:
+  n_(other.n_),
+  packed_(other.packed_),
+  pool_(other.pool_)
+{
+  for (double& v : packed_) {
+    v *= scale;
+  }
+}
+
+size_t SymmetricOperator::impl_n_rows() const
+{
+  return n_;
+}
+
+size_t SymmetricOperator::impl_n_cols() const
+{
+  return n_;
+}
+
+void SymmetricOperator::impl_apply(const double* x, double* y) const
+{
+  const size_t n_blocks = (n_ + block_rows - 1) / block_rows;
+  const double* p = packed_.data();
+  parallel_for_blocks(n_blocks, *pool_, 0, [&](const size_t b_begin, const size_t b_end) {
+    for (size_t b = b_begin; b < b_end; ++b) {
+      const size_t r0 = b * block_rows;
+      const size_t r1 = std::min(n_, r0 + block_rows);
+      // left of the block and its diagonal block's lower part: the rows' own columns
+      for (size_t i = r0; i < r1; ++i) {
+        const double* __restrict col = p + i*(i+1)/2;
+        double sum = 0;
+        for (size_t j = 0; j < i; ++j) {
+          sum += col[j] * x[j];
+        }
+        y[i] = sum;
+      }
+      // the diagonal and right of it: pieces of the columns, row r0 to the diagonal or r1
+      for (size_t j = r0; j < n_; ++j) {
+        const double* __restrict col = p + j*(j+1)/2;
+        const double x_j = x[j];
+        const size_t i_end = std::min(r1, j + 1);
+        for (size_t i = r0; i < i_end; ++i) {
+          y[i] += col[i] * x_j;
+        }
+      }
+    }
+  });
+}
+
+void SymmetricOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  impl_apply(y, x);
+}
+
+} /* namespace details */
+} /* namespace cm */
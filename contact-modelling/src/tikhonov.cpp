@@ -0,0 +1,64 @@
+#include "cm/details/tikhonov.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "cm/details/power_iteration.hpp"
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   The solution of r^T r x = b, r upper triangular (as given by arma::chol()), for every
+ *          column of b: two of armadillo's triangular solves (LAPACK's trtrs), over all the
+ *          columns at once.
+ */
+arma::mat cholesky_solve(const arma::mat& r, const arma::mat& b)
+{
+  const arma::mat y = arma::solve(arma::trimatl(r.t()), b);
+  return arma::solve(arma::trimatu(r), y);
+}
+
+} /* anonymous namespace */
+
+double largest_eigenvalue(const arma::mat& g)
+{
+  return power_iteration(g.n_rows, [&](const double* v, double* w) {
+    const arma::colvec gv = g * arma::colvec(arma::mat(v, g.n_rows, 1));
+    std::copy(gv.begin(), gv.end(), w);
+  });
+}
+
+arma::mat tikhonov_inverse(
+  const arma::mat& a,
+  const double regularisation
+)
+{
+  if (!(regularisation > 0)) {
+    throw std::runtime_error(sb() << "tikhonov_inverse: the regularisation must be positive; got "
+      << regularisation);
+  }
+  const bool wide = a.n_rows < a.n_cols;
+  arma::mat g = wide ? arma::mat(a * a.t()) : arma::mat(a.t() * a);
+  const double lambda = regularisation * largest_eigenvalue(g);
+  for (size_t i = 0; i < g.n_rows; ++i) {
+    g(i, i) += lambda;
+  }
+  arma::mat r;
+  if (!arma::chol(r, g)) {
+    throw std::runtime_error(sb() << "tikhonov_inverse: the Cholesky factorisation failed; is the "
+      << "regularisation (" << regularisation << ") too small?");
+  }
+  g.reset();
+  if (wide) {
+    // a^T (a a^T + lambda I)^-1 = ((a a^T + lambda I)^-1 a)^T
+    return cholesky_solve(r, a).t();
+  }
+  return cholesky_solve(r, a.t());
+}
+
+} /* namespace details */
+} /* namespace cm */
@@ -0,0 +1,207 @@
+#include "cm/details/truncated_svd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "cm/details/parallel.hpp"
+#include "cm/details/string.hpp"
+
+namespace cm {
+namespace details {
+
+namespace {
+
+/**
+ * \brief   Random vectors beyond the rank asked for: the range found is then accurate for the
+ *          rank largest singular values with overwhelming probability
+ */
+const size_t oversampling = 10;
+
+/**
+ * \brief   Number of extra applications of a a^T to the random vectors
+ */
+const size_t power_iterations = 2;
+
+/**
+ * \brief   Orthonormalise the columns of y in place (modified Gram-Schmidt, twice)
+ */
+void orthonormalise(arma::mat& y)
+{
+  for (size_t pass = 0; pass < 2; ++pass) {
+    for (size_t j = 0; j < y.n_cols; ++j) {
+      double* __restrict c = y.colptr(j);
+      for (size_t k = 0; k < j; ++k) {
+        const double* __restrict q = y.colptr(k);
+        double dot = 0;
+        for (size_t i = 0; i < y.n_rows; ++i) {
+          dot += q[i] * c[i];
+        }
+        for (size_t i = 0; i < y.n_rows; ++i) {
+          c[i] -= dot * q[i];
+        }
+      }
+      double norm = 0;
+      for (size_t i = 0; i < y.n_rows; ++i) {
+        norm += c[i] * c[i];
+      }
+      norm = std::sqrt(norm);
+      for (size_t i = 0; i < y.n_rows; ++i) {
+        c[i] = norm > 0 ? c[i] / norm : 0;
+      }
+    }
+  }
+}
+
+} /* anonymous namespace */
+
+TruncatedSVD truncated_svd(const arma::mat& a, const size_t rank)
+{
+  TruncatedSVD ret;
+  const size_t min_side = std::min(a.n_rows, a.n_cols);
+  if (rank == 0 || rank + oversampling >= min_side) {
+    if (!arma::svd_econ(ret.u, ret.s, ret.v, a)) {
+      throw std::runtime_error("truncated_svd: the decomposition failed");
+    }
+    ret.complete = true;
+    if (rank > 0 && rank < ret.s.n_elem) {
+      ret.u = ret.u.cols(0, rank - 1);
+      ret.s = ret.s.rows(0, rank - 1);
+      ret.v = ret.v.cols(0, rank - 1);
+      ret.complete = false;
+    }
+    return ret;
+  }
+
+  std::mt19937 generator(5489u);
+  std::normal_distribution<double> normal;
+  arma::mat q(a.n_cols, rank + oversampling);
+  for (size_t i = 0; i < q.n_elem; ++i) {
+    q(i) = normal(generator);
+  }
+  q = a * q;
+  orthonormalise(q);
+  for (size_t i = 0; i < power_iterations; ++i) {
+    arma::mat z = a.t() * q;
+    orthonormalise(z);
+    q = a * z;
+    orthonormalise(q);
+  }
+  const arma::mat b = q.t() * a;
+  arma::mat u_b;
+  if (!arma::svd_econ(u_b, ret.s, ret.v, b)) {
+    throw std::runtime_error("truncated_svd: the decomposition failed");
+  }
+  ret.u = q * u_b.cols(0, rank - 1);
+  ret.s = ret.s.rows(0, rank - 1);
+  ret.v = ret.v.cols(0, rank - 1);
+  ret.complete = false;
+  return ret;
+}
+
+SpectralInverseOperator::SpectralInverseOperator(
+  std::shared_ptr<const TruncatedSVD> svd,
+  const size_t rank,
+  const double regularisation,
+  const double scale,
+  const size_t num_threads
+)
+:
+  svd_(std::move(svd)),
+  scale_(scale),
+  pool_(std::make_shared<WorkerPool>(num_threads))
+{
+  if (!svd_->covers(rank)) {
+    throw std::runtime_error(sb() << "SpectralInverseOperator: rank " << rank << " asked for, "
+      << "but only " << svd_->s.n_elem << " singular values are stored");
+  }
+  if (!(regularisation >= 0)) {
+    throw std::runtime_error(sb() << "SpectralInverseOperator: invalid regularisation: "
+      << regularisation);
+  }
+  const size_t k = rank == 0 ? svd_->s.n_elem : std::min<size_t>(rank, svd_->s.n_elem);
+  const double s_max = svd_->s.n_elem > 0 ? scale_ * svd_->s(0) : 0;
+  const double tol = std::max(svd_->u.n_rows, svd_->v.n_rows) * s_max
+    * std::numeric_limits<double>::epsilon();
+  const double lambda = regularisation * s_max * s_max;
+  filter_.resize(k);
+  for (size_t j = 0; j < k; ++j) {
+    const double s = scale_ * svd_->s(j);
+    if (regularisation > 0) {
+      filter_[j] = s / (s*s + lambda);
+    } else {
+      filter_[j] = s > tol ? 1 / s : 0;
+    }
+  }
+}
+
+size_t SpectralInverseOperator::impl_n_rows() const
+{
+  return svd_->v.n_rows;
+}
+
+size_t SpectralInverseOperator::impl_n_cols() const
+{
+  return svd_->u.n_rows;
+}
+
+void SpectralInverseOperator::impl_apply(const double* x, double* y) const
+{
+  const arma::mat& u = svd_->u;
+  const arma::mat& v = svd_->v;
+  const size_t k = filter_.size();
+  std::vector<double> t(k);
+  parallel_for_blocks(k, *pool_, 0, [&](const size_t j_begin, const size_t j_end) {
+    for (size_t j = j_begin; j < j_end; ++j) {
+      const double* __restrict c = u.colptr(j);
+      double dot = 0;
+      for (size_t i = 0; i < u.n_rows; ++i) {
+        dot += c[i] * x[i];
+      }
+      t[j] = filter_[j] * dot;
+    }
+  });
+  parallel_for_blocks(v.n_rows, *pool_, 0, [&](const size_t r_begin, const size_t r_end) {
+    std::fill(y + r_begin, y + r_end, 0.0);
+    for (size_t j = 0; j < k; ++j) {
+      const double* __restrict c = v.colptr(j);
+      const double t_j = t[j];
+      for (size_t i = r_begin; i < r_end; ++i) {
+        y[i] += c[i] * t_j;
+      }
+    }
+  });
+}
+
+void SpectralInverseOperator::impl_apply_transpose(const double* y, double* x) const
+{
+  const arma::mat& u = svd_->u;
+  const arma::mat& v = svd_->v;
+  const size_t k = filter_.size();
+  std::vector<double> t(k);
+  parallel_for_blocks(k, *pool_, 0, [&](const size_t j_begin, const size_t j_end) {
+    for (size_t j = j_begin; j < j_end; ++j) {
+      const double* __restrict c = v.colptr(j);
+      double dot = 0;
+      for (size_t i = 0; i < v.n_rows; ++i) {
+        dot += c[i] * y[i];
+      }
+      t[j] = filter_[j] * dot;
+    }
+  });
+  parallel_for_blocks(u.n_rows, *pool_, 0, [&](const size_t r_begin, const size_t r_end) {
+    std::fill(x + r_begin, x + r_end, 0.0);
+    for (size_t j = 0; j < k; ++j) {
+      const double* __restrict c = u.colptr(j);
+      const double t_j = t[j];
+      for (size_t i = r_begin; i < r_end; ++i) {
+        x[i] += c[i] * t_j;
+      }
+    }
+  });
+}
+
+} /* namespace details */
+} /* namespace cm */
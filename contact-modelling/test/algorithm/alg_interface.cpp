@@ -100,4 +100,20 @@ BOOST_AUTO_TEST_CASE(test_run_correctly_through_base)
   );
 }
 
+BOOST_AUTO_TEST_CASE(test_recalibrate_defaults_to_offline)
+{
+  GridDerived input;
+  input.v = 1;
+  GridDerived output;
+  MyAlg::params_type params;
+  MyAlg a;
+
+  boost::any precomputed = 1.0;
+  boost::any recalibrated = a.recalibrate(input, output, params, precomputed, params);
+  BOOST_CHECK_EQUAL(
+    PRECOMPUTED_VAL,
+    boost::any_cast<double>(recalibrated)
+  );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "cm/details/cgls.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/sparse_operator.hpp"
+
+namespace {
+
+/**
+ * \brief   Columns of very different norms, as the preconditioner is meant for
+ */
+arma::mat badly_scaled(const size_t n_rows, const size_t n_cols)
+{
+  arma::mat a(n_rows, n_cols);
+  for (size_t j = 0; j < n_cols; ++j) {
+    for (size_t i = 0; i < n_rows; ++i) {
+      const double di = double(i) / n_rows - double(j) / n_cols;
+      a(i, j) = (1.0 + 9.0 * (j % 3)) * (1.0 / (1.0 + 20*std::fabs(di))
+        + 0.05 * std::sin(0.7*i + 1.1*j));
+    }
+  }
+  return a;
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__cgls)
+
+BOOST_AUTO_TEST_CASE(converges_to_least_squares)
+{
+  const arma::mat a = badly_scaled(40, 15);
+  std::vector<double> b(a.n_rows);
+  for (size_t i = 0; i < b.size(); ++i) {
+    b[i] = 1.0 + 0.3 * std::cos(0.4*i);
+  }
+  const arma::colvec at_b = a.t() * arma::colvec(b);
+  const std::vector<double> expected = arma::conv_to<std::vector<double>>::from(
+    arma::solve(arma::mat(a.t() * a), at_b));
+
+  const cm::details::DenseOperator op(a);
+  const std::vector<double> d = cm::details::column_scaling(op);
+  std::vector<double> x;
+  const size_t iterations = cm::details::cgls(op, d, b, x, 100, 1e-12);
+  BOOST_CHECK_LE(iterations, 3*a.n_cols);
+  CHECK_CLOSE_COLLECTION(x, expected, 1e-6);
+
+  // started from the solution, there's nothing left to do
+  BOOST_CHECK_EQUAL(cm::details::cgls(op, d, b, x, 100, 1e-6), 0u);
+
+  // a nearby right-hand side takes fewer iterations from the previous solution than from 0
+  std::vector<double> b_next(b);
+  for (size_t i = 0; i < b_next.size(); ++i) {
+    b_next[i] += 0.01 * std::sin(0.3*i);
+  }
+  std::vector<double> cold;
+  const size_t cold_iterations = cm::details::cgls(op, d, b_next, cold, 100, 1e-4);
+  const size_t warm_iterations = cm::details::cgls(op, d, b_next, x, 100, 1e-4);
+  BOOST_CHECK_LT(warm_iterations, cold_iterations);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_matches_dense)
+{
+  // a banded 3-valued matrix, as block-compressed rows
+  const size_t n = 12;
+  const size_t dim = 3;
+  std::vector<size_t> row_begin(1, 0);
+  std::vector<size_t> cols;
+  std::vector<double> values;
+  arma::mat dense(dim*n, dim*n);
+  dense.zeros();
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = (i > 0 ? i - 1 : 0); j < std::min(n, i + 2); ++j) {
+      cols.push_back(j);
+      for (size_t a = 0; a < dim; ++a) {
+        for (size_t b = 0; b < dim; ++b) {
+          const double v = (i == j && a == b ? 4.0 : 0.5) + 0.1 * std::sin(1.0*i + 2.0*a + 3.0*b);
+          values.push_back(v);
+          dense(dim*i + a, dim*j + b) = v;
+        }
+      }
+    }
+    row_begin.push_back(cols.size());
+  }
+  const cm::details::SparseOperator sparse(n, dim, dim, row_begin, cols, values);
+  const cm::details::DenseOperator op(dense);
+
+  const std::vector<double> sparse_norms = sparse.column_norms();
+  const std::vector<double> dense_norms = op.column_norms();
+  CHECK_CLOSE_COLLECTION(sparse_norms, dense_norms, 1e-10);
+
+  std::vector<double> rhs(dim*n);
+  for (size_t i = 0; i < rhs.size(); ++i) {
+    rhs[i] = std::cos(0.5*i);
+  }
+  std::vector<double> x_sparse, x_dense;
+  cm::details::cgls(sparse, cm::details::column_scaling(sparse), rhs, x_sparse, 200, 1e-12);
+  cm::details::cgls(op, cm::details::column_scaling(op), rhs, x_dense, 200, 1e-12);
+  CHECK_CLOSE_COLLECTION(x_sparse, x_dense, 1e-6);
+  const std::vector<double> reproduced = op.apply(x_dense);
+  CHECK_CLOSE_COLLECTION(reproduced, rhs, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(rejects_wrong_sizes)
+{
+  arma::mat a(4, 3);
+  a.fill(1.0);
+  const cm::details::DenseOperator op(a);
+  std::vector<double> x;
+  BOOST_CHECK_THROW(cm::details::cgls(op, std::vector<double>(3, 1.0),
+    std::vector<double>(3, 1.0), x, 10, 1e-6), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
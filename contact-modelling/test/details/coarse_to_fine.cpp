@@ -0,0 +1,115 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/coarse_to_fine.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/power_iteration.hpp"
+#include "cm/grid/grid.hpp"
+
+namespace {
+
+/**
+ * \brief   The centres of the cells of the given pitch filling a square of side length
+ */
+cm::details::CellCoordinates lattice(const double length, const double pitch)
+{
+  const std::unique_ptr<const cm::Grid> g(cm::Grid::fromFill(1, cm::Square(pitch), 0, 0, length,
+    length));
+  return cm::details::CellCoordinates(*g);
+}
+
+/**
+ * \brief   A model smoothing the values of cells of the given area, decaying as 1/r as the models
+ *          do, at the points of the given coordinates
+ */
+arma::mat smoothing(
+  const cm::details::CellCoordinates& points,
+  const cm::details::CellCoordinates& cells,
+  const double area
+)
+{
+  arma::mat a(points.size(), cells.size());
+  for (size_t j = 0; j < cells.size(); ++j) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      const double dx = points.x[i] - cells.x[j];
+      const double dy = points.y[i] - cells.y[j];
+      a(i, j) = area / (0.5 * std::sqrt(area) + std::sqrt(dx*dx + dy*dy));
+    }
+  }
+  return a;
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__coarse_to_fine)
+
+BOOST_AUTO_TEST_CASE(whole_window_is_tikhonov)
+{
+  const cm::details::CellCoordinates fine = lattice(8, 1);
+  const cm::details::CellCoordinates coarse = lattice(8, 4);
+  const arma::mat a = smoothing(fine, fine, 1);
+  const auto forward = std::make_shared<const cm::details::DenseOperator>(a);
+  const arma::mat coarse_inverse = arma::pinv(smoothing(fine, coarse, 16));
+  std::vector<double> d(a.n_rows);
+  for (size_t i = 0; i < d.size(); ++i) {
+    d[i] = 1.0 + 0.5 * std::sin(0.3*i);
+  }
+
+  // every coarse cell is in contact, and reaches all the fine ones
+  const double lambda = 1e-4;
+  const cm::details::CoarseToFine c2f(forward, coarse_inverse, fine, coarse, 1, 4, 4, 0,
+    lambda);
+  size_t window = 0;
+  const std::vector<double> x = c2f.solve(d, &window);
+  BOOST_CHECK_EQUAL(window, fine.size());
+
+  arma::mat normal = a.t() * a;
+  const double absolute = lambda * cm::details::largest_squared_singular_value(*forward, 1e-3);
+  for (size_t i = 0; i < a.n_cols; ++i) {
+    normal(i, i) += absolute;
+  }
+  const std::vector<double> expected = arma::conv_to<std::vector<double>>::from(
+    arma::solve(normal, arma::colvec(a.t() * arma::colvec(d))));
+  CHECK_CLOSE_COLLECTION(x, expected, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(solves_around_the_contact)
+{
+  const cm::details::CellCoordinates fine = lattice(24, 1);
+  const cm::details::CellCoordinates coarse = lattice(24, 4);
+  const arma::mat a = smoothing(fine, fine, 1);
+  const arma::mat coarse_inverse = arma::pinv(smoothing(fine, coarse, 16));
+
+  // a bump of 2 by 2 cells, in one of the coarse ones
+  std::vector<double> expected(fine.size(), 0.0);
+  for (size_t c = 0; c < fine.size(); ++c) {
+    if (std::fabs(fine.x[c] - 6) < 1 && std::fabs(fine.y[c] - 6) < 1) {
+      expected[c] = 1;
+    }
+  }
+  const std::vector<double> d = arma::conv_to<std::vector<double>>::from(
+    a * arma::colvec(expected));
+
+  // the contact's coarse cell and a ring of them around it
+  const cm::details::CoarseToFine c2f(std::make_shared<const cm::details::DenseOperator>(a),
+    coarse_inverse, fine, coarse, 1, 6, 6, 0.3, 1e-9);
+  size_t window = 0;
+  const std::vector<double> x = c2f.solve(d, &window);
+  BOOST_TEST_MESSAGE("coarse_to_fine: " << window << " of " << fine.size() << " cells");
+  BOOST_CHECK_GE(window, 16u);
+  BOOST_CHECK_LE(window, 144u);
+  double error = 0;
+  for (size_t c = 0; c < x.size(); ++c) {
+    error = std::max(error, std::fabs(x[c] - expected[c]));
+  }
+  BOOST_CHECK_LT(error, 1e-2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,214 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cm/grid/grid.hpp"
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/convolution_operator.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/fft.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__convolution_operator)
+
+BOOST_AUTO_TEST_CASE(fft_matches_dft)
+{
+  const size_t nx = 8;
+  const size_t ny = 4;
+  std::vector<std::complex<double>> a(nx * ny);
+  for (size_t k = 0; k < a.size(); ++k) {
+    a[k] = std::complex<double>(std::sin(1.0 + k), 0.5 * std::cos(3.0 * k));
+  }
+  std::vector<double> expected_re, expected_im;
+  for (size_t u = 0; u < nx; ++u) {
+    for (size_t v = 0; v < ny; ++v) {
+      std::complex<double> sum = 0;
+      for (size_t i = 0; i < nx; ++i) {
+        for (size_t j = 0; j < ny; ++j) {
+          const double phi = -2 * M_PI * (double(u*i) / nx + double(v*j) / ny);
+          sum += a[i*ny + j] * std::complex<double>(std::cos(phi), std::sin(phi));
+        }
+      }
+      expected_re.push_back(sum.real());
+      expected_im.push_back(sum.imag());
+    }
+  }
+
+  const cm::details::Fft2d fft(nx, ny);
+  std::vector<std::complex<double>> b(a);
+  fft.forward(b.data());
+  std::vector<double> calc_re, calc_im;
+  for (const auto& z : b) {
+    calc_re.push_back(z.real());
+    calc_im.push_back(z.imag());
+  }
+  CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_re, expected_re, 1e-8, 1e-9);
+  CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_im, expected_im, 1e-8, 1e-9);
+
+  fft.inverse(b.data());
+  for (size_t k = 0; k < a.size(); ++k) {
+    BOOST_CHECK_SMALL(std::abs(b[k] - a[k]), 1e-12);
+  }
+
+  BOOST_CHECK_EQUAL(cm::details::fft_size(1), 1);
+  BOOST_CHECK_EQUAL(cm::details::fft_size(5), 8);
+  BOOST_CHECK_EQUAL(cm::details::fft_size(16), 16);
+  BOOST_CHECK_THROW(cm::details::Fft1d(6), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(fit_lattice)
+{
+  std::unique_ptr<cm::Grid> g(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0, 0.0045, 0.003));
+  const cm::details::CellCoordinates c(*g);
+  cm::details::Lattice l;
+  BOOST_REQUIRE(cm::details::fit_lattice(c, 1e-3, 1e-3, l));
+  BOOST_CHECK_EQUAL(l.nx * l.ny, g->num_cells());
+  for (size_t k = 0; k < c.size(); ++k) {
+    const size_t i = l.node[k] / l.ny;
+    const size_t j = l.node[k] % l.ny;
+    BOOST_CHECK_SMALL(l.x0 + i * l.px - c.x[k], 1e-12);
+    BOOST_CHECK_SMALL(l.y0 + j * l.py - c.y[k], 1e-12);
+  }
+
+  // not on the lattice of that pitch
+  BOOST_CHECK(!cm::details::fit_lattice(c, 0.7e-3, 1e-3, l));
+  cm::details::CellCoordinates shifted(c);
+  shifted.x[2] += 1e-4;
+  BOOST_CHECK(!cm::details::fit_lattice(shifted, 1e-3, 1e-3, l));
+  // two cells on the same node
+  cm::details::CellCoordinates doubled(c);
+  doubled.x.push_back(c.x[0]);
+  doubled.y.push_back(c.y[0]);
+  BOOST_CHECK(!cm::details::fit_lattice(doubled, 1e-3, 1e-3, l));
+}
+
+BOOST_AUTO_TEST_CASE(convolution_matches_dense)
+{
+  // src: a 5x4 lattice with a node missing; dst: 3x6, shifted by half a pitch
+  cm::details::Lattice src;
+  src.x0 = 0;
+  src.y0 = 0;
+  src.px = src.py = 1;
+  src.nx = 5;
+  src.ny = 4;
+  for (size_t n = 0; n < src.nx * src.ny; ++n) {
+    if (n != 7) {
+      src.node.push_back(n);
+    }
+  }
+  cm::details::Lattice dst;
+  dst.x0 = 0.5;
+  dst.y0 = -1;
+  dst.px = dst.py = 1;
+  dst.nx = 3;
+  dst.ny = 6;
+  for (size_t n = 0; n < dst.nx * dst.ny; ++n) {
+    dst.node.push_back(dst.nx * dst.ny - 1 - n);
+  }
+
+  const auto kernel = [](const size_t a, const size_t b, const double x, const double y) {
+    return (1.0 + a + 2.0*b) / (1.0 + x*x + 0.5*y*y) + 0.1 * a * x - 0.2 * b * y;
+  };
+  for (size_t src_dim : {1, 3}) {
+    for (size_t dst_dim : {1, 3}) {
+      std::vector<double> ox, oy;
+      cm::details::ConvolutionOperator::stencil_offsets(src, dst, ox, oy);
+      std::vector<std::vector<double>> stencils(src_dim * dst_dim);
+      for (size_t a = 0; a < dst_dim; ++a) {
+        for (size_t b = 0; b < src_dim; ++b) {
+          for (size_t k = 0; k < ox.size(); ++k) {
+            stencils[a*src_dim + b].push_back(kernel(a, b, ox[k], oy[k]));
+          }
+        }
+      }
+      const cm::details::ConvolutionOperator op(src, dst, src_dim, dst_dim, stencils);
+
+      arma::mat m(dst_dim * dst.node.size(), src_dim * src.node.size());
+      for (size_t r = 0; r < dst.node.size(); ++r) {
+        for (size_t c = 0; c < src.node.size(); ++c) {
+          const double x = dst.x0 + (dst.node[r] / dst.ny) - (src.x0 + (src.node[c] / src.ny));
+          const double y = dst.y0 + (dst.node[r] % dst.ny) - (src.y0 + (src.node[c] % src.ny));
+          for (size_t a = 0; a < dst_dim; ++a) {
+            for (size_t b = 0; b < src_dim; ++b) {
+              m(r*dst_dim + a, c*src_dim + b) = kernel(a, b, x, y);
+            }
+          }
+        }
+      }
+      BOOST_REQUIRE_EQUAL(op.n_rows(), m.n_rows);
+      BOOST_REQUIRE_EQUAL(op.n_cols(), m.n_cols);
+
+      std::vector<double> x(m.n_cols);
+      for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 1.0 + 0.1 * (i % 7);
+      }
+      std::vector<double> y(m.n_rows);
+      for (size_t i = 0; i < y.size(); ++i) {
+        y[i] = 1.0 - 0.1 * (i % 5);
+      }
+      const std::vector<double> expected_y =
+        arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+      const std::vector<double> expected_x =
+        arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+      const std::vector<double> calc_y = op.apply(x);
+      const std::vector<double> calc_x = op.apply_transpose(y);
+      CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_y, expected_y, 1e-10, 1e-10);
+      CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_x, expected_x, 1e-10, 1e-10);
+
+      std::vector<double> expected_norms;
+      for (size_t j = 0; j < m.n_cols; ++j) {
+        expected_norms.push_back(arma::norm(m.col(j), 2));
+      }
+      const std::vector<double> calc_norms = op.column_norms();
+      CHECK_CLOSE_COLLECTION(calc_norms, expected_norms, 1e-10);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(deconvolution_transpose)
+{
+  std::unique_ptr<cm::Grid> g(cm::Grid::fromFill(1, cm::Square(1), 0, 0, 6, 5));
+  cm::details::Lattice l;
+  BOOST_REQUIRE(cm::details::fit_lattice(cm::details::CellCoordinates(*g), 1, 1, l));
+  for (size_t dim : {1, 3}) {
+    std::vector<double> ox, oy;
+    cm::details::ConvolutionOperator::stencil_offsets(l, l, ox, oy);
+    std::vector<std::vector<double>> stencils(dim * dim);
+    for (size_t a = 0; a < dim; ++a) {
+      for (size_t b = 0; b < dim; ++b) {
+        for (size_t k = 0; k < ox.size(); ++k) {
+          const double r2 = ox[k]*ox[k] + oy[k]*oy[k];
+          stencils[a*dim + b].push_back(((a == b) ? 1.0 : 0.2) / (1.0 + r2));
+        }
+      }
+    }
+    const cm::details::DeconvolutionOperator op(
+      std::make_shared<const cm::details::ConvolutionOperator>(l, l, dim, dim, stencils), 1e-6, 2);
+    std::vector<double> x(op.n_cols());
+    for (size_t i = 0; i < x.size(); ++i) {
+      x[i] = std::sin(1.0 + i);
+    }
+    std::vector<double> y(op.n_rows());
+    for (size_t i = 0; i < y.size(); ++i) {
+      y[i] = std::cos(2.0 * i);
+    }
+    // <A x, y> == <x, A^T y>
+    const std::vector<double> ax = op.apply(x);
+    const std::vector<double> aty = op.apply_transpose(y);
+    double lhs = 0;
+    double rhs = 0;
+    for (size_t i = 0; i < y.size(); ++i) {
+      lhs += ax[i] * y[i];
+    }
+    for (size_t i = 0; i < x.size(); ++i) {
+      rhs += x[i] * aty[i];
+    }
+    BOOST_CHECK_CLOSE(lhs, rhs, 1e-8);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,46 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+#include "cm/details/math.hpp"
+
+// The bounds below are the ones documented in cm/details/math.hpp
+
+BOOST_AUTO_TEST_SUITE(details__fast_math)
+
+BOOST_AUTO_TEST_CASE(fast_log_relative_error)
+{
+  using cm::details::fast_log;
+  double max_err = 0;
+  // the whole range of (normal) exponents ...
+  for (double v = 1e-300; v < 1e300; v *= 1.0137) {
+    max_err = std::fmax(max_err, std::fabs((fast_log(v) - std::log(v)) / std::log(v)));
+  }
+  // ... and the neighbourhood of 1, where log(v) -> 0
+  for (double d = 1e-12; d < 0.5; d *= 1.0071) {
+    for (double v : {1 + d, 1 - d}) {
+      max_err = std::fmax(max_err, std::fabs((fast_log(v) - std::log(v)) / std::log(v)));
+    }
+  }
+  BOOST_CHECK_LT(max_err, 1e-15);
+  BOOST_CHECK_EQUAL(fast_log(1.0), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(fast_atan_relative_error)
+{
+  using cm::details::fast_atan;
+  double max_err = 0;
+  for (double a = 1e-200; a < 1e200; a *= 1.0113) {
+    for (double v : {a, -a}) {
+      max_err = std::fmax(max_err, std::fabs((fast_atan(v) - std::atan(v)) / std::atan(v)));
+    }
+  }
+  // boundaries of the argument reduction
+  for (double v = 0.3; v < 3; v += 1e-4) {
+    max_err = std::fmax(max_err, std::fabs((fast_atan(v) - std::atan(v)) / std::atan(v)));
+  }
+  BOOST_CHECK_LT(max_err, 1e-15);
+  BOOST_CHECK_EQUAL(fast_atan(0.0), 0.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
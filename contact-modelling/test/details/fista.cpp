@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/fista.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/nnls.hpp"
+#include "cm/details/power_iteration.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__fista)
+
+BOOST_AUTO_TEST_CASE(matches_active_set)
+{
+  arma::mat a(60, 40);
+  for (size_t j = 0; j < a.n_cols; ++j) {
+    for (size_t i = 0; i < a.n_rows; ++i) {
+      const double di = double(i) / a.n_rows - double(j) / a.n_cols;
+      a(i, j) = 1.0 / (1.0 + 10*std::fabs(di)) + 0.02 * std::sin(0.7*i + 1.1*j);
+    }
+  }
+  std::vector<double> b(a.n_rows);
+  for (size_t i = 0; i < b.size(); ++i) {
+    const double t = double(i) / b.size();
+    b[i] = std::exp(-30 * (t - 0.4) * (t - 0.4)) - 0.2 * t;
+  }
+  const auto op = std::make_shared<const cm::details::DenseOperator>(a, 2);
+
+  // the largest eigenvalue of a^T a
+  const arma::colvec ev = arma::eig_sym(arma::mat(a.t() * a));
+  double largest = 0;
+  for (size_t i = 0; i < ev.n_elem; ++i) {
+    largest = std::max(largest, ev(i));
+  }
+  const double lipschitz = cm::details::largest_squared_singular_value(*op);
+  BOOST_CHECK_CLOSE(lipschitz, largest, 1e-3);
+
+  cm::details::NnlsState exact;
+  cm::details::NonnegativeLeastSquares(op).solve(b.data(), exact);
+
+  std::vector<double> x;
+  const cm::details::FistaReport report =
+    cm::details::fista(*op, lipschitz, b, x, 5000, 1e-8);
+  BOOST_TEST_MESSAGE(report.iterations << " iterations, " << report.restarts << " restarts");
+  BOOST_CHECK(report.converged);
+  BOOST_CHECK_LE(report.relative_step, 1e-8);
+  const arma::colvec diff = arma::colvec(x) - arma::colvec(exact.x);
+  BOOST_CHECK_LT(arma::norm(diff, 2) / arma::norm(arma::colvec(exact.x), 2), 1e-3);
+  for (const double v : x) {
+    BOOST_CHECK_GE(v, 0);
+  }
+
+  // from the solution, it's over at once
+  const cm::details::FistaReport warm = cm::details::fista(*op, lipschitz, b, x, 5000, 1e-6);
+  BOOST_CHECK(warm.converged);
+  BOOST_CHECK_EQUAL(warm.iterations, 1u);
+
+  // capped: not converged, but no more iterations than allowed
+  std::vector<double> capped;
+  const cm::details::FistaReport short_report =
+    cm::details::fista(*op, lipschitz, b, capped, 3, 1e-8);
+  BOOST_CHECK(!short_report.converged);
+  BOOST_CHECK_EQUAL(short_report.iterations, 3u);
+
+  // from far too low an estimate, backtracking raises it to the right order of magnitude
+  std::vector<double> low;
+  const cm::details::FistaReport backtracked =
+    cm::details::fista(*op, 1e-3 * lipschitz, b, low, 5000, 1e-8);
+  BOOST_TEST_MESSAGE(backtracked.iterations << " iterations, " << backtracked.backtracks
+    << " backtracks");
+  BOOST_CHECK(backtracked.converged);
+  BOOST_CHECK_GT(backtracked.backtracks, 0u);
+  BOOST_CHECK_LE(backtracked.lipschitz, 2 * largest);
+  const arma::colvec low_diff = arma::colvec(low) - arma::colvec(exact.x);
+  BOOST_CHECK_LT(arma::norm(low_diff, 2) / arma::norm(arma::colvec(exact.x), 2), 1e-3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,101 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/grid/grid.hpp"
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/hmatrix.hpp"
+
+namespace {
+
+struct MockCell {
+  std::array<double, 2> relative_position;
+};
+
+/**
+ * \brief   n cells scattered over [0,1)x[0,1), from a fixed sequence
+ */
+std::unique_ptr<cm::Grid> scattered_grid(const size_t dim, const size_t n, const double seed)
+{
+  std::vector<MockCell> cells(n);
+  for (size_t i = 0; i < n; ++i) {
+    cells[i].relative_position[0] = std::fmod(seed + 0.7548776662 * i, 1.0);
+    cells[i].relative_position[1] = std::fmod(seed + 0.5698402910 * i, 1.0);
+  }
+  return std::unique_ptr<cm::Grid>(
+    cm::Grid::fromSensors(dim, cm::Square(0.01), cells.cbegin(), cells.cend()));
+}
+
+double kernel(const size_t a, const size_t b, const double x, const double y)
+{
+  return (1.0 + a + 0.5*b) / std::sqrt(1e-4 + x*x + y*y) + ((a == b) ? 0.0 : 0.1 * x);
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__hmatrix)
+
+BOOST_AUTO_TEST_CASE(hmatrix_matches_dense)
+{
+  for (size_t src_dim : {1, 3}) {
+    for (size_t dst_dim : {1, 3}) {
+      std::unique_ptr<cm::Grid> src(scattered_grid(src_dim, 700, 0.1));
+      std::unique_ptr<cm::Grid> dst(scattered_grid(dst_dim, 500, 0.35));
+      const cm::details::CellCoordinates sc(*src);
+      const cm::details::CellCoordinates dc(*dst);
+      const auto coefficients = [&](const size_t* s, const size_t n_s, const size_t* d,
+        const size_t n_d, arma::mat& block)
+      {
+        for (size_t j = 0; j < n_s; ++j) {
+          for (size_t i = 0; i < n_d; ++i) {
+            for (size_t a = 0; a < dst_dim; ++a) {
+              for (size_t b = 0; b < src_dim; ++b) {
+                block(dst_dim*i + a, src_dim*j + b) =
+                  kernel(a, b, dc.x[d[i]] - sc.x[s[j]], dc.y[d[i]] - sc.y[s[j]]);
+              }
+            }
+          }
+        }
+      };
+      const cm::details::HMatrixOperator op(sc, dc, src_dim, dst_dim, coefficients, 1e-8, 2);
+
+      arma::mat m(dst_dim * dc.size(), src_dim * sc.size());
+      for (size_t j = 0; j < sc.size(); ++j) {
+        for (size_t i = 0; i < dc.size(); ++i) {
+          for (size_t a = 0; a < dst_dim; ++a) {
+            for (size_t b = 0; b < src_dim; ++b) {
+              m(dst_dim*i + a, src_dim*j + b) = kernel(a, b, dc.x[i] - sc.x[j], dc.y[i] - sc.y[j]);
+            }
+          }
+        }
+      }
+      BOOST_REQUIRE_EQUAL(op.n_rows(), m.n_rows);
+      BOOST_REQUIRE_EQUAL(op.n_cols(), m.n_cols);
+      BOOST_CHECK_LT(op.stored_coefficients(), m.n_elem);
+
+      std::vector<double> x(m.n_cols);
+      for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 1.0 + 0.1 * (i % 7);
+      }
+      std::vector<double> y(m.n_rows);
+      for (size_t i = 0; i < y.size(); ++i) {
+        y[i] = 1.0 - 0.1 * (i % 5);
+      }
+      const std::vector<double> expected_y =
+        arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+      const std::vector<double> expected_x =
+        arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+      const std::vector<double> calc_y = op.apply(x);
+      const std::vector<double> calc_x = op.apply_transpose(y);
+      CHECK_CLOSE_COLLECTION(calc_y, expected_y, 1e-4);
+      CHECK_CLOSE_COLLECTION(calc_x, expected_x, 1e-4);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/parallel.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__linear_operator)
+
+BOOST_AUTO_TEST_CASE(dense_apply)
+{
+  arma::mat m;
+  m << 1 << 2 << 3 << arma::endr
+    << 4 << 5 << 6 << arma::endr;
+  const cm::details::DenseOperator op(m);
+  BOOST_CHECK_EQUAL(op.n_rows(), 2);
+  BOOST_CHECK_EQUAL(op.n_cols(), 3);
+
+  const std::vector<double> y = op.apply(std::vector<double>{1, 0, -1});
+  const std::vector<double> expected_y{-2, -2};
+  CHECK_CLOSE_COLLECTION(y, expected_y, 1e-12);
+
+  const std::vector<double> x = op.apply_transpose(std::vector<double>{1, -1});
+  const std::vector<double> expected_x{-3, -3, -3};
+  CHECK_CLOSE_COLLECTION(x, expected_x, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(dense_apply_wrong_size)
+{
+  const cm::details::DenseOperator op(arma::mat(2, 3, arma::fill::zeros));
+  BOOST_CHECK_THROW(op.apply(std::vector<double>(2)), std::runtime_error);
+  BOOST_CHECK_THROW(op.apply_transpose(std::vector<double>(3)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(dense_apply_threads)
+{
+  arma::mat m(37, 23);
+  for (size_t j = 0; j < m.n_cols; ++j) {
+    for (size_t i = 0; i < m.n_rows; ++i) {
+      m(i, j) = 1.0 / (1.0 + i + 2.0*j);
+    }
+  }
+  std::vector<double> x(m.n_cols);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1.0 - 0.1 * (i % 7);
+  }
+  std::vector<double> y(m.n_rows);
+  for (size_t i = 0; i < y.size(); ++i) {
+    y[i] = 1.0 + 0.1 * (i % 5);
+  }
+  const cm::details::DenseOperator single(m);
+  const std::vector<double> expected_y = single.apply(x);
+  const std::vector<double> expected_x = single.apply_transpose(y);
+  const std::vector<double> two_y = cm::details::DenseOperator(m, 2).apply(x);
+  const std::vector<double> two_x = cm::details::DenseOperator(m, 2).apply_transpose(y);
+  CHECK_CLOSE_COLLECTION(two_y, expected_y, 1e-12);
+  CHECK_CLOSE_COLLECTION(two_x, expected_x, 1e-12);
+  // split among however many threads, the same sums in the same order
+  BOOST_CHECK(cm::details::DenseOperator(m, 5).apply(x) == two_y);
+  BOOST_CHECK(cm::details::DenseOperator(m, 5).apply_transpose(y) == two_x);
+}
+
+BOOST_AUTO_TEST_CASE(worker_pool)
+{
+  const cm::details::WorkerPool pool(3);
+  BOOST_CHECK_EQUAL(pool.num_threads(), 3u);
+  // every call on the same threads, every index once
+  for (size_t call = 0; call < 50; ++call) {
+    std::vector<int> seen(1000, 0);
+    cm::details::parallel_for_blocks(seen.size(), pool, 7,
+      [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          ++seen[i];
+        }
+      });
+    BOOST_CHECK(seen == std::vector<int>(seen.size(), 1));
+  }
+  // a body's exception reaches the caller, and the pool is fine afterwards
+  BOOST_CHECK_THROW(cm::details::parallel_for_blocks(100, pool, 1,
+    [](const size_t begin, size_t) {
+      if (begin == 42) {
+        throw std::runtime_error("block 42");
+      }
+    }), std::runtime_error);
+  // and a body calling back into its own pool runs serially
+  std::vector<int> seen(64, 0);
+  cm::details::parallel_for_blocks(8, pool, 1, [&](const size_t outer, size_t) {
+    cm::details::parallel_for_blocks(8, pool, 1, [&](const size_t begin, const size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ++seen[8*outer + i];
+      }
+    });
+  });
+  BOOST_CHECK(seen == std::vector<int>(seen.size(), 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/mapped_operator.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__mapped_operator)
+
+BOOST_AUTO_TEST_CASE(write_reuse_apply)
+{
+  const std::string path = (boost::filesystem::temp_directory_path()
+    / boost::filesystem::unique_path("cm-mapped-%%%%-%%%%.mat")).string();
+  const size_t n_rows = 37;
+  const size_t n_cols = 23;
+  arma::mat m(n_rows, n_cols);
+  for (size_t j = 0; j < n_cols; ++j) {
+    for (size_t i = 0; i < n_rows; ++i) {
+      m(i, j) = 1.0 / (1.0 + i + 2.0*j) - 0.01 * j;
+    }
+  }
+
+  BOOST_CHECK(!cm::details::MappedOperator::reuse(path, n_rows, n_cols, 42));
+  {
+    const cm::details::MappedOperator op(path, n_rows, n_cols, 42,
+      [&](arma::mat& mapped) { mapped = m; }, 3);
+    BOOST_REQUIRE_EQUAL(op.n_rows(), n_rows);
+    BOOST_REQUIRE_EQUAL(op.n_cols(), n_cols);
+
+    std::vector<double> x(n_cols);
+    for (size_t i = 0; i < x.size(); ++i) {
+      x[i] = 1.0 + 0.1 * (i % 7);
+    }
+    std::vector<double> y(n_rows);
+    for (size_t i = 0; i < y.size(); ++i) {
+      y[i] = 1.0 - 0.1 * (i % 5);
+    }
+    const std::vector<double> expected_y =
+      arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+    const std::vector<double> expected_x =
+      arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+    const std::vector<double> calc_y = op.apply(x);
+    const std::vector<double> calc_x = op.apply_transpose(y);
+    CHECK_CLOSE_COLLECTION(calc_y, expected_y, 1e-12);
+    CHECK_CLOSE_COLLECTION(calc_x, expected_x, 1e-12);
+
+    // another process would map the same file
+    const std::unique_ptr<cm::details::MappedOperator> shared =
+      cm::details::MappedOperator::reuse(path, n_rows, n_cols, 42);
+    BOOST_REQUIRE(shared);
+    const std::vector<double> expected_m(m.memptr(), m.memptr() + m.n_elem);
+    const std::vector<double> calc_m(shared->data(), shared->data() + m.n_elem);
+    CHECK_CLOSE_COLLECTION(calc_m, expected_m, 1e-12);
+
+    // computed from something else, or of another size
+    BOOST_CHECK(!cm::details::MappedOperator::reuse(path, n_rows, n_cols, 43));
+    BOOST_CHECK(!cm::details::MappedOperator::reuse(path, n_cols, n_rows, 42));
+
+    // replacing the file leaves the mapped one as it was
+    const cm::details::MappedOperator replaced(path, n_rows, n_cols, 43,
+      [](arma::mat& mapped) { mapped.fill(2.0); });
+    const std::vector<double> calc_y_after = op.apply(x);
+    CHECK_CLOSE_COLLECTION(calc_y_after, expected_y, 1e-12);
+    BOOST_CHECK(cm::details::MappedOperator::reuse(path, n_rows, n_cols, 43));
+  }
+  boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
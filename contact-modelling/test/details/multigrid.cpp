@@ -0,0 +1,131 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/details/cgls.hpp"
+#include "cm/details/convolution_operator.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/multigrid.hpp"
+
+namespace {
+
+/**
+ * \brief   The cells of an nx by ny lattice of unit pitch, x-major
+ */
+cm::details::Lattice lattice(const size_t nx, const size_t ny)
+{
+  cm::details::Lattice ret;
+  ret.x0 = ret.y0 = 0;
+  ret.px = ret.py = 1;
+  ret.nx = nx;
+  ret.ny = ny;
+  for (size_t v = 0; v < nx*ny; ++v) {
+    ret.node.push_back(v);
+  }
+  return ret;
+}
+
+/**
+ * \brief   A smoothing kernel between the cells, decaying as 1/r as the models do
+ */
+arma::mat smoothing(const cm::details::Lattice& l)
+{
+  const size_t n = l.node.size();
+  arma::mat a(n, n);
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      const double dx = double(l.node[i] / l.ny) - double(l.node[j] / l.ny);
+      const double dy = double(l.node[i] % l.ny) - double(l.node[j] % l.ny);
+      a(i, j) = 1.0 / (0.5 + std::sqrt(dx*dx + dy*dy));
+    }
+  }
+  return a;
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__multigrid)
+
+BOOST_AUTO_TEST_CASE(solves_regularised_normal_equations)
+{
+  // odd sizes, so that some coarse cells contain fewer than 4
+  const cm::details::Lattice l = lattice(27, 23);
+  const arma::mat a = smoothing(l);
+  std::vector<double> rhs(a.n_rows);
+  for (size_t i = 0; i < rhs.size(); ++i) {
+    rhs[i] = 1.0 + 0.5 * std::sin(0.3*i) + 0.1 * std::cos(2.1*i);
+  }
+
+  const auto op = std::make_shared<const cm::details::DenseOperator>(a);
+  const cm::details::Multigrid mg(op, l, 1, 1e-6, 32);
+  BOOST_CHECK_GT(mg.levels(), 2u);
+  BOOST_CHECK_LE(mg.cells(mg.levels() - 1), 32u);
+
+  arma::mat normal = a.t() * a;
+  for (size_t i = 0; i < a.n_cols; ++i) {
+    normal(i, i) += mg.lambda();
+  }
+  const std::vector<double> expected = arma::conv_to<std::vector<double>>::from(
+    arma::solve(normal, arma::colvec(a.t() * arma::colvec(rhs))));
+
+  std::vector<double> x;
+  const size_t iterations = mg.solve(rhs, x, 200, 1e-10);
+  BOOST_TEST_MESSAGE("multigrid: " << iterations << " iterations");
+  CHECK_CLOSE_COLLECTION(x, expected, 1e-2);
+
+  // conjugate gradients without the V-cycles take many more iterations to get as far
+  std::vector<double> y;
+  const size_t cgls_iterations = cm::details::cgls(*op, std::vector<double>(a.n_cols, 1.0), rhs,
+    y, 1000, 1e-10);
+  BOOST_TEST_MESSAGE("cgls: " << cgls_iterations << " iterations");
+  BOOST_CHECK_LT(2 * iterations, cgls_iterations);
+
+  // started from the solution, there's nothing left to do
+  BOOST_CHECK_EQUAL(mg.solve(rhs, x, 200, 1e-6), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(vcycle_is_symmetric)
+{
+  // 3-valued cells, as for the forces
+  const cm::details::Lattice l = lattice(12, 10);
+  const arma::mat k = smoothing(l);
+  arma::mat a(3*k.n_rows, 3*k.n_cols, arma::fill::zeros);
+  for (size_t j = 0; j < k.n_cols; ++j) {
+    for (size_t i = 0; i < k.n_rows; ++i) {
+      for (size_t c = 0; c < 3; ++c) {
+        a(3*i + c, 3*j + c) = (1.0 + c) * k(i, j);
+      }
+      a(3*i, 3*j + 2) = 0.3 * k(i, j);
+    }
+  }
+  const cm::details::Multigrid mg(std::make_shared<const cm::details::DenseOperator>(a), l, 3,
+    1e-4, 30);
+  BOOST_CHECK_GT(mg.levels(), 1u);
+
+  std::vector<double> u(a.n_cols);
+  std::vector<double> v(a.n_cols);
+  for (size_t i = 0; i < u.size(); ++i) {
+    u[i] = std::sin(0.7*i);
+    v[i] = std::cos(0.2*i) - 0.5;
+  }
+  std::vector<double> mu(u.size());
+  std::vector<double> mv(v.size());
+  mg.vcycle(u.data(), mu.data());
+  mg.vcycle(v.data(), mv.data());
+  double v_mu = 0;
+  double u_mv = 0;
+  double u_mu = 0;
+  for (size_t i = 0; i < u.size(); ++i) {
+    v_mu += v[i] * mu[i];
+    u_mv += u[i] * mv[i];
+    u_mu += u[i] * mu[i];
+  }
+  BOOST_CHECK_CLOSE(v_mu, u_mv, 1e-6);
+  BOOST_CHECK_GT(u_mu, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
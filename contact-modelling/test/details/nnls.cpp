@@ -0,0 +1,153 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/nnls.hpp"
+#include "cm/details/sparse_operator.hpp"
+
+namespace {
+
+/**
+ * \brief   All positive and decaying away from the diagonal, like the models
+ */
+arma::mat model_like(const size_t n_rows, const size_t n_cols)
+{
+  arma::mat a(n_rows, n_cols);
+  for (size_t j = 0; j < n_cols; ++j) {
+    for (size_t i = 0; i < n_rows; ++i) {
+      const double di = double(i) / n_rows - double(j) / n_cols;
+      a(i, j) = 1.0 / (1.0 + 15*std::fabs(di)) + 0.02 * std::sin(0.7*i + 1.1*j);
+    }
+  }
+  return a;
+}
+
+/**
+ * \brief   Karush-Kuhn-Tucker conditions: x >= 0, and the gradient of ||a x - b||^2 / 2 is 0 where
+ *          x > 0 and >= 0 where x = 0
+ */
+void check_optimal(const arma::mat& a, const std::vector<double>& b,
+  const std::vector<double>& x)
+{
+  const arma::colvec ax = a * arma::colvec(x);
+  const arma::colvec w = a.t() * (arma::colvec(b) - ax);
+  const arma::colvec atb = a.t() * arma::colvec(b);
+  double scale = 0;
+  for (size_t j = 0; j < atb.n_elem; ++j) {
+    scale = std::max(scale, std::fabs(atb(j)));
+  }
+  for (size_t j = 0; j < x.size(); ++j) {
+    BOOST_CHECK_GE(x[j], 0);
+    if (x[j] > 0) {
+      BOOST_CHECK_SMALL(w(j), 1e-6 * scale);
+    } else {
+      BOOST_CHECK_LE(w(j), 1e-6 * scale);
+    }
+  }
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__nnls)
+
+BOOST_AUTO_TEST_CASE(optimal_and_warm_started)
+{
+  const arma::mat a = model_like(50, 30);
+  // a contact: displacements of a bump, minus a tilt which some negative forces would explain
+  std::vector<double> b(a.n_rows);
+  for (size_t i = 0; i < b.size(); ++i) {
+    const double t = double(i) / b.size();
+    b[i] = std::exp(-30 * (t - 0.4) * (t - 0.4)) - 0.2 * t;
+  }
+  const cm::details::NonnegativeLeastSquares nnls(
+    std::make_shared<const cm::details::DenseOperator>(a));
+  cm::details::NnlsState state;
+  const size_t cold_changes = nnls.solve(b.data(), state);
+  BOOST_TEST_MESSAGE("from 0: " << cold_changes << " changes");
+  check_optimal(a, b, state.x);
+  size_t positive = 0;
+  for (const double v : state.x) {
+    positive += v > 0;
+  }
+  BOOST_CHECK_GT(positive, 0u);
+  BOOST_CHECK_LT(positive, a.n_cols);
+
+  // the same frame again: nothing to change
+  BOOST_CHECK_EQUAL(nnls.solve(b.data(), state), 0u);
+  check_optimal(a, b, state.x);
+
+  // the contact moves a little: fewer changes than from 0
+  std::vector<double> b_next(b.size());
+  for (size_t i = 0; i < b.size(); ++i) {
+    const double t = double(i) / b.size();
+    b_next[i] = std::exp(-30 * (t - 0.42) * (t - 0.42)) - 0.2 * t;
+  }
+  const size_t warm_changes = nnls.solve(b_next.data(), state);
+  check_optimal(a, b_next, state.x);
+  cm::details::NnlsState cold;
+  const size_t cold_next_changes = nnls.solve(b_next.data(), cold);
+  BOOST_TEST_MESSAGE("warm: " << warm_changes << ", from 0: " << cold_next_changes);
+  BOOST_CHECK_LT(warm_changes, cold_next_changes);
+  CHECK_CLOSE_COLLECTION(state.x, cold.x, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_matches_dense)
+{
+  // a banded matrix, as compressed rows
+  const size_t n = 40;
+  std::vector<size_t> row_begin(1, 0);
+  std::vector<size_t> cols;
+  std::vector<double> values;
+  arma::mat dense(n, n);
+  dense.zeros();
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = (i > 2 ? i - 2 : 0); j < std::min(n, i + 3); ++j) {
+      const double v = 1.0 / (1.0 + 2.0 * (i > j ? i - j : j - i));
+      cols.push_back(j);
+      values.push_back(v);
+      dense(i, j) = v;
+    }
+    row_begin.push_back(cols.size());
+  }
+  std::vector<double> b(n);
+  for (size_t i = 0; i < n; ++i) {
+    b[i] = std::sin(0.3 * i);
+  }
+
+  const cm::details::NonnegativeLeastSquares from_sparse(
+    std::make_shared<const cm::details::SparseOperator>(n, 1, 1, row_begin, cols, values), 3);
+  const cm::details::NonnegativeLeastSquares from_dense(
+    std::make_shared<const cm::details::DenseOperator>(dense));
+  cm::details::NnlsState sparse_state, dense_state;
+  from_sparse.solve(b.data(), sparse_state);
+  from_dense.solve(b.data(), dense_state);
+  check_optimal(dense, b, dense_state.x);
+  CHECK_CLOSE_COLLECTION(sparse_state.x, dense_state.x, 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(dependent_columns)
+{
+  // the third column is the sum of the first two: left out once they're in
+  arma::mat a(4, 3);
+  a.zeros();
+  a(0, 0) = 1;
+  a(1, 1) = 1;
+  a(0, 2) = 1;
+  a(1, 2) = 1;
+  a(2, 2) = 1e-9;
+  const std::vector<double> b = {1.0, 2.0, 0.0, 0.0};
+  const cm::details::NonnegativeLeastSquares nnls(
+    std::make_shared<const cm::details::DenseOperator>(a));
+  cm::details::NnlsState state;
+  nnls.solve(b.data(), state);
+  const arma::colvec ax = a * arma::colvec(state.x);
+  BOOST_CHECK_SMALL(ax(0) - 1.0, 1e-6);
+  BOOST_CHECK_SMALL(ax(1) - 2.0, 1e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+
+#include "cm/details/offset_cache.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__offset_cache)
+
+BOOST_AUTO_TEST_CASE(key_symmetric_offsets)
+{
+  using cm::details::OffsetCache;
+  using cm::details::OffsetKey;
+  OffsetCache<double> cache(1e-6);
+  const OffsetKey k1 = cache.key( 0.25,  0.5);
+  const OffsetKey k2 = cache.key(-0.25,  0.5);
+  const OffsetKey k3 = cache.key(-0.25, -0.5);
+  BOOST_CHECK_EQUAL(k1.qx, k2.qx);
+  BOOST_CHECK_EQUAL(k1.qx, k3.qx);
+  BOOST_CHECK_EQUAL(k1.qy, k2.qy);
+  BOOST_CHECK_EQUAL(k1.qy, k3.qy);
+  BOOST_CHECK_EQUAL(k1.sx,  1.0);
+  BOOST_CHECK_EQUAL(k1.sy,  1.0);
+  BOOST_CHECK_EQUAL(k2.sx, -1.0);
+  BOOST_CHECK_EQUAL(k2.sy,  1.0);
+  BOOST_CHECK_EQUAL(k3.sx, -1.0);
+  BOOST_CHECK_EQUAL(k3.sy, -1.0);
+  BOOST_CHECK_CLOSE(k3.x, 0.25, 1e-6);
+  BOOST_CHECK_CLOSE(k3.y, 0.5,  1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(key_quantization)
+{
+  using cm::details::OffsetCache;
+  OffsetCache<double> cache(1e-6);
+  // rounding noise of the coordinates doesn't change the key
+  BOOST_CHECK_EQUAL(cache.key(0.3, 0).qx, cache.key(0.1 + 0.2, 0).qx);
+  BOOST_CHECK(cache.key(0.3, 0).qx != cache.key(0.3 + 2e-6, 0).qx);
+}
+
+BOOST_AUTO_TEST_CASE(get_evaluates_once)
+{
+  using cm::details::OffsetCache;
+  OffsetCache<double> cache(1e-6);
+  size_t num_evals = 0;
+  auto eval = [&](const double x, const double y) { ++num_evals; return x + 10*y; };
+  for (size_t i = 0; i < 5000; ++i) {
+    const double x = 1e-3 * (i % 100);
+    const double y = 1e-3 * (i / 100);
+    BOOST_CHECK_CLOSE(cache.get(cache.key(x, y), eval), x + 10*y, 1e-3);
+    BOOST_CHECK_CLOSE(cache.get(cache.key(-x, -y), eval), x + 10*y, 1e-3);
+  }
+  BOOST_CHECK_EQUAL(num_evals, size_t(5000));
+  BOOST_CHECK_EQUAL(cache.size(), size_t(5000));
+}
+
+BOOST_AUTO_TEST_CASE(size_bounded)
+{
+  using cm::details::OffsetCache;
+  OffsetCache<double> cache(1e-6, 10);
+  size_t num_evals = 0;
+  auto eval = [&](const double x, const double y) { ++num_evals; return x; };
+  for (size_t round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < 20; ++i) {
+      BOOST_CHECK_CLOSE(cache.get(cache.key(1e-3 * (i+1), 0), eval), 1e-3 * (i+1), 1e-3);
+    }
+  }
+  BOOST_CHECK_EQUAL(cache.size(), size_t(10));
+  // the first 10 offsets were cached, the other 10 had to be evaluated every time
+  BOOST_CHECK_EQUAL(num_evals, size_t(30));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,41 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/linear_operator.hpp"
+#include "cm/details/power_iteration.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__power_iteration)
+
+BOOST_AUTO_TEST_CASE(largest_squared_singular_value)
+{
+  // the dominant eigenvector of g = a^T a is about (1, -1, 1, -1, ...), orthogonal to the ones
+  const size_t n = 30;
+  arma::mat g(n, n);
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      g(i, j) = (i == j ? 2.0 : 0.0) + (((i + j) % 2) ? -1.0 : 1.0) / n
+        + 0.1 / (1.0 + std::fabs(double(i) - double(j)));
+    }
+  }
+  const arma::mat a = arma::chol(g);
+  const auto op = std::make_shared<const cm::details::DenseOperator>(a, 2);
+
+  const arma::colvec ev = arma::eig_sym(g);
+  double expected = 0;
+  for (size_t i = 0; i < ev.n_elem; ++i) {
+    expected = std::max(expected, ev(i));
+  }
+  const double calc = cm::details::largest_squared_singular_value(*op);
+  BOOST_CHECK_CLOSE(calc, expected, 1e-3);
+  // the Rayleigh quotient is an estimate from below
+  BOOST_CHECK_LE(calc, expected * (1 + 1e-12));
+  // seeded: the same every time
+  BOOST_CHECK_EQUAL(cm::details::largest_squared_singular_value(*op), calc);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/quantized_operator.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__quantized_operator)
+
+BOOST_AUTO_TEST_CASE(quantized_matches_dense)
+{
+  // more rows than a tile of apply(), columns of very different magnitudes
+  const size_t n_rows = 5000;
+  const size_t n_cols = 60;
+  arma::mat m(n_rows, n_cols);
+  for (size_t j = 0; j < n_cols; ++j) {
+    for (size_t i = 0; i < n_rows; ++i) {
+      m(i, j) = std::pow(10.0, double(j % 7) - 3) * std::sin(0.37 * i + 1.3 * j);
+    }
+  }
+  std::vector<double> x(n_cols);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  std::vector<double> y(n_rows);
+  for (size_t i = 0; i < y.size(); ++i) {
+    y[i] = 1.0 - 0.1 * (i % 5);
+  }
+  const arma::colvec expected_y = m * arma::colvec(x);
+  const arma::colvec expected_x = m.t() * arma::colvec(y);
+
+  const cm::details::QuantizedOperator op(m);
+  BOOST_REQUIRE_EQUAL(op.n_rows(), n_rows);
+  BOOST_REQUIRE_EQUAL(op.n_cols(), n_cols);
+  BOOST_CHECK_LT(op.relative_error(), 2e-5);
+  BOOST_CHECK_GT(op.relative_error(), 0);
+
+  // every coefficient is off by at most half a step of its column's largest one
+  const double half_step = 0.5 / 32767 * (1 + 1e-6);
+  std::vector<double> col_max(n_cols, 0.0);
+  for (size_t j = 0; j < n_cols; ++j) {
+    for (size_t i = 0; i < n_rows; ++i) {
+      col_max[j] = std::max(col_max[j], std::fabs(m(i, j)));
+    }
+  }
+  double bound_y = 0;
+  for (size_t j = 0; j < n_cols; ++j) {
+    bound_y += half_step * col_max[j] * std::fabs(x[j]);
+  }
+  double sum_y = 0;
+  for (const double v : y) {
+    sum_y += std::fabs(v);
+  }
+  const std::vector<double> calc_y = op.apply(x);
+  const std::vector<double> calc_x = op.apply_transpose(y);
+  for (size_t i = 0; i < n_rows; ++i) {
+    BOOST_CHECK_LE(std::fabs(calc_y[i] - expected_y[i]), bound_y);
+  }
+  for (size_t j = 0; j < n_cols; ++j) {
+    BOOST_CHECK_LE(std::fabs(calc_x[j] - expected_x[j]),
+      half_step * col_max[j] * sum_y);
+  }
+
+  // every element of the result summed up by one thread, in the same order
+  const cm::details::QuantizedOperator threaded(m, 3);
+  const std::vector<double> threaded_y = threaded.apply(x);
+  const std::vector<double> threaded_x = threaded.apply_transpose(y);
+  BOOST_CHECK(threaded_y == calc_y);
+  BOOST_CHECK(threaded_x == calc_x);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cm/details/region_decomposition.hpp"
+#include "cm/grid/cell_shapes.hpp"
+#include "cm/grid/grid.hpp"
+
+namespace {
+
+/**
+ * \brief   Two regions, split at x = 0.006: the positions of a 12 by 6 lattice's cells
+ */
+std::vector<std::vector<cm::GridCell>> halves(const cm::Grid& g)
+{
+  std::vector<std::vector<cm::GridCell>> ret(2);
+  for (size_t c = 0; c < g.num_cells(); ++c) {
+    ret[g.cell(c).x < 0.006 ? 0 : 1].push_back(g.cell(c));
+  }
+  return ret;
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__region_decomposition)
+
+BOOST_AUTO_TEST_CASE(splits_and_blends)
+{
+  std::unique_ptr<cm::Grid> g(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.012, 0.006));
+  BOOST_REQUIRE_EQUAL(g->num_cells(), 72u);
+  std::vector<double> d(g->num_cells());
+  for (size_t i = 0; i < d.size(); ++i) {
+    d[i] = 1.0 + 0.1 * i;
+  }
+  // every region's "tractions" are its displacements, which their blend must leave as they are
+  const auto copy = [](const size_t, const cm::Grid& disps, cm::Grid& tractions) {
+    tractions.setRawValues(disps.getRawValues());
+  };
+
+  const cm::details::RegionDecomposition none(*g, *g, halves(*g), 0);
+  BOOST_REQUIRE_EQUAL(none.size(), 2u);
+  BOOST_CHECK_EQUAL(none.disps(0).num_cells(), 36u);
+  BOOST_CHECK_EQUAL(none.tractions(1).num_cells(), 36u);
+  const cm::details::WorkerPool two(2);
+  std::vector<double> calc = none.solve(d, two, copy);
+  CHECK_CLOSE_COLLECTION(calc, d, 1e-12);
+
+  // two columns of cells of the other region in either halo, weighing 0.6 and 0.2
+  const cm::details::RegionDecomposition overlapping(*g, *g, halves(*g), 2.5e-3);
+  BOOST_CHECK_EQUAL(overlapping.disps(0).num_cells(), 48u);
+  BOOST_CHECK_EQUAL(overlapping.tractions(1).num_cells(), 48u);
+  calc = overlapping.solve(d, two, copy);
+  CHECK_CLOSE_COLLECTION(calc, d, 1e-12);
+  BOOST_CHECK(overlapping.matches(halves(*g), 2.5e-3));
+  BOOST_CHECK(!overlapping.matches(halves(*g), 1e-3));
+
+  // every region's tractions its number: their blend goes from one to the other across the halos
+  const auto number = [](const size_t r, const cm::Grid&, cm::Grid& tractions) {
+    tractions.setRawValues(std::vector<double>(tractions.num_cells(), double(r)));
+  };
+  calc = overlapping.solve(d, cm::details::WorkerPool(1), number);
+  for (size_t c = 0; c < g->num_cells(); ++c) {
+    const double x = g->cell(c).x;
+    const double expected = x < 0.004 ? 0 : x < 0.005 ? 0.2 / 1.2 : x < 0.006 ? 0.6 / 1.6
+      : x < 0.007 ? 1 / 1.6 : x < 0.008 ? 1 / 1.2 : 1;
+    BOOST_CHECK_CLOSE(calc[c] + 1, expected + 1, 1e-9);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
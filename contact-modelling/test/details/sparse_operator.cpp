@@ -0,0 +1,158 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/grid/grid.hpp"
+#include "cm/details/cell_coordinates.hpp"
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/sparse_operator.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__sparse_operator)
+
+BOOST_AUTO_TEST_CASE(cutoff_matches_dense)
+{
+  struct MockCell { std::array<double, 2> relative_position; };
+  std::vector<MockCell> src_cells(300), dst_cells(200);
+  for (size_t i = 0; i < src_cells.size(); ++i) {
+    src_cells[i].relative_position = {{std::fmod(0.7548776662 * i, 1.0),
+      std::fmod(0.5698402910 * i, 1.0)}};
+  }
+  for (size_t i = 0; i < dst_cells.size(); ++i) {
+    // some of them outside of the src cells' bounding box
+    dst_cells[i].relative_position = {{1.2 * std::fmod(0.1 + 0.7548776662 * i, 1.0) - 0.1,
+      std::fmod(0.3 + 0.5698402910 * i, 1.0)}};
+  }
+  const double radius = 0.15;
+  const auto kernel = [](const size_t a, const size_t b, const double x, const double y) {
+    return (1.0 + a + 2.0*b) / (1.0 + x*x + 0.5*y*y) + 0.1 * a * x - 0.2 * b * y;
+  };
+
+  for (size_t src_dim : {1, 3}) {
+    for (size_t dst_dim : {1, 3}) {
+      std::unique_ptr<cm::Grid> src(
+        cm::Grid::fromSensors(src_dim, cm::Square(0.01), src_cells.cbegin(), src_cells.cend()));
+      std::unique_ptr<cm::Grid> dst(
+        cm::Grid::fromSensors(dst_dim, cm::Square(0.01), dst_cells.cbegin(), dst_cells.cend()));
+      const cm::details::CellCoordinates sc(*src);
+      const cm::details::CellCoordinates dc(*dst);
+      const auto coefficients = [&](const size_t* s, const size_t n_s, const size_t* d,
+        const size_t n_d, arma::mat& block)
+      {
+        for (size_t j = 0; j < n_s; ++j) {
+          for (size_t i = 0; i < n_d; ++i) {
+            for (size_t a = 0; a < dst_dim; ++a) {
+              for (size_t b = 0; b < src_dim; ++b) {
+                block(dst_dim*i + a, src_dim*j + b) =
+                  kernel(a, b, dc.x[d[i]] - sc.x[s[j]], dc.y[d[i]] - sc.y[s[j]]);
+              }
+            }
+          }
+        }
+      };
+      const std::unique_ptr<cm::details::SparseOperator> op =
+        cm::details::cutoff_operator(sc, dc, src_dim, dst_dim, coefficients, radius, 2);
+
+      arma::mat m(dst_dim * dc.size(), src_dim * sc.size());
+      m.zeros();
+      size_t expected_blocks = 0;
+      for (size_t j = 0; j < sc.size(); ++j) {
+        for (size_t i = 0; i < dc.size(); ++i) {
+          const double x = dc.x[i] - sc.x[j];
+          const double y = dc.y[i] - sc.y[j];
+          if (x*x + y*y > radius*radius) {
+            continue;
+          }
+          ++expected_blocks;
+          for (size_t a = 0; a < dst_dim; ++a) {
+            for (size_t b = 0; b < src_dim; ++b) {
+              m(dst_dim*i + a, src_dim*j + b) = kernel(a, b, x, y);
+            }
+          }
+        }
+      }
+      BOOST_REQUIRE_EQUAL(op->n_rows(), m.n_rows);
+      BOOST_REQUIRE_EQUAL(op->n_cols(), m.n_cols);
+      BOOST_CHECK_EQUAL(op->nonzero_blocks(), expected_blocks);
+
+      std::vector<double> x(m.n_cols);
+      for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 1.0 + 0.1 * (i % 7);
+      }
+      std::vector<double> y(m.n_rows);
+      for (size_t i = 0; i < y.size(); ++i) {
+        y[i] = 1.0 - 0.1 * (i % 5);
+      }
+      const std::vector<double> expected_y =
+        arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+      const std::vector<double> expected_x =
+        arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+      const std::vector<double> calc_y = op->apply(x);
+      const std::vector<double> calc_x = op->apply_transpose(y);
+      CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_y, expected_y, 1e-10, 1e-12);
+      CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_x, expected_x, 1e-10, 1e-12);
+
+      // the same coefficients column by column, rows increasing
+      std::vector<int> col_begin, row_ind;
+      std::vector<double> values;
+      op->compressed_columns(col_begin, row_ind, values);
+      BOOST_REQUIRE_EQUAL(col_begin.size(), m.n_cols + 1);
+      BOOST_CHECK_EQUAL(size_t(col_begin.back()), expected_blocks * src_dim * dst_dim);
+      arma::mat from_columns(m.n_rows, m.n_cols);
+      from_columns.zeros();
+      for (size_t j = 0; j < m.n_cols; ++j) {
+        for (int k = col_begin[j]; k < col_begin[j + 1]; ++k) {
+          if (k > col_begin[j]) {
+            BOOST_CHECK_LT(row_ind[k - 1], row_ind[k]);
+          }
+          from_columns(row_ind[k], j) = values[k];
+        }
+      }
+      const std::vector<double> expected_m(m.memptr(), m.memptr() + m.n_elem);
+      const std::vector<double> calc_m(from_columns.memptr(),
+        from_columns.memptr() + from_columns.n_elem);
+      CHECK_CLOSE_COLLECTION(calc_m, expected_m, 1e-12);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(transpose_in_chunks)
+{
+  // more dst cells than a chunk of apply_transpose(): the chunks' partial sums are added up in
+  // the same order whatever the number of threads
+  const size_t n_dst = 2 * cm::details::SparseOperator::transpose_chunk + 100;
+  const size_t n_src = 300;
+  std::vector<size_t> row_begin(1, 0);
+  std::vector<size_t> cols;
+  std::vector<double> values;
+  arma::mat dense(n_dst, n_src);
+  dense.zeros();
+  for (size_t i = 0; i < n_dst; ++i) {
+    for (size_t k = 0; k < 3; ++k) {
+      const size_t j = (7*i + 101*k) % n_src;
+      if (k > 0 && j <= cols.back()) {
+        continue;
+      }
+      cols.push_back(j);
+      values.push_back(1.0 + 0.01 * ((i + k) % 13));
+      dense(i, j) = values.back();
+    }
+    row_begin.push_back(cols.size());
+  }
+  std::vector<double> y(n_dst);
+  for (size_t i = 0; i < n_dst; ++i) {
+    y[i] = std::sin(0.1 * i);
+  }
+  const std::vector<double> expected =
+    arma::conv_to<std::vector<double>>::from(dense.t() * arma::colvec(y));
+  const cm::details::SparseOperator single(n_src, 1, 1, row_begin, cols, values);
+  const cm::details::SparseOperator threaded(n_src, 1, 1, row_begin, cols, values, 3);
+  const std::vector<double> calc = single.apply_transpose(y);
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-10);
+  BOOST_CHECK(threaded.apply_transpose(y) == calc);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,82 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/symmetric_operator.hpp"
+#include "cm/grid/grid.hpp"
+#include "cm/grid/cell_shapes.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__symmetric_operator)
+
+BOOST_AUTO_TEST_CASE(packed_matches_dense)
+{
+  // a few blocks of apply(), the last one shorter
+  const size_t n = 150;
+  arma::mat m(n, n);
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t i = 0; i <= j; ++i) {
+      m(i, j) = m(j, i) = 1.0 / (1.0 + std::fabs(double(i) - double(j))) + 0.01 * ((i*j) % 5);
+    }
+  }
+  std::vector<double> x(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  const std::vector<double> expected = arma::conv_to<std::vector<double>>::from(
+    m * arma::colvec(x));
+
+  const cm::details::SymmetricOperator op(m);
+  BOOST_CHECK_EQUAL(op.packed().size(), n*(n+1)/2);
+  const std::vector<double> calc = op.apply(x);
+  const std::vector<double> calc_t = op.apply_transpose(x);
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-10);
+  CHECK_CLOSE_COLLECTION(calc_t, expected, 1e-10);
+
+  const cm::details::SymmetricOperator threaded(m, 3);
+  const std::vector<double> calc_threaded = threaded.apply(x);
+  BOOST_CHECK(calc_threaded == calc);
+
+  const cm::details::SymmetricOperator doubled(op, 2);
+  const std::vector<double> calc_doubled = doubled.apply(x);
+  std::vector<double> expected_doubled(expected);
+  for (double& v : expected_doubled) {
+    v *= 2;
+  }
+  CHECK_CLOSE_COLLECTION(calc_doubled, expected_doubled, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(inverse_matches_pinv)
+{
+  // rank-deficient: the pseudoinverse's tolerance drops the zero eigenvalues
+  const size_t n = 40;
+  arma::mat b(n, n - 5);
+  for (size_t j = 0; j < b.n_cols; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      b(i, j) = std::sin(0.3 * i * (j + 1)) + (i == j ? 2.0 : 0.0);
+    }
+  }
+  const arma::mat a = b * b.t();
+  const arma::mat expected = arma::pinv(a);
+  const arma::mat calc = cm::details::symmetric_inverse(a);
+  BOOST_CHECK_LT(arma::norm(calc - expected, "fro") / arma::norm(expected, "fro"), 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE(coinciding_grids)
+{
+  std::unique_ptr<cm::Grid> a(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.005, 0.004));
+  std::unique_ptr<cm::Grid> b(cm::Grid::fromEmpty(1, a->getCellShape()));
+  b->clone_structure(*a);
+  BOOST_CHECK(cm::details::coincide(*a, *b));
+  std::unique_ptr<cm::Grid> c(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.005, 0.004));
+  BOOST_CHECK(!cm::details::coincide(*a, *c));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.005, 0.005));
+  BOOST_CHECK(!cm::details::coincide(*a, *d));
+  b->reorderCells(cm::CellOrder::hilbert);
+  BOOST_CHECK(!cm::details::coincide(*a, *b));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,71 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/tikhonov.hpp"
+
+BOOST_AUTO_TEST_SUITE(details__tikhonov)
+
+BOOST_AUTO_TEST_CASE(matches_normal_equations)
+{
+  const double regularisation = 1e-4;
+  // tall and wide, all positive and decaying away from the diagonal like the models
+  for (const size_t n_rows : {40, 25}) {
+    const size_t n_cols = 65 - n_rows;
+    arma::mat a(n_rows, n_cols);
+    for (size_t j = 0; j < n_cols; ++j) {
+      for (size_t i = 0; i < n_rows; ++i) {
+        const double di = double(i) / n_rows - double(j) / n_cols;
+        a(i, j) = 1.0 / (1.0 + 30*std::fabs(di)) + 0.01 * std::sin(0.7*i + 1.1*j);
+      }
+    }
+    arma::mat g = a.t() * a;
+    const arma::colvec ev = arma::eig_sym(g);
+    double largest = 0;
+    for (size_t i = 0; i < ev.n_elem; ++i) {
+      largest = std::max(largest, ev(i));
+    }
+    for (size_t i = 0; i < g.n_rows; ++i) {
+      g(i, i) += regularisation * largest;
+    }
+    const arma::mat expected = arma::solve(g, arma::mat(a.t()));
+    const arma::mat calc = cm::details::tikhonov_inverse(a, regularisation);
+    BOOST_REQUIRE_EQUAL(calc.n_rows, n_cols);
+    BOOST_REQUIRE_EQUAL(calc.n_cols, n_rows);
+    const std::vector<double> expected_v(expected.memptr(), expected.memptr() + expected.n_elem);
+    const std::vector<double> calc_v(calc.memptr(), calc.memptr() + calc.n_elem);
+    CHECK_CLOSE_COLLECTION(calc_v, expected_v, 1e-4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(largest_eigenvalue)
+{
+  // the dominant eigenvector (1, -1, 1, -1, ...) is orthogonal to the ones
+  const size_t n = 30;
+  arma::mat g(n, n);
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      g(i, j) = (i == j ? 2.0 : 0.0) + (((i + j) % 2) ? -1.0 : 1.0) / n
+        + 0.1 / (1.0 + std::fabs(double(i) - double(j)));
+    }
+  }
+  const arma::colvec ev = arma::eig_sym(g);
+  double expected = 0;
+  for (size_t i = 0; i < ev.n_elem; ++i) {
+    expected = std::max(expected, ev(i));
+  }
+  BOOST_CHECK_CLOSE(cm::details::largest_eigenvalue(g), expected, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(rejects_nonpositive_regularisation)
+{
+  arma::mat a(3, 3);
+  a.fill(1.0);
+  BOOST_CHECK_THROW(cm::details::tikhonov_inverse(a, 0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "cm/details/external/armadillo.hpp"
+#include "cm/details/truncated_svd.hpp"
+
+namespace {
+
+/**
+ * \brief   Smooth, all positive and decaying away from the diagonal like the models: rapidly
+ *          decaying singular values
+ */
+arma::mat model_like(const size_t n_rows, const size_t n_cols)
+{
+  arma::mat a(n_rows, n_cols);
+  for (size_t j = 0; j < n_cols; ++j) {
+    for (size_t i = 0; i < n_rows; ++i) {
+      const double d = double(i) / n_rows - double(j) / n_cols;
+      a(i, j) = std::exp(-40 * d * d);
+    }
+  }
+  return a;
+}
+
+std::vector<double> ramp(const size_t n)
+{
+  std::vector<double> x(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  return x;
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(details__truncated_svd)
+
+BOOST_AUTO_TEST_CASE(complete_matches_pinv)
+{
+  arma::mat a = model_like(50, 40);
+  for (size_t i = 0; i < a.n_cols; ++i) {
+    a(i, i) += 0.1;
+  }
+  const auto svd = std::make_shared<const cm::details::TruncatedSVD>(
+    cm::details::truncated_svd(a, 0));
+  BOOST_CHECK(svd->complete);
+  const cm::details::SpectralInverseOperator op(svd, 0, 0, 1, 3);
+  BOOST_REQUIRE_EQUAL(op.n_rows(), 40u);
+  BOOST_REQUIRE_EQUAL(op.n_cols(), 50u);
+
+  const arma::mat inv = arma::pinv(a);
+  const std::vector<double> x = ramp(50);
+  const std::vector<double> y = ramp(40);
+  const std::vector<double> expected_y = arma::conv_to<std::vector<double>>::from(
+    inv * arma::colvec(x));
+  const std::vector<double> expected_x = arma::conv_to<std::vector<double>>::from(
+    inv.t() * arma::colvec(y));
+  const std::vector<double> calc_y = op.apply(x);
+  const std::vector<double> calc_x = op.apply_transpose(y);
+  CHECK_CLOSE_COLLECTION(calc_y, expected_y, 1e-6);
+  CHECK_CLOSE_COLLECTION(calc_x, expected_x, 1e-6);
+
+  // the same decomposition, half as stiff
+  const cm::details::SpectralInverseOperator scaled(svd, 0, 0, 0.5);
+  const std::vector<double> calc_scaled = scaled.apply(x);
+  std::vector<double> expected_scaled(expected_y);
+  for (double& v : expected_scaled) {
+    v *= 2;
+  }
+  CHECK_CLOSE_COLLECTION(calc_scaled, expected_scaled, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(randomized_matches_complete)
+{
+  const arma::mat a = model_like(300, 200);
+  const size_t rank = 12;
+  const cm::details::TruncatedSVD full = cm::details::truncated_svd(a, 0);
+  const auto svd = std::make_shared<const cm::details::TruncatedSVD>(
+    cm::details::truncated_svd(a, rank));
+  BOOST_CHECK(!svd->complete);
+  BOOST_REQUIRE_EQUAL(svd->s.n_elem, rank);
+  BOOST_REQUIRE_EQUAL(svd->u.n_cols, rank);
+  BOOST_REQUIRE_EQUAL(svd->v.n_cols, rank);
+  BOOST_TEST_MESSAGE("singular values " << full.s(0) << " .. " << full.s(rank - 1) << ", next "
+    << full.s(rank));
+  for (size_t j = 0; j < rank; ++j) {
+    BOOST_CHECK_CLOSE(svd->s(j), full.s(j), 1e-6);
+  }
+
+  // the inverse of the same rank, Tikhonov-filtered
+  const double regularisation = 1e-6;
+  const cm::details::SpectralInverseOperator op(svd, rank, regularisation);
+  const cm::details::SpectralInverseOperator expected_op(
+    std::make_shared<const cm::details::TruncatedSVD>(full), rank, regularisation);
+  const std::vector<double> x = ramp(300);
+  const std::vector<double> calc = op.apply(x);
+  const std::vector<double> expected = expected_op.apply(x);
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-4);
+
+  BOOST_CHECK(svd->covers(rank));
+  BOOST_CHECK(svd->covers(rank - 1));
+  BOOST_CHECK(!svd->covers(rank + 1));
+  BOOST_CHECK(!svd->covers(0));
+  BOOST_CHECK_THROW(cm::details::SpectralInverseOperator(svd, rank + 1, 0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
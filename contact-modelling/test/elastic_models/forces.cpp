@@ -4,6 +4,12 @@
 #include <cstddef>
 #include <array>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <boost/filesystem.hpp>
 
 #include "cm/algorithm/forces_to_displacements.hpp"
 #include "cm/algorithm/displacements_to_forces.hpp"
@@ -404,4 +410,709 @@ BOOST_AUTO_TEST_CASE(psi)
 }
 
 
+// The matrices are assembled in tiles of displacement cells; make sure a grid spanning more than
+// one tile gives the same coefficients as evaluating CoeffsBouss/bouss_*/appro_* pair by pair.
+BOOST_AUTO_TEST_CASE(test_matrix_tiles_match_pairwise)
+{
+  namespace bi = cm::details::impl;
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.013, 0.011));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(1e-3), 0.0005, 0, 0.0135, 0.011));
+  BOOST_REQUIRE(d->num_cells() > bi::BoussTile::size);
+  const double s = f->getCellShape().area();
+
+  arma::mat calc_mat = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+  BOOST_REQUIRE_EQUAL(3*d->num_cells(), calc_mat.n_rows);
+  BOOST_REQUIRE_EQUAL(3*f->num_cells(), calc_mat.n_cols);
+
+  arma::mat expected(calc_mat.n_rows, calc_mat.n_cols);
+  for (size_t id = 0; id < d->num_cells(); ++id) {
+    for (size_t jf = 0; jf < f->num_cells(); ++jf) {
+      const double x = d->cell(id).x - f->cell(jf).x;
+      const double y = d->cell(id).y - f->cell(jf).y;
+      const bi::CoeffsBouss cb(skin_attr.E, x, y, skin_attr.h, s, true);
+      const bool origin = (x == 0 && y == 0);
+      const double b[3][3] = {
+        {bi::bouss_xx(skin_attr,cb,x,y), bi::bouss_xy(skin_attr,cb,x,y), bi::bouss_xz(skin_attr,cb,x,y)},
+        {bi::bouss_yx(skin_attr,cb,x,y), bi::bouss_yy(skin_attr,cb,x,y), bi::bouss_yz(skin_attr,cb,x,y)},
+        {bi::bouss_zx(skin_attr,cb,x,y), bi::bouss_zy(skin_attr,cb,x,y), bi::bouss_zz(skin_attr,cb,x,y)}
+      };
+      const double a[3] = {bi::appro_xx(skin_attr,cb), bi::appro_yy(skin_attr,cb), bi::appro_zz(skin_attr,cb)};
+      for (size_t i = 0; i < 3; ++i) {
+        const bool appro = origin || std::fabs(a[i]) < std::fabs(b[i][i]);
+        for (size_t j = 0; j < 3; ++j) {
+          expected(3*id + i, 3*jf + j) = appro ? ((i == j) ? a[i] : 0) : b[i][j];
+        }
+      }
+    }
+  }
+  CHECK_CLOSE_COLLECTION(expected, calc_mat, eps_normal_nums);
+};
+
+// Multithreaded assembly splits the columns among the threads; the result has to be exactly the
+// one of the serial assembly, for all the combinations of dimensions.
+BOOST_AUTO_TEST_CASE(test_matrix_threads_bit_identical)
+{
+  for (size_t f_dim : {1, 3}) {
+    for (size_t d_dim : {1, 3}) {
+      std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(f_dim, cm::Square(1e-3), 0, 0, 0.013, 0.011));
+      std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(d_dim, cm::Square(1e-3), 0.0005, 0, 0.0135, 0.011));
+      const arma::mat serial = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true, 1);
+      for (size_t num_threads : {2, 3, 0}) {
+        const arma::mat parallel =
+          cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true, num_threads);
+        BOOST_REQUIRE_EQUAL(serial.n_rows, parallel.n_rows);
+        BOOST_REQUIRE_EQUAL(serial.n_cols, parallel.n_cols);
+        BOOST_CHECK_MESSAGE(std::equal(serial.begin(), serial.end(), parallel.begin()),
+          "f_dim: " << f_dim << ", d_dim: " << d_dim << ", num_threads: " << num_threads);
+      }
+    }
+  }
+};
+
+// A change of E merely scales the matrices; recalibrate() must match offline() with the new E.
+BOOST_AUTO_TEST_CASE(test_alg_recalibrate_matches_offline)
+{
+  cm::AlgForcesToDisplacements fd;
+  cm::AlgForcesToDisplacements::params_type fd_params;
+  fd_params.skin_props = skin_attr;
+  fd_params.psi_exact = true;
+  cm::AlgForcesToDisplacements::params_type fd_new_params = fd_params;
+  fd_new_params.skin_props.E = 0.4 * skin_attr.E;
+
+  boost::any fd_pre = fd.offline(*force33_grid, *disps33_grid, fd_params);
+  fd.run(*force33_grid, *disps33_grid, fd_new_params,
+    fd.recalibrate(*force33_grid, *disps33_grid, fd_params, fd_pre, fd_new_params));
+  const std::vector<double> recalibrated_disps(disps33_grid->getRawValues());
+  fd.run(*force33_grid, *disps33_grid, fd_new_params,
+    fd.offline(*force33_grid, *disps33_grid, fd_new_params));
+  CHECK_CLOSE_COLLECTION(recalibrated_disps, disps33_grid->getRawValues(), eps_normal_nums);
+
+  cm::AlgDisplacementsToForces df;
+  cm::AlgDisplacementsToForces::params_type df_params;
+  df_params.skin_props = skin_attr;
+  df_params.psi_exact = true;
+  cm::AlgDisplacementsToForces::params_type df_new_params = df_params;
+  df_new_params.skin_props.E = fd_new_params.skin_props.E;
+
+  boost::any df_pre = df.offline(*disps33_grid, *force33_grid, df_params);
+  df.run(*disps33_grid, *force33_grid, df_new_params,
+    df.recalibrate(*disps33_grid, *force33_grid, df_params, df_pre, df_new_params));
+  const std::vector<double> recalibrated_forces(force33_grid->getRawValues());
+  df.run(*disps33_grid, *force33_grid, df_new_params,
+    df.offline(*disps33_grid, *force33_grid, df_new_params));
+  CHECK_CLOSE_COLLECTION_IGNORE_SMALL(recalibrated_forces, force33_grid->getRawValues(),
+    eps_normal_nums, small_threshold);
+};
+
+// The matrix-free operator evaluates the same coefficients as the matrix; only the order of the
+// summations differs.
+BOOST_AUTO_TEST_CASE(test_operator_matches_matrix)
+{
+  for (size_t f_dim : {1, 3}) {
+    for (size_t d_dim : {1, 3}) {
+      std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(f_dim, cm::Square(1e-3), 0, 0, 0.013, 0.011));
+      std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(d_dim, cm::Square(1e-3), 0.0005, 0, 0.0135, 0.011));
+      const arma::mat m = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+      std::vector<double> x(m.n_cols);
+      for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 1.0 + 0.1 * (i % 7);
+      }
+      std::vector<double> y(m.n_rows);
+      for (size_t i = 0; i < y.size(); ++i) {
+        y[i] = 1e-4 * (1.0 + 0.1 * (i % 5));
+      }
+      const std::vector<double> expected_y =
+        arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+      const std::vector<double> expected_x =
+        arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+      const double small_y = 1e-9 * arma::abs(arma::colvec(expected_y)).max();
+      const double small_x = 1e-9 * arma::abs(arma::colvec(expected_x)).max();
+      std::vector<double> expected_norms(m.n_cols);
+      for (size_t j = 0; j < m.n_cols; ++j) {
+        expected_norms[j] = arma::norm(m.col(j), 2);
+      }
+      for (size_t num_threads : {1, 3}) {
+        const std::unique_ptr<cm::details::LinearOperator> op =
+          cm::details::forces_to_displacements_operator(*f, *d, skin_attr, true, num_threads);
+        BOOST_REQUIRE_EQUAL(op->n_rows(), m.n_rows);
+        BOOST_REQUIRE_EQUAL(op->n_cols(), m.n_cols);
+        const std::vector<double> calc_y = op->apply(x);
+        const std::vector<double> calc_x = op->apply_transpose(y);
+        const std::vector<double> calc_norms = op->column_norms();
+        CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_y, expected_y, 1e-8, small_y);
+        CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_x, expected_x, 1e-8, small_x);
+        CHECK_CLOSE_COLLECTION(calc_norms, expected_norms, 1e-8);
+        const std::vector<size_t> cols = {m.n_cols - 1, 0, m.n_cols / 2};
+        const arma::mat calc_cols = op->columns(cols);
+        BOOST_REQUIRE_EQUAL(calc_cols.n_cols, cols.size());
+        for (size_t k = 0; k < cols.size(); ++k) {
+          const std::vector<double> calc_col =
+            arma::conv_to<std::vector<double>>::from(calc_cols.col(k));
+          const std::vector<double> expected_col =
+            arma::conv_to<std::vector<double>>::from(m.col(cols[k]));
+          CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_col, expected_col, 1e-8,
+            1e-9 * arma::abs(m.col(cols[k])).max());
+        }
+      }
+    }
+  }
+};
+
+BOOST_AUTO_TEST_CASE(test_alg_matrix_free)
+{
+  std::vector<double> local_copy(disps33_grid->getRawValues());
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type   params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  params.matrix_free = true;
+
+  boost::any pre = alg.offline(*force33_grid, *disps33_grid, params);
+  alg.run(*force33_grid, *disps33_grid, params, pre);
+
+  CHECK_CLOSE_COLLECTION(local_copy, disps33_grid->getRawValues(), eps_small_nums);
+};
+
+// The convolution evaluates the coefficients at the exact offsets, the matrix at the quantized
+// ones (\sa OffsetKey); they agree up to rounding.
+BOOST_AUTO_TEST_CASE(test_convolution_matches_matrix)
+{
+  for (size_t f_dim : {1, 3}) {
+    for (size_t d_dim : {1, 3}) {
+      std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(f_dim, cm::Square(1e-3), 0, 0, 0.013, 0.011));
+      std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(d_dim, cm::Square(1e-3), 0.0005, 0, 0.0095, 0.016));
+      const arma::mat m = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+      const std::unique_ptr<cm::details::LinearOperator> op =
+        cm::details::forces_to_displacements_convolution(*f, *d, skin_attr, true);
+      BOOST_REQUIRE(op);
+      BOOST_REQUIRE_EQUAL(op->n_rows(), m.n_rows);
+      BOOST_REQUIRE_EQUAL(op->n_cols(), m.n_cols);
+      std::vector<double> x(m.n_cols);
+      for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 1.0 + 0.1 * (i % 7);
+      }
+      std::vector<double> y(m.n_rows);
+      for (size_t i = 0; i < y.size(); ++i) {
+        y[i] = 1e-4 * (1.0 + 0.1 * (i % 5));
+      }
+      const std::vector<double> expected_y =
+        arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+      const std::vector<double> expected_x =
+        arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+      const double small_y = 1e-9 * arma::abs(arma::colvec(expected_y)).max();
+      const double small_x = 1e-9 * arma::abs(arma::colvec(expected_x)).max();
+      const std::vector<double> calc_y = op->apply(x);
+      const std::vector<double> calc_x = op->apply_transpose(y);
+      CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_y, expected_y, 1e-8, small_y);
+      CHECK_CLOSE_COLLECTION_IGNORE_SMALL(calc_x, expected_x, 1e-8, small_x);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_convolution_irregular_grids)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.005, 0.005));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(0.7e-3), 0, 0, 0.005, 0.005));
+  BOOST_CHECK(!cm::details::forces_to_displacements_convolution(*f, *d, skin_attr, true));
+  // the algorithm falls back to the matrix
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  params.convolution = true;
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_convolution)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const std::vector<double> expected(d->getRawValues());
+
+  params.convolution = true;
+  pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const std::vector<double> calc(d->getRawValues());
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-8);
+};
+
+BOOST_AUTO_TEST_CASE(test_hmatrix_matches_matrix)
+{
+  // a regular grid with every cell shifted a bit: no lattice
+  struct MockCell { std::array<double, 2> relative_position; };
+  std::vector<MockCell> cells;
+  for (size_t i = 0; i < 30; ++i) {
+    for (size_t j = 0; j < 25; ++j) {
+      cells.push_back({{1e-3 * (i + 0.3 * std::sin(1.0 + 25*i + j)),
+        1e-3 * (j + 0.3 * std::cos(2.0 * (25*i + j)))}});
+    }
+  }
+  for (size_t f_dim : {1, 3}) {
+    for (size_t d_dim : {1, 3}) {
+      std::unique_ptr<cm::Grid> f(
+        cm::Grid::fromSensors(f_dim, cm::Square(1e-3), cells.cbegin(), cells.cend()));
+      std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(d_dim, cm::Square(1.5e-3), 0, 0, 0.03, 0.025));
+      const arma::mat m = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+      const std::unique_ptr<cm::details::HMatrixOperator> op =
+        cm::details::forces_to_displacements_hmatrix(*f, *d, skin_attr, true, 1e-8, 2);
+      BOOST_CHECK_LT(op->stored_coefficients(), m.n_elem);
+
+      std::vector<double> forces(m.n_cols);
+      for (size_t i = 0; i < forces.size(); ++i) {
+        forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+      }
+      const std::vector<double> expected =
+        arma::conv_to<std::vector<double>>::from(m * arma::colvec(forces));
+      const std::vector<double> calc = op->apply(forces);
+      CHECK_CLOSE_COLLECTION(calc, expected, 1e-4);
+
+      std::vector<double> expected_norms(m.n_cols);
+      for (size_t j = 0; j < m.n_cols; ++j) {
+        expected_norms[j] = arma::norm(m.col(j), 2);
+      }
+      const std::vector<double> calc_norms = op->column_norms();
+      CHECK_CLOSE_COLLECTION(calc_norms, expected_norms, 1e-4);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_hierarchical)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(0.7e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const std::vector<double> expected(d->getRawValues());
+
+  params.hierarchical = true;
+  params.hierarchical_tolerance = 1e-8;
+  pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const std::vector<double> calc(d->getRawValues());
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(test_sparse_matches_matrix)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.012, 0.01));
+  const double radius = 3 * skin_attr.h;
+  for (size_t d_dim : {1, 3}) {
+    std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(d_dim, cm::Square(0.7e-3), 0, 0, 0.012, 0.01));
+    arma::mat m = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+    for (size_t i = 0; i < d->num_cells(); ++i) {
+      for (size_t j = 0; j < f->num_cells(); ++j) {
+        const double x = d->cell(i).x - f->cell(j).x;
+        const double y = d->cell(i).y - f->cell(j).y;
+        if (x*x + y*y > radius*radius) {
+          for (size_t a = 0; a < d_dim; ++a) {
+            for (size_t b = 0; b < 3; ++b) {
+              m(d_dim*i + a, 3*j + b) = 0;
+            }
+          }
+        }
+      }
+    }
+    const std::unique_ptr<cm::details::SparseOperator> op =
+      cm::details::forces_to_displacements_sparse(*f, *d, skin_attr, true, radius, 2);
+    BOOST_CHECK_LT(op->nonzero_blocks(), d->num_cells() * f->num_cells());
+
+    std::vector<double> forces(m.n_cols);
+    for (size_t i = 0; i < forces.size(); ++i) {
+      forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+    }
+    const std::vector<double> expected =
+      arma::conv_to<std::vector<double>>::from(m * arma::colvec(forces));
+    const std::vector<double> calc = op->apply(forces);
+    CHECK_CLOSE_COLLECTION(calc, expected, 1e-8);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_mapped)
+{
+  const std::string path = (boost::filesystem::temp_directory_path()
+    / boost::filesystem::unique_path("cm-forces-%%%%-%%%%.mat")).string();
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(0.7e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const std::vector<double> expected(d->getRawValues());
+
+  // written by the first offline(), mapped as is by the second
+  params.mapped_file = path;
+  params.num_threads = 2;
+  for (int i = 0; i < 2; ++i) {
+    pre = alg.offline(*f, *d, params);
+    alg.run(*f, *d, params, pre);
+    const std::vector<double> calc(d->getRawValues());
+    CHECK_CLOSE_COLLECTION(calc, expected, 1e-10);
+  }
+
+  // and the pseudoinverse, written next to it
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type inv_params;
+  inv_params.skin_props = skin_attr;
+  inv_params.psi_exact = true;
+  boost::any inv_pre = inv.offline(*d, *f, inv_params);
+  inv.run(*d, *f, inv_params, inv_pre);
+  const std::vector<double> expected_forces(f->getRawValues());
+  inv_params.mapped_file = path + ".pinv";
+  for (int i = 0; i < 2; ++i) {
+    inv_pre = inv.offline(*d, *f, inv_params);
+    inv.run(*d, *f, inv_params, inv_pre);
+    const std::vector<double> calc(f->getRawValues());
+    CHECK_CLOSE_COLLECTION(calc, expected_forces, 1e-10);
+  }
+
+  boost::filesystem::remove(path);
+  boost::filesystem::remove(inv_params.mapped_file);
+}
+
+// Flags which contradict each other are rejected rather than some of them ignored
+BOOST_AUTO_TEST_CASE(test_alg_conflicting_params)
+{
+  typedef cm::AlgDisplacementsToForces A_d_f;
+  A_d_f::params_type base;
+  base.skin_props = skin_attr;
+  base.psi_exact = true;
+  std::vector<A_d_f::params_type> conflicting(6, base);
+  conflicting[0].iterative = true;
+  conflicting[0].truncated_svd = true;
+  conflicting[1].coarse_to_fine = true;
+  conflicting[1].deconvolution = true;
+  conflicting[2].quantized = true;
+  conflicting[2].single_precision = true;
+  conflicting[3].iterative = true;
+  conflicting[3].hierarchical = true;
+  conflicting[3].matrix_free = true;
+  conflicting[4].multigrid = true;
+  conflicting[5].mapped_file = "unused.mat";
+  conflicting[5].regions = {{{0.002, 0.002}}, {{0.008, 0.002}}};
+  for (size_t i = 0; i < conflicting.size(); ++i) {
+    BOOST_CHECK_THROW(A_d_f().offline(*disps33_grid, *force33_grid, conflicting[i]),
+      std::runtime_error);
+  }
+
+  // and recalibrate() checks the new ones
+  const boost::any pre = A_d_f().offline(*disps33_grid, *force33_grid, base);
+  BOOST_CHECK_THROW(A_d_f().recalibrate(*disps33_grid, *force33_grid, base, pre, conflicting[2]),
+    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_single_precision)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const arma::colvec expected_disps = arma::conv_to<arma::colvec>::from(d->getRawValues());
+
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type inv_params;
+  inv_params.skin_props = skin_attr;
+  inv_params.psi_exact = true;
+  pre = inv.offline(*d, *f, inv_params);
+  inv.run(*d, *f, inv_params, pre);
+  const arma::colvec expected_forces = arma::conv_to<arma::colvec>::from(f->getRawValues());
+
+  params.single_precision = true;
+  pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+  const arma::colvec disps = arma::conv_to<arma::colvec>::from(d->getRawValues());
+  const double disps_error =
+    arma::norm(disps - expected_disps, 2) / arma::norm(expected_disps, 2);
+  BOOST_TEST_MESSAGE("displacements' relative error: " << disps_error);
+  BOOST_CHECK_LT(disps_error, 1e-5);
+
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(expected_disps));
+  inv_params.single_precision = true;
+  pre = inv.offline(*d, *f, inv_params);
+  inv.run(*d, *f, inv_params, pre);
+  const arma::colvec calc_forces = arma::conv_to<arma::colvec>::from(f->getRawValues());
+  const double forces_error =
+    arma::norm(calc_forces - expected_forces, 2) / arma::norm(expected_forces, 2);
+  BOOST_TEST_MESSAGE("forces' relative error: " << forces_error);
+  BOOST_CHECK_LT(forces_error, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_tikhonov)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  const arma::colvec expected(forces);
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type inv_params;
+  inv_params.skin_props = skin_attr;
+  inv_params.psi_exact = true;
+  inv_params.tikhonov = true;
+  inv_params.regularisation = 1e-12;
+  pre = inv.offline(*d, *f, inv_params);
+  inv.run(*d, *f, inv_params, pre);
+  const arma::colvec calc = arma::conv_to<arma::colvec>::from(f->getRawValues());
+  const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("forces' relative error: " << error);
+  BOOST_CHECK_LT(error, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_iterative)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  const arma::colvec expected(forces);
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type inv_params;
+  inv_params.skin_props = skin_attr;
+  inv_params.psi_exact = true;
+  inv_params.iterative = true;
+  inv_params.max_iterations = 100;
+  inv_params.iterative_tolerance = 1e-10;
+  pre = inv.offline(*d, *f, inv_params);
+  // every frame starts where the previous one stopped: on a still contact, the error keeps
+  // decreasing
+  double previous_error = 0;
+  for (size_t frame = 0; frame < 5; ++frame) {
+    inv.run(*d, *f, inv_params, pre);
+    const arma::colvec calc = arma::conv_to<arma::colvec>::from(f->getRawValues());
+    const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+    BOOST_TEST_MESSAGE("frame " << frame << ", forces' relative error: " << error);
+    if (frame > 0) {
+      BOOST_CHECK_LT(error, previous_error);
+    }
+    previous_error = error;
+  }
+  BOOST_CHECK_LT(previous_error, 1e-2);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_iterative_forward_models)
+{
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.02, 0.016));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(3, cm::Square(0.7e-3), 0, 0, 0.02, 0.016));
+  std::vector<double> disps(d->getRawValues().size());
+  for (size_t i = 0; i < disps.size(); ++i) {
+    disps[i] = 1e-4 * (1.0 + (i % 3)) * (1.0 + 0.1 * (i % 11));
+  }
+  d->setRawValues(disps);
+
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  params.iterative = true;
+  params.max_iterations = 10;
+  params.iterative_tolerance = 0;
+  boost::any pre = inv.offline(*d, *f, params);
+  inv.run(*d, *f, params, pre);
+  const arma::colvec expected = arma::conv_to<arma::colvec>::from(f->getRawValues());
+
+  // the same iterations against the model evaluated on the fly, or compressed
+  cm::AlgDisplacementsToForces::params_type matrix_free = params;
+  matrix_free.matrix_free = true;
+  pre = inv.offline(*d, *f, matrix_free);
+  inv.run(*d, *f, matrix_free, pre);
+  arma::colvec calc = arma::conv_to<arma::colvec>::from(f->getRawValues());
+  double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("matrix-free, relative difference: " << error);
+  BOOST_CHECK_LT(error, 1e-9);
+
+  cm::AlgDisplacementsToForces::params_type hierarchical = params;
+  hierarchical.hierarchical = true;
+  hierarchical.hierarchical_tolerance = 1e-8;
+  pre = inv.offline(*d, *f, hierarchical);
+  inv.run(*d, *f, hierarchical, pre);
+  calc = arma::conv_to<arma::colvec>::from(f->getRawValues());
+  error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("hierarchical, relative difference: " << error);
+  BOOST_CHECK_LT(error, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_multigrid)
+{
+  // normal forces on a few levels of 2x the pitch, down to 128 cells
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.03, 0.025));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.03, 0.025));
+  std::vector<double> forces(f->getRawValues().size());
+  for (size_t i = 0; i < forces.size(); ++i) {
+    forces[i] = 0.01 * (1.0 + 0.1 * (i % 11));
+  }
+  const arma::colvec expected(forces);
+  f->setRawValues(forces);
+  cm::AlgForcesToDisplacements alg;
+  cm::AlgForcesToDisplacements::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  boost::any pre = alg.offline(*f, *d, params);
+  alg.run(*f, *d, params, pre);
+
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type inv_params;
+  inv_params.skin_props = skin_attr;
+  inv_params.psi_exact = true;
+  inv_params.iterative = true;
+  inv_params.multigrid = true;
+  inv_params.regularisation = 1e-12;
+  inv_params.max_iterations = 30;
+  inv_params.iterative_tolerance = 1e-10;
+  pre = inv.offline(*d, *f, inv_params);
+  inv.run(*d, *f, inv_params, pre);
+  const arma::colvec calc = arma::conv_to<arma::colvec>::from(f->getRawValues());
+  const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("forces' relative error: " << error);
+  BOOST_CHECK_LT(error, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_symmetric)
+{
+  // normal forces on the displacements' own cells: a symmetric model
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.012, 0.01));
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromEmpty(1, d->getCellShape()));
+  f->clone_structure(*d);
+  std::vector<double> disps(d->num_cells());
+  for (size_t i = 0; i < disps.size(); ++i) {
+    disps[i] = 1e-4 * (1.0 + 0.1 * (i % 11));
+  }
+  d->setRawValues(disps);
+  const arma::mat m = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+  const std::vector<double> expected = arma::conv_to<std::vector<double>>::from(
+    arma::pinv(m) * arma::colvec(disps));
+
+  cm::AlgDisplacementsToForces inv;
+  cm::AlgDisplacementsToForces::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  params.num_threads = 2;
+  boost::any pre = inv.offline(*d, *f, params);
+  inv.run(*d, *f, params, pre);
+  const std::vector<double> calc = f->getRawValues();
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-4);
+
+  // rescaled to a stiffer skin
+  cm::AlgDisplacementsToForces::params_type stiffer = params;
+  stiffer.skin_props.E *= 2;
+  pre = inv.recalibrate(*d, *f, params, pre, stiffer);
+  inv.run(*d, *f, stiffer, pre);
+  const std::vector<double> calc_stiffer = f->getRawValues();
+  std::vector<double> expected_stiffer(expected);
+  for (double& v : expected_stiffer) {
+    v *= 2;
+  }
+  CHECK_CLOSE_COLLECTION(calc_stiffer, expected_stiffer, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(test_alg_deconvolution)
+{
+  // normal forces only: the Fourier symbol of the 3x3 model comes too close to 0 for the
+  // refinement to converge, see DeconvolutionOperator
+  std::unique_ptr<cm::Grid> f(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::vector<double> forces(f->num_cells());
+  for (size_t i = 0; i < f->num_cells(); ++i) {
+    const double x = (f->cell(i).x - 0.007) / 0.002;
+    const double y = (f->cell(i).y - 0.009) / 0.0025;
+    forces[i] = 0.01 * std::exp(-(x*x + y*y));
+  }
+  const arma::mat m = cm::details::forces_to_displacements_matrix(*f, *d, skin_attr, true);
+  const arma::colvec disps = m * arma::colvec(forces);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(disps));
+  const arma::colvec expected = arma::pinv(m) * disps;
+
+  cm::AlgDisplacementsToForces alg;
+  cm::AlgDisplacementsToForces::params_type params;
+  params.skin_props = skin_attr;
+  params.psi_exact = true;
+  params.deconvolution = true;
+  double previous = 1;
+  for (size_t steps : {0, 2, 4}) {
+    params.refinement_steps = steps;
+    boost::any pre = alg.offline(*d, *f, params);
+    alg.run(*d, *f, params, pre);
+    const arma::colvec calc = arma::conv_to<arma::colvec>::from(f->getRawValues());
+    const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+    BOOST_TEST_MESSAGE("refinement steps: " << steps << ", relative error: " << error);
+    BOOST_CHECK_LT(error, 0.2);
+    BOOST_CHECK_LT(error, previous);
+    previous = error;
+  }
+
+  // the refinement doesn't converge on 3-valued grids: dropped rather than blowing up
+  std::unique_ptr<cm::Grid> f3(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.008, 0.008));
+  std::unique_ptr<cm::Grid> d3(cm::Grid::fromFill(3, cm::Square(1e-3), 0, 0, 0.008, 0.008));
+  std::vector<double> disps3(d3->getRawValues().size());
+  for (size_t i = 0; i < disps3.size(); ++i) {
+    disps3[i] = 1e-4 * std::sin(1.0 + i);
+  }
+  d3->setRawValues(disps3);
+  params.refinement_steps = 0;
+  alg.run(*d3, *f3, params, alg.offline(*d3, *f3, params));
+  const std::vector<double> unrefined = f3->getRawValues();
+  params.refinement_steps = 4;
+  alg.run(*d3, *f3, params, alg.offline(*d3, *f3, params));
+  const std::vector<double> refined = f3->getRawValues();
+  CHECK_CLOSE_COLLECTION(refined, unrefined, 1e-10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,8 @@
 #include <boost/any.hpp>
 #include "custom_test_macros.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <array>
 #include <vector>
@@ -10,7 +12,9 @@
 
 #include "cm/algorithm/pressures_to_displacements.hpp"
 #include "cm/algorithm/displacements_to_pressures.hpp"
+#include "cm/algorithm/displacements_to_nonnegative_pressures.hpp"
 #include "cm/details/elastic_model_love.hpp"
+#include "cm/details/love_surrogate.hpp"
 #include "cm/details/string.hpp"
 
 #include "cm/details/external/armadillo.hpp"
@@ -52,6 +56,11 @@ BOOST_AUTO_TEST_CASE(alg_pressures_to_disps)
   A_p_d().run(*press_grid, *disps_grid, params_p_d, pre_p_d);
 
   CHECK_CLOSE_COLLECTION(disps_grid->getRawValues(), expected_disps, 1e-5);
+
+  // the single precision matrix's error bound doesn't hold with a surrogate
+  params_p_d.single_precision = true;
+  params_p_d.surrogate_sampled_tol = 1e-6;
+  BOOST_CHECK_THROW(A_p_d().offline(*press_grid, *disps_grid, params_p_d), std::runtime_error);
 }
 
 BOOST_AUTO_TEST_CASE(alg_disps_to_pressures)
@@ -65,6 +74,57 @@ BOOST_AUTO_TEST_CASE(alg_disps_to_pressures)
   CHECK_CLOSE_COLLECTION(press_grid->getRawValues(), expected_press, 1e-5);
 }
 
+// Recalibrated precomputed data must give the same results as offline() with the new parameters,
+// whether it's rescaled, recombined (parametric) or computed anew (a change of nu otherwise).
+BOOST_AUTO_TEST_CASE(alg_recalibrate_matches_offline)
+{
+  typedef cm::AlgPressuresToDisplacements A_p_d;
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  for (const bool parametric : {false, true}) {
+    for (const double new_nu : {skin_attr.nu, 0.45}) {
+      A_p_d::params_type params_p_d;
+      params_p_d.skin_props = skin_attr;
+      params_p_d.parametric = parametric;
+      A_p_d::params_type new_params_p_d = params_p_d;
+      new_params_p_d.skin_props.E  = 2.5 * skin_attr.E;
+      new_params_p_d.skin_props.nu = new_nu;
+      A_p_d a_p_d;
+      const boost::any pre_p_d = a_p_d.offline(*press_grid, *disps_grid, params_p_d);
+      const boost::any re_p_d =
+        a_p_d.recalibrate(*press_grid, *disps_grid, params_p_d, pre_p_d, new_params_p_d);
+      a_p_d.run(*press_grid, *disps_grid, new_params_p_d, re_p_d);
+      const std::vector<double> recalibrated_disps = disps_grid->getRawValues();
+      a_p_d.run(*press_grid, *disps_grid, new_params_p_d,
+        a_p_d.offline(*press_grid, *disps_grid, new_params_p_d));
+      CHECK_CLOSE_COLLECTION(recalibrated_disps, disps_grid->getRawValues(), 1e-8);
+
+      A_d_p::params_type params_d_p;
+      params_d_p.skin_props = skin_attr;
+      params_d_p.parametric = parametric;
+      A_d_p::params_type new_params_d_p = params_d_p;
+      new_params_d_p.skin_props = new_params_p_d.skin_props;
+      A_d_p a_d_p;
+      const boost::any pre_d_p = a_d_p.offline(*disps_grid, *press_grid, params_d_p);
+      const boost::any re_d_p =
+        a_d_p.recalibrate(*disps_grid, *press_grid, params_d_p, pre_d_p, new_params_d_p);
+      a_d_p.run(*disps_grid, *press_grid, new_params_d_p, re_d_p);
+      const std::vector<double> recalibrated_press = press_grid->getRawValues();
+      a_d_p.run(*disps_grid, *press_grid, new_params_d_p,
+        a_d_p.offline(*disps_grid, *press_grid, new_params_d_p));
+      CHECK_CLOSE_COLLECTION(recalibrated_press, press_grid->getRawValues(), 1e-8);
+    }
+  }
+}
+
+// The parametric mode combines the very terms the matrix is assembled from
+BOOST_AUTO_TEST_CASE(matrix_terms_combine)
+{
+  const cm::details::LoveTermsMatrices terms =
+    cm::details::pressures_to_displacements_terms(*press_grid, *disps_grid, skin_attr);
+  const arma::mat combined = terms.combine(skin_attr.E, skin_attr.nu);
+  CHECK_CLOSE_COLLECTION(combined, press2disps, 1e-5);
+}
+
 /* HARD-CODED pre-computated values follow */
 
 BOOST_AUTO_TEST_CASE(love_r10)
@@ -177,4 +237,738 @@ BOOST_AUTO_TEST_CASE(love_coeff_zn0)
   const double cal = love_coeff(0.001, 0.001, 210000, 0.49, 0.008, 0.007, 0.02);
 }
 
+// The matrix is assembled from a cache of coefficients keyed by the (quantized) offsets between the
+// cells, using the symmetries of the kernel; check it against evaluating love_coeff() pair by pair,
+// with the pressures grid placed so that the offsets take both signs in both directions.
+BOOST_AUTO_TEST_CASE(matrix_cached_match_pairwise)
+{
+  using cm::details::impl::love_coeff;
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Rectangle(1e-3, 2e-3), 0.002, 0.004, 0.006, 0.012));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0, 0.0075, 0.016));
+  const double dx = p->getCellShape().dx()/2.0;
+  const double dy = p->getCellShape().dy()/2.0;
+  const arma::mat calc_mat = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  BOOST_REQUIRE_EQUAL(d->num_cells(), calc_mat.n_rows);
+  BOOST_REQUIRE_EQUAL(p->num_cells(), calc_mat.n_cols);
+
+  arma::mat expected(calc_mat.n_rows, calc_mat.n_cols);
+  for (size_t id = 0; id < d->num_cells(); ++id) {
+    for (size_t ip = 0; ip < p->num_cells(); ++ip) {
+      const double x = d->cell(id).x - p->cell(ip).x;
+      const double y = d->cell(id).y - p->cell(ip).y;
+      expected(id, ip) = love_coeff(dx, dy, skin_attr.E, skin_attr.nu, x, y, 0)
+        - love_coeff(dx, dy, skin_attr.E, skin_attr.nu, x, y, skin_attr.h);
+    }
+  }
+  CHECK_CLOSE_COLLECTION(expected, calc_mat, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(love_coeffs_batch_near)
+{
+  using cm::details::impl::love_coeff;
+  using cm::details::impl::love_coeffs_batch;
+  const double dx = 0.5e-3;
+  const double dy = 0.25e-3;
+  const double h  = skin_attr.h;
+  // offsets up to 10 cells' sizes, including the cell's edges and corners
+  std::vector<double> x;
+  std::vector<double> y;
+  for (int i = -40; i <= 40; ++i) {
+    for (int j = -40; j <= 40; ++j) {
+      x.push_back(i * 0.25*dx);
+      y.push_back(j * 0.25*dy);
+    }
+  }
+  std::vector<double> calc(x.size());
+  love_coeffs_batch(dx, dy, skin_attr.E, skin_attr.nu, h, x.data(), y.data(), x.size(), calc.data());
+
+  std::vector<double> expected(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    expected[i] = love_coeff(dx, dy, skin_attr.E, skin_attr.nu, x[i], y[i], 0)
+      - love_coeff(dx, dy, skin_attr.E, skin_attr.nu, x[i], y[i], h);
+  }
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(love_coeffs_batch_far)
+{
+  using cm::details::impl::love_coeffs_batch;
+  // computed in quad precision from the same formulae as love_coeff(); dx = dy = 0.5e-3,
+  // E = 300000, nu = 0.5, h = 0.002
+  const std::vector<double> x = {0.091, 0.01, 0.05, 0.1, 0.03, 0.0, 0.07};
+  const std::vector<double> y = {0.0,   0.02, 0.05, 0.1, 0.04, 0.1, 0.033};
+  const std::vector<double> expected = {
+    -2.1098114322984381e-15,
+    -1.3991998092800799e-13,
+    -4.4938237015389259e-15,
+    -5.6245509166210682e-16,
+    -1.2688551739504065e-14,
+    -1.5901773667383741e-15,
+    -3.4289666436160631e-15
+  };
+  std::vector<double> calc(x.size());
+  love_coeffs_batch(0.5e-3, 0.5e-3, 300000, 0.5, 0.002, x.data(), y.data(), x.size(), calc.data());
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(matrix_threads_bit_identical)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.007, 0.006));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0, 0.0075, 0.006));
+  const arma::mat serial = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr, 1);
+  for (size_t num_threads : {2, 3, 0}) {
+    const arma::mat parallel =
+      cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr, num_threads);
+    BOOST_REQUIRE_EQUAL(serial.n_rows, parallel.n_rows);
+    BOOST_REQUIRE_EQUAL(serial.n_cols, parallel.n_cols);
+    BOOST_CHECK_MESSAGE(std::equal(serial.begin(), serial.end(), parallel.begin()),
+      "num_threads: " << num_threads);
+  }
+}
+
+// With a surrogate, the coefficients must stay within its sampled tolerance of the exact ones
+// (at the grid's offsets, which aren't the samples), and the near field must be evaluated exactly
+// (i.e. be the very same numbers).
+BOOST_AUTO_TEST_CASE(matrix_surrogate_within_sampled_tol)
+{
+  using cm::details::impl::LoveSurrogate;
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0.0005, 0.0205, 0.0205));
+  const double tol = 1e-6;
+  const arma::mat exact = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  const arma::mat calc = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr, 1, tol);
+  CHECK_CLOSE_COLLECTION(calc, exact, 100*tol);
+
+  const double near = LoveSurrogate::near_cells * p->getCellShape().dx();
+  size_t num_near = 0;
+  size_t num_differ = 0;
+  for (size_t id = 0; id < d->num_cells(); ++id) {
+    for (size_t ip = 0; ip < p->num_cells(); ++ip) {
+      const double x = d->cell(id).x - p->cell(ip).x;
+      const double y = d->cell(id).y - p->cell(ip).y;
+      if (std::fabs(x) < near && std::fabs(y) < near) {
+        ++num_near;
+        BOOST_CHECK_EQUAL(calc(id, ip), exact(id, ip));
+      } else if (calc(id, ip) != exact(id, ip)) {
+        ++num_differ;
+      }
+    }
+  }
+  BOOST_CHECK(num_near > 0);
+  // most of the far field should actually come from the table
+  BOOST_CHECK_GT(num_differ, (calc.n_elem - num_near) / 2);
+}
+
+// On a skin thicker than near_cells cells, the coefficients change their sign at about h from the
+// pressure cell: the surrogate must leave that ring to the closed form as well.
+BOOST_AUTO_TEST_CASE(matrix_surrogate_thick_skin)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0.0005, 0.0205, 0.0205));
+  cm::SkinAttributes thick = skin_attr;
+  thick.h = 0.006;
+  const double tol = 1e-6;
+  const arma::mat exact = cm::details::pressures_to_displacements_matrix(*p, *d, thick);
+  const arma::mat calc = cm::details::pressures_to_displacements_matrix(*p, *d, thick, 1, tol);
+  CHECK_CLOSE_COLLECTION(calc, exact, 100*tol);
+
+  size_t num_near = 0;
+  for (size_t id = 0; id < d->num_cells(); ++id) {
+    for (size_t ip = 0; ip < p->num_cells(); ++ip) {
+      const double x = d->cell(id).x - p->cell(ip).x;
+      const double y = d->cell(id).y - p->cell(ip).y;
+      if (std::fabs(x) < 2*thick.h && std::fabs(y) < 2*thick.h) {
+        ++num_near;
+        BOOST_CHECK_EQUAL(calc(id, ip), exact(id, ip));
+      }
+    }
+  }
+  BOOST_CHECK(num_near > 0);
+}
+
+BOOST_AUTO_TEST_CASE(surrogate_rejects_tiny_tol)
+{
+  using cm::details::impl::LoveSurrogate;
+  BOOST_CHECK_THROW(LoveSurrogate(0.5e-3, 0.5e-3, 0.002, 0.5, 0.01, 0.01, 1e-9),
+    std::runtime_error);
+}
+
+// The matrix-free operator evaluates the same coefficients as the matrix (exactly or from the
+// same surrogate); only the order of the summations differs.
+BOOST_AUTO_TEST_CASE(operator_matches_matrix)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.012, 0.01));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0.0005, 0.0125, 0.0105));
+  for (const double sampled_tol : {0.0, 1e-6}) {
+    const arma::mat m =
+      cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr, 1, sampled_tol);
+    std::vector<double> x(m.n_cols);
+    for (size_t i = 0; i < x.size(); ++i) {
+      x[i] = 1.0 + 0.1 * (i % 7);
+    }
+    std::vector<double> y(m.n_rows);
+    for (size_t i = 0; i < y.size(); ++i) {
+      y[i] = 1e-4 * (1.0 + 0.1 * (i % 5));
+    }
+    const std::vector<double> expected_y =
+      arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+    const std::vector<double> expected_x =
+      arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+    std::vector<double> expected_norms(m.n_cols);
+    for (size_t j = 0; j < m.n_cols; ++j) {
+      expected_norms[j] = arma::norm(m.col(j), 2);
+    }
+    for (size_t num_threads : {1, 3}) {
+      const std::unique_ptr<cm::details::LinearOperator> op =
+        cm::details::pressures_to_displacements_operator(*p, *d, skin_attr, num_threads,
+          sampled_tol);
+      BOOST_REQUIRE_EQUAL(op->n_rows(), m.n_rows);
+      BOOST_REQUIRE_EQUAL(op->n_cols(), m.n_cols);
+      const std::vector<double> calc_y = op->apply(x);
+      const std::vector<double> calc_x = op->apply_transpose(y);
+      const std::vector<double> calc_norms = op->column_norms();
+      CHECK_CLOSE_COLLECTION(calc_y, expected_y, 1e-8);
+      CHECK_CLOSE_COLLECTION(calc_x, expected_x, 1e-8);
+      CHECK_CLOSE_COLLECTION(calc_norms, expected_norms, 1e-8);
+      const std::vector<size_t> cols = {m.n_cols - 1, 0, m.n_cols / 2};
+      const arma::mat calc_cols = op->columns(cols);
+      BOOST_REQUIRE_EQUAL(calc_cols.n_cols, cols.size());
+      for (size_t k = 0; k < cols.size(); ++k) {
+        const std::vector<double> calc_col =
+          arma::conv_to<std::vector<double>>::from(calc_cols.col(k));
+        const std::vector<double> expected_col =
+          arma::conv_to<std::vector<double>>::from(m.col(cols[k]));
+        CHECK_CLOSE_COLLECTION(calc_col, expected_col, 1e-8);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(operator_threads_bit_identical)
+{
+  // more columns than LoveOperator::apply_chunk, so that apply() sums several chunks up
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.024, 0.024));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0.0005, 0.0245, 0.0245));
+  std::vector<double> x(p->num_cells());
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  const std::vector<double> reference =
+    cm::details::pressures_to_displacements_operator(*p, *d, skin_attr, 1)->apply(x);
+  for (size_t num_threads : {2, 3, 0}) {
+    const std::vector<double> calc =
+      cm::details::pressures_to_displacements_operator(*p, *d, skin_attr, num_threads)->apply(x);
+    BOOST_CHECK_MESSAGE(calc == reference, "num_threads: " << num_threads);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(alg_pressures_to_disps_matrix_free)
+{
+  typedef cm::AlgPressuresToDisplacements A_p_d;
+  A_p_d::params_type params_p_d;
+  params_p_d.skin_props = skin_attr;
+  params_p_d.matrix_free = true;
+  boost::any pre_p_d = A_p_d().offline(*press_grid, *disps_grid, params_p_d);
+  A_p_d().run(*press_grid, *disps_grid, params_p_d, pre_p_d);
+
+  CHECK_CLOSE_COLLECTION(disps_grid->getRawValues(), expected_disps, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(convolution_matches_matrix)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.012, 0.01));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0.0005, 0.0005, 0.0085, 0.0155));
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  const std::unique_ptr<cm::details::LinearOperator> op =
+    cm::details::pressures_to_displacements_convolution(*p, *d, skin_attr);
+  BOOST_REQUIRE(op);
+  BOOST_REQUIRE_EQUAL(op->n_rows(), m.n_rows);
+  BOOST_REQUIRE_EQUAL(op->n_cols(), m.n_cols);
+  std::vector<double> x(m.n_cols);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  std::vector<double> y(m.n_rows);
+  for (size_t i = 0; i < y.size(); ++i) {
+    y[i] = 1e-4 * (1.0 + 0.1 * (i % 5));
+  }
+  const std::vector<double> expected_y =
+    arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+  const std::vector<double> expected_x =
+    arma::conv_to<std::vector<double>>::from(m.t() * arma::colvec(y));
+  const std::vector<double> calc_y = op->apply(x);
+  const std::vector<double> calc_x = op->apply_transpose(y);
+  CHECK_CLOSE_COLLECTION(calc_y, expected_y, 1e-8);
+  CHECK_CLOSE_COLLECTION(calc_x, expected_x, 1e-8);
+
+  std::unique_ptr<cm::Grid> irregular(
+    cm::Grid::fromFill(1, cm::Square(0.7e-3), 0.0005, 0.0005, 0.0085, 0.0155));
+  BOOST_CHECK(!cm::details::pressures_to_displacements_convolution(*p, *irregular, skin_attr));
+}
+
+BOOST_AUTO_TEST_CASE(hmatrix_matches_matrix)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.03, 0.025));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(0.7e-3), 0, 0, 0.03, 0.025));
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  const std::unique_ptr<cm::details::HMatrixOperator> op =
+    cm::details::pressures_to_displacements_hmatrix(*p, *d, skin_attr, 1e-8, 2);
+  BOOST_CHECK_LT(op->stored_coefficients(), m.n_elem);
+  std::vector<double> x(m.n_cols);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  const std::vector<double> expected =
+    arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+  const std::vector<double> calc = op->apply(x);
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-4);
+
+  std::vector<double> expected_norms(m.n_cols);
+  for (size_t j = 0; j < m.n_cols; ++j) {
+    expected_norms[j] = arma::norm(m.col(j), 2);
+  }
+  const std::vector<double> calc_norms = op->column_norms();
+  CHECK_CLOSE_COLLECTION(calc_norms, expected_norms, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_matches_matrix)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.012, 0.01));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(0.7e-3), 0, 0, 0.012, 0.01));
+  const double radius = 3 * skin_attr.h;
+  arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  for (size_t i = 0; i < d->num_cells(); ++i) {
+    for (size_t j = 0; j < p->num_cells(); ++j) {
+      const double x = d->cell(i).x - p->cell(j).x;
+      const double y = d->cell(i).y - p->cell(j).y;
+      if (x*x + y*y > radius*radius) {
+        m(i, j) = 0;
+      }
+    }
+  }
+  const std::unique_ptr<cm::details::SparseOperator> op =
+    cm::details::pressures_to_displacements_sparse(*p, *d, skin_attr, radius, 2);
+  BOOST_CHECK_LT(op->nonzero_blocks(), m.n_elem);
+  std::vector<double> x(m.n_cols);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1.0 + 0.1 * (i % 7);
+  }
+  const std::vector<double> expected =
+    arma::conv_to<std::vector<double>>::from(m * arma::colvec(x));
+  const std::vector<double> calc = op->apply(x);
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(alg_pressures_to_disps_convolution)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.01, 0.008));
+  std::vector<double> pressures(p->getRawValues().size());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    pressures[i] = 1e3 * (1.0 + 0.1 * (i % 11));
+  }
+  p->setRawValues(pressures);
+  typedef cm::AlgPressuresToDisplacements A_p_d;
+  A_p_d::params_type params_p_d;
+  params_p_d.skin_props = skin_attr;
+  boost::any pre_p_d = A_p_d().offline(*p, *d, params_p_d);
+  A_p_d().run(*p, *d, params_p_d, pre_p_d);
+  const std::vector<double> expected(d->getRawValues());
+
+  params_p_d.convolution = true;
+  pre_p_d = A_p_d().offline(*p, *d, params_p_d);
+  A_p_d().run(*p, *d, params_p_d, pre_p_d);
+  const std::vector<double> calc(d->getRawValues());
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-8);
+}
+
+// A pressure blob on a sensor-sized grid: the deconvolution errs near the borders, the refinement
+// steps bring it close to the pseudoinverse.
+BOOST_AUTO_TEST_CASE(deconvolution_matches_pinv)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    const double x = (p->cell(i).x - 0.011) / 0.002;
+    const double y = (p->cell(i).y - 0.009) / 0.003;
+    pressures[i] = 1e3 * std::exp(-(x*x + y*y));
+  }
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  const arma::colvec disps = m * arma::colvec(pressures);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(disps));
+  const arma::colvec expected = arma::pinv(m) * disps;
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  params.deconvolution = true;
+  for (const size_t steps : {0, 2, 4}) {
+    params.refinement_steps = steps;
+    boost::any pre = A_d_p().offline(*d, *p, params);
+    A_d_p().run(*d, *p, params, pre);
+    const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+    const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+    BOOST_TEST_MESSAGE("refinement steps: " << steps << ", relative error: " << error);
+    BOOST_CHECK_LT(error, 0.05 * std::pow(0.2, static_cast<double>(steps)));
+  }
+}
+
+// The sensors give about 12 bits: the rounding of the stored matrices to floats must stay far
+// below that, for the pseudoinverse as well.
+BOOST_AUTO_TEST_CASE(single_precision_within_bounds)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    const double x = (p->cell(i).x - 0.011) / 0.002;
+    const double y = (p->cell(i).y - 0.009) / 0.003;
+    pressures[i] = 1e3 * std::exp(-(x*x + y*y));
+  }
+  p->setRawValues(pressures);
+
+  typedef cm::AlgPressuresToDisplacements A_p_d;
+  A_p_d::params_type params_p_d;
+  params_p_d.skin_props = skin_attr;
+  boost::any pre = A_p_d().offline(*p, *d, params_p_d);
+  A_p_d().run(*p, *d, params_p_d, pre);
+  const arma::colvec expected_disps = arma::conv_to<arma::colvec>::from(d->getRawValues());
+  params_p_d.single_precision = true;
+  pre = A_p_d().offline(*p, *d, params_p_d);
+  A_p_d().run(*p, *d, params_p_d, pre);
+  const arma::colvec disps = arma::conv_to<arma::colvec>::from(d->getRawValues());
+  const double disps_error =
+    arma::norm(disps - expected_disps, 2) / arma::norm(expected_disps, 2);
+  BOOST_TEST_MESSAGE("displacements' relative error: " << disps_error);
+  BOOST_CHECK_LT(disps_error, 1e-5);
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params_d_p;
+  params_d_p.skin_props = skin_attr;
+  pre = A_d_p().offline(*d, *p, params_d_p);
+  A_d_p().run(*d, *p, params_d_p, pre);
+  const arma::colvec expected_press = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  params_d_p.single_precision = true;
+  pre = A_d_p().offline(*d, *p, params_d_p);
+  A_d_p().run(*d, *p, params_d_p, pre);
+  const arma::colvec press = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  const double press_error = arma::norm(press - expected_press, 2) / arma::norm(expected_press, 2);
+  BOOST_TEST_MESSAGE("pressures' relative error: " << press_error);
+  BOOST_CHECK_LT(press_error, 1e-4);
+
+  // recalibrated in single precision as well
+  A_d_p::params_type stiffer = params_d_p;
+  stiffer.skin_props.E *= 2;
+  pre = A_d_p().recalibrate(*d, *p, params_d_p, pre, stiffer);
+  A_d_p().run(*d, *p, stiffer, pre);
+  const arma::colvec stiffer_press = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  BOOST_CHECK_LT(arma::norm(stiffer_press - 2.0*expected_press, 2)
+    / arma::norm(2.0*expected_press, 2), 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_pressures_quantized)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    const double x = (p->cell(i).x - 0.011) / 0.002;
+    const double y = (p->cell(i).y - 0.009) / 0.003;
+    pressures[i] = 1e3 * std::exp(-(x*x + y*y));
+  }
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(m * arma::colvec(pressures)));
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  A_d_p().run(*d, *p, params, pre);
+  const arma::colvec expected = arma::conv_to<arma::colvec>::from(p->getRawValues());
+
+  params.quantized = true;
+  params.num_threads = 2;
+  pre = A_d_p().offline(*d, *p, params);
+  A_d_p().run(*d, *p, params, pre);
+  const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("relative error: " << error);
+  BOOST_CHECK_LT(error, 2e-4);
+}
+
+// Flags which contradict each other are rejected rather than some of them ignored
+BOOST_AUTO_TEST_CASE(alg_disps_to_pressures_conflicting_params)
+{
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type base;
+  base.skin_props = skin_attr;
+  std::vector<A_d_p::params_type> conflicting(7, base);
+  conflicting[0].iterative = true;
+  conflicting[0].coarse_to_fine = true;
+  conflicting[1].truncated_svd = true;
+  conflicting[1].quantized = true;
+  conflicting[2].iterative = true;
+  conflicting[2].tikhonov = true;
+  conflicting[3].cutoff_radius = 0.003;
+  conflicting[4].deconvolution = true;
+  conflicting[4].parametric = true;
+  conflicting[5].quantized = true;
+  conflicting[5].surrogate_sampled_tol = 1e-6;
+  conflicting[6].single_precision = true;
+  conflicting[6].surrogate_sampled_tol = 1e-6;
+  for (size_t i = 0; i < conflicting.size(); ++i) {
+    BOOST_CHECK_THROW(A_d_p().offline(*disps_grid, *press_grid, conflicting[i]),
+      std::runtime_error);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_nonnegative_pressures)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  typedef cm::AlgDisplacementsToNonnegativePressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  // a contact sliding over the grid: each frame starts from the previous one's solution
+  for (const double x0 : {0.006, 0.007, 0.008}) {
+    std::vector<double> pressures(p->num_cells());
+    for (size_t i = 0; i < pressures.size(); ++i) {
+      const double x = (p->cell(i).x - x0) / 0.003;
+      const double y = (p->cell(i).y - 0.008) / 0.004;
+      pressures[i] = 1e3 * std::max(0.0, 1 - x*x - y*y);
+    }
+    const arma::colvec expected(pressures);
+    d->setRawValues(arma::conv_to<std::vector<double>>::from(m * expected));
+    A_d_p().run(*d, *p, params, pre);
+    const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+    const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+    BOOST_TEST_MESSAGE("contact at " << x0 << ", relative error: " << error);
+    BOOST_CHECK_LT(error, 1e-4);
+  }
+
+  // recalibrated to a stiffer skin: the same displacements take twice the pressures
+  const std::vector<double> soft = p->getRawValues();
+  A_d_p::params_type stiffer = params;
+  stiffer.skin_props.E *= 2;
+  pre = A_d_p().recalibrate(*d, *p, params, pre, stiffer);
+  A_d_p().run(*d, *p, stiffer, pre);
+  std::vector<double> expected_stiffer(soft);
+  for (double& v : expected_stiffer) {
+    v *= 2;
+  }
+  const std::vector<double> calc_stiffer = p->getRawValues();
+  CHECK_CLOSE_COLLECTION(calc_stiffer, expected_stiffer, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_nonnegative_pressures_fista)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    const double x = (p->cell(i).x - 0.007) / 0.003;
+    const double y = (p->cell(i).y - 0.008) / 0.004;
+    pressures[i] = 1e3 * std::max(0.0, 1 - x*x - y*y);
+  }
+  const arma::colvec expected(pressures);
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(m * expected));
+
+  typedef cm::AlgDisplacementsToNonnegativePressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  params.num_threads = 2;
+  params.fista = true;
+  params.max_iterations = 50;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  // every frame of a still contact carries on from the previous one
+  double previous_error = 0;
+  for (size_t frame = 0; frame < 4; ++frame) {
+    A_d_p().run(*d, *p, params, pre);
+    const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+    const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+    BOOST_TEST_MESSAGE("frame " << frame << ", relative error: " << error);
+    if (frame > 0) {
+      BOOST_CHECK_LE(error, previous_error);
+    }
+    previous_error = error;
+  }
+  BOOST_CHECK_LT(previous_error, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_pressures_tikhonov)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.02, 0.02));
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    const double x = (p->cell(i).x - 0.011) / 0.002;
+    const double y = (p->cell(i).y - 0.009) / 0.003;
+    pressures[i] = 1e3 * std::exp(-(x*x + y*y));
+  }
+  const arma::colvec expected(pressures);
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(m * expected));
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  params.tikhonov = true;
+  params.regularisation = 1e-8;
+  params.num_threads = 2;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  A_d_p().run(*d, *p, params, pre);
+  const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("relative error: " << error);
+  BOOST_CHECK_LT(error, 1e-5);
+
+  // recalibrated to a stiffer skin: the same relative lambda, so just rescaled
+  A_d_p::params_type stiffer = params;
+  stiffer.skin_props.E *= 2;
+  pre = A_d_p().recalibrate(*d, *p, params, pre, stiffer);
+  A_d_p().run(*d, *p, stiffer, pre);
+  const arma::colvec recalibrated = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  const double recalibrated_error =
+    arma::norm(recalibrated - 2.0*expected, 2) / arma::norm(2.0*expected, 2);
+  BOOST_CHECK_LT(recalibrated_error, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_pressures_coarse_to_fine)
+{
+  // a contact on a few percent of the skin
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.032, 0.032));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.032, 0.032));
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    const double x = (p->cell(i).x - 0.006) / 0.002;
+    const double y = (p->cell(i).y - 0.007) / 0.002;
+    pressures[i] = 1e3 * std::max(0.0, 1 - x*x - y*y);
+  }
+  const arma::colvec expected(pressures);
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(m * expected));
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  params.coarse_to_fine = true;
+  params.regularisation = 1e-10;
+  params.num_threads = 2;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  A_d_p().run(*d, *p, params, pre);
+  const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  size_t solved = 0;
+  for (size_t i = 0; i < calc.n_elem; ++i) {
+    solved += (calc(i) != 0);
+  }
+  BOOST_TEST_MESSAGE("relative error: " << error << ", " << solved << " of " << calc.n_elem
+    << " cells solved for");
+  BOOST_CHECK_LT(error, 1e-3);
+  BOOST_CHECK_LT(solved, calc.n_elem / 4);
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_pressures_regions)
+{
+  // two halves of the skin, and a contact across their border
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.024, 0.012));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.024, 0.012));
+  std::vector<std::vector<cm::GridCell>> halves(2);
+  std::vector<double> pressures(p->num_cells());
+  for (size_t i = 0; i < pressures.size(); ++i) {
+    halves[p->cell(i).x < 0.012 ? 0 : 1].push_back(p->cell(i));
+    const double x = (p->cell(i).x - 0.011) / 0.003;
+    const double y = (p->cell(i).y - 0.006) / 0.003;
+    pressures[i] = 1e3 * std::exp(-(x*x + y*y));
+  }
+  const arma::colvec expected(pressures);
+  const arma::mat m = cm::details::pressures_to_displacements_matrix(*p, *d, skin_attr);
+  d->setRawValues(arma::conv_to<std::vector<double>>::from(m * expected));
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  params.tikhonov = true;
+  params.regularisation = 1e-8;
+  params.num_threads = 2;
+  params.regions = halves;
+  params.region_overlap = 5e-3;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  A_d_p().run(*d, *p, params, pre);
+  const arma::colvec calc = arma::conv_to<arma::colvec>::from(p->getRawValues());
+  const double error = arma::norm(calc - expected, 2) / arma::norm(expected, 2);
+  BOOST_TEST_MESSAGE("relative error: " << error);
+  // without the halos, the regions' pressures near the border are several times further off
+  BOOST_CHECK_LT(error, 2e-2);
+
+  // recalibrated to a stiffer skin: every region's inverse rescaled
+  A_d_p::params_type stiffer = params;
+  stiffer.skin_props.E *= 2;
+  pre = A_d_p().recalibrate(*d, *p, params, pre, stiffer);
+  A_d_p().run(*d, *p, stiffer, pre);
+  const std::vector<double> recalibrated = p->getRawValues();
+  const std::vector<double> doubled = arma::conv_to<std::vector<double>>::from(2.0 * calc);
+  CHECK_CLOSE_COLLECTION(recalibrated, doubled, 1e-6);
+
+  // a single region is the whole skin
+  A_d_p::params_type whole = params;
+  whole.regions.assign(1, std::vector<cm::GridCell>(p->cells_cbegin(), p->cells_cend()));
+  pre = A_d_p().offline(*d, *p, whole);
+  A_d_p().run(*d, *p, whole, pre);
+  const std::vector<double> single = p->getRawValues();
+  A_d_p::params_type plain = params;
+  plain.regions.clear();
+  pre = A_d_p().offline(*d, *p, plain);
+  A_d_p().run(*d, *p, plain, pre);
+  const std::vector<double> unsplit = p->getRawValues();
+  CHECK_CLOSE_COLLECTION(single, unsplit, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(alg_disps_to_pressures_truncated_svd)
+{
+  std::unique_ptr<cm::Grid> p(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::unique_ptr<cm::Grid> d(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.016, 0.016));
+  std::vector<double> disps(d->num_cells());
+  for (size_t i = 0; i < disps.size(); ++i) {
+    const double x = (d->cell(i).x - 0.009) / 0.003;
+    const double y = (d->cell(i).y - 0.007) / 0.004;
+    disps[i] = 1e-4 * std::exp(-(x*x + y*y));
+  }
+  d->setRawValues(disps);
+
+  typedef cm::AlgDisplacementsToPressures A_d_p;
+  A_d_p::params_type params;
+  params.skin_props = skin_attr;
+  boost::any pre = A_d_p().offline(*d, *p, params);
+  A_d_p().run(*d, *p, params, pre);
+  const std::vector<double> expected = p->getRawValues();
+
+  A_d_p::params_type svd_params = params;
+  svd_params.truncated_svd = true;
+  svd_params.num_threads = 2;
+  pre = A_d_p().offline(*d, *p, svd_params);
+  A_d_p().run(*d, *p, svd_params, pre);
+  const std::vector<double> calc = p->getRawValues();
+  CHECK_CLOSE_COLLECTION(calc, expected, 1e-4);
+
+  // retuned without decomposing again: as if computed offline with the new parameters (with few
+  // enough singular values dropped that it's by a full SVD as well)
+  A_d_p::params_type retuned = svd_params;
+  retuned.svd_rank = 250;
+  retuned.tikhonov = true;
+  retuned.regularisation = 1e-4;
+  retuned.skin_props.E *= 2;
+  pre = A_d_p().recalibrate(*d, *p, svd_params, pre, retuned);
+  A_d_p().run(*d, *p, retuned, pre);
+  const std::vector<double> calc_retuned = p->getRawValues();
+  pre = A_d_p().offline(*d, *p, retuned);
+  A_d_p().run(*d, *p, retuned, pre);
+  const std::vector<double> expected_retuned = p->getRawValues();
+  CHECK_CLOSE_COLLECTION(calc_retuned, expected_retuned, 1e-6);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
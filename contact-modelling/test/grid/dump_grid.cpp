@@ -52,6 +52,26 @@ BOOST_AUTO_TEST_CASE(dump_to_ss)
   CHECK_CLOSE_COLLECTION(result,expected, 0.1);
 };
 
+BOOST_AUTO_TEST_CASE(dump_reordered)
+{
+  MockGrid source;
+  source.cells.push_back({0.3, 0.4});
+  source.cells.push_back({0.1, 0.2});
+  source.cells.push_back({0.4, 0.1});
+  auto m = source.create(1, cm::Rectangle(0.002, 0.001));
+  m->setValue(0, 0, 1.23);
+  m->setValue(1, 0, 5.67);
+  m->setValue(2, 0, 8.9);
+  m->reorderCells(cm::CellOrder::hilbert);
+  std::stringstream ss;
+  cm::dumpForPlot(*m, ss);
+
+  // dumped in the order of construction all the same
+  std::vector<double> result(std::istream_iterator<double>(ss), {});
+  std::vector<double> expected({0.002,0.001,0.3,0.1,0.4,0.4,0.2,0.1,1.23,5.67,8.9});
+  CHECK_CLOSE_COLLECTION(result,expected, 0.1);
+};
+
 struct DumpToFile
 {
   boost::filesystem::path tmp;
@@ -1,6 +1,7 @@
 #include <boost/test/unit_test.hpp>
 #include "custom_test_macros.hpp"
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <array>
 #include <vector>
@@ -199,3 +200,126 @@ BOOST_AUTO_TEST_CASE(grid_fromFill_other)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+
+BOOST_AUTO_TEST_SUITE(grid_reordering)
+
+namespace {
+
+/**
+ * \brief   Average distance between the cells in windows of `window` consecutive cells
+ */
+double window_spread(const cm::Grid& g, const size_t window)
+{
+  double sum = 0;
+  size_t num = 0;
+  for (size_t w = 0; w + window <= g.num_cells(); w += window) {
+    for (size_t i = w; i < w + window; ++i) {
+      for (size_t j = i + 1; j < w + window; ++j) {
+        sum += std::hypot(g.cell(i).x - g.cell(j).x, g.cell(i).y - g.cell(j).y);
+        ++num;
+      }
+    }
+  }
+  return sum / num;
+}
+
+std::unique_ptr<cm::Grid> numbered_grid()
+{
+  std::unique_ptr<cm::Grid> g(cm::Grid::fromFill(2, cm::Square(1), 0, 0, 64, 64));
+  for (size_t i = 0; i < g->num_cells(); ++i) {
+    g->setValue(i, 0, g->cell(i).x);
+    g->setValue(i, 1, g->cell(i).y);
+  }
+  return g;
+}
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_CASE(values_follow_the_cells)
+{
+  for (const cm::CellOrder order : {cm::CellOrder::morton, cm::CellOrder::hilbert}) {
+    auto g = numbered_grid();
+    const std::vector<double> original = g->getRawValues();
+    g->setBadCells({3, 100, 4000});
+    std::vector<std::array<double, 2>> bad;
+    for (const size_t b : g->getBadCells()) {
+      bad.push_back({g->cell(b).x, g->cell(b).y});
+    }
+
+    g->reorderCells(order);
+    BOOST_REQUIRE_EQUAL(g->num_cells(), 64u*64u);
+    BOOST_REQUIRE_EQUAL(g->getPermutation().size(), g->num_cells());
+    for (size_t i = 0; i < g->num_cells(); ++i) {
+      BOOST_CHECK_EQUAL(g->getValue(i, 0), g->cell(i).x);
+      BOOST_CHECK_EQUAL(g->getValue(i, 1), g->cell(i).y);
+      BOOST_CHECK_EQUAL(original[2*g->getPermutation()[i]], g->cell(i).x);
+    }
+    std::vector<std::array<double, 2>> bad_after;
+    for (const size_t b : g->getBadCells()) {
+      bad_after.push_back({g->cell(b).x, g->cell(b).y});
+    }
+    std::sort(bad.begin(), bad.end());
+    std::sort(bad_after.begin(), bad_after.end());
+    BOOST_CHECK(bad == bad_after);
+
+    const std::vector<double> in_original_order = g->getRawValuesInOriginalOrder();
+    BOOST_CHECK(in_original_order == original);
+
+    std::vector<double> shifted(original);
+    for (double& v : shifted) {
+      v += 1;
+    }
+    g->setRawValuesInOriginalOrder(shifted);
+    for (size_t i = 0; i < g->num_cells(); ++i) {
+      BOOST_CHECK_EQUAL(g->getValue(i, 0), g->cell(i).x + 1);
+    }
+
+    g->reorderCells(cm::CellOrder::original);
+    BOOST_CHECK(g->getPermutation().empty());
+    const std::vector<double>& restored = g->getRawValues();
+    BOOST_CHECK(restored == shifted);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(reordered_twice)
+{
+  auto g = numbered_grid();
+  const std::vector<double> original = g->getRawValues();
+  g->reorderCells(cm::CellOrder::morton);
+  g->reorderCells(cm::CellOrder::hilbert);
+  const std::vector<double> in_original_order = g->getRawValuesInOriginalOrder();
+  BOOST_CHECK(in_original_order == original);
+
+  std::unique_ptr<cm::Grid> clone(cm::Grid::fromEmpty(2, cm::Square(1)));
+  clone->clone_structure(*g);
+  BOOST_CHECK(clone->getPermutation() == g->getPermutation());
+
+  // erasing the first cells of the original order leaves the others numbered from 0
+  std::vector<size_t> first;
+  for (size_t i = 0; i < g->num_cells(); ++i) {
+    if (g->getPermutation()[i] < 10) {
+      first.push_back(i);
+    }
+  }
+  g->erase(first);
+  const std::vector<double> after_erase = g->getRawValuesInOriginalOrder();
+  const std::vector<double> expected(original.begin() + 20, original.end());
+  BOOST_CHECK(after_erase == expected);
+}
+
+BOOST_AUTO_TEST_CASE(locality)
+{
+  auto g = numbered_grid();
+  const double x_major = window_spread(*g, 16);
+  g->reorderCells(cm::CellOrder::morton);
+  const double morton = window_spread(*g, 16);
+  g->reorderCells(cm::CellOrder::hilbert);
+  const double hilbert = window_spread(*g, 16);
+  BOOST_TEST_MESSAGE("Average distance within 16 cells: x-major " << x_major << ", Morton "
+    << morton << ", Hilbert " << hilbert);
+  // 16 consecutive cells are a 4x4 square along either curve, and a 1x16 column x-major
+  BOOST_CHECK_LT(morton, 0.5 * x_major);
+  BOOST_CHECK_LT(hilbert, 0.5 * x_major);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
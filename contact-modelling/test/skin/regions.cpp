@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+#include "custom_test_macros.hpp"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "cm/grid/cell_shapes.hpp"
+#include "cm/grid/grid.hpp"
+#include "cm/skin/regions.hpp"
+
+namespace {
+
+/**
+ * \brief   Six taxels of two types; region 0 has taxels 0-3, region 1 taxels 3-5
+ */
+const char* const cache =
+  "6 2\n"
+  "4 0 2 4 5\n"
+  "2 1 3\n"
+  "\n"
+  "3\n"
+  "0 2  0 1\n"
+  "2 4  0 0\n"
+  "0 0  1 2\n"
+  "\n"
+  "2 4\n"
+  "2 0 2\n"
+  "2 1 2\n"
+  "\n"
+  "Format:\n"
+  "sensors-count  sensor-types-count\n";
+
+} /* anonymous namespace */
+
+BOOST_AUTO_TEST_SUITE(skin__regions)
+
+BOOST_AUTO_TEST_CASE(read_cache)
+{
+  std::istringstream in(cache);
+  const cm::SkinRegions regions = cm::SkinRegions::fromCache(in);
+  BOOST_REQUIRE_EQUAL(regions.taxels.size(), 2u);
+  const std::vector<size_t> first = {0, 1, 2, 3};
+  const std::vector<size_t> second = {3, 4, 5};
+  BOOST_CHECK_EQUAL_COLLECTIONS(regions.taxels[0].begin(), regions.taxels[0].end(),
+    first.begin(), first.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(regions.taxels[1].begin(), regions.taxels[1].end(),
+    second.begin(), second.end());
+
+  // a sensor which isn't there, and a cache cut short
+  std::istringstream wrong_sensor("6 1\n2 0 6\n");
+  BOOST_CHECK_THROW(cm::SkinRegions::fromCache(wrong_sensor), std::runtime_error);
+  std::istringstream truncated(std::string(cache).substr(0, 40));
+  BOOST_CHECK_THROW(cm::SkinRegions::fromCache(truncated), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(positions_follow_the_taxels)
+{
+  std::istringstream in(cache);
+  const cm::SkinRegions regions = cm::SkinRegions::fromCache(in);
+  std::unique_ptr<cm::Grid> original(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.003,
+    0.002));
+  std::unique_ptr<cm::Grid> reordered(cm::Grid::fromEmpty(1, original->getCellShape()));
+  reordered->clone_structure(*original);
+  reordered->reorderCells(cm::CellOrder::hilbert);
+
+  for (const cm::Grid* g : {original.get(), reordered.get()}) {
+    const auto positions = regions.positions(*g);
+    BOOST_REQUIRE_EQUAL(positions.size(), 2u);
+    BOOST_REQUIRE_EQUAL(positions[1].size(), 3u);
+    for (size_t k = 0; k < 3; ++k) {
+      BOOST_CHECK_EQUAL(positions[1][k].x, original->cell(3 + k).x);
+      BOOST_CHECK_EQUAL(positions[1][k].y, original->cell(3 + k).y);
+    }
+  }
+  std::unique_ptr<cm::Grid> fewer(cm::Grid::fromFill(1, cm::Square(1e-3), 0, 0, 0.002, 0.002));
+  BOOST_CHECK_THROW(regions.positions(*fewer), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()